@@ -0,0 +1,676 @@
+/*
+	nbtbench.m
+
+	Throughput and allocation benchmark for JANBTSerialization. Each workload
+	is parsed and encoded with and without a schema, compressed and
+	uncompressed, and the results are written to stdout as JSON so runs can
+	be compared between releases. Build with the Release configuration;
+	Debug builds of the library are unoptimized.
+
+	Workloads are the NBT spec test files (or files named on the command
+	line) plus synthetic NBTs built to stress specific paths: large byte
+	arrays, deeply nested compounds, long lists of small compounds in the
+	style of TileEntities, a schematic of layered terrain, and a region’s
+	worth of entity-heavy chunks. Most tags in the chunks are small numbers,
+	so the allocation count of their schema-less parse case tracks how many
+	typed numbers are shared rather than allocated.
+	
+	Each workload is also encoded with every writing preset (compression
+	level, strategy, container and parallel compression), as the operation
+	"compress". These cases report the preset and the compressed size it
+	produced, so speed can be weighed against compression ratio.
+
+	For each case, the report has:
+		MBps			Uncompressed NBT bytes per second, even for compressed
+						cases, so that the cost of compression shows.
+		tagsPerSecond	Tags (including list elements) per second.
+		allocations		malloc calls per iteration, and allocatedBytes their
+						total size, on the default malloc zone.
+		peakRSS			Process high water mark after the case, in bytes.
+						Since this is process-wide, it only ever grows; run
+						with --filter to isolate a workload.
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import <JANBTSerialization/JANBTSerialization.h>
+#import "JANBTTagType.h"
+#import "JAZLibCompressor.h"
+#import "JAPrintf.h"
+#import <malloc/malloc.h>
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <sys/resource.h>
+#import <stdatomic.h>
+
+
+typedef struct
+{
+	uint64_t				count;
+	uint64_t				bytes;
+} AllocationCounts;
+
+
+static void PrintHelpAndExit(void) __attribute__((noreturn));
+
+static void InstallAllocationCounters(void);
+static AllocationCounts CurrentAllocationCounts(void);
+static uint64_t Nanoseconds(void);
+static uint64_t PeakRSS(void);
+
+static NSArray *SpecWorkloads(NSArray *paths);
+static NSArray *SyntheticWorkloads(void);
+static NSDictionary *SyntheticSchematic(void);
+static NSDictionary *SyntheticChunks(void);
+static NSDictionary *PrepareWorkload(NSString *name, NSData *uncompressed);
+static id InferSchema(id value);
+static NSArray *RunWorkload(NSDictionary *workload, double minimumTime);
+
+
+int main (int argc, const char * argv[])
+{
+	@autoreleasepool
+	{
+		double minimumTime = 1.0;
+		NSString *filter;
+		NSMutableArray *paths = [NSMutableArray array];
+
+		for (int argi = 1; argi < argc; argi++)
+		{
+			if (strcmp(argv[argi], "--time") == 0 && argi + 1 < argc)
+			{
+				minimumTime = atof(argv[++argi]);
+			}
+			else if (strcmp(argv[argi], "--filter") == 0 && argi + 1 < argc)
+			{
+				filter = @(argv[++argi]);
+			}
+			else if (strcasecmp(argv[argi], "--help") == 0 || strcmp(argv[argi], "-?") == 0 || argv[argi][0] == '-')
+			{
+				PrintHelpAndExit();
+			}
+			else
+			{
+				NSString *path = RealPathFromCString(argv[argi]);
+				if (path == nil)  Fatal(@"Failed to resolve input path \"%s\".\n", argv[argi]);
+				[paths addObject:path];
+			}
+		}
+
+		if (paths.count == 0)
+		{
+			NSString *dataDir = @NBTBENCH_DATA_DIR;
+			[paths addObject:[dataDir stringByAppendingPathComponent:@"test.nbt"]];
+			[paths addObject:[dataDir stringByAppendingPathComponent:@"bigtest.nbt"]];
+		}
+
+		NSArray *workloads = [SpecWorkloads(paths) arrayByAddingObjectsFromArray:SyntheticWorkloads()];
+		InstallAllocationCounters();
+
+		NSMutableArray *results = [NSMutableArray array];
+		for (NSDictionary *workload in workloads)
+		{
+			if (filter != nil && [workload[@"name"] rangeOfString:filter].location == NSNotFound)  continue;
+
+			EPrint(@"%@...\n", workload[@"name"]);
+			[results addObjectsFromArray:RunWorkload(workload, minimumTime)];
+		}
+
+		// ISO 8601 in UTC, so reports from different machines and locales compare.
+		NSDateFormatter *dateFormatter = [NSDateFormatter new];
+		dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+		dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+		dateFormatter.dateFormat = @"yyyy-MM-dd'T'HH:mm:ss'Z'";
+
+		NSDictionary *report = @{
+			@"benchmark": @"nbtbench",
+			@"version": @1,
+			@"date": [dateFormatter stringFromDate:[NSDate date]],
+			@"minimumTime": @(minimumTime),
+			@"results": results
+		};
+
+		NSError *error;
+		NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+		if (json == nil)  Fatal(@"Failed to generate report: %@\n", error);
+		fwrite(json.bytes, 1, json.length, stdout);
+		fputc('\n', stdout);
+	}
+
+	fflush(stdout);
+	return 0;
+}
+
+
+static void PrintHelpAndExit(void)
+{
+	Fatal(@"Usage: nbtbench [--time seconds] [--filter name] [file.nbt ...]\n"
+		   "Benchmarks reading and writing NBTs, and writes the results to stdout as JSON.\n"
+		   "  --time     Minimum time to spend on each case (default 1 second).\n"
+		   "  --filter   Only run workloads whose name contains the specified string.\n"
+		   "If no files are specified, the spec test files test.nbt and bigtest.nbt are used.\n"
+		   "Synthetic workloads are always included.\n");
+}
+
+
+static NSArray *SpecWorkloads(NSArray *paths)
+{
+	NSMutableArray *result = [NSMutableArray array];
+	for (NSString *path in paths)
+	{
+		NSError *error;
+		NSData *data = [NSData dataWithContentsOfFile:path options:0 error:&error];
+		if (data == nil)  Fatal(@"Failed to read %@: %@\n", path, error);
+
+		// Inputs may or may not be compressed; normalize them.
+		NSData *uncompressed = [JAZlibDecompressor inflateData:data mode:kJAZLibCompressionAutoDetect error:NULL] ?: data;
+		[result addObject:PrepareWorkload(path.lastPathComponent.stringByDeletingPathExtension, uncompressed)];
+	}
+	return result;
+}
+
+
+static NSArray *SyntheticWorkloads(void)
+{
+	uint32_t seed = 1;
+
+	// Large byte arrays: eight 4 MiB arrays of noisy, somewhat compressible data.
+	NSMutableDictionary *byteArrays = [NSMutableDictionary dictionary];
+	for (unsigned i = 0; i < 8; i++)
+	{
+		NSMutableData *data = [NSMutableData dataWithLength:4 << 20];
+		uint8_t *bytes = data.mutableBytes;
+		for (NSUInteger j = 0; j < data.length; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			bytes[j] = (seed >> 16) % 16;
+		}
+		byteArrays[[NSString stringWithFormat:@"Data%u", i]] = data;
+	}
+
+	// Deep compounds: 64 chains of compounds nested 256 deep.
+	NSMutableArray *chains = [NSMutableArray array];
+	for (unsigned i = 0; i < 64; i++)
+	{
+		NSDictionary *chain = @{ @"Leaf": @YES };
+		for (int32_t depth = 255; depth >= 0; depth--)
+		{
+			chain = @{ @"Depth": @(depth), @"Name": @"Branch", @"Child": chain };
+		}
+		[chains addObject:chain];
+	}
+
+	// TileEntities: 50 000 chests, each with a few items.
+	NSMutableArray *tileEntities = [NSMutableArray array];
+	for (int32_t i = 0; i < 50000; i++)
+	{
+		NSMutableArray *items = [NSMutableArray array];
+		for (int8_t slot = 0; slot < 3; slot++)
+		{
+			seed = seed * 1103515245 + 12345;
+			[items addObject:@{ @"id": @((int16_t)((seed >> 16) % 400)), @"Count": @((int8_t)(1 + (seed >> 8) % 64)), @"Slot": @(slot), @"Damage": @((int16_t)0) }];
+		}
+		[tileEntities addObject:@{ @"id": @"Chest", @"x": @(i % 512), @"y": @(i / 512 % 256), @"z": @(i / (512 * 256)), @"Items": items }];
+	}
+
+	NSDictionary *roots =
+	@{
+		@"synthetic-byte-arrays": byteArrays,
+		@"synthetic-deep-compounds": @{ @"Trees": chains },
+		@"synthetic-tile-entities": @{ @"TileEntities": tileEntities },
+		@"synthetic-schematic": SyntheticSchematic(),
+		@"synthetic-chunks": SyntheticChunks()
+	};
+
+	NSMutableArray *result = [NSMutableArray array];
+	for (NSString *name in [roots.allKeys sortedArrayUsingSelector:@selector(compare:)])
+	{
+		NSError *error;
+		NSData *data = [JANBTSerialization dataWithNBTObject:roots[name] rootName:@"" options:JANBTWritingOptionsUncompressed schema:nil error:&error];
+		if (data == nil)  Fatal(@"Failed to generate %@: %@\n", name, error);
+		[result addObject:PrepareWorkload(name, data)];
+	}
+	return result;
+}
+
+
+// Stone, then dirt and grass, then air, with scattered ores; roughly what a cut of terrain looks like.
+static NSDictionary *SyntheticSchematic(void)
+{
+	const NSUInteger width = 256, height = 128, length = 256, volume = width * height * length;
+	NSMutableData *blocks = [NSMutableData dataWithLength:volume];
+	NSMutableData *data = [NSMutableData dataWithLength:volume];
+	uint8_t *blockBytes = blocks.mutableBytes, *dataBytes = data.mutableBytes;
+
+	uint32_t seed = 1;
+	for (NSUInteger i = 0; i < volume; i++)
+	{
+		NSUInteger y = i / (width * length);
+		seed = seed * 1103515245 + 12345;
+		uint8_t block = (y < 60) ? 1 : (y < 64) ? 3 : (y == 64) ? 2 : 0;
+		if (block == 1 && (seed >> 16) % 50 == 0)  block = 14 + (seed >> 8) % 3;
+		blockBytes[i] = block;
+		dataBytes[i] = (block != 0 && (seed >> 20) % 4 == 0) ? (seed >> 24) % 16 : 0;
+	}
+
+	return @{ @"Width": @(int16_t)width, @"Height": @(int16_t)height, @"Length": @(int16_t)length,
+			  @"Materials": @"Alpha", @"Blocks": blocks, @"Data": data,
+			  @"Entities": @[], @"TileEntities": @[] };
+}
+
+
+// 1024 chunks shaped like Anvil chunks, each with a few sections, 40 sheep and 60 chests.
+static NSDictionary *SyntheticChunks(void)
+{
+	NSMutableArray *chunks = [NSMutableArray array];
+	for (int32_t c = 0; c < 1024; c++)
+	{
+		NSMutableArray *sections = [NSMutableArray array];
+		for (int8_t y = 0; y < 4; y++)
+		{
+			[sections addObject:@{ @"Y": @(y), @"Blocks": [NSMutableData dataWithLength:4096], @"Data": [NSMutableData dataWithLength:2048] }];
+		}
+
+		NSMutableArray *entities = [NSMutableArray array];
+		for (int i = 0; i < 40; i++)
+		{
+			[entities addObject:@{ @"id": @"Sheep", @"Pos": @[ @(i * 0.37 + 100.5), @64.0, @(i * 1.13 - 200.5) ], @"Motion": @[ @0.0, @(-0.0784), @0.0 ],
+								   @"Rotation": @[ @((float)i * 3.1f), @0.0f ], @"Health": @((int16_t)8), @"Air": @((int16_t)300), @"Fire": @((int16_t)-1),
+								   @"FallDistance": @0.0f, @"OnGround": @((int8_t)1), @"Color": @((int8_t)(i % 16)), @"Sheared": @((int8_t)0) }];
+		}
+
+		NSMutableArray *tileEntities = [NSMutableArray array];
+		for (int32_t i = 0; i < 60; i++)
+		{
+			[tileEntities addObject:@{ @"id": @"Chest", @"x": @(c % 32 * 16 + i % 16), @"y": @(i + 10), @"z": @(c / 32 * 16 + i / 4),
+									   @"Items": @[ @{ @"id": @((int16_t)4), @"Damage": @((int16_t)0), @"Count": @((int8_t)64), @"Slot": @((int8_t)(i % 27)) } ] }];
+		}
+
+		[chunks addObject:@{ @"Level": @{ @"xPos": @(c % 32), @"zPos": @(c / 32), @"LastUpdate": @((int64_t)1234567890123), @"TerrainPopulated": @((int8_t)1),
+										  @"Sections": sections, @"Entities": entities, @"TileEntities": tileEntities } }];
+	}
+
+	return @{ @"Chunks": chunks };
+}
+
+
+/*
+	Everything the cases need that isn’t being measured: the compressed
+	form, tag count, a schema, and objects to encode. The objects to encode
+	are read back from the data, so that without a schema they carry their
+	NBT types as they would in real use.
+*/
+static NSDictionary *PrepareWorkload(NSString *name, NSData *uncompressed)
+{
+	NSError *error;
+	JANBTValidationSummary summary;
+	NSString *rootName;
+	if (![JANBTSerialization validateNBTData:uncompressed rootName:&rootName options:JANBTReadingOptionsUncompressed schema:nil summary:&summary error:&error])
+	{
+		Fatal(@"%@ is not a valid NBT: %@\n", name, error);
+	}
+
+	NSUInteger tagCount = 0;
+	for (unsigned i = 0; i < sizeof summary.tagCounts / sizeof *summary.tagCounts; i++)  tagCount += summary.tagCounts[i];
+
+	NSData *compressed = [JANBTSerialization dataWithNBTObject:[JANBTSerialization NBTObjectWithData:uncompressed rootName:NULL options:JANBTReadingOptionsUncompressed schema:nil error:NULL]
+													  rootName:rootName
+													   options:0
+														schema:nil
+														 error:&error];
+	if (compressed == nil)  Fatal(@"Failed to compress %@: %@\n", name, error);
+
+	id typedRoot = [JANBTSerialization NBTObjectWithData:uncompressed rootName:NULL options:JANBTReadingOptionsUncompressed schema:nil error:&error];
+	id schema = InferSchema(typedRoot);
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaWithPropertyList:schema error:&error];
+	if (compiledSchema == nil)  Fatal(@"Failed to build schema for %@: %@\n", name, error);
+	id plainRoot = [JANBTSerialization NBTObjectWithData:uncompressed rootName:NULL options:JANBTReadingOptionsUncompressed schema:compiledSchema error:&error];
+	if (plainRoot == nil)  Fatal(@"Failed to read %@ with inferred schema: %@\n", name, error);
+
+	return @{
+		@"name": name,
+		@"rootName": rootName,
+		@"uncompressed": uncompressed,
+		@"compressed": compressed,
+		@"tagCount": @(tagCount),
+		@"schema": compiledSchema,
+		@"typedRoot": typedRoot,
+		@"plainRoot": plainRoot
+	};
+}
+
+
+static NSString *SchemaNameForTagType(JANBTTagType type)
+{
+	switch (type)
+	{
+		case kJANBTTagByte:			return @"byte";
+		case kJANBTTagShort:		return @"short";
+		case kJANBTTagInt:			return @"int";
+		case kJANBTTagLong:			return @"long";
+		case kJANBTTagFloat:		return @"float";
+		case kJANBTTagDouble:		return @"double";
+		case kJANBTTagByteArray:	return @"data";
+		case kJANBTTagString:		return @"string";
+		case kJANBTTagIntArray:		return @"intarray";
+		case kJANBTTagLongArray:	return @"longarray";
+
+		case kJANBTTagList:
+		case kJANBTTagCompound:
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			break;
+	}
+	return nil;
+}
+
+
+// Merge two inferred schemata, keeping only what they agree on.
+static id MergeSchemata(id a, id b)
+{
+	if (a == nil || b == nil)  return a ?: b;
+
+	if ([a isKindOfClass:[NSDictionary class]] && [b isKindOfClass:[NSDictionary class]])
+	{
+		NSMutableDictionary *result = [a mutableCopy];
+		[b enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop)
+		{
+			id merged = MergeSchemata(result[key], value);
+			if (merged != nil)  result[key] = merged;
+			else  [result removeObjectForKey:key];
+		}];
+		return result;
+	}
+
+	if ([a isKindOfClass:[NSArray class]] && [b isKindOfClass:[NSArray class]])
+	{
+		id element = MergeSchemata([a firstObject], [b firstObject]);
+		return (element != nil) ? @[ element ] : nil;
+	}
+
+	return [a isEqual:b] ? a : nil;
+}
+
+
+/*
+	Build a schema matching a property list read without one. Members whose
+	types can’t be determined, such as empty lists, are left out, which is
+	allowed.
+*/
+static id InferSchema(id value)
+{
+	switch ([value ja_NBTType])
+	{
+		case kJANBTTagCompound:
+		{
+			NSMutableDictionary *result = [NSMutableDictionary dictionary];
+			[value enumerateKeysAndObjectsUsingBlock:^(id key, id member, BOOL *stop)
+			{
+				id memberSchema = InferSchema(member);
+				if (memberSchema != nil)  result[key] = memberSchema;
+			}];
+			return result;
+		}
+
+		case kJANBTTagList:
+		{
+			id element;
+			for (id member in value)
+			{
+				id memberSchema = InferSchema(member);
+				if (memberSchema == nil)  return nil;
+				element = (element == nil) ? memberSchema : MergeSchemata(element, memberSchema);
+				if (element == nil)  return nil;
+			}
+			return (element != nil) ? @[ element ] : nil;
+		}
+
+		default:
+			return SchemaNameForTagType([value ja_NBTType]);
+	}
+}
+
+
+static NSDictionary *MeasureCase(NSDictionary *workload, NSString *operation, BOOL compressed, BOOL withSchema, double minimumTime, BOOL (^body)(void))
+{
+	// Warm up, and make sure the case works at all.
+	@autoreleasepool
+	{
+		if (!body())  Fatal(@"%@ %@ failed.\n", workload[@"name"], operation);
+	}
+
+	NSUInteger iterations = 0;
+	uint64_t elapsed = 0;
+	AllocationCounts before = CurrentAllocationCounts();
+
+	// At least three iterations, so one slow run doesn’t dominate.
+	while (iterations < 3 || elapsed < minimumTime * 1e9)
+	{
+		uint64_t start = Nanoseconds();
+		@autoreleasepool
+		{
+			body();
+		}
+		elapsed += Nanoseconds() - start;
+		iterations++;
+	}
+
+	AllocationCounts after = CurrentAllocationCounts();
+	double seconds = elapsed / 1e9;
+	NSUInteger length = [workload[@"uncompressed"] length];
+
+	return @{
+		@"workload": workload[@"name"],
+		@"operation": operation,
+		@"compressed": @(compressed),
+		@"schema": @(withSchema),
+		@"bytes": @(length),
+		@"compressedBytes": @([workload[@"compressed"] length]),
+		@"tags": workload[@"tagCount"],
+		@"iterations": @(iterations),
+		@"seconds": @(seconds),
+		@"MBps": @(length * iterations / seconds / 1e6),
+		@"tagsPerSecond": @([workload[@"tagCount"] doubleValue] * iterations / seconds),
+		@"allocations": @((after.count - before.count) / iterations),
+		@"allocatedBytes": @((after.bytes - before.bytes) / iterations),
+		@"peakRSS": @(PeakRSS())
+	};
+}
+
+
+static NSArray *RunWorkload(NSDictionary *workload, double minimumTime)
+{
+	NSMutableArray *results = [NSMutableArray array];
+	NSString *rootName = workload[@"rootName"];
+
+	for (int compressed = 1; compressed >= 0; compressed--)
+	{
+		for (int withSchema = 0; withSchema <= 1; withSchema++)
+		{
+			NSData *data = compressed ? workload[@"compressed"] : workload[@"uncompressed"];
+			JANBTCompiledSchema *schema = withSchema ? workload[@"schema"] : nil;
+			id root = withSchema ? workload[@"plainRoot"] : workload[@"typedRoot"];
+			JANBTReadingOptions readingOptions = compressed ? 0 : JANBTReadingOptionsUncompressed;
+			JANBTWritingOptions writingOptions = compressed ? 0 : JANBTWritingOptionsUncompressed;
+
+			[results addObject:MeasureCase(workload, @"parse", compressed, withSchema, minimumTime, ^{
+				return (BOOL)([JANBTSerialization NBTObjectWithData:data rootName:NULL options:readingOptions schema:schema error:NULL] != nil);
+			})];
+
+			[results addObject:MeasureCase(workload, @"encode", compressed, withSchema, minimumTime, ^{
+				return (BOOL)([JANBTSerialization dataWithNBTObject:root rootName:rootName options:writingOptions schema:schema error:NULL] != nil);
+			})];
+		}
+	}
+
+	NSArray *presets = @[
+		@[ @"default", @0 ],
+		@[ @"level 1", @(JANBTWritingOptionsCompressionLevel(1)) ],
+		@[ @"fast", @(JANBTWritingOptionsFastPreset) ],
+		@[ @"filtered", @(JANBTWritingOptionsFilteredStrategy) ],
+		@[ @"RLE", @(JANBTWritingOptionsRLEStrategy) ],
+		@[ @"smallest", @(JANBTWritingOptionsSmallestPreset) ],
+		@[ @"zlib container", @(JANBTWritingOptionsZLibContainer) ],
+		@[ @"parallel", @(JANBTWritingOptionsParallelCompression) ],
+		@[ @"parallel, fast", @(JANBTWritingOptionsParallelCompression | JANBTWritingOptionsFastPreset) ]
+	];
+
+	id root = workload[@"typedRoot"];
+	for (NSArray *preset in presets)
+	{
+		JANBTWritingOptions options = [preset[1] integerValue];
+
+		// Compress once outside the measurement, for the size and to check that it round-trips.
+		NSError *error;
+		NSData *data = [JANBTSerialization dataWithNBTObject:root rootName:rootName options:options schema:nil error:&error];
+		if (data == nil)  Fatal(@"%@ compress (%@) failed: %@\n", workload[@"name"], preset[0], error);
+		if (![[JANBTSerialization NBTObjectWithData:data rootName:NULL options:0 schema:nil error:NULL] isEqual:root])
+		{
+			Fatal(@"%@ compress (%@) did not round-trip.\n", workload[@"name"], preset[0]);
+		}
+
+		NSMutableDictionary *result = [MeasureCase(workload, @"compress", YES, NO, minimumTime, ^{
+			return (BOOL)([JANBTSerialization dataWithNBTObject:root rootName:rootName options:options schema:nil error:NULL] != nil);
+		}) mutableCopy];
+		result[@"preset"] = preset[0];
+		result[@"compressedBytes"] = @(data.length);
+		[results addObject:result];
+	}
+
+	return results;
+}
+
+
+/*
+	Allocation counting: the default malloc zone’s entry points are wrapped
+	with counters. malloc() and friends, Foundation and CoreFoundation all
+	allocate through it, so this sees everything the codec allocates.
+*/
+static malloc_zone_t		*sCountedZone;
+static void *(*sZoneMalloc)(malloc_zone_t *zone, size_t size);
+static void *(*sZoneCalloc)(malloc_zone_t *zone, size_t count, size_t size);
+static void *(*sZoneRealloc)(malloc_zone_t *zone, void *ptr, size_t size);
+static void *(*sZoneMemalign)(malloc_zone_t *zone, size_t alignment, size_t size);
+static atomic_uint_fast64_t	sAllocationCount;
+static atomic_uint_fast64_t	sAllocatedBytes;
+
+
+static inline void CountAllocation(size_t size)
+{
+	atomic_fetch_add_explicit(&sAllocationCount, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&sAllocatedBytes, size, memory_order_relaxed);
+}
+
+
+static void *CountingMalloc(malloc_zone_t *zone, size_t size)
+{
+	CountAllocation(size);
+	return sZoneMalloc(zone, size);
+}
+
+
+static void *CountingCalloc(malloc_zone_t *zone, size_t count, size_t size)
+{
+	CountAllocation(count * size);
+	return sZoneCalloc(zone, count, size);
+}
+
+
+static void *CountingRealloc(malloc_zone_t *zone, void *ptr, size_t size)
+{
+	CountAllocation(size);
+	return sZoneRealloc(zone, ptr, size);
+}
+
+
+static void *CountingMemalign(malloc_zone_t *zone, size_t alignment, size_t size)
+{
+	CountAllocation(size);
+	return sZoneMemalign(zone, alignment, size);
+}
+
+
+static void InstallAllocationCounters(void)
+{
+	// malloc() uses the first registered zone, which isn’t necessarily what malloc_default_zone() returns.
+	vm_address_t *zones;
+	unsigned zoneCount;
+	if (malloc_get_all_zones(mach_task_self(), NULL, &zones, &zoneCount) != KERN_SUCCESS || zoneCount == 0)
+	{
+		EPrint(@"Warning: could not find default malloc zone; allocations will not be counted.\n");
+		return;
+	}
+	sCountedZone = (malloc_zone_t *)zones[0];
+
+	// Zones are write-protected after setup.
+	vm_size_t pageSize = (vm_size_t)getpagesize();
+	vm_address_t page = (vm_address_t)sCountedZone & ~(pageSize - 1);
+	if (vm_protect(mach_task_self(), page, pageSize, FALSE, VM_PROT_READ | VM_PROT_WRITE) != KERN_SUCCESS)
+	{
+		EPrint(@"Warning: could not unprotect default malloc zone; allocations will not be counted.\n");
+		return;
+	}
+
+	sZoneMalloc = sCountedZone->malloc;
+	sZoneCalloc = sCountedZone->calloc;
+	sZoneRealloc = sCountedZone->realloc;
+	sCountedZone->malloc = CountingMalloc;
+	sCountedZone->calloc = CountingCalloc;
+	sCountedZone->realloc = CountingRealloc;
+	if (sCountedZone->version >= 5 && sCountedZone->memalign != NULL)
+	{
+		sZoneMemalign = sCountedZone->memalign;
+		sCountedZone->memalign = CountingMemalign;
+	}
+
+	vm_protect(mach_task_self(), page, pageSize, FALSE, VM_PROT_READ);
+}
+
+
+static AllocationCounts CurrentAllocationCounts(void)
+{
+	return (AllocationCounts)
+	{
+		.count = atomic_load_explicit(&sAllocationCount, memory_order_relaxed),
+		.bytes = atomic_load_explicit(&sAllocatedBytes, memory_order_relaxed)
+	};
+}
+
+
+static uint64_t Nanoseconds(void)
+{
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)  mach_timebase_info(&timebase);
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+}
+
+
+static uint64_t PeakRSS(void)
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)  return 0;
+	return (uint64_t)usage.ru_maxrss;	// Bytes on Mac OS X, unlike Linux.
+}
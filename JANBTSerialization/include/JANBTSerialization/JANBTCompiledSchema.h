@@ -0,0 +1,50 @@
+/*
+	JANBTCompiledSchema.h
+
+	A schema property list (see JANBTSerialization.h) preprocessed for use by
+	the parser and encoder. Compound members are looked up by their UTF-8
+	bytes, so reading doesn’t need to create key strings to find their types,
+	and type names are resolved to tag types up front.
+
+	Compiled schemata are immutable and may be shared between threads. The
+	JANBTSerialization methods accept either a compiled schema or a property
+	list; in the latter case, the property list is compiled the first time
+	it is used and the result is cached, so property list schemata must not
+	be mutated after use.
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+
+@interface JANBTCompiledSchema: NSObject
+
+/*	Fails with kJANBTSerializationInvalidSchemaError if the property list
+	contains anything other than dictionaries, single-element arrays and
+	known type names.
+*/
++ (instancetype) compiledSchemaWithPropertyList:(id)propertyList error:(NSError **)outError;
+
+@property (readonly) id propertyList;
+
+@end
@@ -0,0 +1,185 @@
+/*
+	JANBTDocument.h
+	
+	A flat, read-only representation of an NBT for bulk analysis, where
+	Foundation objects aren’t needed. Parsing walks the NBT once and records
+	each tag as a fixed-size entry in a single array, the tape, in document
+	order. Names, strings and arrays stay in the uncompressed buffer and are
+	referred to by offset; nothing else is allocated.
+	
+	A document can be reused. Each parse replaces the previous contents but
+	keeps the tape and inflate state, so scanning the chunks of a region
+	with one document costs a single allocation per chunk, for the inflated
+	data, once the tape has grown to fit the largest chunk. Like
+	JANBTReadingContext, a document may only be used by one thread at a
+	time.
+	
+	The whole NBT is checked as it is parsed, with the same errors as
+	+[JANBTSerialization validateNBTData:…], so the accessors below don’t
+	fail. Their arguments are only checked with assertions; indices must
+	come from the current parse.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTSerialization.h"
+
+
+typedef uint32_t JANBTTapeIndex;
+
+enum
+{
+	kJANBTTapeNotFound			= UINT32_MAX
+};
+
+
+// NBT tag IDs, as found in JANBTTapeEntry.type and .elementType.
+enum
+{
+	kJANBTTapeTagByte			= 1,
+	kJANBTTapeTagShort			= 2,
+	kJANBTTapeTagInt			= 3,
+	kJANBTTapeTagLong			= 4,
+	kJANBTTapeTagFloat			= 5,
+	kJANBTTapeTagDouble			= 6,
+	kJANBTTapeTagByteArray		= 7,
+	kJANBTTapeTagString			= 8,
+	kJANBTTapeTagList			= 9,
+	kJANBTTapeTagCompound		= 10,
+	kJANBTTapeTagIntArray		= 11,
+	kJANBTTapeTagLongArray		= 12
+};
+
+
+/*
+	One tag. The root is entry 0, and the members of a compound or elements
+	of a list follow it directly, each followed in turn by its own subtree.
+	Offsets are from the start of the uncompressed NBT.
+*/
+typedef struct JANBTTapeEntry
+{
+	uint8_t					type;			// A kJANBTTapeTag… ID.
+	uint8_t					elementType;	// Lists only.
+	uint16_t				nameLength;
+	uint32_t				nameOffset;		// 0 for list elements, which have no name.
+	uint32_t				payloadOffset;	// The value, after any length prefix.
+	uint32_t				count;			// Members, elements, or bytes of a string; 0 for numbers.
+	JANBTTapeIndex			next;			// The entry after this one’s subtree.
+} JANBTTapeEntry;
+
+
+typedef struct JANBTTape
+{
+	const JANBTTapeEntry	*entries;
+	const uint8_t			*bytes;			// The uncompressed NBT.
+	JANBTTapeIndex			count;			// 0 for an empty fragment.
+} JANBTTape;
+
+
+@interface JANBTDocument: NSObject
+
+/*
+	Parse an NBT, replacing the current contents. Of options, only
+	JANBTReadingOptionsUncompressed and JANBTReadingOptionsAllowFragments
+	are used. Uncompressed data is referenced, not copied, and must not be
+	mutated. On failure, the document is empty.
+*/
+- (BOOL) parseData:(NSData *)data options:(JANBTReadingOptions)options error:(NSError **)outError;
+
+// Valid until the next parse, or until the document is deallocated.
+@property (readonly) JANBTTape tape;
+
+@property (readonly) NSString *rootName;
+
+/*
+	Convert the subtree at index to a property list, like the result of
+	+[JANBTSerialization NBTObjectWithData:…] without a schema. Of options,
+	only JANBTReadingOptionsMutableContainers and
+	JANBTReadingOptionsMutableLeaves are used. Byte arrays refer to the
+	document’s buffer rather than copying it, unless they’re mutable.
+*/
+- (id) objectAtIndex:(JANBTTapeIndex)index options:(JANBTReadingOptions)options;
+
+@end
+
+
+static inline uint8_t JANBTTapeType(JANBTTape tape, JANBTTapeIndex index)
+{
+	return tape.entries[index].type;
+}
+
+
+static inline uint32_t JANBTTapeCount(JANBTTape tape, JANBTTapeIndex index)
+{
+	return tape.entries[index].count;
+}
+
+
+static inline JANBTStringRef JANBTTapeName(JANBTTape tape, JANBTTapeIndex index)
+{
+	const JANBTTapeEntry *entry = &tape.entries[index];
+	if (entry->nameOffset == 0)  return (JANBTStringRef){ NULL, 0 };
+	return (JANBTStringRef){ (const char *)tape.bytes + entry->nameOffset, entry->nameLength };
+}
+
+
+// The first member or element of a compound or list, or kJANBTTapeNotFound if it’s empty or something else.
+static inline JANBTTapeIndex JANBTTapeFirstChild(JANBTTape tape, JANBTTapeIndex index)
+{
+	const JANBTTapeEntry *entry = &tape.entries[index];
+	BOOL isContainer = (entry->type == kJANBTTapeTagList || entry->type == kJANBTTapeTagCompound);
+	if (!isContainer || entry->count == 0)  return kJANBTTapeNotFound;
+	return index + 1;
+}
+
+
+// The entry after index’s subtree. Only a sibling if index isn’t the last member or element of its parent.
+static inline JANBTTapeIndex JANBTTapeNext(JANBTTape tape, JANBTTapeIndex index)
+{
+	return tape.entries[index].next;
+}
+
+
+// Linear search of a compound’s members. Returns kJANBTTapeNotFound if there’s no such member.
+JANBTTapeIndex JANBTTapeMemberNamed(JANBTTape tape, JANBTTapeIndex compound, const char *name);
+
+// Constant time for lists of numbers, strings and arrays; linear for lists of lists and compounds.
+JANBTTapeIndex JANBTTapeElementAtIndex(JANBTTape tape, JANBTTapeIndex list, uint32_t elementIndex);
+
+/*
+	Typed reads. The number accessors accept any numerical tag, converting
+	as C would, and return 0 for anything else. String contents are
+	valid UTF-8, but not terminated.
+*/
+int64_t JANBTTapeIntegerValue(JANBTTape tape, JANBTTapeIndex index);
+double JANBTTapeDoubleValue(JANBTTape tape, JANBTTapeIndex index);
+JANBTStringRef JANBTTapeStringValue(JANBTTape tape, JANBTTapeIndex index);
+
+// The contents of a byte array, as stored.
+const uint8_t *JANBTTapeByteArrayBytes(JANBTTape tape, JANBTTapeIndex index);
+
+/*
+	Copy up to maxCount elements of an int or long array into values, in
+	host byte order. Returns the number copied.
+*/
+uint32_t JANBTTapeCopyIntArray(JANBTTape tape, JANBTTapeIndex index, int32_t *values, uint32_t maxCount);
+uint32_t JANBTTapeCopyLongArray(JANBTTape tape, JANBTTapeIndex index, int64_t *values, uint32_t maxCount);
@@ -0,0 +1,63 @@
+/*
+	JANBTPackedArrays.h
+	
+	Immutable NSArrays of integers backed by a single contiguous buffer, used
+	to represent TAG_Int_Array and TAG_Long_Array. The values can be accessed
+	directly, in host byte order, through the values property; as NSArrays,
+	they produce NSNumbers on demand.
+	
+	When reading NBT, int and long arrays are returned as these classes unless
+	JANBTReadingOptionsMutableContainers is specified. When writing, they are
+	encoded with a single byte-swapping pass over the buffer. Plain NSArrays
+	of NSNumbers can still be written as int arrays using the "intarray" and
+	"longarray" schema types.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+
+@interface JANBTIntArray: NSArray
+
+// Copies values.
+- (id) initWithValues:(const int32_t *)values count:(NSUInteger)count;
+
+// Takes ownership of values, which must have been allocated with malloc() if freeWhenDone is YES.
+- (id) initWithValuesNoCopy:(int32_t *)values count:(NSUInteger)count freeWhenDone:(BOOL)freeWhenDone;
+
+@property (readonly) const int32_t *values NS_RETURNS_INNER_POINTER;
+
+@end
+
+
+@interface JANBTLongArray: NSArray
+
+// Copies values.
+- (id) initWithValues:(const int64_t *)values count:(NSUInteger)count;
+
+// Takes ownership of values, which must have been allocated with malloc() if freeWhenDone is YES.
+- (id) initWithValuesNoCopy:(int64_t *)values count:(NSUInteger)count freeWhenDone:(BOOL)freeWhenDone;
+
+@property (readonly) const int64_t *values NS_RETURNS_INNER_POINTER;
+
+@end
@@ -0,0 +1,80 @@
+/*
+	JANBTPushParser.h
+
+	Incremental NBT reading. Where +[JANBTSerialization NBTObjectWithStream:…]
+	pulls from a stream and blocks until it has what it needs, a push parser
+	is handed input as it becomes available, in pieces of any size, and
+	keeps its place between calls. This lets reading, inflating and parsing
+	be overlapped, for instance with dispatch_io, using bounded buffers.
+
+	Unless JANBTReadingOptionsUncompressed is specified, input is inflated
+	as it arrives. The result is the same property list, or the same
+	sequence of delegate calls, as the corresponding JANBTSerialization
+	method produces. Key path projection and lazy containers are not
+	supported.
+
+	A push parser reads a single NBT and is not thread safe.
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTSerialization.h"
+
+
+typedef NS_ENUM(NSInteger, JANBTPushParserStatus)
+{
+	JANBTPushParserNeedsMoreData,
+	JANBTPushParserDone,
+	JANBTPushParserFailed
+};
+
+
+@interface JANBTPushParser: NSObject
+
+// Build a property list, as +NBTObjectWithData:…. Returns nil if schema is invalid.
+- (id) initWithOptions:(JANBTReadingOptions)options schema:(id)schema error:(NSError **)outError;
+
+// Report tags to delegate, as +readNBTData:…. The delegate is retained until parsing ends.
+- (id) initWithOptions:(JANBTReadingOptions)options delegate:(id<JANBTReaderDelegate>)delegate;
+
+/*
+	Parse as much as possible of the input so far. The bytes are not
+	referenced after the call returns. Input after the end of the NBT is
+	ignored, and once the status is Done or Failed, feeding has no effect.
+*/
+- (JANBTPushParserStatus) feedBytes:(const void *)bytes length:(NSUInteger)length;
+- (JANBTPushParserStatus) feedData:(NSData *)data;
+- (JANBTPushParserStatus) feedDispatchData:(dispatch_data_t)data;
+
+// Signal the end of input. If the NBT is incomplete, this fails with a read error.
+- (JANBTPushParserStatus) finish;
+
+@property (readonly) JANBTPushParserStatus status;
+
+// Valid once status is Done; root is always nil in delegate mode.
+@property (readonly) id root;
+@property (readonly) NSString *rootName;
+
+// Valid once status is Failed.
+@property (readonly) NSError *error;
+
+@end
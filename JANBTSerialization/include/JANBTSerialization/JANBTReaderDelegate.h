@@ -0,0 +1,85 @@
+/*
+	JANBTReaderDelegate.h
+
+	Event-driven (SAX-style) NBT reading. Instead of building a property list,
+	+[JANBTSerialization readNBTData:options:delegate:error:] walks the NBT
+	and reports each tag to a delegate as it is encountered.
+
+	Names, strings and arrays are passed as borrowed pointers which are only
+	valid for the duration of the callback. No objects are created per tag,
+	so large NBTs can be scanned in constant memory.
+
+	All delegate methods are optional; tags whose callbacks aren’t
+	implemented are skipped. Elements of lists are reported with a null name
+	(name.bytes == NULL).
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+
+// A borrowed, non-terminated UTF-8 string.
+typedef struct JANBTStringRef
+{
+	const char				*bytes;
+	NSUInteger				length;
+} JANBTStringRef;
+
+
+// ref may contain NULs, which valid UTF-8 allows, so it is compared by length rather than with strncmp().
+static inline BOOL JANBTStringRefIsEqualToCString(JANBTStringRef ref, const char *string)
+{
+	return ref.bytes != NULL && strlen(string) == ref.length && memcmp(ref.bytes, string, ref.length) == 0;
+}
+
+
+static inline NSString *JANBTStringFromStringRef(JANBTStringRef ref)
+{
+	if (ref.bytes == NULL)  return nil;
+	return [[NSString alloc] initWithBytes:ref.bytes length:ref.length encoding:NSUTF8StringEncoding];
+}
+
+
+@protocol JANBTReaderDelegate <NSObject>
+@optional
+
+- (void) beginCompoundNamed:(JANBTStringRef)name;
+- (void) endCompound;
+
+- (void) beginListNamed:(JANBTStringRef)name count:(NSUInteger)count;
+- (void) endList;
+
+- (void) foundByte:(int8_t)value named:(JANBTStringRef)name;
+- (void) foundShort:(int16_t)value named:(JANBTStringRef)name;
+- (void) foundInt:(int32_t)value named:(JANBTStringRef)name;
+- (void) foundLong:(int64_t)value named:(JANBTStringRef)name;
+- (void) foundFloat:(float)value named:(JANBTStringRef)name;
+- (void) foundDouble:(double)value named:(JANBTStringRef)name;
+- (void) foundString:(JANBTStringRef)value named:(JANBTStringRef)name;
+
+// Array contents are borrowed. Int and long array values are in host byte order.
+- (void) foundByteArray:(const uint8_t *)bytes length:(NSUInteger)length named:(JANBTStringRef)name;
+- (void) foundIntArray:(const int32_t *)values count:(NSUInteger)count named:(JANBTStringRef)name;
+- (void) foundLongArray:(const int64_t *)values count:(NSUInteger)count named:(JANBTStringRef)name;
+
+@end
@@ -15,10 +15,11 @@
 	
 	When reading, numbers whose type is not defined in the schema are tagged
 	with their NBT type. These numbers act like normal NSNumbers, but are
-	costlier (they’re real objects rather than tagged values). This allows
-	you to read and write an NBT without a known schema and maintain type
-	information. Using the same schema on read and write will avoid the cost
-	as long as the NBT strictly conforms to the schema.
+	costlier (they’re real objects rather than tagged values, although small
+	values are shared rather than allocated). This allows you to read and
+	write an NBT without a known schema and maintain type information. Using
+	the same schema on read and write will avoid the cost as long as the NBT
+	strictly conforms to the schema.
 	
 	When writing, the schema is used to validate the property list and to ensure
 	the correct number types are written. Unknown dictionary keys will still
@@ -42,6 +43,11 @@
 		data			Binary data, TAG_Byte_Array
 		string			UTF-8 string, TAG_String
 		intarray		list of 32-bit signed integers, TAG_Int_Array
+		longarray		list of 64-bit signed integers, TAG_Long_Array
+	
+	Int and long arrays are read as JANBTIntArray and JANBTLongArray, which
+	are NSArrays backed by a packed buffer of integers; see
+	JANBTPackedArrays.h.
 	
 	For example, here’s a fragment of a schema in OpenStep plist format. It
 	specifies that Items is a TAG_List containing TAG_Compounds with four
@@ -56,6 +62,12 @@
 			}
 		);
 	
+	Wherever a schema is accepted, it may be either a property list or a
+	JANBTCompiledSchema. Property list schemata are compiled the first time
+	they’re used and the result is cached, so they must not be mutated
+	afterwards. An invalid schema causes reading and writing to fail with
+	kJANBTSerializationInvalidSchemaError.
+	
 	For a full NBT, the root must be a named compound. In the corresponding
 	schema, the root element is a dictionary and its name is not part of the
 	schema. The separate rootName parameters can be used instead.
@@ -89,6 +101,10 @@
 */
 
 #import <Foundation/Foundation.h>
+#import "JANBTReaderDelegate.h"
+#import "JANBTPackedArrays.h"
+#import "JANBTCompiledSchema.h"
+#import "JANBTStatistics.h"
 
 
 typedef NS_ENUM(NSInteger, JANBTReadingOptions)
@@ -104,6 +120,22 @@ typedef NS_ENUM(NSInteger, JANBTReadingOptions)
 
 	// The provided data is not zlib-compressed.
 	JANBTReadingOptionsUncompressed			= 0x0008,
+	
+	// Compound keys are always interned, so repeated keys within an NBT share
+	// one NSString. With this option, the intern table is shared by all
+	// parsers in the process, which pays off when reading many similar NBTs
+	// such as the chunks of a region.
+	JANBTReadingOptionsSharedKeyTable		= 0x0010,
+	
+	// Return compounds and lists that only parse their members when they’re
+	// first accessed, straight out of the decompressed buffer. This is much
+	// cheaper when only a few values are needed from a large NBT. The whole
+	// NBT is still checked for truncation up front, but a few errors, such
+	// as invalid UTF-8 in a string, are only found on access and raise an
+	// exception. The result keeps the decompressed buffer alive. Ignored
+	// when reading streams or with JANBTReadingOptionsMutableContainers, and
+	// for compounds filtered by key paths.
+	JANBTReadingOptionsLazyContainers		= 0x0020,
 };
 
 
@@ -111,9 +143,55 @@ typedef NS_ENUM(NSInteger, JANBTWritingOptions)
 {
 	// Produce uncomressed data.
 	JANBTWritingOptionsUncompressed			= 0x0008,
+	
+	// Compress on all cores, pigz style. The output is a standard gzip
+	// stream, typically a percent or so larger. This only pays off for big
+	// NBTs such as large schematics; smaller data objects are compressed
+	// normally even if it is set.
+	JANBTWritingOptionsParallelCompression	= 0x0010,
+	
+	// Compression level from 1 (fastest) to 9 (smallest); see
+	// JANBTWritingOptionsCompressionLevel(). If unset, zlib’s default (6)
+	// is used.
+	JANBTWritingOptionsCompressionLevelMask	= 0x0F00,
+	
+	// Compression strategy. Filtered and RLE are faster than the default,
+	// and RLE does well on block data, which is mostly long runs.
+	JANBTWritingOptionsFilteredStrategy		= 0x1000,
+	JANBTWritingOptionsRLEStrategy			= 0x2000,
+	JANBTWritingOptionsHuffmanOnlyStrategy	= 0x3000,
+	JANBTWritingOptionsStrategyMask			= 0x3000,
+	
+	// Container format. The default is gzip, which Minecraft uses for
+	// level.dat and schematics; region chunks use zlib. Raw deflate has no
+	// header or checksum and can’t be read back by NBTObjectWithData:.
+	JANBTWritingOptionsZLibContainer		= 0x4000,
+	JANBTWritingOptionsRawDeflateContainer	= 0x8000,
+	JANBTWritingOptionsContainerMask		= 0xC000,
+	
+	// Presets. nbtbench’s "compress" cases report speed and ratio for
+	// these and the individual settings.
+	JANBTWritingOptionsFastPreset			= 0x0100 | JANBTWritingOptionsRLEStrategy,
+	JANBTWritingOptionsSmallestPreset		= 0x0900,
 };
 
 
+static inline JANBTWritingOptions JANBTWritingOptionsCompressionLevel(unsigned level)
+{
+	return (JANBTWritingOptions)((MIN(level, 9U) << 8) & JANBTWritingOptionsCompressionLevelMask);
+}
+
+
+// Filled in by validateNBTData:…
+typedef struct JANBTValidationSummary
+{
+	NSUInteger				tagCounts[13];	// Indexed by tag ID, from 1 (TAG_Byte) to 12 (TAG_Long_Array). Includes list elements and the root.
+	NSUInteger				maxDepth;		// Nesting of compounds and lists; a root compound of scalars is 1.
+	NSUInteger				length;			// Bytes of uncompressed NBT.
+	NSUInteger				payloadLength;	// Bytes of values (numbers, string contents and array contents), excluding names and headers.
+} JANBTValidationSummary;
+
+
 @interface JANBTSerialization : NSObject
 
 // Test whether dataWithNBTObject:… can be expected to succeed.
@@ -128,11 +206,36 @@ typedef NS_ENUM(NSInteger, JANBTWritingOptions)
 						schema:(id)schema
 						 error:(NSError **)outError;
 
+// As above, adding counters for the encode to statistics if it succeeds. See JANBTStatistics.h.
++ (NSData *) dataWithNBTObject:(id)root
+					  rootName:(NSString *)rootName
+					   options:(JANBTWritingOptions)options
+						schema:(id)schema
+					statistics:(JANBTStatistics *)statistics
+						 error:(NSError **)outError;
 
+
++ (id) NBTObjectWithData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				   error:(NSError **)outError;
+
+/*
+	Projected parsing: only the parts of the NBT selected by keyPaths are
+	returned, and everything else is skipped without being converted to
+	objects. Key paths are relative to the root compound and separated by
+	dots, for example Level.xPos or Level.Sections[*].Blocks. The [*] suffix
+	selects the elements of a list and may be omitted. Compounds only contain
+	the selected members; lists contain all their elements.
+	
+	A nil keyPaths selects everything.
+*/
 + (id) NBTObjectWithData:(NSData *)data
 				rootName:(NSString **)ioRootName
 				 options:(JANBTReadingOptions)options
 				  schema:(id)schema
+				keyPaths:(id<NSFastEnumeration>)keyPaths
 				   error:(NSError **)outError;
 
 + (NSInteger) writeNBTObject:(id)obj
@@ -147,6 +250,122 @@ typedef NS_ENUM(NSInteger, JANBTWritingOptions)
 				   options:(JANBTReadingOptions)options
 					schema:(id)schema
 					 error:(NSError **)outError;
+
++ (id) NBTObjectWithStream:(NSInputStream *)stream
+				  rootName:(NSString **)ioRootName
+				   options:(JANBTReadingOptions)options
+					schema:(id)schema
+				  keyPaths:(id<NSFastEnumeration>)keyPaths
+					 error:(NSError **)outError;
+
+/*
+	Event-driven reading: report the contents of an NBT to delegate instead
+	of building a property list. See JANBTReaderDelegate.h. Options other
+	than JANBTReadingOptionsUncompressed and JANBTReadingOptionsAllowFragments
+	are ignored.
+*/
++ (BOOL) readNBTData:(NSData *)data
+			rootName:(NSString **)ioRootName
+			 options:(JANBTReadingOptions)options
+			delegate:(id<JANBTReaderDelegate>)delegate
+			   error:(NSError **)outError;
+
++ (BOOL) readNBTStream:(NSInputStream *)stream
+			  rootName:(NSString **)ioRootName
+			   options:(JANBTReadingOptions)options
+			  delegate:(id<JANBTReaderDelegate>)delegate
+				 error:(NSError **)outError;
+
+/*
+	Check that data is well-formed NBT, and conforms to schema if one is
+	given, without building any objects: after inflating, the NBT is walked
+	in place and nothing is allocated per tag. If this succeeds,
+	NBTObjectWithData: with the same schema should too, barring memory
+	exhaustion. Options other than JANBTReadingOptionsUncompressed and
+	JANBTReadingOptionsAllowFragments are ignored. summary may be NULL.
+*/
++ (BOOL) validateNBTData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				 summary:(JANBTValidationSummary *)outSummary
+				   error:(NSError **)outError;
+
+/*
+	Splicing edits: produce a copy of an NBT with some tags replaced or
+	removed, without reading the rest into objects. Only the new values are
+	encoded; everything else is copied from the original bytes, which are
+	only scanned as far as the last change. For a small change to a large
+	NBT, this costs little more than decompressing and recompressing it.
+	
+	changes maps key paths to replacement values, or to NSNull to remove a
+	tag. Key paths are as for projected parsing, except that list elements
+	are selected by index, as in Level.TileEntities[12].Items, and [*] is
+	not allowed. Setting a compound member that doesn’t exist adds it, and
+	removing one does nothing; list elements can be replaced or removed,
+	but a replacement must have the list’s element type. Key paths may not
+	overlap.
+	
+	schema, if given, is used to encode the new values; the rest of the NBT
+	is not checked against it, nor is it validated beyond what’s needed to
+	find the changes. Of readingOptions, only JANBTReadingOptionsUncompressed
+	is used.
+*/
++ (NSData *) dataByPatchingNBTData:(NSData *)data
+					readingOptions:(JANBTReadingOptions)readingOptions
+						   changes:(NSDictionary *)changes
+					writingOptions:(JANBTWritingOptions)writingOptions
+							schema:(id)schema
+							 error:(NSError **)outError;
+@end
+
+
+/*
+	Reusable state for reading many NBTs in a row, such as the chunks of a
+	region: the inflate state and its buffers are reset between NBTs instead
+	of being set up and torn down each time, and the output buffer starts
+	out at the size of the previous NBT.
+	
+	The JANBTSerialization methods already borrow this state from a small
+	per-thread pool; holding a context avoids even that, and keeps the size
+	history across calls. A context may only be used by one thread at a
+	time.
+*/
+@interface JANBTReadingContext: NSObject
+
+/*
+	If set, every NBT successfully read through the context is added to
+	statistics. Several contexts on different threads may share one
+	statistics object.
+*/
+@property JANBTStatistics *statistics;
+
+- (id) NBTObjectWithData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				   error:(NSError **)outError;
+
+- (id) NBTObjectWithData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				keyPaths:(id<NSFastEnumeration>)keyPaths
+				   error:(NSError **)outError;
+
+- (BOOL) readNBTData:(NSData *)data
+			rootName:(NSString **)ioRootName
+			 options:(JANBTReadingOptions)options
+			delegate:(id<JANBTReaderDelegate>)delegate
+			   error:(NSError **)outError;
+
+- (BOOL) validateNBTData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				 summary:(JANBTValidationSummary *)outSummary
+				   error:(NSError **)outError;
+
 @end
 
 
@@ -163,5 +382,6 @@ enum
 	kJANBTSerializationWrongTypeError,
 	kJANBTSerializationObjectTooLargeError,
 	kJANBTSerializationWrongRootNameError,
-	kJANBTSerializationInvalidSchemaError
+	kJANBTSerializationInvalidSchemaError,
+	kJANBTSerializationInvalidKeyPathError
 };
@@ -0,0 +1,88 @@
+/*
+	JANBTStatistics.h
+	
+	Runtime counters for reading and writing NBTs, for finding out where
+	the time goes in batch jobs. Attach a statistics object to a
+	JANBTReadingContext, or pass one to
+	+[JANBTSerialization dataWithNBTObject:…statistics:error:], and every
+	NBT successfully read or written is added to it.
+	
+	While an NBT is being read or written, counting is done with plain
+	integers local to that operation, and the totals are added to the
+	statistics object once at the end under a lock. This is cheap enough to
+	leave on in production. One statistics object may be shared between
+	threads, or each thread can keep its own and merge them afterwards with
+	-addStatistics:.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+
+@interface JANBTStatistics: NSObject <NSCopying>
+
+// NBTs read or written. Failed operations are not counted.
+@property (readonly) NSUInteger documentCount;
+
+/*
+	Tags by ID, from 1 (TAG_Byte) to 12 (TAG_Long_Array), including list
+	elements and the root. Tags that are never looked at, because they were
+	skipped by a projection or are inside a lazy container, aren’t counted.
+*/
+- (NSUInteger) countOfTagsWithID:(NSUInteger)tagID;
+@property (readonly) NSUInteger tagCount;
+
+/*
+	Bytes going in and out of zlib: for reading, the input and the inflated
+	NBT; for writing, the NBT and the output. Uncompressed NBTs count the
+	same length for both.
+*/
+@property (readonly) unsigned long long compressedLength;
+@property (readonly) unsigned long long uncompressedLength;
+
+/*
+	Time spent inflating or deflating, and time spent on everything else:
+	parsing and building objects, or walking objects and encoding them.
+	With parallel compression, compressionTime is the time the encoder
+	spent handing data to the compressor and waiting for it.
+*/
+@property (readonly) NSTimeInterval compressionTime;
+@property (readonly) NSTimeInterval processingTime;
+
+// Deepest nesting of compounds and lists; a root compound of scalars is 1.
+@property (readonly) NSUInteger maxDepth;
+
+/*
+	Objects produced by parsing: one for each tag converted to an object,
+	and one for each lazy container. Numbers are counted even when they’re
+	shared instances. Always zero for writing and validation.
+*/
+@property (readonly) NSUInteger objectCount;
+
+- (void) addStatistics:(JANBTStatistics *)other;
+- (void) reset;
+
+// The above as a property list suitable for JSON, with tag counts keyed by tag name.
+- (NSDictionary *) dictionaryRepresentation;
+
+@end
@@ -0,0 +1,95 @@
+/*
+	JANBTStreamWriter.h
+	
+	Incremental NBT writing. Where +[JANBTSerialization writeNBTObject:…]
+	needs the whole document as a property list up front, a stream writer is
+	handed tags one at a time, in document order, and writes them out as it
+	goes. Memory use is bounded by the encoder’s staging buffer and the
+	compressor, however big the NBT gets, so producers can generate data and
+	write it at the same time.
+	
+	The calls mirror JANBTReaderDelegate. The root and compound members must
+	be named; list elements must not be. A list’s element type is set by its
+	first element, and the number of elements must match the count it was
+	begun with. Byte arrays can be written in pieces, with
+	-beginByteArrayNamed:length: followed by -writeByteArrayChunk:length:
+	until length bytes have been written. Subtrees that are easier to build
+	as property lists can be written with -writeObject:named:, which uses
+	the schema in the same way as +dataWithNBTObject:….
+	
+	Mistakes, such as writing a member with no name, and output errors cause
+	the call to return NO. The first error is kept in the error property,
+	and every later call fails. The output is unusable after a failure.
+	
+	A stream writer writes a single NBT and is not thread safe.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTSerialization.h"
+
+
+@interface JANBTStreamWriter: NSObject
+
+// Write to stream, opening it if necessary. Returns nil if schema is invalid.
+- (id) initWithStream:(NSOutputStream *)stream options:(JANBTWritingOptions)options schema:(id)schema error:(NSError **)outError;
+
+// Write to memory. The result is available from data once finished.
+- (id) initForDataWithOptions:(JANBTWritingOptions)options schema:(id)schema error:(NSError **)outError;
+
+- (BOOL) beginCompoundNamed:(NSString *)name;
+- (BOOL) endCompound;
+
+- (BOOL) beginListNamed:(NSString *)name count:(NSUInteger)count;
+- (BOOL) endList;
+
+- (BOOL) writeByte:(int8_t)value named:(NSString *)name;
+- (BOOL) writeShort:(int16_t)value named:(NSString *)name;
+- (BOOL) writeInt:(int32_t)value named:(NSString *)name;
+- (BOOL) writeLong:(int64_t)value named:(NSString *)name;
+- (BOOL) writeFloat:(float)value named:(NSString *)name;
+- (BOOL) writeDouble:(double)value named:(NSString *)name;
+- (BOOL) writeString:(NSString *)value named:(NSString *)name;
+
+// Int and long array values are in host byte order.
+- (BOOL) writeByteArray:(const void *)bytes length:(NSUInteger)length named:(NSString *)name;
+- (BOOL) writeIntArray:(const int32_t *)values count:(NSUInteger)count named:(NSString *)name;
+- (BOOL) writeLongArray:(const int64_t *)values count:(NSUInteger)count named:(NSString *)name;
+
+- (BOOL) beginByteArrayNamed:(NSString *)name length:(NSUInteger)length;
+- (BOOL) writeByteArrayChunk:(const void *)bytes length:(NSUInteger)length;
+
+// Write a property list value as one tag.
+- (BOOL) writeObject:(id)object named:(NSString *)name;
+
+// Flush the output. Fails if any compound, list or byte array is unfinished.
+- (BOOL) finishWithError:(NSError **)outError;
+
+// Valid once finished; nil when writing to a stream.
+@property (readonly) NSData *data;
+
+// Bytes written to the stream or data so far.
+@property (readonly) NSUInteger bytesWritten;
+
+@property (readonly) NSError *error;
+
+@end
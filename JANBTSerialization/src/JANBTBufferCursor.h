@@ -0,0 +1,146 @@
+/*
+	JANBTBufferCursor.h
+
+	Internal helpers for reading big-endian NBT primitives from a contiguous
+	in-memory buffer. Everything here is inlined; reading an int is a bounds
+	check, a load and a byte swap.
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <CoreFoundation/CoreFoundation.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+typedef struct JANBTBufferCursor
+{
+	const uint8_t			*next;
+	const uint8_t			*end;
+} JANBTBufferCursor;
+
+
+static inline JANBTBufferCursor JANBTMakeBufferCursor(const void *bytes, size_t length)
+{
+	return (JANBTBufferCursor){ bytes, (const uint8_t *)bytes + length };
+}
+
+
+static inline size_t JANBTCursorRemaining(const JANBTBufferCursor *cursor)
+{
+	return (size_t)(cursor->end - cursor->next);
+}
+
+
+/*
+	Returns a pointer to the next length bytes and advances past them, or
+	NULL if the buffer is too short. The cursor is not moved on failure.
+*/
+static inline const uint8_t *JANBTCursorReadBytes(JANBTBufferCursor *cursor, size_t length)
+{
+	if (__builtin_expect(JANBTCursorRemaining(cursor) < length, 0))  return NULL;
+	const uint8_t *result = cursor->next;
+	cursor->next += length;
+	return result;
+}
+
+
+static inline bool JANBTCursorReadByte(JANBTBufferCursor *cursor, int8_t *value)
+{
+	if (__builtin_expect(cursor->next >= cursor->end, 0))  return false;
+	*value = (int8_t)*cursor->next++;
+	return true;
+}
+
+
+static inline bool JANBTCursorReadShort(JANBTBufferCursor *cursor, int16_t *value)
+{
+	const uint8_t *bytes = JANBTCursorReadBytes(cursor, sizeof *value);
+	if (__builtin_expect(bytes == NULL, 0))  return false;
+	uint16_t raw;
+	memcpy(&raw, bytes, sizeof raw);
+	*value = (int16_t)CFSwapInt16BigToHost(raw);
+	return true;
+}
+
+
+static inline bool JANBTCursorReadInt(JANBTBufferCursor *cursor, int32_t *value)
+{
+	const uint8_t *bytes = JANBTCursorReadBytes(cursor, sizeof *value);
+	if (__builtin_expect(bytes == NULL, 0))  return false;
+	uint32_t raw;
+	memcpy(&raw, bytes, sizeof raw);
+	*value = (int32_t)CFSwapInt32BigToHost(raw);
+	return true;
+}
+
+
+static inline bool JANBTCursorReadLong(JANBTBufferCursor *cursor, int64_t *value)
+{
+	const uint8_t *bytes = JANBTCursorReadBytes(cursor, sizeof *value);
+	if (__builtin_expect(bytes == NULL, 0))  return false;
+	uint64_t raw;
+	memcpy(&raw, bytes, sizeof raw);
+	*value = (int64_t)CFSwapInt64BigToHost(raw);
+	return true;
+}
+
+
+static inline bool JANBTCursorReadFloat(JANBTBufferCursor *cursor, Float32 *value)
+{
+	union { int32_t i; Float32 f; } convert;
+	if (__builtin_expect(!JANBTCursorReadInt(cursor, &convert.i), 0))  return false;
+	*value = convert.f;
+	return true;
+}
+
+
+static inline bool JANBTCursorReadDouble(JANBTBufferCursor *cursor, Float64 *value)
+{
+	union { int64_t i; Float64 f; } convert;
+	if (__builtin_expect(!JANBTCursorReadLong(cursor, &convert.i), 0))  return false;
+	*value = convert.f;
+	return true;
+}
+
+
+/*
+	Read a length-prefixed string without decoding it. On success, *outBytes
+	points into the buffer.
+*/
+static inline bool JANBTCursorReadStringBytes(JANBTBufferCursor *cursor, const char **outBytes, uint16_t *outLength)
+{
+	JANBTBufferCursor saved = *cursor;
+	int16_t length;
+	if (__builtin_expect(!JANBTCursorReadShort(cursor, &length), 0))  return false;
+
+	const uint8_t *bytes = JANBTCursorReadBytes(cursor, (uint16_t)length);
+	if (__builtin_expect(bytes == NULL, 0))
+	{
+		*cursor = saved;
+		return false;
+	}
+
+	*outBytes = (const char *)bytes;
+	*outLength = (uint16_t)length;
+	return true;
+}
@@ -0,0 +1,105 @@
+/*
+	JANBTBufferWriter.h
+
+	Internal helpers for writing big-endian NBT primitives into a contiguous
+	buffer; the counterpart of JANBTBufferCursor.h. Writing an int is a
+	bounds check, a byte swap and a store. When the buffer is full, the
+	caller is responsible for flushing or growing it and starting a new
+	writer.
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <CoreFoundation/CoreFoundation.h>
+#include <stdbool.h>
+#include <string.h>
+
+
+typedef struct JANBTBufferWriter
+{
+	uint8_t					*next;
+	uint8_t					*end;
+} JANBTBufferWriter;
+
+
+static inline JANBTBufferWriter JANBTMakeBufferWriter(void *bytes, size_t length)
+{
+	return (JANBTBufferWriter){ bytes, (uint8_t *)bytes + length };
+}
+
+
+static inline size_t JANBTWriterRemaining(const JANBTBufferWriter *writer)
+{
+	return (size_t)(writer->end - writer->next);
+}
+
+
+/*
+	Returns a pointer to space for the next length bytes and advances past
+	it, or NULL if the buffer is too short. The writer is not moved on
+	failure.
+*/
+static inline uint8_t *JANBTWriterReserve(JANBTBufferWriter *writer, size_t length)
+{
+	if (__builtin_expect(JANBTWriterRemaining(writer) < length, 0))  return NULL;
+	uint8_t *result = writer->next;
+	writer->next += length;
+	return result;
+}
+
+
+static inline bool JANBTWriterWriteByte(JANBTBufferWriter *writer, uint8_t value)
+{
+	if (__builtin_expect(writer->next >= writer->end, 0))  return false;
+	*writer->next++ = value;
+	return true;
+}
+
+
+static inline bool JANBTWriterWriteShort(JANBTBufferWriter *writer, uint16_t value)
+{
+	uint8_t *bytes = JANBTWriterReserve(writer, sizeof value);
+	if (__builtin_expect(bytes == NULL, 0))  return false;
+	value = CFSwapInt16HostToBig(value);
+	memcpy(bytes, &value, sizeof value);
+	return true;
+}
+
+
+static inline bool JANBTWriterWriteInt(JANBTBufferWriter *writer, uint32_t value)
+{
+	uint8_t *bytes = JANBTWriterReserve(writer, sizeof value);
+	if (__builtin_expect(bytes == NULL, 0))  return false;
+	value = CFSwapInt32HostToBig(value);
+	memcpy(bytes, &value, sizeof value);
+	return true;
+}
+
+
+static inline bool JANBTWriterWriteLong(JANBTBufferWriter *writer, uint64_t value)
+{
+	uint8_t *bytes = JANBTWriterReserve(writer, sizeof value);
+	if (__builtin_expect(bytes == NULL, 0))  return false;
+	value = CFSwapInt64HostToBig(value);
+	memcpy(bytes, &value, sizeof value);
+	return true;
+}
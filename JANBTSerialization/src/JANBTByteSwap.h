@@ -0,0 +1,152 @@
+/*
+	JANBTByteSwap.h
+	
+	Internal helpers for converting arrays of integers between big-endian
+	(NBT) and host byte order. The conversion is its own inverse, so the same
+	functions are used for reading and writing. dst and src may be the same
+	buffer, but must not otherwise overlap. Neither needs to be aligned.
+	
+	Int and long arrays (heightmaps, biomes, block states) are in every
+	chunk, so the bulk of each array is swapped a vector at a time with
+	whatever the target supports: AVX2, SSSE3 or SSE2 on x86 and NEON on
+	ARM, selected at compile time. The remainder is swapped one element at
+	a time.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <CoreFoundation/CoreFoundation.h>
+#include <string.h>
+
+#if __BIG_ENDIAN__
+	// Nothing to swap.
+#elif __AVX2__
+#include <immintrin.h>
+#elif __SSSE3__
+#include <tmmintrin.h>
+#elif __SSE2__
+#include <emmintrin.h>
+#elif __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+
+static inline void JANBTByteSwapInt32Array(void *dst, const void *src, size_t count)
+{
+	uint8_t *out = dst;
+	const uint8_t *in = src;
+	size_t i = 0;
+	
+#if __BIG_ENDIAN__
+	if (dst != src)  memcpy(dst, src, count * sizeof (uint32_t));
+	return;
+#elif __AVX2__
+	// vpshufb shuffles within each 128-bit lane, so the pattern is repeated.
+	const __m256i pattern = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+											 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i * sizeof (uint32_t)));
+		_mm256_storeu_si256((__m256i *)(out + i * sizeof (uint32_t)), _mm256_shuffle_epi8(v, pattern));
+	}
+#elif __SSSE3__
+	const __m128i pattern = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i * sizeof (uint32_t)));
+		_mm_storeu_si128((__m128i *)(out + i * sizeof (uint32_t)), _mm_shuffle_epi8(v, pattern));
+	}
+#elif __SSE2__
+	// No byte shuffle, so swap the bytes of each 16-bit word and then the words of each 32-bit value.
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i * sizeof (uint32_t)));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128((__m128i *)(out + i * sizeof (uint32_t)), v);
+	}
+#elif __ARM_NEON
+	for (; i + 4 <= count; i += 4)
+	{
+		vst1q_u8(out + i * sizeof (uint32_t), vrev32q_u8(vld1q_u8(in + i * sizeof (uint32_t))));
+	}
+#endif
+	
+	for (; i < count; i++)
+	{
+		uint32_t value;
+		memcpy(&value, in + i * sizeof value, sizeof value);
+		value = CFSwapInt32BigToHost(value);
+		memcpy(out + i * sizeof value, &value, sizeof value);
+	}
+}
+
+
+static inline void JANBTByteSwapInt64Array(void *dst, const void *src, size_t count)
+{
+	uint8_t *out = dst;
+	const uint8_t *in = src;
+	size_t i = 0;
+	
+#if __BIG_ENDIAN__
+	if (dst != src)  memcpy(dst, src, count * sizeof (uint64_t));
+	return;
+#elif __AVX2__
+	const __m256i pattern = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+											 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i * sizeof (uint64_t)));
+		_mm256_storeu_si256((__m256i *)(out + i * sizeof (uint64_t)), _mm256_shuffle_epi8(v, pattern));
+	}
+#elif __SSSE3__
+	const __m128i pattern = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i * sizeof (uint64_t)));
+		_mm_storeu_si128((__m128i *)(out + i * sizeof (uint64_t)), _mm_shuffle_epi8(v, pattern));
+	}
+#elif __SSE2__
+	for (; i + 2 <= count; i += 2)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i * sizeof (uint64_t)));
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+		v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+		_mm_storeu_si128((__m128i *)(out + i * sizeof (uint64_t)), v);
+	}
+#elif __ARM_NEON
+	for (; i + 2 <= count; i += 2)
+	{
+		vst1q_u8(out + i * sizeof (uint64_t), vrev64q_u8(vld1q_u8(in + i * sizeof (uint64_t))));
+	}
+#endif
+	
+	for (; i < count; i++)
+	{
+		uint64_t value;
+		memcpy(&value, in + i * sizeof value, sizeof value);
+		value = CFSwapInt64BigToHost(value);
+		memcpy(out + i * sizeof value, &value, sizeof value);
+	}
+}
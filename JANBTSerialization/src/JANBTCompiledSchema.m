@@ -0,0 +1,242 @@
+/*
+	JANBTCompiledSchema.m
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTSchemaNode.h"
+#import "JANBTSerialization.h"
+#import "JANBTStringTable.h"
+#import <objc/runtime.h>
+
+
+static const void *kCompiledSchemaStorageKey = &kCompiledSchemaStorageKey;
+
+// Create an NSError with code kJANBTSerializationInvalidSchemaError if outError is not null.
+static void SetError(NSError **outError, NSString *format, ...) NS_FORMAT_FUNCTION(2, 3);
+
+
+@implementation JANBTCompiledSchema
+{
+	// Owns the nodes, member tables and names; NSData contents don’t move.
+	NSMutableArray			*_storage;
+	const JANBTSchemaNode	*_rootNode;
+
+	id						_propertyList;
+	// Cached compilations refer to their property list weakly to avoid a retain cycle.
+	__weak id				_cachedPropertyList;
+}
+
+
++ (instancetype) compiledSchemaWithPropertyList:(id)propertyList error:(NSError **)outError
+{
+	JANBTCompiledSchema *result = [self new];
+	result->_rootNode = [result compileNode:propertyList path:@"" error:outError];
+	if (result->_rootNode == NULL)  return nil;
+
+	result->_propertyList = propertyList;
+	return result;
+}
+
+
++ (JANBTCompiledSchema *) compiledSchemaForSchema:(id)schema error:(NSError **)outError
+{
+	if (schema == nil)  return nil;
+	if ([schema isKindOfClass:[JANBTCompiledSchema class]])  return schema;
+
+	// Only containers are cached; atomic schemata are cheap to compile, and may be tagged pointers.
+	BOOL cacheable = [schema isKindOfClass:[NSDictionary class]] || [schema isKindOfClass:[NSArray class]];
+	if (cacheable)
+	{
+		JANBTCompiledSchema *cached = objc_getAssociatedObject(schema, kCompiledSchemaStorageKey);
+		if (cached != nil)  return cached;
+	}
+
+	JANBTCompiledSchema *result = [self new];
+	result->_rootNode = [result compileNode:schema path:@"" error:outError];
+	if (result->_rootNode == NULL)  return nil;
+
+	if (cacheable)
+	{
+		result->_cachedPropertyList = schema;
+		objc_setAssociatedObject(schema, kCompiledSchemaStorageKey, result, OBJC_ASSOCIATION_RETAIN);
+	}
+	else
+	{
+		result->_propertyList = schema;
+	}
+	return result;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_storage = [NSMutableArray new];
+	}
+	return self;
+}
+
+
+- (id) propertyList
+{
+	return _propertyList ?: _cachedPropertyList;
+}
+
+
+- (const JANBTSchemaNode *) rootNode
+{
+	return _rootNode;
+}
+
+
+- (NSString *) description
+{
+	return [NSString stringWithFormat:@"<%@ %p>{%@}", self.class, self, JANBTTagNameFromTagType(_rootNode->type)];
+}
+
+
+- (void *) allocate:(NSUInteger)size
+{
+	NSMutableData *block = [NSMutableData dataWithLength:size];
+	[_storage addObject:block];
+	return block.mutableBytes;
+}
+
+
+- (const JANBTSchemaNode *) compileNode:(id)plist path:(NSString *)path error:(NSError **)outError
+{
+	JANBTSchemaNode *node = [self allocate:sizeof *node];
+
+	if ([plist isKindOfClass:[NSDictionary class]])
+	{
+		node->type = kJANBTTagCompound;
+
+		NSUInteger slotCount = 1;
+		while (slotCount < [plist count] * 2)  slotCount *= 2;
+		JANBTSchemaMember *members = [self allocate:slotCount * sizeof *members];
+		node->members = members;
+		node->memberMask = (uint32_t)(slotCount - 1);
+
+		for (NSString *key in plist)
+		{
+			if (![key isKindOfClass:[NSString class]])
+			{
+				SetError(outError, @"Invalid NBT schema: compound key %@ at %@ is not a string.", key, path);
+				return NULL;
+			}
+
+			NSData *name = [key dataUsingEncoding:NSUTF8StringEncoding];
+			const JANBTSchemaNode *child = [self compileNode:[plist objectForKey:key] path:[path stringByAppendingFormat:@".%@", key] error:outError];
+			if (child == NULL)  return NULL;
+
+			char *nameBytes = [self allocate:name.length + 1];
+			memcpy(nameBytes, name.bytes, name.length);
+			uint32_t hash = JANBTHashUTF8Bytes(nameBytes, name.length);
+
+			uint32_t slot = hash & node->memberMask;
+			while (members[slot].name != NULL)  slot = (slot + 1) & node->memberMask;
+
+			members[slot] = (JANBTSchemaMember){ hash, (uint32_t)name.length, nameBytes, child };
+		}
+	}
+	else if ([plist isKindOfClass:[NSArray class]])
+	{
+		if ([plist count] != 1)
+		{
+			SetError(outError, @"Invalid NBT schema: list at %@ must have exactly one element type.", path);
+			return NULL;
+		}
+
+		node->type = kJANBTTagList;
+		node->element = [self compileNode:[plist objectAtIndex:0] path:[path stringByAppendingString:@"[*]"] error:outError];
+		if (node->element == NULL)  return NULL;
+	}
+	else
+	{
+		node->type = [plist isKindOfClass:[NSString class]] ? [plist ja_NBTSchemaType] : kJANBTTagUnknown;
+		if (node->type == kJANBTTagUnknown)
+		{
+			SetError(outError, @"Invalid NBT schema: unknown type %@ at %@.", plist, path);
+			return NULL;
+		}
+	}
+
+	return node;
+}
+
+@end
+
+
+const JANBTSchemaNode *JANBTSchemaNodeMemberNamed(const JANBTSchemaNode *node, const char *name, NSUInteger length)
+{
+	if (node == NULL || node->members == NULL)  return NULL;
+
+	uint32_t hash = JANBTHashUTF8Bytes(name, length);
+	for (uint32_t slot = hash & node->memberMask;; slot = (slot + 1) & node->memberMask)
+	{
+		const JANBTSchemaMember *member = &node->members[slot];
+		if (member->name == NULL)  return NULL;
+		if (member->hash == hash && member->nameLength == length && memcmp(member->name, name, length) == 0)
+		{
+			return member->node;
+		}
+	}
+}
+
+
+const JANBTSchemaNode *JANBTSchemaNodeMemberForKey(const JANBTSchemaNode *node, NSString *key)
+{
+	if (node == NULL || node->members == NULL)  return NULL;
+
+	CFStringRef cfKey = (__bridge CFStringRef)key;
+	const char *bytes = CFStringGetCStringPtr(cfKey, kCFStringEncodingUTF8);
+	if (bytes != NULL)  return JANBTSchemaNodeMemberNamed(node, bytes, strlen(bytes));
+
+	// Keys are almost always short, so convert them on the stack.
+	char buffer[256];
+	CFIndex length = CFStringGetLength(cfKey), used;
+	if (CFStringGetBytes(cfKey, CFRangeMake(0, length), kCFStringEncodingUTF8, 0, false, (UInt8 *)buffer, sizeof buffer, &used) == length)
+	{
+		return JANBTSchemaNodeMemberNamed(node, buffer, (NSUInteger)used);
+	}
+
+	NSData *data = [key dataUsingEncoding:NSUTF8StringEncoding];
+	return JANBTSchemaNodeMemberNamed(node, data.bytes, data.length);
+}
+
+
+static void SetError(NSError **outError, NSString *format, ...)
+{
+	if (outError != NULL)
+	{
+		va_list args;
+		va_start(args, format);
+		NSString *message = [[NSString alloc] initWithFormat:format arguments:args];
+		va_end(args);
+
+		*outError = [NSError errorWithDomain:kJANBTSerializationErrorDomain
+										code:kJANBTSerializationInvalidSchemaError
+									userInfo:@{ NSLocalizedDescriptionKey: message }];
+	}
+}
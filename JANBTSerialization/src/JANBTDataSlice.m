@@ -0,0 +1,73 @@
+/*
+	JANBTDataSlice.m
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTDataSlice.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@implementation JANBTDataSlice
+{
+	NSData						*_backing;
+	const void					*_bytes;
+	NSUInteger					_length;
+}
+
+
+- (id) initWithBackingData:(NSData *)backing bytes:(const void *)bytes length:(NSUInteger)length
+{
+	NSParameterAssert((const uint8_t *)backing.bytes <= (const uint8_t *)bytes &&
+					  (const uint8_t *)bytes + length <= (const uint8_t *)backing.bytes + backing.length);
+
+	if ((self = [super init]))
+	{
+		_backing = backing;
+		_bytes = bytes;
+		_length = length;
+	}
+	return self;
+}
+
+
+- (NSUInteger) length
+{
+	return _length;
+}
+
+
+- (const void *) bytes
+{
+	return _bytes;
+}
+
+
+- (id) copyWithZone:(nullable NSZone *)zone
+{
+	// Immutable, and the backing data is immutable too.
+	return self;
+}
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,690 @@
+/*
+	JANBTDocument.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTDocument.h"
+#import "JANBTTagType.h"
+#import "JANBTTypedNumbers.h"
+#import "JANBTBufferCursor.h"
+#import "JANBTByteSwap.h"
+#import "JANBTDataSlice.h"
+#import "JANBTPackedArrays.h"
+#import "JANBTStringTable.h"
+#import "JANBTValidator.h"
+#import "JAZLibCompressor.h"
+
+
+enum
+{
+	kInitialTapeCapacity		= 256
+};
+
+
+// Entries store JANBTTagType values; the public IDs must match them.
+_Static_assert(kJANBTTapeTagByte == kJANBTTagByte && kJANBTTapeTagByteArray == kJANBTTagByteArray && kJANBTTapeTagString == kJANBTTagString, "Tape tag IDs out of step");
+_Static_assert(kJANBTTapeTagList == kJANBTTagList && kJANBTTapeTagCompound == kJANBTTagCompound && kJANBTTapeTagLongArray == kJANBTTagLongArray, "Tape tag IDs out of step");
+
+
+/*
+	Tape construction. This mirrors JANBTValidateBytes(), with the same
+	failures and depth limit, but appends an entry for each tag. Since
+	entries may move when the tape grows, they are referred to by index.
+*/
+typedef struct
+{
+	JANBTBufferCursor		cursor;
+	const uint8_t			*start;
+	JANBTTapeEntry			*entries;
+	JANBTTapeIndex			count;
+	JANBTTapeIndex			capacity;
+	NSUInteger				depth;
+	BOOL					outOfMemory;
+	JANBTValidationFailure	failure;
+} TapeBuilder;
+
+
+static BOOL BuildTagBody(TapeBuilder *builder, JANBTTagType type, JANBTStringRef name);
+
+
+static BOOL Fail(TapeBuilder *builder, JANBTValidationStatus status, JANBTTagType type)
+{
+	builder->failure = (JANBTValidationFailure)
+	{
+		.status = status,
+		.offset = (size_t)(builder->cursor.next - builder->start),
+		.type = type,
+		.expectedType = kJANBTTagAny
+	};
+	return NO;
+}
+
+
+static inline uint32_t Offset(TapeBuilder *builder, const void *pointer)
+{
+	return (uint32_t)((const uint8_t *)pointer - builder->start);
+}
+
+
+static BOOL Reserve(TapeBuilder *builder, size_t needed)
+{
+	size_t capacity = builder->capacity;
+	if (builder->count + needed <= capacity)  return YES;
+	
+	while (capacity < builder->count + needed)  capacity *= 2;
+	if (capacity >= kJANBTTapeNotFound)
+	{
+		builder->outOfMemory = YES;
+		return NO;
+	}
+	
+	JANBTTapeEntry *entries = realloc(builder->entries, capacity * sizeof *entries);
+	if (entries == NULL)
+	{
+		builder->outOfMemory = YES;
+		return NO;
+	}
+	
+	builder->entries = entries;
+	builder->capacity = (JANBTTapeIndex)capacity;
+	return YES;
+}
+
+
+static inline BOOL Skip(TapeBuilder *builder, size_t length)
+{
+	if (__builtin_expect(JANBTCursorReadBytes(&builder->cursor, length) == NULL, 0))
+	{
+		return Fail(builder, kJANBTValidationPrematureEnd, kJANBTTagEnd);
+	}
+	return YES;
+}
+
+
+static BOOL ReadString(TapeBuilder *builder, JANBTStringRef *outString)
+{
+	const char *bytes;
+	uint16_t length;
+	if (!JANBTCursorReadStringBytes(&builder->cursor, &bytes, &length))
+	{
+		return Fail(builder, kJANBTValidationPrematureEnd, kJANBTTagEnd);
+	}
+	if (!JANBTIsValidUTF8(bytes, length))
+	{
+		builder->cursor.next = (const uint8_t *)bytes;
+		return Fail(builder, kJANBTValidationInvalidUTF8, kJANBTTagString);
+	}
+	
+	*outString = (JANBTStringRef){ bytes, length };
+	return YES;
+}
+
+
+static BOOL BuildList(TapeBuilder *builder, JANBTTapeIndex index)
+{
+	int8_t type;
+	uint32_t count;
+	if (!JANBTCursorReadByte(&builder->cursor, &type) || !JANBTCursorReadInt(&builder->cursor, (int32_t *)&count))
+	{
+		return Fail(builder, kJANBTValidationPrematureEnd, kJANBTTagEnd);
+	}
+	
+	builder->entries[index].elementType = (uint8_t)type;
+	builder->entries[index].count = count;
+	if (count == 0)  return YES;
+	if (!JANBTIsKnownTagType(type))  return Fail(builder, kJANBTValidationUnknownTag, type);
+	
+	// Numbers have no subtrees, so their entries are filled in without recursing.
+	size_t elementSize = JANBTFixedTagSize(type);
+	if (elementSize != 0)
+	{
+		const uint8_t *first = builder->cursor.next;
+		if (!Skip(builder, (size_t)count * elementSize))  return NO;
+		if (!Reserve(builder, count))  return NO;
+		
+		uint32_t offset = Offset(builder, first);
+		JANBTTapeEntry *entries = builder->entries;
+		JANBTTapeIndex next = builder->count;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			entries[next] = (JANBTTapeEntry){ .type = (uint8_t)type, .payloadOffset = offset, .next = next + 1 };
+			offset += (uint32_t)elementSize;
+			next++;
+		}
+		builder->count = next;
+		return YES;
+	}
+	
+	JANBTStringRef noName = { NULL, 0 };
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!BuildTagBody(builder, type, noName))  return NO;
+	}
+	return YES;
+}
+
+
+static BOOL BuildCompound(TapeBuilder *builder, JANBTTapeIndex index)
+{
+	uint32_t count = 0;
+	for (;;)
+	{
+		int8_t type;
+		if (!JANBTCursorReadByte(&builder->cursor, &type))  return Fail(builder, kJANBTValidationPrematureEnd, kJANBTTagEnd);
+		if (type == kJANBTTagEnd)  break;
+		
+		JANBTStringRef name;
+		if (!ReadString(builder, &name))  return NO;
+		if (!BuildTagBody(builder, type, name))  return NO;
+		count++;
+	}
+	
+	builder->entries[index].count = count;
+	return YES;
+}
+
+
+static BOOL BuildTagBody(TapeBuilder *builder, JANBTTagType type, JANBTStringRef name)
+{
+	if (!JANBTIsKnownTagType(type))  return Fail(builder, kJANBTValidationUnknownTag, type);
+	if (!Reserve(builder, 1))  return NO;
+	
+	JANBTTapeIndex index = builder->count++;
+	builder->entries[index] = (JANBTTapeEntry)
+	{
+		.type = (uint8_t)type,
+		.nameLength = (uint16_t)name.length,
+		.nameOffset = (name.bytes != NULL) ? Offset(builder, name.bytes) : 0,
+		.payloadOffset = Offset(builder, builder->cursor.next)
+	};
+	
+	BOOL OK = NO;
+	switch (type)
+	{
+		case kJANBTTagByte:
+		case kJANBTTagShort:
+		case kJANBTTagInt:
+		case kJANBTTagLong:
+		case kJANBTTagFloat:
+		case kJANBTTagDouble:
+			OK = Skip(builder, JANBTFixedTagSize(type));
+			break;
+		
+		case kJANBTTagString:
+		{
+			JANBTStringRef string;
+			OK = ReadString(builder, &string);
+			if (OK)
+			{
+				builder->entries[index].payloadOffset = Offset(builder, string.bytes);
+				builder->entries[index].count = (uint32_t)string.length;
+			}
+			break;
+		}
+		
+		case kJANBTTagByteArray:
+		case kJANBTTagIntArray:
+		case kJANBTTagLongArray:
+		{
+			uint32_t count;
+			if (!JANBTCursorReadInt(&builder->cursor, (int32_t *)&count))  return Fail(builder, kJANBTValidationPrematureEnd, kJANBTTagEnd);
+			builder->entries[index].payloadOffset = Offset(builder, builder->cursor.next);
+			builder->entries[index].count = count;
+			OK = Skip(builder, (size_t)count * ((type == kJANBTTagByteArray) ? 1 : (type == kJANBTTagIntArray) ? 4 : 8));
+			break;
+		}
+		
+		case kJANBTTagList:
+		case kJANBTTagCompound:
+			if (++builder->depth > kJANBTValidationMaxDepth)  return Fail(builder, kJANBTValidationTooDeep, kJANBTTagEnd);
+			OK = (type == kJANBTTagList) ? BuildList(builder, index) : BuildCompound(builder, index);
+			builder->depth--;
+			break;
+		
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			return Fail(builder, kJANBTValidationUnknownTag, type);
+	}
+	
+	builder->entries[index].next = builder->count;
+	return OK;
+}
+
+
+@implementation JANBTDocument
+{
+	NSData					*_buffer;
+	NSString				*_rootName;
+	JANBTTapeEntry			*_entries;
+	JANBTTapeIndex			_count;
+	JANBTTapeIndex			_capacity;
+	JAZLibInflater			*_inflater;
+	JANBTStringTable		*_keyTable;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_capacity = kInitialTapeCapacity;
+		_entries = malloc(_capacity * sizeof *_entries);
+		if (_entries == NULL)  return nil;
+		
+		_inflater = [JAZLibInflater new];
+		_keyTable = [JANBTStringTable new];
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	free(_entries);
+}
+
+
+- (BOOL) parseData:(NSData *)data options:(JANBTReadingOptions)options error:(NSError **)outError
+{
+	NSParameterAssert(data != nil);
+	
+	_buffer = nil;
+	_rootName = nil;
+	_count = 0;
+	
+	NSData *buffer;
+	if (options & JANBTReadingOptionsUncompressed)
+	{
+		buffer = [data copy];
+	}
+	else
+	{
+		NSError *error;
+		buffer = [_inflater inflateData:data mode:kJAZLibCompressionAutoDetect error:&error];
+		if (buffer == nil)
+		{
+			if (outError != NULL)
+			{
+				NSString *message = [NSString stringWithFormat:@"Could not decompress NBT data: %@", error.localizedFailureReason ?: error.localizedDescription];
+				*outError = [NSError errorWithDomain:kJANBTSerializationErrorDomain code:kJANBTSerializationCompressionError userInfo:@{ NSLocalizedDescriptionKey: message }];
+			}
+			return NO;
+		}
+	}
+	
+	// Offsets are 32 bits; in practice, NBTs are much smaller.
+	if (buffer.length >= UINT32_MAX)
+	{
+		if (outError != NULL)
+		{
+			*outError = [NSError errorWithDomain:kJANBTSerializationErrorDomain code:kJANBTSerializationObjectTooLargeError userInfo:@{ NSLocalizedDescriptionKey: @"NBT is too large to parse into a document." }];
+		}
+		return NO;
+	}
+	
+	TapeBuilder builder =
+	{
+		.cursor = JANBTMakeBufferCursor(buffer.bytes, buffer.length),
+		.start = buffer.bytes,
+		.entries = _entries,
+		.capacity = _capacity
+	};
+	
+	BOOL OK = YES;
+	JANBTStringRef rootName = { NULL, 0 };
+	int8_t rootType;
+	if (!JANBTCursorReadByte(&builder.cursor, &rootType))
+	{
+		OK = Fail(&builder, kJANBTValidationPrematureEnd, kJANBTTagEnd);
+	}
+	else if (rootType != kJANBTTagCompound && !(options & JANBTReadingOptionsAllowFragments))
+	{
+		OK = Fail(&builder, kJANBTValidationRootNotCompound, rootType);
+	}
+	else if (rootType != kJANBTTagEnd)
+	{
+		OK = ReadString(&builder, &rootName) && BuildTagBody(&builder, rootType, rootName);
+	}
+	
+	// The tape may have moved even if parsing failed.
+	_entries = builder.entries;
+	_capacity = builder.capacity;
+	
+	if (!OK)
+	{
+		if (builder.outOfMemory)
+		{
+			if (outError != NULL)
+			{
+				*outError = [NSError errorWithDomain:kJANBTSerializationErrorDomain code:kJANBTSerializationMemoryError userInfo:@{ NSLocalizedDescriptionKey: @"Not enough memory for NBT document." }];
+			}
+		}
+		else
+		{
+			JANBTSetValidationError(outError, &builder.failure);
+		}
+		return NO;
+	}
+	
+	_buffer = buffer;
+	_count = builder.count;
+	_rootName = JANBTStringFromStringRef(rootName);
+	return YES;
+}
+
+
+- (JANBTTape) tape
+{
+	return (JANBTTape){ _entries, _buffer.bytes, _count };
+}
+
+
+- (NSString *) rootName
+{
+	return _rootName;
+}
+
+
+- (id) objectAtIndex:(JANBTTapeIndex)index options:(JANBTReadingOptions)options
+{
+	NSParameterAssert(index < _count);
+	
+	BOOL mutableContainers = (options & JANBTReadingOptionsMutableContainers) != 0;
+	BOOL mutableLeaves = (options & JANBTReadingOptionsMutableLeaves) != 0;
+	
+	id result;
+	@autoreleasepool
+	{
+		result = [self objectAtIndex:index mutableContainers:mutableContainers mutableLeaves:mutableLeaves];
+	}
+	return result;
+}
+
+
+- (id) objectAtIndex:(JANBTTapeIndex)index mutableContainers:(BOOL)mutableContainers mutableLeaves:(BOOL)mutableLeaves
+{
+	JANBTTape tape = self.tape;
+	const JANBTTapeEntry *entry = &_entries[index];
+	const uint8_t *payload = tape.bytes + entry->payloadOffset;
+	JANBTTagType type = entry->type;
+	
+	switch (type)
+	{
+		case kJANBTTagByte:
+		case kJANBTTagShort:
+		case kJANBTTagInt:
+		case kJANBTTagLong:
+			return JANBTMakeInteger((NSInteger)JANBTTapeIntegerValue(tape, index), type);
+		
+		case kJANBTTagFloat:
+			return JANBTMakeFloat((Float32)JANBTTapeDoubleValue(tape, index));
+		
+		case kJANBTTagDouble:
+			return JANBTMakeDouble(JANBTTapeDoubleValue(tape, index));
+		
+		case kJANBTTagByteArray:
+			if (mutableLeaves)  return [[NSMutableData alloc] initWithBytes:payload length:entry->count];
+			return [[JANBTDataSlice alloc] initWithBackingData:_buffer bytes:payload length:entry->count];
+		
+		case kJANBTTagString:
+			if (mutableLeaves)  return [[NSMutableString alloc] initWithBytes:payload length:entry->count encoding:NSUTF8StringEncoding];
+			return JANBTMakeString((const char *)payload, entry->count);
+		
+		case kJANBTTagList:
+		{
+			NSMutableArray *array = [NSMutableArray arrayWithCapacity:entry->count];
+			JANBTTapeIndex child = index + 1;
+			for (uint32_t i = 0; i < entry->count; i++)
+			{
+				[array addObject:[self objectAtIndex:child mutableContainers:mutableContainers mutableLeaves:mutableLeaves]];
+				child = _entries[child].next;
+			}
+			
+			if (!mutableContainers)  array = [array copy];
+			array.NBTListElementType = entry->elementType;
+			return array;
+		}
+		
+		case kJANBTTagCompound:
+		{
+			NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:entry->count];
+			JANBTTapeIndex child = index + 1;
+			for (uint32_t i = 0; i < entry->count; i++)
+			{
+				JANBTStringRef name = JANBTTapeName(tape, child);
+				NSString *key = [_keyTable stringWithUTF8Bytes:name.bytes length:name.length];
+				dictionary[key] = [self objectAtIndex:child mutableContainers:mutableContainers mutableLeaves:mutableLeaves];
+				child = _entries[child].next;
+			}
+			
+			if (!mutableContainers)  dictionary = [dictionary copy];
+			return dictionary;
+		}
+		
+		case kJANBTTagIntArray:
+		{
+			int32_t *values = malloc(MAX(entry->count * sizeof *values, (size_t)1));
+			if (values == NULL)  return nil;
+			JANBTByteSwapInt32Array(values, payload, entry->count);
+			NSArray *array = [[JANBTIntArray alloc] initWithValuesNoCopy:values count:entry->count freeWhenDone:YES];
+			if (mutableContainers)
+			{
+				array = [array mutableCopy];
+				array.NBTListElementType = kJANBTTagIntArrayContent;
+			}
+			return array;
+		}
+		
+		case kJANBTTagLongArray:
+		{
+			int64_t *values = malloc(MAX(entry->count * sizeof *values, (size_t)1));
+			if (values == NULL)  return nil;
+			JANBTByteSwapInt64Array(values, payload, entry->count);
+			NSArray *array = [[JANBTLongArray alloc] initWithValuesNoCopy:values count:entry->count freeWhenDone:YES];
+			if (mutableContainers)
+			{
+				array = [array mutableCopy];
+				array.NBTListElementType = kJANBTTagLongArrayContent;
+			}
+			return array;
+		}
+		
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+	
+	return nil;
+}
+
+@end
+
+
+JANBTTapeIndex JANBTTapeMemberNamed(JANBTTape tape, JANBTTapeIndex compound, const char *name)
+{
+	NSCParameterAssert(compound < tape.count && tape.entries[compound].type == kJANBTTagCompound && name != NULL);
+	
+	JANBTTapeIndex child = compound + 1;
+	for (uint32_t i = 0; i < tape.entries[compound].count; i++)
+	{
+		if (JANBTStringRefIsEqualToCString(JANBTTapeName(tape, child), name))  return child;
+		child = tape.entries[child].next;
+	}
+	return kJANBTTapeNotFound;
+}
+
+
+JANBTTapeIndex JANBTTapeElementAtIndex(JANBTTape tape, JANBTTapeIndex list, uint32_t elementIndex)
+{
+	NSCParameterAssert(list < tape.count && tape.entries[list].type == kJANBTTagList);
+	
+	const JANBTTapeEntry *entry = &tape.entries[list];
+	if (elementIndex >= entry->count)  return kJANBTTapeNotFound;
+	
+	// Elements with no subtrees are consecutive.
+	if (entry->elementType != kJANBTTagList && entry->elementType != kJANBTTagCompound)  return list + 1 + elementIndex;
+	
+	JANBTTapeIndex child = list + 1;
+	for (uint32_t i = 0; i < elementIndex; i++)
+	{
+		child = tape.entries[child].next;
+	}
+	return child;
+}
+
+
+/*
+	Read a number. Returns YES with *outInteger set for integer types, or NO
+	with *outReal set for floating-point types. Anything else is 0.
+*/
+static BOOL ReadNumber(JANBTTape tape, JANBTTapeIndex index, int64_t *outInteger, double *outReal)
+{
+	NSCParameterAssert(index < tape.count);
+	
+	const JANBTTapeEntry *entry = &tape.entries[index];
+	JANBTTagType type = entry->type;
+	JANBTBufferCursor cursor = JANBTMakeBufferCursor(tape.bytes + entry->payloadOffset, JANBTFixedTagSize(type));
+	*outInteger = 0;
+	*outReal = 0;
+	
+	switch (type)
+	{
+		case kJANBTTagByte:
+		{
+			int8_t value;
+			JANBTCursorReadByte(&cursor, &value);
+			*outInteger = value;
+			return YES;
+		}
+		
+		case kJANBTTagShort:
+		{
+			int16_t value;
+			JANBTCursorReadShort(&cursor, &value);
+			*outInteger = value;
+			return YES;
+		}
+		
+		case kJANBTTagInt:
+		{
+			int32_t value;
+			JANBTCursorReadInt(&cursor, &value);
+			*outInteger = value;
+			return YES;
+		}
+		
+		case kJANBTTagLong:
+			JANBTCursorReadLong(&cursor, outInteger);
+			return YES;
+		
+		case kJANBTTagFloat:
+		{
+			Float32 value;
+			JANBTCursorReadFloat(&cursor, &value);
+			*outReal = value;
+			return NO;
+		}
+		
+		case kJANBTTagDouble:
+			JANBTCursorReadDouble(&cursor, outReal);
+			return NO;
+		
+		case kJANBTTagByteArray:
+		case kJANBTTagString:
+		case kJANBTTagList:
+		case kJANBTTagCompound:
+		case kJANBTTagIntArray:
+		case kJANBTTagLongArray:
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+	
+	return YES;
+}
+
+
+int64_t JANBTTapeIntegerValue(JANBTTape tape, JANBTTapeIndex index)
+{
+	int64_t integer;
+	double real;
+	if (ReadNumber(tape, index, &integer, &real))  return integer;
+	return (int64_t)real;
+}
+
+
+double JANBTTapeDoubleValue(JANBTTape tape, JANBTTapeIndex index)
+{
+	int64_t integer;
+	double real;
+	if (ReadNumber(tape, index, &integer, &real))  return (double)integer;
+	return real;
+}
+
+
+JANBTStringRef JANBTTapeStringValue(JANBTTape tape, JANBTTapeIndex index)
+{
+	NSCParameterAssert(index < tape.count && tape.entries[index].type == kJANBTTagString);
+	
+	const JANBTTapeEntry *entry = &tape.entries[index];
+	return (JANBTStringRef){ (const char *)tape.bytes + entry->payloadOffset, entry->count };
+}
+
+
+const uint8_t *JANBTTapeByteArrayBytes(JANBTTape tape, JANBTTapeIndex index)
+{
+	NSCParameterAssert(index < tape.count && tape.entries[index].type == kJANBTTagByteArray);
+	
+	return tape.bytes + tape.entries[index].payloadOffset;
+}
+
+
+uint32_t JANBTTapeCopyIntArray(JANBTTape tape, JANBTTapeIndex index, int32_t *values, uint32_t maxCount)
+{
+	NSCParameterAssert(index < tape.count && tape.entries[index].type == kJANBTTagIntArray);
+	
+	const JANBTTapeEntry *entry = &tape.entries[index];
+	uint32_t count = MIN(entry->count, maxCount);
+	JANBTByteSwapInt32Array(values, tape.bytes + entry->payloadOffset, count);
+	return count;
+}
+
+
+uint32_t JANBTTapeCopyLongArray(JANBTTape tape, JANBTTapeIndex index, int64_t *values, uint32_t maxCount)
+{
+	NSCParameterAssert(index < tape.count && tape.entries[index].type == kJANBTTagLongArray);
+	
+	const JANBTTapeEntry *entry = &tape.entries[index];
+	uint32_t count = MIN(entry->count, maxCount);
+	JANBTByteSwapInt64Array(values, tape.bytes + entry->payloadOffset, count);
+	return count;
+}
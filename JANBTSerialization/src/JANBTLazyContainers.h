@@ -0,0 +1,96 @@
+/*
+	JANBTLazyContainers.h
+
+	NSDictionary and NSArray subclasses produced for
+	JANBTReadingOptionsLazyContainers. When a lazy container is created, its
+	members are located by skipping over them in the decompressed buffer;
+	each member is parsed the first time it’s accessed and then kept. Member
+	compounds and lists are themselves lazy, so reading a couple of keys out
+	of a large NBT only parses the path to them.
+
+	Lazy containers are immutable and may be used from any thread.
+
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTSerialization.h"
+#import "JANBTTagType.h"
+#import "JANBTSchemaNode.h"
+
+@class JANBTStringTable;
+
+
+// The state shared by all lazy containers from one parse.
+@interface JANBTLazyDocument: NSObject
+
+// buffer must be immutable. schema may be nil.
+- (id) initWithBuffer:(NSData *)buffer
+			  options:(JANBTReadingOptions)options
+			 keyTable:(JANBTStringTable *)keyTable
+			   schema:(JANBTCompiledSchema *)schema;
+
+@property (readonly) NSData *buffer;
+@property (readonly) JANBTReadingOptions options;
+@property (readonly) JANBTStringTable *keyTable;
+
+@end
+
+
+// Where a member’s tag body starts in the buffer, and how to parse it.
+typedef struct JANBTLazyEntry
+{
+	const uint8_t			*bytes;
+	const JANBTSchemaNode	*schema;
+	JANBTTagType			type;
+} JANBTLazyEntry;
+
+
+@interface JANBTLazyCompound: NSDictionary
+
+/*
+	entries is an array of JANBTLazyEntry. indices maps each key to the
+	index of its entry; entries shadowed by a duplicate key are never used.
+*/
+- (id) initWithDocument:(JANBTLazyDocument *)document
+				entries:(NSData *)entries
+				indices:(NSDictionary *)indices;
+
+@end
+
+
+@interface JANBTLazyList: NSArray
+
+/*
+	Elements of fixed-size types are found at first + index * stride. For
+	other types, stride is 0 and starts is an array of count pointers to the
+	element bodies.
+*/
+- (id) initWithDocument:(JANBTLazyDocument *)document
+			elementType:(JANBTTagType)elementType
+				 schema:(const JANBTSchemaNode *)elementSchema
+				  count:(NSUInteger)count
+				  first:(const uint8_t *)first
+				 stride:(size_t)stride
+				 starts:(NSData *)starts;
+
+@end
@@ -0,0 +1,266 @@
+/*
+	JANBTLazyContainers.m
+
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTLazyContainers.h"
+#import "JANBTStreamParser.h"
+#include <stdatomic.h>
+
+
+/*
+	Members are cached in slots holding a retained object or NULL. Parsing a
+	member is idempotent, so threads racing on an empty slot both parse it
+	and the loser drops its copy; every caller sees the same object.
+*/
+typedef _Atomic(void *) ValueSlot;
+
+static ValueSlot *AllocateSlots(NSUInteger count);
+static void ReleaseSlots(ValueSlot *slots, NSUInteger count);
+static id ValueInSlot(ValueSlot *slot, JANBTLazyDocument *document, const JANBTLazyEntry *entry);
+
+
+@implementation JANBTLazyDocument
+{
+	JANBTCompiledSchema		*_schema;	// Owns the schema nodes referenced by entries.
+}
+
+
+- (id) initWithBuffer:(NSData *)buffer
+			  options:(JANBTReadingOptions)options
+			 keyTable:(JANBTStringTable *)keyTable
+			   schema:(JANBTCompiledSchema *)schema
+{
+	if ((self = [super init]))
+	{
+		_buffer = buffer;
+		_options = options;
+		_keyTable = keyTable;
+		_schema = schema;
+	}
+	return self;
+}
+
+@end
+
+
+@implementation JANBTLazyCompound
+{
+	JANBTLazyDocument		*_document;
+	NSData					*_entries;
+	NSDictionary			*_indices;
+	ValueSlot				*_values;
+	NSUInteger				_entryCount;
+}
+
+
+- (id) initWithDocument:(JANBTLazyDocument *)document
+				entries:(NSData *)entries
+				indices:(NSDictionary *)indices
+{
+	if ((self = [super init]))
+	{
+		_document = document;
+		_entries = entries;
+		_indices = indices;
+		_entryCount = entries.length / sizeof (JANBTLazyEntry);
+		_values = AllocateSlots(_entryCount);
+		if (_values == NULL)  return nil;
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	ReleaseSlots(_values, _entryCount);
+}
+
+
+- (NSUInteger) count
+{
+	return _indices.count;
+}
+
+
+- (id) objectForKey:(id)key
+{
+	NSNumber *index = _indices[key];
+	if (index == nil)  return nil;
+	
+	NSUInteger i = index.unsignedIntegerValue;
+	const JANBTLazyEntry *entries = _entries.bytes;
+	return ValueInSlot(&_values[i], _document, &entries[i]);
+}
+
+
+- (NSEnumerator *) keyEnumerator
+{
+	return _indices.keyEnumerator;
+}
+
+
+- (NSUInteger) countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)length
+{
+	return [_indices countByEnumeratingWithState:state objects:buffer count:length];
+}
+
+
+- (id) copyWithZone:(NSZone *)zone
+{
+	return self;
+}
+
+@end
+
+
+@implementation JANBTLazyList
+{
+	JANBTLazyDocument		*_document;
+	const JANBTSchemaNode	*_elementSchema;
+	NSUInteger				_count;
+	const uint8_t			*_first;
+	size_t					_stride;
+	NSData					*_starts;
+	ValueSlot				*_values;
+	JANBTTagType			_elementType;
+}
+
+
+- (id) initWithDocument:(JANBTLazyDocument *)document
+			elementType:(JANBTTagType)elementType
+				 schema:(const JANBTSchemaNode *)elementSchema
+				  count:(NSUInteger)count
+				  first:(const uint8_t *)first
+				 stride:(size_t)stride
+				 starts:(NSData *)starts
+{
+	NSParameterAssert(stride != 0 || starts.length == count * sizeof (const uint8_t *));
+	
+	if ((self = [super init]))
+	{
+		_document = document;
+		_elementType = elementType;
+		_elementSchema = elementSchema;
+		_count = count;
+		_first = first;
+		_stride = stride;
+		_starts = starts;
+		_values = AllocateSlots(count);
+		if (_values == NULL)  return nil;
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	ReleaseSlots(_values, _count);
+}
+
+
+- (NSUInteger) count
+{
+	return _count;
+}
+
+
+- (id) objectAtIndex:(NSUInteger)index
+{
+	if (index >= _count)  [NSException raise:NSRangeException format:@"Index %lu out of range for list of %lu elements.", (unsigned long)index, (unsigned long)_count];
+	
+	const uint8_t *bytes;
+	if (_stride != 0)  bytes = _first + index * _stride;
+	else  bytes = ((const uint8_t * const *)_starts.bytes)[index];
+	
+	JANBTLazyEntry entry = { bytes, _elementSchema, _elementType };
+	return ValueInSlot(&_values[index], _document, &entry);
+}
+
+
+- (id) copyWithZone:(NSZone *)zone
+{
+	return self;
+}
+
+
+- (JANBTTagType) ja_NBTListElementType
+{
+	// Matches the eager parser, which only records the element type when there’s no schema.
+	if (_elementSchema == NULL)  return _elementType;
+	return [super ja_NBTListElementType];
+}
+
+@end
+
+
+static ValueSlot *AllocateSlots(NSUInteger count)
+{
+	return calloc(MAX(count, 1U), sizeof (ValueSlot));
+}
+
+
+static void ReleaseSlots(ValueSlot *slots, NSUInteger count)
+{
+	if (slots == NULL)  return;
+	
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		void *value = atomic_load_explicit(&slots[i], memory_order_relaxed);
+		if (value != NULL)  CFRelease(value);
+	}
+	free(slots);
+}
+
+
+/*
+	The buffer was walked when the container was created, so structural
+	damage and invalid UTF-8 have already been reported. What can still go
+	wrong here is a schema mismatch deeper in the tree, or running out of
+	memory; since NSDictionary and NSArray accessors have no way to report
+	errors, those raise an exception.
+*/
+static id ValueInSlot(ValueSlot *slot, JANBTLazyDocument *document, const JANBTLazyEntry *entry)
+{
+	void *cached = atomic_load_explicit(slot, memory_order_acquire);
+	if (cached != NULL)  return (__bridge id)cached;
+	
+	NSError *error;
+	id value = [JANBTStreamParser lazyValueOfType:entry->type bytes:entry->bytes schema:entry->schema document:document error:&error];
+	if (value == nil)
+	{
+		@throw [NSException exceptionWithName:NSGenericException
+									   reason:[NSString stringWithFormat:@"Could not read lazily-parsed NBT: %@", error.localizedDescription]
+									 userInfo:error ? @{ NSUnderlyingErrorKey: error } : nil];
+	}
+	
+	void *expected = NULL;
+	void *retained = (void *)CFBridgingRetain(value);
+	if (!atomic_compare_exchange_strong_explicit(slot, &expected, retained, memory_order_acq_rel, memory_order_acquire))
+	{
+		CFRelease(retained);
+		return (__bridge id)expected;
+	}
+	return value;
+}
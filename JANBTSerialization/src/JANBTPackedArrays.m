@@ -0,0 +1,207 @@
+/*
+	JANBTPackedArrays.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTPackedArrays.h"
+#import "JANBTTagType.h"
+
+
+@implementation JANBTIntArray
+{
+	int32_t					*_values;
+	NSUInteger				_count;
+	BOOL					_freeWhenDone;
+}
+
+
+- (id) initWithValues:(const int32_t *)values count:(NSUInteger)count
+{
+	int32_t *copy = malloc(MAX(count, 1U) * sizeof *copy);
+	if (copy == NULL)  return nil;
+	if (count != 0)  memcpy(copy, values, count * sizeof *copy);
+	
+	return [self initWithValuesNoCopy:copy count:count freeWhenDone:YES];
+}
+
+
+- (id) initWithValuesNoCopy:(int32_t *)values count:(NSUInteger)count freeWhenDone:(BOOL)freeWhenDone
+{
+	if ((self = [super init]))
+	{
+		_values = values;
+		_count = count;
+		_freeWhenDone = freeWhenDone;
+	}
+	else if (freeWhenDone)
+	{
+		free(values);
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	if (_freeWhenDone)  free(_values);
+}
+
+
+- (const int32_t *) values
+{
+	return _values;
+}
+
+
+- (NSUInteger) count
+{
+	return _count;
+}
+
+
+- (id) objectAtIndex:(NSUInteger)index
+{
+	if (index >= _count)  [NSException raise:NSRangeException format:@"Index %lu out of range for int array of %lu elements.", (unsigned long)index, (unsigned long)_count];
+	return @(_values[index]);
+}
+
+
+- (BOOL) isEqualToArray:(NSArray *)other
+{
+	if ([other isKindOfClass:[JANBTIntArray class]])
+	{
+		JANBTIntArray *otherInts = (JANBTIntArray *)other;
+		return _count == otherInts->_count && memcmp(_values, otherInts->_values, _count * sizeof *_values) == 0;
+	}
+	return [super isEqualToArray:other];
+}
+
+
+- (id) copyWithZone:(NSZone *)zone
+{
+	return self;
+}
+
+
+- (JANBTTagType) ja_NBTType
+{
+	return kJANBTTagIntArray;
+}
+
+
+- (JANBTTagType) ja_NBTListElementType
+{
+	return kJANBTTagIntArrayContent;
+}
+
+@end
+
+
+@implementation JANBTLongArray
+{
+	int64_t					*_values;
+	NSUInteger				_count;
+	BOOL					_freeWhenDone;
+}
+
+
+- (id) initWithValues:(const int64_t *)values count:(NSUInteger)count
+{
+	int64_t *copy = malloc(MAX(count, 1U) * sizeof *copy);
+	if (copy == NULL)  return nil;
+	if (count != 0)  memcpy(copy, values, count * sizeof *copy);
+	
+	return [self initWithValuesNoCopy:copy count:count freeWhenDone:YES];
+}
+
+
+- (id) initWithValuesNoCopy:(int64_t *)values count:(NSUInteger)count freeWhenDone:(BOOL)freeWhenDone
+{
+	if ((self = [super init]))
+	{
+		_values = values;
+		_count = count;
+		_freeWhenDone = freeWhenDone;
+	}
+	else if (freeWhenDone)
+	{
+		free(values);
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	if (_freeWhenDone)  free(_values);
+}
+
+
+- (const int64_t *) values
+{
+	return _values;
+}
+
+
+- (NSUInteger) count
+{
+	return _count;
+}
+
+
+- (id) objectAtIndex:(NSUInteger)index
+{
+	if (index >= _count)  [NSException raise:NSRangeException format:@"Index %lu out of range for long array of %lu elements.", (unsigned long)index, (unsigned long)_count];
+	return @(_values[index]);
+}
+
+
+- (BOOL) isEqualToArray:(NSArray *)other
+{
+	if ([other isKindOfClass:[JANBTLongArray class]])
+	{
+		JANBTLongArray *otherLongs = (JANBTLongArray *)other;
+		return _count == otherLongs->_count && memcmp(_values, otherLongs->_values, _count * sizeof *_values) == 0;
+	}
+	return [super isEqualToArray:other];
+}
+
+
+- (id) copyWithZone:(NSZone *)zone
+{
+	return self;
+}
+
+
+- (JANBTTagType) ja_NBTType
+{
+	return kJANBTTagLongArray;
+}
+
+
+- (JANBTTagType) ja_NBTListElementType
+{
+	return kJANBTTagLongArrayContent;
+}
+
+@end
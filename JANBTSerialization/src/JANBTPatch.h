@@ -0,0 +1,66 @@
+/*
+	JANBTPatch.h
+	
+	Compiled form of the changes passed to
+	+[JANBTSerialization dataByPatchingNBTData:readingOptions:changes:writingOptions:schema:error:].
+	
+	A patch is a tree of compound member names and list indices, like
+	JANBTProjection but with values at the leaves. While splicing, the
+	encoder walks the original NBT alongside the tree, and only stops to
+	rewrite tags that have a node in the tree.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "JANBTReaderDelegate.h"
+
+
+@interface JANBTPatch: NSObject
+
+/*
+	Key paths are as for JANBTProjection, except that a component may be
+	suffixed with one or more list indices such as [3], and [*] is not
+	allowed. Returns nil and sets outError
+	(kJANBTSerializationInvalidKeyPathError) if a key path is malformed,
+	or if one key path is inside another.
+*/
++ (instancetype) patchWithChanges:(NSDictionary *)changes error:(NSError **)outError;
+
+// Returns nil if the member named name is unchanged.
+- (JANBTPatch *) childNamed:(JANBTStringRef)name;
+
+@property (readonly) NSArray *namedChildren;
+@property (readonly) NSArray *indexedChildren;	// Sorted by index.
+
+// The replacement value, NSNull to remove the tag, or nil if the changes are further down.
+@property (readonly) id value;
+
+@property (readonly) NSString *name;			// Compound members only.
+@property (readonly) uint32_t index;			// List elements only.
+@property (readonly) NSString *keyPath;
+@property (readonly) NSUInteger changeCount;	// Values at or below this node.
+
+// Set by the encoder when the node’s tag has been found.
+@property BOOL applied;
+
+@end
@@ -0,0 +1,195 @@
+/*
+	JANBTPatch.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTPatch.h"
+#import "JANBTSerialization.h"
+
+
+@implementation JANBTPatch
+{
+	// As in JANBTProjection, names are UTF-8 NSDatas, looked up linearly.
+	NSMutableArray			*_names;
+	NSMutableArray			*_namedChildren;
+	NSMutableDictionary		*_indexedChildrenByIndex;
+}
+
+
+static void SetKeyPathError(NSError **outError, NSString *keyPath, NSString *reason)
+{
+	if (outError != NULL)
+	{
+		NSString *message = [NSString stringWithFormat:@"Invalid NBT key path “%@”: %@", keyPath, reason];
+		*outError = [NSError errorWithDomain:kJANBTSerializationErrorDomain
+										code:kJANBTSerializationInvalidKeyPathError
+									userInfo:@{ NSLocalizedDescriptionKey: message }];
+	}
+}
+
+
++ (instancetype) patchWithChanges:(NSDictionary *)changes error:(NSError **)outError
+{
+	JANBTPatch *root = [self new];
+	root->_keyPath = @"";
+	NSCharacterSet *brackets = [NSCharacterSet characterSetWithCharactersInString:@"[]"];
+	NSMutableArray *path = [NSMutableArray array];
+	
+	for (NSString *keyPath in changes)
+	{
+		if (![keyPath isKindOfClass:[NSString class]])
+		{
+			SetKeyPathError(outError, keyPath.description, @"not a string.");
+			return nil;
+		}
+		
+		JANBTPatch *node = root;
+		[path removeAllObjects];
+		
+		for (NSString *component in [keyPath componentsSeparatedByString:@"."])
+		{
+			NSUInteger nameLength = [component rangeOfString:@"["].location;
+			if (nameLength == NSNotFound)  nameLength = component.length;
+			NSString *name = [component substringToIndex:nameLength];
+			
+			if (name.length == 0 || [name rangeOfCharacterFromSet:brackets].location != NSNotFound)
+			{
+				SetKeyPathError(outError, keyPath, @"empty or malformed member name.");
+				return nil;
+			}
+			
+			node = [node addChildNamed:name];
+			if (node != nil)  [path addObject:node];
+			
+			NSScanner *scanner = [NSScanner scannerWithString:[component substringFromIndex:nameLength]];
+			scanner.charactersToBeSkipped = nil;
+			while (node != nil && node.value == nil && !scanner.atEnd)
+			{
+				long long index;
+				if (![scanner scanString:@"[" intoString:NULL] || ![scanner scanLongLong:&index] || ![scanner scanString:@"]" intoString:NULL] || index < 0 || index > INT32_MAX)
+				{
+					SetKeyPathError(outError, keyPath, @"list indices must be non-negative integers in brackets.");
+					return nil;
+				}
+				node = [node addChildAtIndex:(uint32_t)index];
+				if (node != nil)  [path addObject:node];
+			}
+			
+			if (node == nil)
+			{
+				SetKeyPathError(outError, keyPath, @"refers to both a compound and a list.");
+				return nil;
+			}
+			
+			// A shorter key path already replaces everything below node.
+			if (node.value != nil)  break;
+		}
+		
+		if (node.value != nil || node.changeCount != 0)
+		{
+			SetKeyPathError(outError, keyPath, @"overlaps another change.");
+			return nil;
+		}
+		
+		node->_value = changes[keyPath];
+		root->_changeCount++;
+		for (JANBTPatch *ancestor in path)  ancestor->_changeCount++;
+	}
+	
+	[root sortIndexedChildren];
+	return root;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_names = [NSMutableArray new];
+		_namedChildren = [NSMutableArray new];
+		_indexedChildrenByIndex = [NSMutableDictionary new];
+	}
+	return self;
+}
+
+
+// Returns nil if self already has list elements.
+- (JANBTPatch *) addChildNamed:(NSString *)name
+{
+	if (_indexedChildrenByIndex.count != 0)  return nil;
+	
+	NSData *nameData = [name dataUsingEncoding:NSUTF8StringEncoding];
+	NSUInteger index = [_names indexOfObject:nameData];
+	if (index != NSNotFound)  return _namedChildren[index];
+	
+	JANBTPatch *child = [JANBTPatch new];
+	child->_name = name;
+	child->_keyPath = (_keyPath.length != 0) ? [NSString stringWithFormat:@"%@.%@", _keyPath, name] : name;
+	[_names addObject:nameData];
+	[_namedChildren addObject:child];
+	return child;
+}
+
+
+// Returns nil if self already has members.
+- (JANBTPatch *) addChildAtIndex:(uint32_t)index
+{
+	if (_namedChildren.count != 0)  return nil;
+	
+	JANBTPatch *child = _indexedChildrenByIndex[@(index)];
+	if (child == nil)
+	{
+		child = [JANBTPatch new];
+		child->_index = index;
+		child->_keyPath = [NSString stringWithFormat:@"%@[%u]", _keyPath, index];
+		_indexedChildrenByIndex[@(index)] = child;
+	}
+	return child;
+}
+
+
+- (void) sortIndexedChildren
+{
+	NSArray *indices = [_indexedChildrenByIndex.allKeys sortedArrayUsingSelector:@selector(compare:)];
+	_indexedChildren = [_indexedChildrenByIndex objectsForKeys:indices notFoundMarker:[NSNull null]];
+	
+	for (JANBTPatch *child in _namedChildren)  [child sortIndexedChildren];
+	for (JANBTPatch *child in _indexedChildren)  [child sortIndexedChildren];
+}
+
+
+- (JANBTPatch *) childNamed:(JANBTStringRef)name
+{
+	NSUInteger i, count = _names.count;
+	for (i = 0; i < count; i++)
+	{
+		NSData *candidate = _names[i];
+		if (candidate.length == name.length && memcmp(candidate.bytes, name.bytes, name.length) == 0)
+		{
+			return _namedChildren[i];
+		}
+	}
+	return nil;
+}
+
+@end
@@ -0,0 +1,58 @@
+/*
+	JANBTProjection.h
+	
+	Compiled form of the key paths passed to
+	+[JANBTSerialization NBTObjectWithData:rootName:options:schema:keyPaths:error:].
+	
+	A projection is a tree of compound member names. While parsing a compound
+	with a projection, members that aren’t in the tree are skipped using the
+	length prefixes in the NBT, without creating any objects. Leaf nodes mean
+	“everything below here”. Lists are transparent: the projection applies
+	to each element.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#import "JANBTReaderDelegate.h"
+
+
+@interface JANBTProjection: NSObject
+
+/*
+	Key paths are relative to the root compound, with components separated by
+	dots. A component may be suffixed with [*] to make it explicit that it
+	refers to a list; since lists are transparent, this is optional.
+	Returns nil and sets outError (kJANBTSerializationInvalidKeyPathError)
+	if a key path is malformed.
+*/
++ (instancetype) projectionWithKeyPaths:(id<NSFastEnumeration>)keyPaths error:(NSError **)outError;
+
+/*
+	Returns nil if the member named name should be skipped. If the returned
+	projection is a leaf, the member should be parsed in full.
+*/
+- (JANBTProjection *) childNamed:(JANBTStringRef)name;
+
+@property (readonly, getter=isLeaf) BOOL leaf;
+
+@end
@@ -0,0 +1,122 @@
+/*
+	JANBTProjection.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTProjection.h"
+#import "JANBTSerialization.h"
+
+
+@implementation JANBTProjection
+{
+	// Parallel arrays of UTF-8 names (NSData) and child projections. Projections are small, so lookup is linear.
+	NSMutableArray			*_names;
+	NSMutableArray			*_children;
+}
+
+
++ (instancetype) projectionWithKeyPaths:(id<NSFastEnumeration>)keyPaths error:(NSError **)outError
+{
+	JANBTProjection *root = [self new];
+	NSCharacterSet *brackets = [NSCharacterSet characterSetWithCharactersInString:@"[]"];
+	
+	for (NSString *keyPath in keyPaths)
+	{
+		JANBTProjection *node = root;
+		
+		for (NSString *component in [keyPath componentsSeparatedByString:@"."])
+		{
+			NSString *name = component;
+			while ([name hasSuffix:@"[*]"])  name = [name substringToIndex:name.length - 3];
+			
+			if (name.length == 0 || [name rangeOfCharacterFromSet:brackets].location != NSNotFound)
+			{
+				if (outError != NULL)
+				{
+					NSString *message = [NSString stringWithFormat:@"Invalid NBT key path “%@”.", keyPath];
+					*outError = [NSError errorWithDomain:kJANBTSerializationErrorDomain
+													code:kJANBTSerializationInvalidKeyPathError
+												userInfo:@{ NSLocalizedDescriptionKey: message }];
+				}
+				return nil;
+			}
+			
+			// A shorter key path already selects everything below node.
+			if (node.leaf)  break;
+			node = [node addChildNamed:name];
+		}
+		
+		[node makeLeaf];
+	}
+	
+	return root;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_names = [NSMutableArray new];
+		_children = [NSMutableArray new];
+	}
+	return self;
+}
+
+
+- (JANBTProjection *) addChildNamed:(NSString *)name
+{
+	NSData *nameData = [name dataUsingEncoding:NSUTF8StringEncoding];
+	NSUInteger index = [_names indexOfObject:nameData];
+	if (index != NSNotFound)  return _children[index];
+	
+	JANBTProjection *child = [JANBTProjection new];
+	[_names addObject:nameData];
+	[_children addObject:child];
+	return child;
+}
+
+
+- (void) makeLeaf
+{
+	_leaf = YES;
+	[_names removeAllObjects];
+	[_children removeAllObjects];
+}
+
+
+- (JANBTProjection *) childNamed:(JANBTStringRef)name
+{
+	NSUInteger i, count = _names.count;
+	for (i = 0; i < count; i++)
+	{
+		NSData *candidate = _names[i];
+		if (candidate.length == name.length && memcmp(candidate.bytes, name.bytes, name.length) == 0)
+		{
+			return _children[i];
+		}
+	}
+	return nil;
+}
+
+@end
@@ -0,0 +1,896 @@
+/*
+	JANBTPushParser.m
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTPushParser.h"
+#import "JANBTTagType.h"
+#import "JANBTTypedNumbers.h"
+#import "JANBTSchemaNode.h"
+#import "JANBTStringTable.h"
+#import "JANBTBufferCursor.h"
+#import "JANBTByteSwap.h"
+#import "JAZLibCompressor.h"
+
+
+/*
+	The parser is a state machine over the input, with an explicit stack of
+	open compounds and lists in place of JANBTStreamParser’s recursion.
+	Each state consumes one token; a token split across pieces of input is
+	collected in _pending, except for array contents, which are copied
+	straight into their final buffer as they arrive.
+
+	The three length states are each immediately followed by the state
+	that reads the bytes they measure.
+*/
+typedef enum
+{
+	kStateRootType,
+	kStateRootNameLength,
+	kStateRootName,
+	kStateMemberType,
+	kStateMemberNameLength,
+	kStateMemberName,
+	kStateTagBody,
+	kStateScalar,
+	kStateStringLength,
+	kStateString,
+	kStateArrayCount,
+	kStateArrayContents,
+	kStateListHeader,
+	kStateDone,
+	kStateFailed
+} ParserState;
+
+
+// An open compound or list. Objects are retained through CF, since ARC doesn’t allow them in structs.
+typedef struct
+{
+	CFTypeRef				container;		// NSMutableDictionary or NSMutableArray; NULL in delegate mode.
+	CFTypeRef				key;			// Compounds: key of the member being parsed.
+	const JANBTSchemaNode	*schema;
+	uint32_t				remaining;		// Lists: elements not yet started.
+	JANBTTagType			elementType;	// Lists only.
+	BOOL					isList;
+} Frame;
+
+
+enum
+{
+	// Don’t trust a list’s or array’s count for preallocation, since the elements may never arrive.
+	kMaxListPreallocation		= 1024
+};
+
+
+@interface JANBTPushParser ()
+
+- (BOOL) failWithCode:(NSInteger)errorCode underlyingError:(NSError *)underlyingError format:(NSString *)format, ... NS_FORMAT_FUNCTION(3, 4);
+
+@end
+
+
+@implementation JANBTPushParser
+{
+	ParserState				_state;
+	JANBTCompiledSchema		*_schema;
+	JANBTStringTable		*_keyTable;
+	JAZLibInflater			*_inflater;
+	BOOL					_mutableContainers;
+	BOOL					_mutableLeaves;
+	BOOL					_allowFragments;
+
+	id<JANBTReaderDelegate>	_delegate;
+	struct
+	{
+		unsigned				beginCompound: 1,
+								endCompound: 1,
+								beginList: 1,
+								endList: 1,
+								foundByte: 1,
+								foundShort: 1,
+								foundInt: 1,
+								foundLong: 1,
+								foundFloat: 1,
+								foundDouble: 1,
+								foundString: 1,
+								foundByteArray: 1,
+								foundIntArray: 1,
+								foundLongArray: 1;
+	}						_delegateResponds;
+
+	// The piece of input being parsed.
+	const uint8_t			*_next;
+	const uint8_t			*_end;
+
+	uint8_t					*_pending;
+	size_t					_pendingLength;
+	size_t					_pendingCapacity;
+
+	// The tag being parsed.
+	JANBTTagType			_type;
+	const JANBTSchemaNode	*_typeSchema;
+	uint32_t				_length;			// String length or array count.
+	uint8_t					*_array;
+	size_t					_arrayLength;
+	size_t					_arrayFilled;
+	size_t					_arrayCapacity;
+	BOOL					_ownsArray;
+
+	// Delegate mode: the tag’s name, copied so it survives between pieces of input.
+	char					*_nameBuffer;
+	JANBTStringRef			_name;
+	uint8_t					*_scratch;
+	size_t					_scratchCapacity;
+
+	Frame					*_frames;
+	NSUInteger				_depth;
+	NSUInteger				_frameCapacity;
+}
+
+
+- (id) initWithOptions:(JANBTReadingOptions)options schema:(id)schema error:(NSError **)outError
+{
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:outError];
+	if (schema != nil && compiledSchema == nil)  return nil;
+
+	if ((self = [self initWithOptions:options]))
+	{
+		_schema = compiledSchema;
+		_mutableContainers = options & JANBTReadingOptionsMutableContainers;
+		_mutableLeaves = options & JANBTReadingOptionsMutableLeaves;
+
+		if (options & JANBTReadingOptionsSharedKeyTable)  _keyTable = [JANBTStringTable sharedTable];
+		else  _keyTable = [JANBTStringTable new];
+	}
+	return self;
+}
+
+
+- (id) initWithOptions:(JANBTReadingOptions)options delegate:(id<JANBTReaderDelegate>)delegate
+{
+	NSParameterAssert(delegate != nil);
+
+	if ((self = [self initWithOptions:options]))
+	{
+		_delegate = delegate;
+		_delegateResponds.beginCompound = [delegate respondsToSelector:@selector(beginCompoundNamed:)];
+		_delegateResponds.endCompound = [delegate respondsToSelector:@selector(endCompound)];
+		_delegateResponds.beginList = [delegate respondsToSelector:@selector(beginListNamed:count:)];
+		_delegateResponds.endList = [delegate respondsToSelector:@selector(endList)];
+		_delegateResponds.foundByte = [delegate respondsToSelector:@selector(foundByte:named:)];
+		_delegateResponds.foundShort = [delegate respondsToSelector:@selector(foundShort:named:)];
+		_delegateResponds.foundInt = [delegate respondsToSelector:@selector(foundInt:named:)];
+		_delegateResponds.foundLong = [delegate respondsToSelector:@selector(foundLong:named:)];
+		_delegateResponds.foundFloat = [delegate respondsToSelector:@selector(foundFloat:named:)];
+		_delegateResponds.foundDouble = [delegate respondsToSelector:@selector(foundDouble:named:)];
+		_delegateResponds.foundString = [delegate respondsToSelector:@selector(foundString:named:)];
+		_delegateResponds.foundByteArray = [delegate respondsToSelector:@selector(foundByteArray:length:named:)];
+		_delegateResponds.foundIntArray = [delegate respondsToSelector:@selector(foundIntArray:count:named:)];
+		_delegateResponds.foundLongArray = [delegate respondsToSelector:@selector(foundLongArray:count:named:)];
+
+		_nameBuffer = malloc(UINT16_MAX);
+		if (_nameBuffer == NULL)  return nil;
+	}
+	return self;
+}
+
+
+- (id) initWithOptions:(JANBTReadingOptions)options
+{
+	if ((self = [super init]))
+	{
+		_allowFragments = options & JANBTReadingOptionsAllowFragments;
+
+		if (!(options & JANBTReadingOptionsUncompressed))
+		{
+			_inflater = [JAZLibInflater checkOutInflater];
+			if (![_inflater beginIncrementalInflateWithMode:kJAZLibCompressionAutoDetect error:NULL])  return nil;
+		}
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	[self cleanUp];
+	free(_pending);
+	free(_nameBuffer);
+	free(_scratch);
+	free(_frames);
+}
+
+
+// Release everything only needed while parsing.
+- (void) cleanUp
+{
+	while (_depth > 0)
+	{
+		Frame *frame = &_frames[--_depth];
+		if (frame->container != NULL)  CFRelease(frame->container);
+		if (frame->key != NULL)  CFRelease(frame->key);
+	}
+
+	if (_ownsArray)  free(_array);
+	_array = NULL;
+	_ownsArray = NO;
+
+	[_inflater checkIn];
+	_inflater = nil;
+	_delegate = nil;
+}
+
+
+- (JANBTPushParserStatus) status
+{
+	switch (_state)
+	{
+		case kStateDone:
+			return JANBTPushParserDone;
+
+		case kStateFailed:
+			return JANBTPushParserFailed;
+
+		default:
+			return JANBTPushParserNeedsMoreData;
+	}
+}
+
+
+static inline BOOL IsFinished(JANBTPushParser *self)
+{
+	return self->_state == kStateDone || self->_state == kStateFailed;
+}
+
+
+- (JANBTPushParserStatus) feedBytes:(const void *)bytes length:(NSUInteger)length
+{
+	if (IsFinished(self))  return self.status;
+
+	if (_inflater == nil)
+	{
+		[self parseBytes:bytes length:length];
+	}
+	else
+	{
+		NSError *error;
+		BOOL OK = [_inflater inflateBytes:bytes length:length error:&error handler:^BOOL(const uint8_t *inflated, NSUInteger inflatedLength)
+		{
+			[self parseBytes:inflated length:inflatedLength];
+			return !IsFinished(self);
+		}];
+
+		if (!OK)
+		{
+			[self failWithCode:kJANBTSerializationCompressionError underlyingError:error format:@"Could not decompress NBT data: %@", error.localizedFailureReason ?: error.localizedDescription];
+		}
+		else if (_inflater.incrementalInflateFinished && !IsFinished(self))
+		{
+			[self failWithCode:kJANBTSerializationReadError underlyingError:nil format:@"Premature end of file."];
+		}
+	}
+
+	if (IsFinished(self))  [self cleanUp];
+	return self.status;
+}
+
+
+- (JANBTPushParserStatus) feedData:(NSData *)data
+{
+	return [self feedBytes:data.bytes length:data.length];
+}
+
+
+- (JANBTPushParserStatus) feedDispatchData:(dispatch_data_t)data
+{
+	dispatch_data_apply(data, ^bool(dispatch_data_t region, size_t offset, const void *buffer, size_t size)
+	{
+		return [self feedBytes:buffer length:size] == JANBTPushParserNeedsMoreData;
+	});
+	return self.status;
+}
+
+
+- (JANBTPushParserStatus) finish
+{
+	if (!IsFinished(self))
+	{
+		[self failWithCode:kJANBTSerializationReadError underlyingError:nil format:@"Premature end of file."];
+		[self cleanUp];
+	}
+	return self.status;
+}
+
+
+- (BOOL) failWithCode:(NSInteger)errorCode underlyingError:(NSError *)underlyingError format:(NSString *)format, ...
+{
+	if (_error == nil)
+	{
+		format = [[NSBundle bundleForClass:[JANBTSerialization class]] localizedStringForKey:format value:format table:nil];
+		va_list args;
+		va_start(args, format);
+		NSString *message = [[NSString alloc] initWithFormat:format arguments:args];
+		va_end(args);
+
+		NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject:message forKey:NSLocalizedDescriptionKey];
+		if (underlyingError != nil)  userInfo[NSUnderlyingErrorKey] = underlyingError;
+		_error = [NSError errorWithDomain:kJANBTSerializationErrorDomain code:errorCode userInfo:userInfo];
+	}
+
+	_state = kStateFailed;
+	return NO;
+}
+
+
+static inline uint32_t ReadCount(const uint8_t *bytes)
+{
+	uint32_t raw;
+	memcpy(&raw, bytes, sizeof raw);
+	return CFSwapInt32BigToHost(raw);
+}
+
+
+/*
+	Returns a pointer to the next length bytes, which are either in the
+	input or collected in _pending, or NULL if the input runs out first.
+*/
+static const uint8_t *Take(JANBTPushParser *self, size_t length)
+{
+	size_t available = (size_t)(self->_end - self->_next);
+	if (__builtin_expect(self->_pendingLength == 0 && available >= length, 1))
+	{
+		const uint8_t *result = self->_next;
+		self->_next += length;
+		return result;
+	}
+
+	if (self->_pendingCapacity < length)
+	{
+		size_t capacity = MAX(length, (size_t)256);
+		uint8_t *pending = realloc(self->_pending, capacity);
+		if (pending == NULL)
+		{
+			[self failWithCode:kJANBTSerializationMemoryError underlyingError:nil format:@"Not enough memory for NBT value of length %zu.", length];
+			return NULL;
+		}
+		self->_pending = pending;
+		self->_pendingCapacity = capacity;
+	}
+
+	size_t copied = MIN(length - self->_pendingLength, available);
+	memcpy(self->_pending + self->_pendingLength, self->_next, copied);
+	self->_next += copied;
+	self->_pendingLength += copied;
+	if (self->_pendingLength < length)  return NULL;
+
+	self->_pendingLength = 0;
+	return self->_pending;
+}
+
+
+- (void) parseBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+	_next = bytes;
+	_end = bytes + length;
+
+	@autoreleasepool
+	{
+		while (!IsFinished(self) && [self step])  {}
+	}
+
+	_next = _end = NULL;
+}
+
+
+// Consume one token. Returns NO if more input is needed, or if parsing has finished.
+- (BOOL) step
+{
+	const uint8_t *bytes;
+
+	switch (_state)
+	{
+		case kStateRootType:
+			if (!(bytes = Take(self, 1)))  return NO;
+			_type = bytes[0];
+			if (_type != kJANBTTagCompound && !_allowFragments)
+			{
+				return [self failWithCode:kJANBTSerializationWrongTypeError underlyingError:nil format:@"NBT root is not a compound, and fragments are not permitted."];
+			}
+
+			// An empty fragment has neither name nor body; the result is nil.
+			_state = (_type == kJANBTTagEnd) ? kStateDone : kStateRootNameLength;
+			return YES;
+
+		case kStateRootNameLength:
+		case kStateMemberNameLength:
+		case kStateStringLength:
+			if (!(bytes = Take(self, 2)))  return NO;
+			_length = (uint16_t)(bytes[0] << 8 | bytes[1]);
+			_state++;
+			return YES;
+
+		case kStateRootName:
+			if (!(bytes = Take(self, _length)))  return NO;
+			_rootName = JANBTMakeString((const char *)bytes, _length);
+			if (_rootName == nil)  return [self failWithCode:kJANBTSerializationReadError underlyingError:nil format:@"Invalid UTF-8 string."];
+			[self setName:bytes length:_length];
+			_typeSchema = _schema.rootNode;
+			_state = kStateTagBody;
+			return YES;
+
+		case kStateMemberType:
+			if (!(bytes = Take(self, 1)))  return NO;
+			if (bytes[0] == kJANBTTagEnd)  return [self endContainer];
+			_type = bytes[0];
+			_state = kStateMemberNameLength;
+			return YES;
+
+		case kStateMemberName:
+			if (!(bytes = Take(self, _length)))  return NO;
+			return [self beginMemberNamed:bytes];
+
+		case kStateTagBody:
+			return [self beginTagBody];
+
+		case kStateScalar:
+			if (!(bytes = Take(self, JANBTFixedTagSize(_type))))  return NO;
+			return [self finishScalar:bytes];
+
+		case kStateString:
+			if (!(bytes = Take(self, _length)))  return NO;
+			return [self finishString:bytes];
+
+		case kStateArrayCount:
+			if (!(bytes = Take(self, 4)))  return NO;
+			return [self beginArrayOfCount:ReadCount(bytes)];
+
+		case kStateArrayContents:
+		{
+			size_t copied = MIN((size_t)(_end - _next), _arrayLength - _arrayFilled);
+			if (_array != NULL)
+			{
+				if (_arrayFilled + copied > _arrayCapacity && ![self growArrayToHold:_arrayFilled + copied])  return NO;
+				memcpy(_array + _arrayFilled, _next, copied);
+			}
+			_next += copied;
+			_arrayFilled += copied;
+			if (_arrayFilled < _arrayLength)  return NO;
+			return [self finishArray];
+		}
+
+		case kStateListHeader:
+			if (!(bytes = Take(self, 5)))  return NO;
+			return [self beginListOfType:bytes[0] count:ReadCount(bytes + 1)];
+
+		case kStateDone:
+		case kStateFailed:
+			;
+	}
+	return NO;
+}
+
+
+- (void) setName:(const uint8_t *)bytes length:(NSUInteger)length
+{
+	if (_delegate == nil)  return;
+
+	memcpy(_nameBuffer, bytes, length);
+	_name = (JANBTStringRef){ _nameBuffer, length };
+}
+
+
+- (BOOL) beginMemberNamed:(const uint8_t *)bytes
+{
+	Frame *frame = &_frames[_depth - 1];
+	_typeSchema = JANBTSchemaNodeMemberNamed(frame->schema, (const char *)bytes, _length);
+
+	if (_delegate == nil)
+	{
+		NSString *key = [_keyTable stringWithUTF8Bytes:(const char *)bytes length:_length];
+		if (key == nil)  return [self failWithCode:kJANBTSerializationReadError underlyingError:nil format:@"Invalid UTF-8 string."];
+		frame->key = CFBridgingRetain(key);
+	}
+	else
+	{
+		[self setName:bytes length:_length];
+	}
+
+	_state = kStateTagBody;
+	return YES;
+}
+
+
+- (BOOL) beginTagBody
+{
+	if (!JANBTIsKnownTagType(_type))
+	{
+		return [self failWithCode:kJANBTSerializationUnknownTagError underlyingError:nil format:@"Unknown NBT tag %u.", _type];
+	}
+	if (!JANBTSchemaNodeAcceptsTagType(_typeSchema, _type))
+	{
+		return [self failWithCode:kJANBTSerializationWrongTypeError underlyingError:nil format:@"Wrong type in NBT - expected %@, got %@.", JANBTTagNameFromTagType(JANBTSchemaNodeType(_typeSchema)), JANBTTagNameFromTagType(_type)];
+	}
+
+	switch (_type)
+	{
+		case kJANBTTagByte:
+		case kJANBTTagShort:
+		case kJANBTTagInt:
+		case kJANBTTagLong:
+		case kJANBTTagFloat:
+		case kJANBTTagDouble:
+			_state = kStateScalar;
+			return YES;
+
+		case kJANBTTagString:
+			_state = kStateStringLength;
+			return YES;
+
+		case kJANBTTagByteArray:
+		case kJANBTTagIntArray:
+		case kJANBTTagLongArray:
+			_state = kStateArrayCount;
+			return YES;
+
+		case kJANBTTagList:
+			_state = kStateListHeader;
+			return YES;
+
+		case kJANBTTagCompound:
+			if (_delegateResponds.beginCompound)  [_delegate beginCompoundNamed:_name];
+			if (![self pushFrameWithContainer:(_delegate == nil) ? [NSMutableDictionary new] : nil])  return NO;
+			_state = kStateMemberType;
+			return YES;
+
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+
+	return [self failWithCode:kJANBTSerializationUnknownTagError underlyingError:nil format:@"Unknown NBT tag %u.", _type];
+}
+
+
+- (BOOL) pushFrameWithContainer:(id)container
+{
+	if (_depth == _frameCapacity)
+	{
+		NSUInteger capacity = MAX(_frameCapacity * 2, (NSUInteger)16);
+		Frame *frames = realloc(_frames, capacity * sizeof *frames);
+		if (frames == NULL)  return [self failWithCode:kJANBTSerializationMemoryError underlyingError:nil format:@"Not enough memory for NBT nesting depth %lu.", (unsigned long)_depth];
+		_frames = frames;
+		_frameCapacity = capacity;
+	}
+
+	_frames[_depth++] = (Frame)
+	{
+		.container = (container != nil) ? CFBridgingRetain(container) : NULL,
+		.schema = _typeSchema
+	};
+	return YES;
+}
+
+
+- (BOOL) beginListOfType:(JANBTTagType)elementType count:(uint32_t)count
+{
+	if (_delegateResponds.beginList)  [_delegate beginListNamed:_name count:count];
+
+	NSMutableArray *array;
+	if (_delegate == nil)  array = [NSMutableArray arrayWithCapacity:MIN(count, (uint32_t)kMaxListPreallocation)];
+	if (![self pushFrameWithContainer:array])  return NO;
+
+	Frame *frame = &_frames[_depth - 1];
+	frame->isList = YES;
+	frame->elementType = elementType;
+	frame->remaining = count;
+	return [self beginNextListElement];
+}
+
+
+- (BOOL) beginNextListElement
+{
+	Frame *frame = &_frames[_depth - 1];
+	if (frame->remaining == 0)  return [self endContainer];
+
+	frame->remaining--;
+	_type = frame->elementType;
+	_typeSchema = frame->schema ? frame->schema->element : NULL;
+	_name = (JANBTStringRef){ NULL, 0 };
+	_state = kStateTagBody;
+	return YES;
+}
+
+
+- (BOOL) endContainer
+{
+	Frame frame = _frames[--_depth];
+	id container = CFBridgingRelease(frame.container);
+	if (frame.key != NULL)  CFRelease(frame.key);
+
+	if (frame.isList)
+	{
+		if (_delegateResponds.endList)  [_delegate endList];
+		if (container != nil)
+		{
+			NSArray *array = _mutableContainers ? container : [container copy];
+			if (frame.schema == NULL || frame.schema->element == NULL)  array.NBTListElementType = frame.elementType;
+			container = array;
+		}
+	}
+	else
+	{
+		if (_delegateResponds.endCompound)  [_delegate endCompound];
+		if (container != nil && !_mutableContainers)  container = [container copy];
+	}
+
+	return [self finishValue:container];
+}
+
+
+// Store a completed value in its container, and move on to the next tag.
+- (BOOL) finishValue:(id)value
+{
+	if (_depth == 0)
+	{
+		_root = value;
+		_state = kStateDone;
+		return NO;
+	}
+
+	Frame *frame = &_frames[_depth - 1];
+	if (frame->isList)
+	{
+		if (value != nil)  [(__bridge NSMutableArray *)frame->container addObject:value];
+		return [self beginNextListElement];
+	}
+
+	if (value != nil)  [(__bridge NSMutableDictionary *)frame->container setObject:value forKey:(__bridge NSString *)frame->key];
+	if (frame->key != NULL)  CFRelease(frame->key);
+	frame->key = NULL;
+
+	_state = kStateMemberType;
+	return YES;
+}
+
+
+- (BOOL) finishScalar:(const uint8_t *)bytes
+{
+	JANBTBufferCursor cursor = JANBTMakeBufferCursor(bytes, JANBTFixedTagSize(_type));
+	BOOL typed = (_typeSchema == NULL);
+	id value;
+
+	switch (_type)
+	{
+		case kJANBTTagByte:
+		{
+			int8_t number;
+			JANBTCursorReadByte(&cursor, &number);
+			if (_delegateResponds.foundByte)  [_delegate foundByte:number named:_name];
+			else if (_delegate == nil)  value = typed ? JANBTMakeInteger(number, kJANBTTagByte) : [NSNumber numberWithChar:number];
+			break;
+		}
+
+		case kJANBTTagShort:
+		{
+			int16_t number;
+			JANBTCursorReadShort(&cursor, &number);
+			if (_delegateResponds.foundShort)  [_delegate foundShort:number named:_name];
+			else if (_delegate == nil)  value = typed ? JANBTMakeInteger(number, kJANBTTagShort) : [NSNumber numberWithShort:number];
+			break;
+		}
+
+		case kJANBTTagInt:
+		{
+			int32_t number;
+			JANBTCursorReadInt(&cursor, &number);
+			if (_delegateResponds.foundInt)  [_delegate foundInt:number named:_name];
+			else if (_delegate == nil)  value = typed ? JANBTMakeInteger(number, kJANBTTagInt) : [NSNumber numberWithInt:number];
+			break;
+		}
+
+		case kJANBTTagLong:
+		{
+			int64_t number;
+			JANBTCursorReadLong(&cursor, &number);
+			if (_delegateResponds.foundLong)  [_delegate foundLong:number named:_name];
+			else if (_delegate == nil)  value = typed ? JANBTMakeInteger(number, kJANBTTagLong) : [NSNumber numberWithLong:number];
+			break;
+		}
+
+		case kJANBTTagFloat:
+		{
+			Float32 number;
+			JANBTCursorReadFloat(&cursor, &number);
+			if (_delegateResponds.foundFloat)  [_delegate foundFloat:number named:_name];
+			else if (_delegate == nil)  value = typed ? JANBTMakeFloat(number) : [NSNumber numberWithFloat:number];
+			break;
+		}
+
+		case kJANBTTagDouble:
+		{
+			Float64 number;
+			JANBTCursorReadDouble(&cursor, &number);
+			if (_delegateResponds.foundDouble)  [_delegate foundDouble:number named:_name];
+			else if (_delegate == nil)  value = typed ? JANBTMakeDouble(number) : [NSNumber numberWithDouble:number];
+			break;
+		}
+
+		case kJANBTTagByteArray:
+		case kJANBTTagString:
+		case kJANBTTagList:
+		case kJANBTTagCompound:
+		case kJANBTTagIntArray:
+		case kJANBTTagLongArray:
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+
+	return [self finishValue:value];
+}
+
+
+- (BOOL) finishString:(const uint8_t *)bytes
+{
+	if (_delegate != nil)
+	{
+		if (_delegateResponds.foundString)  [_delegate foundString:(JANBTStringRef){ (const char *)bytes, _length } named:_name];
+		return [self finishValue:nil];
+	}
+
+	NSString *string;
+	if (_mutableLeaves)  string = [[NSMutableString alloc] initWithBytes:bytes length:_length encoding:NSUTF8StringEncoding];
+	else  string = JANBTMakeString((const char *)bytes, _length);
+	if (string == nil)  return [self failWithCode:kJANBTSerializationReadError underlyingError:nil format:@"Invalid UTF-8 string."];
+
+	return [self finishValue:string];
+}
+
+
+- (BOOL) beginArrayOfCount:(uint32_t)count
+{
+	size_t elementSize = (_type == kJANBTTagByteArray) ? 1 : (_type == kJANBTTagIntArray) ? sizeof (int32_t) : sizeof (int64_t);
+	_length = count;
+	_arrayLength = (size_t)count * elementSize;
+	_arrayFilled = 0;
+	_array = NULL;
+	_ownsArray = NO;
+
+	// The buffer grows as contents arrive; see -growArrayToHold:.
+	size_t initialCapacity = MIN(count, (uint32_t)kMaxListPreallocation) * elementSize;
+
+	BOOL wanted;
+	switch (_type)
+	{
+		case kJANBTTagByteArray:	wanted = _delegateResponds.foundByteArray; break;
+		case kJANBTTagIntArray:		wanted = _delegateResponds.foundIntArray; break;
+		default:					wanted = _delegateResponds.foundLongArray; break;
+	}
+
+	if (_delegate == nil)
+	{
+		_array = malloc(MAX(initialCapacity, (size_t)1));
+		_arrayCapacity = initialCapacity;
+		_ownsArray = YES;
+	}
+	else if (wanted)
+	{
+		// Delegates only borrow array contents, so one buffer serves for all of them.
+		if (_scratch == NULL || _scratchCapacity < initialCapacity)
+		{
+			free(_scratch);
+			_scratch = malloc(MAX(initialCapacity, (size_t)1));
+			_scratchCapacity = (_scratch != NULL) ? initialCapacity : 0;
+		}
+		_array = _scratch;
+		_arrayCapacity = _scratchCapacity;
+	}
+	// Otherwise the contents are skipped.
+
+	if (_array == NULL && (_delegate == nil || wanted))
+	{
+		return [self failWithCode:kJANBTSerializationMemoryError underlyingError:nil format:@"Not enough memory for array of %u elements.", count];
+	}
+
+	_state = kStateArrayContents;
+	return YES;
+}
+
+
+- (BOOL) growArrayToHold:(size_t)needed
+{
+	size_t capacity = MIN(MAX(_arrayCapacity * 2, needed), _arrayLength);
+	uint8_t *grown = realloc(_array, capacity);
+	if (grown == NULL)
+	{
+		if (_ownsArray)  free(_array);
+		_array = NULL;
+		_ownsArray = NO;
+		return [self failWithCode:kJANBTSerializationMemoryError underlyingError:nil format:@"Not enough memory for array of %u elements.", _length];
+	}
+
+	_array = grown;
+	_arrayCapacity = capacity;
+	if (!_ownsArray)
+	{
+		_scratch = grown;
+		_scratchCapacity = capacity;
+	}
+	return YES;
+}
+
+
+- (BOOL) finishArray
+{
+	uint8_t *bytes = _array;
+	uint32_t count = _length;
+	BOOL ownsArray = _ownsArray;
+	_array = NULL;
+	_ownsArray = NO;
+
+	if (_type == kJANBTTagIntArray && bytes != NULL)  JANBTByteSwapInt32Array(bytes, bytes, count);
+	if (_type == kJANBTTagLongArray && bytes != NULL)  JANBTByteSwapInt64Array(bytes, bytes, count);
+
+	if (_delegate != nil)
+	{
+		if (bytes != NULL)
+		{
+			if (_type == kJANBTTagByteArray)  [_delegate foundByteArray:bytes length:count named:_name];
+			else if (_type == kJANBTTagIntArray)  [_delegate foundIntArray:(const int32_t *)bytes count:count named:_name];
+			else  [_delegate foundLongArray:(const int64_t *)bytes count:count named:_name];
+		}
+		return [self finishValue:nil];
+	}
+
+	NSParameterAssert(ownsArray);
+	id value;
+	if (_type == kJANBTTagByteArray)
+	{
+		Class dataClass = _mutableLeaves ? [NSMutableData class] : [NSData class];
+		value = [[dataClass alloc] initWithBytesNoCopy:bytes length:count freeWhenDone:YES];
+	}
+	else
+	{
+		NSArray *array;
+		if (_type == kJANBTTagIntArray)  array = [[JANBTIntArray alloc] initWithValuesNoCopy:(int32_t *)bytes count:count freeWhenDone:YES];
+		else  array = [[JANBTLongArray alloc] initWithValuesNoCopy:(int64_t *)bytes count:count freeWhenDone:YES];
+
+		if (array != nil && _mutableContainers)
+		{
+			array = [array mutableCopy];
+			array.NBTListElementType = (_type == kJANBTTagIntArray) ? kJANBTTagIntArrayContent : kJANBTTagLongArrayContent;
+		}
+		value = array;
+	}
+
+	if (value == nil)  return [self failWithCode:kJANBTSerializationMemoryError underlyingError:nil format:@"Not enough memory for array of %u elements.", count];
+	return [self finishValue:value];
+}
+
+@end
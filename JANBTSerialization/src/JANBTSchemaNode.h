@@ -0,0 +1,93 @@
+/*
+	JANBTSchemaNode.h
+
+	Internal representation of a JANBTCompiledSchema: a tree of C structs
+	owned by the compiled schema object. A NULL node means “no schema”, i.e.
+	any type is accepted.
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTCompiledSchema.h"
+#import "JANBTTagType.h"
+
+
+typedef struct JANBTSchemaNode JANBTSchemaNode;
+
+
+typedef struct JANBTSchemaMember
+{
+	uint32_t				hash;
+	uint32_t				nameLength;
+	const char				*name;		// UTF-8, not terminated. NULL for empty slots.
+	const JANBTSchemaNode	*node;
+} JANBTSchemaMember;
+
+
+struct JANBTSchemaNode
+{
+	JANBTTagType			type;
+	const JANBTSchemaNode	*element;	// Lists only.
+
+	// Compounds only: open-addressed hash table with memberMask + 1 slots.
+	const JANBTSchemaMember	*members;
+	uint32_t				memberMask;
+};
+
+
+@interface JANBTCompiledSchema (Internal)
+
+/*	Returns schema if it is already compiled, otherwise the cached
+	compilation of the property list schema. Returns nil for a nil schema,
+	and nil with outError set if the schema is invalid.
+*/
++ (JANBTCompiledSchema *) compiledSchemaForSchema:(id)schema error:(NSError **)outError;
+
+@property (readonly) const JANBTSchemaNode *rootNode;
+
+@end
+
+
+// The member schema for a compound key, or NULL if node is not a compound or doesn’t mention the key.
+const JANBTSchemaNode *JANBTSchemaNodeMemberNamed(const JANBTSchemaNode *node, const char *name, NSUInteger length);
+const JANBTSchemaNode *JANBTSchemaNodeMemberForKey(const JANBTSchemaNode *node, NSString *key);
+
+
+static inline JANBTTagType JANBTSchemaNodeType(const JANBTSchemaNode *node)
+{
+	return node != NULL ? node->type : kJANBTTagAny;
+}
+
+
+static inline BOOL JANBTIsNumericalSchemaNode(const JANBTSchemaNode *node)
+{
+	return node == NULL || JANBTIsNumericalTagType(node->type);
+}
+
+
+// Whether a tag of type can be read with node, following the parser’s rules: any number will do for a numerical node.
+static inline BOOL JANBTSchemaNodeAcceptsTagType(const JANBTSchemaNode *node, JANBTTagType type)
+{
+	if (node == NULL)  return YES;
+	if (JANBTIsNumericalTagType(type))  return JANBTIsNumericalTagType(node->type);
+	return node->type == type;
+}
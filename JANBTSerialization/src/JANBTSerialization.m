@@ -27,6 +27,12 @@
 #import "JANBTTagType.h"
 #import "JANBTStreamParser.h"
 #import "JANBTStreamEncoder.h"
+#import "JAZLibCompressor.h"
+#import "JANBTProjection.h"
+#import "JANBTPatch.h"
+#import "JANBTSchemaNode.h"
+#import "JANBTValidator.h"
+#import "JANBTStatisticsCounters.h"
 
 
 NSString * const kJANBTSerializationErrorDomain = @"se.ayton.jens.minecraftkit JANBTSerialization ErrorDomain";
@@ -34,6 +40,41 @@ NSString * const kJANBTSerializationErrorDomain = @"se.ayton.jens.minecraftkit J
 // Create an NSError in kJANBTSerializationErrorDomain if outError is not null.
 static void SetError(NSError **outError, NSInteger errorCode, NSString *format, ...) NS_FORMAT_FUNCTION(3, 4);
 
+static NSData *UncompressedBuffer(NSData *data, JANBTReadingOptions options, JAZLibInflater *inflater, JANBTStatisticsCounters *counters, NSError **outError);
+static void RecordStatistics(JANBTStatistics *statistics, JANBTStatisticsCounters *counters, BOOL success);
+
+
+@interface JANBTSerialization ()
+
+// If inflater is nil, one is borrowed from the current thread’s pool. counters may be NULL.
++ (JANBTStreamParser *) parserForData:(NSData *)data
+							  options:(JANBTReadingOptions)options
+							 inflater:(JAZLibInflater *)inflater
+							 counters:(JANBTStatisticsCounters *)counters
+								error:(NSError **)outError;
+
++ (id) NBTObjectWithParser:(JANBTStreamParser *)parser
+				  rootName:(NSString **)ioRootName
+					schema:(id)schema
+				  keyPaths:(id<NSFastEnumeration>)keyPaths
+					 error:(NSError **)outError;
+
++ (BOOL) readNBTWithParser:(JANBTStreamParser *)parser
+				  rootName:(NSString **)ioRootName
+				  delegate:(id<JANBTReaderDelegate>)delegate
+					 error:(NSError **)outError;
+
++ (BOOL) validateNBTData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				inflater:(JAZLibInflater *)inflater
+				counters:(JANBTStatisticsCounters *)counters
+				 summary:(JANBTValidationSummary *)outSummary
+				   error:(NSError **)outError;
+
+@end
+
 
 @implementation JANBTSerialization
 
@@ -51,10 +92,13 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 
 + (BOOL) isValidNBTObject:(id)object conformingToSchema:(id)schema options:(JANBTWritingOptions)options
 {
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:NULL];
+	if (schema != nil && compiledSchema == nil)  return NO;
+	
 	JANBTStreamEncoder *encoder = [[JANBTStreamEncoder alloc] initWithStream:nil options:options];
 	if (encoder == nil)  return YES;	// Your guess is as good as mine.
 	
-	return [encoder encodeObject:object withSchema:schema rootName:@"" error:NULL];
+	return [encoder encodeObject:object withSchema:compiledSchema rootName:@"" error:NULL];
 }
 
 
@@ -64,13 +108,65 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 						schema:(id)schema
 						 error:(NSError **)outError
 {
-	NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
-	[stream open];
-	NSInteger bytesWritten = [self writeNBTObject:root rootName:rootName toStream:stream options:options schema:schema error:outError];
-	[stream close];
+	return [self dataWithNBTObject:root rootName:rootName options:options schema:schema statistics:nil error:outError];
+}
+
+
++ (NSData *) dataWithNBTObject:(id)root
+					  rootName:(NSString *)rootName
+					   options:(JANBTWritingOptions)options
+						schema:(id)schema
+					statistics:(JANBTStatistics *)statistics
+						 error:(NSError **)outError
+{
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:outError];
+	if (schema != nil && compiledSchema == nil)  return nil;
+	
+	JANBTStreamEncoder *encoder = [[JANBTStreamEncoder alloc] initForDataWithOptions:options];
+	if (encoder == nil)
+	{
+		SetError(outError, kJANBTSerializationMemoryError, @"Could not create NBT encoder.");
+		return nil;
+	}
+	
+	JANBTStatisticsCounters counters = { 0 };
+	if (statistics != nil)  encoder.statisticsCounters = &counters;
+	
+	BOOL OK = [encoder encodeObject:root withSchema:compiledSchema rootName:rootName error:outError];
+	RecordStatistics(statistics, &counters, OK);
+	
+	if (!OK)  return nil;
+	return encoder.encodedData;
+}
+
+
++ (NSData *) dataByPatchingNBTData:(NSData *)data
+					readingOptions:(JANBTReadingOptions)readingOptions
+						   changes:(NSDictionary *)changes
+					writingOptions:(JANBTWritingOptions)writingOptions
+							schema:(id)schema
+							 error:(NSError **)outError
+{
+	NSParameterAssert(data != nil);
+	
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:outError];
+	if (schema != nil && compiledSchema == nil)  return nil;
 	
-	if (bytesWritten == 0)  return nil;
-	return [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+	JANBTPatch *patch = [JANBTPatch patchWithChanges:changes error:outError];
+	if (patch == nil)  return nil;
+	
+	NSData *buffer = UncompressedBuffer(data, readingOptions, nil, NULL, outError);
+	if (buffer == nil)  return nil;
+	
+	JANBTStreamEncoder *encoder = [[JANBTStreamEncoder alloc] initForDataWithOptions:writingOptions];
+	if (encoder == nil)
+	{
+		SetError(outError, kJANBTSerializationMemoryError, @"Could not create NBT encoder.");
+		return nil;
+	}
+	
+	if (![encoder encodePatch:patch ofNBTBytes:buffer.bytes length:buffer.length withSchema:compiledSchema error:outError])  return nil;
+	return encoder.encodedData;
 }
 
 
@@ -80,11 +176,22 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 				  schema:(id)schema
 				   error:(NSError **)outError
 {
-	NSInputStream *stream = [NSInputStream inputStreamWithData:data];
-	[stream open];
-	id result = [self NBTObjectWithStream:stream rootName:outRootName options:options schema:schema error:outError];
-	[stream close];
-	return result;
+	return [self NBTObjectWithData:data rootName:outRootName options:options schema:schema keyPaths:nil error:outError];
+}
+
+
++ (id) NBTObjectWithData:(NSData *)data
+				rootName:(NSString **)outRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				keyPaths:(id<NSFastEnumeration>)keyPaths
+				   error:(NSError **)outError
+{
+	if (data == nil)  return nil;
+	
+	JANBTStreamParser *parser = [self parserForData:data options:options inflater:nil counters:NULL error:outError];
+	if (parser == nil)  return nil;
+	return [self NBTObjectWithParser:parser rootName:outRootName schema:schema keyPaths:keyPaths error:outError];
 }
 
 
@@ -97,6 +204,9 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 {
 	if (stream == nil)  return 0;
 	
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:outError];
+	if (schema != nil && compiledSchema == nil)  return 0;
+	
 	JANBTStreamEncoder *encoder = [[JANBTStreamEncoder alloc] initWithStream:stream options:options];
 	if (encoder == nil)
 	{
@@ -104,7 +214,7 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 		return 0;
 	}
 	
-	BOOL success = [encoder encodeObject:object withSchema:schema rootName:rootName error:outError];
+	BOOL success = [encoder encodeObject:object withSchema:compiledSchema rootName:rootName error:outError];
 	
 	if (success)  return encoder.bytesWritten;
 	return 0;
@@ -116,19 +226,49 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 				   options:(JANBTReadingOptions)options
 					schema:(id)schema
 					 error:(NSError **)outError
+{
+	return [self NBTObjectWithStream:stream rootName:ioRootName options:options schema:schema keyPaths:nil error:outError];
+}
+
+
++ (id) NBTObjectWithStream:(NSInputStream *)stream
+				  rootName:(NSString **)ioRootName
+				   options:(JANBTReadingOptions)options
+					schema:(id)schema
+				  keyPaths:(id<NSFastEnumeration>)keyPaths
+					 error:(NSError **)outError
 {
 	if (stream == nil)  return nil;
 	
 	JANBTStreamParser *parser = [[JANBTStreamParser alloc] initWithStream:stream options:options];
+	return [self NBTObjectWithParser:parser rootName:ioRootName schema:schema keyPaths:keyPaths error:outError];
+}
+
+
++ (id) NBTObjectWithParser:(JANBTStreamParser *)parser
+				  rootName:(NSString **)ioRootName
+					schema:(id)schema
+				  keyPaths:(id<NSFastEnumeration>)keyPaths
+					 error:(NSError **)outError
+{
 	if (parser == nil)
 	{
 		SetError(outError, kJANBTSerializationMemoryError, @"Could not create NBT parser.");
 		return nil;
 	}
 	
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:outError];
+	if (schema != nil && compiledSchema == nil)  return nil;
+	
+	if (keyPaths != nil)
+	{
+		parser.projection = [JANBTProjection projectionWithKeyPaths:keyPaths error:outError];
+		if (parser.projection == nil)  return nil;
+	}
+	
 	NSString *expectedName;
 	if (ioRootName != NULL)  expectedName = *ioRootName;
-	if (![parser parseWithSchema:schema expectedRootName:expectedName error:outError])
+	if (![parser parseWithSchema:compiledSchema expectedRootName:expectedName error:outError])
 	{
 		return nil;
 	}
@@ -137,6 +277,257 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 	return parser.root;
 }
 
+
++ (BOOL) readNBTData:(NSData *)data
+			rootName:(NSString **)ioRootName
+			 options:(JANBTReadingOptions)options
+			delegate:(id<JANBTReaderDelegate>)delegate
+			   error:(NSError **)outError
+{
+	if (data == nil)  return NO;
+	
+	JANBTStreamParser *parser = [self parserForData:data options:options inflater:nil counters:NULL error:outError];
+	if (parser == nil)  return NO;
+	return [self readNBTWithParser:parser rootName:ioRootName delegate:delegate error:outError];
+}
+
+
++ (BOOL) readNBTStream:(NSInputStream *)stream
+			  rootName:(NSString **)ioRootName
+			   options:(JANBTReadingOptions)options
+			  delegate:(id<JANBTReaderDelegate>)delegate
+				 error:(NSError **)outError
+{
+	if (stream == nil)  return NO;
+	
+	JANBTStreamParser *parser = [[JANBTStreamParser alloc] initWithStream:stream options:options];
+	return [self readNBTWithParser:parser rootName:ioRootName delegate:delegate error:outError];
+}
+
+
++ (BOOL) readNBTWithParser:(JANBTStreamParser *)parser
+				  rootName:(NSString **)ioRootName
+				  delegate:(id<JANBTReaderDelegate>)delegate
+					 error:(NSError **)outError
+{
+	if (parser == nil)
+	{
+		SetError(outError, kJANBTSerializationMemoryError, @"Could not create NBT parser.");
+		return NO;
+	}
+	
+	NSString *expectedName;
+	if (ioRootName != NULL)  expectedName = *ioRootName;
+	if (![parser scanWithDelegate:delegate expectedRootName:expectedName error:outError])
+	{
+		return NO;
+	}
+	
+	if (ioRootName != NULL)  *ioRootName = parser.rootName;
+	return YES;
+}
+
+
++ (BOOL) validateNBTData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				 summary:(JANBTValidationSummary *)outSummary
+				   error:(NSError **)outError
+{
+	return [self validateNBTData:data rootName:ioRootName options:options schema:schema inflater:nil counters:NULL summary:outSummary error:outError];
+}
+
+
++ (BOOL) validateNBTData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				inflater:(JAZLibInflater *)inflater
+				counters:(JANBTStatisticsCounters *)counters
+				 summary:(JANBTValidationSummary *)outSummary
+				   error:(NSError **)outError
+{
+	if (data == nil)  return NO;
+	
+	JANBTCompiledSchema *compiledSchema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:outError];
+	if (schema != nil && compiledSchema == nil)  return NO;
+	
+	NSData *buffer = UncompressedBuffer(data, options, inflater, counters, outError);
+	if (buffer == nil)  return NO;
+	
+	// The validator already counts tags and nesting, so statistics come from its summary.
+	JANBTValidationSummary summary;
+	if (outSummary == NULL && counters != NULL)  outSummary = &summary;
+	uint64_t start = (counters != NULL) ? mach_absolute_time() : 0;
+	
+	JANBTStringRef rootNameRef;
+	JANBTValidationFailure failure;
+	BOOL allowFragments = (options & JANBTReadingOptionsAllowFragments) != 0;
+	if (!JANBTValidateBytes(buffer.bytes, buffer.length, compiledSchema.rootNode, allowFragments, &rootNameRef, outSummary, &failure))
+	{
+		JANBTSetValidationError(outError, &failure);
+		return NO;
+	}
+	
+	if (counters != NULL)
+	{
+		counters->processingTime += mach_absolute_time() - start;
+		for (unsigned i = kJANBTTagByte; i <= kJANBTTagLongArray; i++)
+		{
+			counters->tagCounts[i] += outSummary->tagCounts[i];
+		}
+		counters->maxDepth = MAX(counters->maxDepth, (uint32_t)outSummary->maxDepth);
+	}
+	
+	if (ioRootName != NULL)
+	{
+		NSString *rootName = JANBTStringFromStringRef(rootNameRef);
+		if (rootName != nil && *ioRootName != nil && ![rootName isEqualToString:*ioRootName])
+		{
+			SetError(outError, kJANBTSerializationWrongRootNameError, @"Expected NBT root name to be %@, but found %@.", *ioRootName, rootName);
+			return NO;
+		}
+		*ioRootName = rootName;
+	}
+	return YES;
+}
+
+
+/*
+	Rather than streaming, inflate the whole payload up front and parse
+	straight out of the resulting buffer. If the data is uncompressed, we use
+	it directly; the copy is just a retain unless it’s mutable.
+*/
+static NSData *UncompressedBuffer(NSData *data, JANBTReadingOptions options, JAZLibInflater *inflater, JANBTStatisticsCounters *counters, NSError **outError)
+{
+	if (options & JANBTReadingOptionsUncompressed)
+	{
+		if (counters != NULL)
+		{
+			counters->compressedLength += data.length;
+			counters->uncompressedLength += data.length;
+		}
+		return [data copy];
+	}
+	
+	uint64_t start = (counters != NULL) ? mach_absolute_time() : 0;
+	NSError *error;
+	NSData *buffer;
+	if (inflater != nil)  buffer = [inflater inflateData:data mode:kJAZLibCompressionAutoDetect error:&error];
+	else  buffer = [JAZlibDecompressor inflateData:data mode:kJAZLibCompressionAutoDetect error:&error];
+	if (buffer == nil)
+	{
+		SetError(outError, kJANBTSerializationCompressionError, @"Could not decompress NBT data: %@", error.localizedFailureReason ?: error.localizedDescription);
+	}
+	else if (counters != NULL)
+	{
+		counters->compressionTime += mach_absolute_time() - start;
+		counters->compressedLength += data.length;
+		counters->uncompressedLength += buffer.length;
+	}
+	return buffer;
+}
+
+
++ (JANBTStreamParser *) parserForData:(NSData *)data
+							  options:(JANBTReadingOptions)options
+							 inflater:(JAZLibInflater *)inflater
+							 counters:(JANBTStatisticsCounters *)counters
+								error:(NSError **)outError
+{
+	NSData *buffer = UncompressedBuffer(data, options, inflater, counters, outError);
+	if (buffer == nil)  return nil;
+	
+	JANBTStreamParser *parser = [[JANBTStreamParser alloc] initWithUncompressedData:buffer options:options];
+	if (parser == nil)  SetError(outError, kJANBTSerializationMemoryError, @"Could not create NBT parser.");
+	parser.statisticsCounters = counters;
+	return parser;
+}
+
+@end
+
+
+@implementation JANBTReadingContext
+{
+	JAZLibInflater				*_inflater;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_inflater = [JAZLibInflater new];
+	}
+	
+	return self;
+}
+
+
+- (id) NBTObjectWithData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				   error:(NSError **)outError
+{
+	return [self NBTObjectWithData:data rootName:ioRootName options:options schema:schema keyPaths:nil error:outError];
+}
+
+
+- (id) NBTObjectWithData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				keyPaths:(id<NSFastEnumeration>)keyPaths
+				   error:(NSError **)outError
+{
+	if (data == nil)  return nil;
+	
+	JANBTStatistics *statistics = _statistics;
+	JANBTStatisticsCounters counters = { 0 };
+	JANBTStreamParser *parser = [JANBTSerialization parserForData:data options:options inflater:_inflater counters:statistics ? &counters : NULL error:outError];
+	if (parser == nil)  return nil;
+	
+	id result = [JANBTSerialization NBTObjectWithParser:parser rootName:ioRootName schema:schema keyPaths:keyPaths error:outError];
+	RecordStatistics(statistics, &counters, result != nil);
+	return result;
+}
+
+
+- (BOOL) readNBTData:(NSData *)data
+			rootName:(NSString **)ioRootName
+			 options:(JANBTReadingOptions)options
+			delegate:(id<JANBTReaderDelegate>)delegate
+			   error:(NSError **)outError
+{
+	if (data == nil)  return NO;
+	
+	JANBTStatistics *statistics = _statistics;
+	JANBTStatisticsCounters counters = { 0 };
+	JANBTStreamParser *parser = [JANBTSerialization parserForData:data options:options inflater:_inflater counters:statistics ? &counters : NULL error:outError];
+	if (parser == nil)  return NO;
+	
+	BOOL OK = [JANBTSerialization readNBTWithParser:parser rootName:ioRootName delegate:delegate error:outError];
+	RecordStatistics(statistics, &counters, OK);
+	return OK;
+}
+
+
+- (BOOL) validateNBTData:(NSData *)data
+				rootName:(NSString **)ioRootName
+				 options:(JANBTReadingOptions)options
+				  schema:(id)schema
+				 summary:(JANBTValidationSummary *)outSummary
+				   error:(NSError **)outError
+{
+	JANBTStatistics *statistics = _statistics;
+	JANBTStatisticsCounters counters = { 0 };
+	BOOL OK = [JANBTSerialization validateNBTData:data rootName:ioRootName options:options schema:schema inflater:_inflater counters:statistics ? &counters : NULL summary:outSummary error:outError];
+	RecordStatistics(statistics, &counters, OK);
+	return OK;
+}
+
 @end
 
 
@@ -159,3 +550,50 @@ static void SetError(NSError **outError, NSInteger errorCode, NSString *format,
 									userInfo:@{ NSLocalizedDescriptionKey: message }];
 	}
 }
+
+
+void JANBTSetValidationError(NSError **outError, const JANBTValidationFailure *failure)
+{
+	switch (failure->status)
+	{
+		case kJANBTValidationOK:
+			break;
+			
+		case kJANBTValidationPrematureEnd:
+			SetError(outError, kJANBTSerializationReadError, @"Premature end of file.");
+			break;
+			
+		case kJANBTValidationUnknownTag:
+			SetError(outError, kJANBTSerializationUnknownTagError, @"Unknown NBT tag %u at offset %zu.", failure->type, failure->offset);
+			break;
+			
+		case kJANBTValidationInvalidUTF8:
+			SetError(outError, kJANBTSerializationReadError, @"Invalid UTF-8 string at offset %zu.", failure->offset);
+			break;
+			
+		case kJANBTValidationWrongType:
+			SetError(outError, kJANBTSerializationWrongTypeError, @"Wrong type in NBT - expected %@, got %@ - at offset %zu.", JANBTTagNameFromTagType(failure->expectedType), JANBTTagNameFromTagType(failure->type), failure->offset);
+			break;
+			
+		case kJANBTValidationRootNotCompound:
+			SetError(outError, kJANBTSerializationWrongTypeError, @"NBT root is not a compound, and fragments are not permitted.");
+			break;
+			
+		case kJANBTValidationTooDeep:
+			SetError(outError, kJANBTSerializationReadError, @"NBT is nested more than %u levels deep.", (unsigned)kJANBTValidationMaxDepth);
+			break;
+	}
+}
+
+
+/*
+	Add the counters for one NBT to statistics, if any. Failures aren’t
+	recorded, since they may have stopped anywhere.
+*/
+static void RecordStatistics(JANBTStatistics *statistics, JANBTStatisticsCounters *counters, BOOL success)
+{
+	if (statistics == nil || !success)  return;
+	
+	counters->documentCount++;
+	[statistics addCounters:counters];
+}
@@ -0,0 +1,217 @@
+/*
+	JANBTStatistics.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTStatisticsCounters.h"
+#include <pthread.h>
+
+
+static NSTimeInterval SecondsFromAbsoluteTime(uint64_t time);
+
+
+@implementation JANBTStatistics
+{
+	JANBTStatisticsCounters	_counters;
+	pthread_mutex_t			_lock;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		pthread_mutex_init(&_lock, NULL);
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	pthread_mutex_destroy(&_lock);
+}
+
+
+- (id) copyWithZone:(NSZone *)zone
+{
+	JANBTStatistics *result = [[JANBTStatistics allocWithZone:zone] init];
+	[result addStatistics:self];
+	return result;
+}
+
+
+// Take a consistent snapshot, so readers don’t see a half-merged operation.
+- (JANBTStatisticsCounters) snapshot
+{
+	pthread_mutex_lock(&_lock);
+	JANBTStatisticsCounters result = _counters;
+	pthread_mutex_unlock(&_lock);
+	return result;
+}
+
+
+- (void) addCounters:(const JANBTStatisticsCounters *)counters
+{
+	NSParameterAssert(counters != NULL);
+	
+	pthread_mutex_lock(&_lock);
+	
+	_counters.documentCount += counters->documentCount;
+	for (unsigned i = 0; i < 13; i++)
+	{
+		_counters.tagCounts[i] += counters->tagCounts[i];
+	}
+	_counters.compressedLength += counters->compressedLength;
+	_counters.uncompressedLength += counters->uncompressedLength;
+	_counters.compressionTime += counters->compressionTime;
+	_counters.processingTime += counters->processingTime;
+	_counters.objectCount += counters->objectCount;
+	_counters.maxDepth = MAX(_counters.maxDepth, counters->maxDepth);
+	
+	pthread_mutex_unlock(&_lock);
+}
+
+
+- (void) addStatistics:(JANBTStatistics *)other
+{
+	if (other == nil || other == self)  return;
+	
+	JANBTStatisticsCounters counters = [other snapshot];
+	[self addCounters:&counters];
+}
+
+
+- (void) reset
+{
+	pthread_mutex_lock(&_lock);
+	_counters = (JANBTStatisticsCounters){ 0 };
+	pthread_mutex_unlock(&_lock);
+}
+
+
+- (NSUInteger) documentCount
+{
+	return (NSUInteger)self.snapshot.documentCount;
+}
+
+
+- (NSUInteger) countOfTagsWithID:(NSUInteger)tagID
+{
+	if (tagID == kJANBTTagEnd || tagID > kJANBTTagLongArray)  return 0;
+	return (NSUInteger)self.snapshot.tagCounts[tagID];
+}
+
+
+- (NSUInteger) tagCount
+{
+	JANBTStatisticsCounters counters = self.snapshot;
+	uint64_t result = 0;
+	for (unsigned i = kJANBTTagByte; i <= kJANBTTagLongArray; i++)
+	{
+		result += counters.tagCounts[i];
+	}
+	return (NSUInteger)result;
+}
+
+
+- (unsigned long long) compressedLength
+{
+	return self.snapshot.compressedLength;
+}
+
+
+- (unsigned long long) uncompressedLength
+{
+	return self.snapshot.uncompressedLength;
+}
+
+
+- (NSTimeInterval) compressionTime
+{
+	return SecondsFromAbsoluteTime(self.snapshot.compressionTime);
+}
+
+
+- (NSTimeInterval) processingTime
+{
+	return SecondsFromAbsoluteTime(self.snapshot.processingTime);
+}
+
+
+- (NSUInteger) maxDepth
+{
+	return self.snapshot.maxDepth;
+}
+
+
+- (NSUInteger) objectCount
+{
+	return (NSUInteger)self.snapshot.objectCount;
+}
+
+
+- (NSDictionary *) dictionaryRepresentation
+{
+	JANBTStatisticsCounters counters = self.snapshot;
+	
+	NSMutableDictionary *tagCounts = [NSMutableDictionary dictionary];
+	for (unsigned i = kJANBTTagByte; i <= kJANBTTagLongArray; i++)
+	{
+		if (counters.tagCounts[i] != 0)  tagCounts[JANBTTagNameFromTagType(i)] = @(counters.tagCounts[i]);
+	}
+	
+	return @{
+		@"documentCount": @(counters.documentCount),
+		@"tagCounts": tagCounts,
+		@"compressedLength": @(counters.compressedLength),
+		@"uncompressedLength": @(counters.uncompressedLength),
+		@"compressionTime": @(SecondsFromAbsoluteTime(counters.compressionTime)),
+		@"processingTime": @(SecondsFromAbsoluteTime(counters.processingTime)),
+		@"maxDepth": @(counters.maxDepth),
+		@"objectCount": @(counters.objectCount)
+	};
+}
+
+
+- (NSString *) description
+{
+	JANBTStatisticsCounters counters = self.snapshot;
+	return [NSString stringWithFormat:@"<%@ %p>{%llu documents, %llu -> %llu bytes, %g s compression, %g s processing}", self.class, self, counters.documentCount, counters.compressedLength, counters.uncompressedLength, SecondsFromAbsoluteTime(counters.compressionTime), SecondsFromAbsoluteTime(counters.processingTime)];
+}
+
+@end
+
+
+static NSTimeInterval SecondsFromAbsoluteTime(uint64_t time)
+{
+	static double scale;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		mach_timebase_info_data_t timebase;
+		mach_timebase_info(&timebase);
+		scale = (double)timebase.numer / (double)timebase.denom * 1e-9;
+	});
+	
+	return (double)time * scale;
+}
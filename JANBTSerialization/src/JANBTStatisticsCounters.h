@@ -0,0 +1,72 @@
+/*
+	JANBTStatisticsCounters.h
+	
+	Per-operation counters behind JANBTStatistics. The parser and encoder
+	are handed a pointer to one of these, which is NULL when statistics
+	aren’t wanted, and the caller adds it to a JANBTStatistics when the
+	operation succeeds. Times are in mach_absolute_time() units.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTStatistics.h"
+#import "JANBTTagType.h"
+#include <mach/mach_time.h>
+
+
+typedef struct JANBTStatisticsCounters
+{
+	uint64_t				documentCount;
+	uint64_t				tagCounts[13];		// Indexed by tag ID; [0] is unused.
+	uint64_t				compressedLength;
+	uint64_t				uncompressedLength;
+	uint64_t				compressionTime;
+	uint64_t				processingTime;
+	uint64_t				objectCount;
+	uint32_t				maxDepth;
+	uint32_t				depth;				// Current nesting; not merged.
+} JANBTStatisticsCounters;
+
+
+@interface JANBTStatistics (Internal)
+
+- (void) addCounters:(const JANBTStatisticsCounters *)counters;
+
+@end
+
+
+static inline void JANBTStatisticsCountTag(JANBTStatisticsCounters *counters, JANBTTagType type)
+{
+	if (counters != NULL && kJANBTTagEnd < type && type <= kJANBTTagLongArray)  counters->tagCounts[type]++;
+}
+
+
+static inline void JANBTStatisticsEnterContainer(JANBTStatisticsCounters *counters)
+{
+	if (counters != NULL && ++counters->depth > counters->maxDepth)  counters->maxDepth = counters->depth;
+}
+
+
+static inline void JANBTStatisticsExitContainer(JANBTStatisticsCounters *counters)
+{
+	if (counters != NULL)  counters->depth--;
+}
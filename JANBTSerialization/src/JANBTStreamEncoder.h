@@ -27,13 +27,70 @@
 */
 
 #import "JANBTSerialization.h"
+#import "JANBTStatisticsCounters.h"
+#import "JANBTSchemaNode.h"
+
+@class JANBTCompiledSchema, JANBTPatch;
 
 
 @interface JANBTStreamEncoder: NSObject
 
 - (id) initWithStream:(NSOutputStream *)stream options:(JANBTWritingOptions)options;
-- (BOOL) encodeObject:(id)root withSchema:(id)schema rootName:(NSString *)rootName error:(NSError **)outError;
+
+/*
+	Encode to memory. The size of the NBT is computed before encoding, so
+	uncompressed output is written straight into a buffer of the right size,
+	and compressed output is deflated into a single buffer without going
+	through a stream. The result is available from encodedData.
+*/
+- (id) initForDataWithOptions:(JANBTWritingOptions)options;
+
+- (BOOL) encodeObject:(id)root withSchema:(JANBTCompiledSchema *)schema rootName:(NSString *)rootName error:(NSError **)outError;
+
+/*
+	Write a copy of the uncompressed NBT in bytes with patch applied. Only
+	the patched values are encoded; everything else is copied from bytes,
+	and once the last change is written the rest is copied without being
+	looked at. schema is used for the new values.
+*/
+- (BOOL) encodePatch:(JANBTPatch *)patch ofNBTBytes:(const uint8_t *)bytes length:(NSUInteger)length withSchema:(JANBTCompiledSchema *)schema error:(NSError **)outError;
+
+/*
+	Incremental encoding, for JANBTStreamWriter. These write straight to the
+	output, with no checking of structure; the caller is responsible for
+	producing a well-formed NBT. Numbers are in host byte order, and names
+	are written with the tag type if not nil. Call -finishWithError: at the
+	end. Only available for streams.
+*/
+- (BOOL) writeTagType:(JANBTTagType)type name:(NSString *)name;
+- (BOOL) writeByte:(int8_t)value;
+- (BOOL) writeShort:(int16_t)value;
+- (BOOL) writeInt:(int32_t)value;
+- (BOOL) writeLong:(int64_t)value;
+- (BOOL) writeFloat:(Float32)value;
+- (BOOL) writeDouble:(Float64)value;
+- (BOOL) writeString:(NSString *)value;
+- (BOOL) writeBytes:(const void *)bytes length:(NSUInteger)length;
+- (BOOL) writeInts:(const int32_t *)values count:(NSUInteger)count;
+- (BOOL) writeLongs:(const int64_t *)values count:(NSUInteger)count;
+
+// The type value would be encoded as, or kJANBTTagUnknown if it isn’t an NBT value.
+- (JANBTTagType) tagTypeOfObject:(id)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeTagBody:(id)value ofType:(JANBTTagType)type withSchema:(const JANBTSchemaNode *)schema;
+
+- (BOOL) finishWithError:(NSError **)outError;
+
+// The first error from the incremental methods.
+@property (readonly) NSError *error;
 
 @property (readonly) NSUInteger bytesWritten;
+@property (readonly) NSData *encodedData;
+
+/*
+	If set, -encodeObject:… adds tags, nesting, lengths and time spent
+	encoding and compressing to these counters. They must outlive the
+	encode.
+*/
+@property (nonatomic) JANBTStatisticsCounters *statisticsCounters;
 
 @end
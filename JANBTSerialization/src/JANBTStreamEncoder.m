@@ -27,6 +27,13 @@
 #import "JANBTTagType.h"
 #import "JANBTParserNullCompressor.h"
 #import "JAZLibCompressor.h"
+#import "JAZLibParallelCompressor.h"
+#import "JANBTPackedArrays.h"
+#import "JANBTByteSwap.h"
+#import "JANBTSchemaNode.h"
+#import "JANBTBufferWriter.h"
+#import "JANBTBufferCursor.h"
+#import "JANBTPatch.h"
 
 
 /*
@@ -46,43 +53,72 @@
 #define REQUIRE(COND) do { if (__builtin_expect(!(COND), 0))  return 0; } while (0)
 
 
+enum
+{
+	// Small tags are collected in a staging buffer before being passed to the compressor.
+	kStagingSize				= 64 << 10,
+	
+	// Byte arrays at least this big bypass the staging buffer.
+	kDirectWriteThreshold		= kStagingSize / 2,
+	
+	// With JANBTWritingOptionsParallelCompression, data smaller than this is compressed on one thread.
+	kParallelCompressionThreshold	= 1 << 20
+};
+
+
 @interface JANBTStreamEncoder ()
 
 - (void) setErrorIfClear:(NSInteger)errorCode underlyingError:(NSError *)underlyingError format:(NSString *)format, ... NS_FORMAT_FUNCTION(3, 4);
 
-- (BOOL) encodeObjectInner:(id)root withSchema:(id)schema rootName:(NSString *)rootName;
-
-- (BOOL) encodeOneTagBody:(id)value ofType:(JANBTTagType)type withSchema:(id)schema;
-- (BOOL) encodeByte:(NSNumber *)value withSchema:(id)schema;
-- (BOOL) encodeShort:(NSNumber *)value withSchema:(id)schema;
-- (BOOL) encodeInt:(NSNumber *)value withSchema:(id)schema;
-- (BOOL) encodeLong:(NSNumber *)value withSchema:(id)schema;
-- (BOOL) encodeFloat:(NSNumber *)value withSchema:(id)schema;
-- (BOOL) encodeDouble:(NSNumber *)value withSchema:(id)schema;
-- (BOOL) encodeByteArray:(NSData *)value withSchema:(id)schema;
-- (BOOL) encodeString:(NSString *)value withSchema:(id)schema;
-- (BOOL) encodeList:(NSArray *)value withSchema:(id)schema;
-- (BOOL) encodeCompound:(NSDictionary *)value withSchema:(id)schema;
-
-- (BOOL) writeByte:(uint8_t)value __attribute__((warn_unused_result));
-- (BOOL) writeShort:(uint16_t)value __attribute__((warn_unused_result));
-- (BOOL) writeInt:(uint32_t)value __attribute__((warn_unused_result));
-- (BOOL) writeLong:(uint64_t)value __attribute__((warn_unused_result));
-- (BOOL) writeFloat:(Float32)value __attribute__((warn_unused_result));
-- (BOOL) writeDouble:(Float64)value __attribute__((warn_unused_result));
-- (BOOL) writeString:(NSString *)value __attribute__((nonnull, warn_unused_result));
-- (BOOL) writeBytes:(const void *)bytes length:(NSUInteger)length __attribute__((nonnull, warn_unused_result));
+- (BOOL) encodeObjectInner:(id)root withSchema:(const JANBTSchemaNode *)schema rootName:(NSString *)rootName;
+
+- (BOOL) encodeOneTagBody:(id)value ofType:(JANBTTagType)type withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeByte:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeShort:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeInt:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeLong:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeFloat:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeDouble:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeByteArray:(NSData *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeString:(NSString *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeList:(NSArray *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeCompound:(NSDictionary *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeIntArray:(NSArray *)value withSchema:(const JANBTSchemaNode *)schema;
+- (BOOL) encodeLongArray:(NSArray *)value withSchema:(const JANBTSchemaNode *)schema;
+
+- (BOOL) writeToCompressor:(const void *)bytes length:(NSUInteger)length __attribute__((nonnull, warn_unused_result));
 
 @end
 
 
-static JANBTTagType NormalizedTagType(id value, id schema);
+static JANBTTagType NormalizedTagType(id value, const JANBTSchemaNode *schema);
+static JAZLibCompressionSettings CompressionSettingsFromOptions(JANBTWritingOptions options);
+static BOOL FlushStaging(JANBTStreamEncoder *self);
+static BOOL SpliceCopy(JANBTStreamEncoder *self, const uint8_t *upTo);
 
 
 @implementation JANBTStreamEncoder
 {
 	id<JANBTParserCompressor>	_compressor;
 	NSError						*_error;
+	
+	JANBTBufferWriter			_writer;
+	uint8_t						*_staging;
+	
+	// Data mode.
+	BOOL						_dataMode;
+	BOOL						_uncompressed;
+	BOOL						_parallel;
+	JAZLibCompressionSettings	_compressionSettings;
+	NSMutableData				*_outData;		// Uncompressed data mode only; _writer points straight into it.
+	NSData						*_encodedData;
+	
+	JANBTStatisticsCounters		*_counters;
+	
+	// Splicing.
+	JANBTBufferCursor			_spliceCursor;
+	const uint8_t				*_spliceCopied;	// Start of the source bytes not yet copied or replaced.
+	NSUInteger					_splicePending;	// Changes not yet written.
 }
 
 
@@ -94,43 +130,188 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 		{
 			if (options & JANBTWritingOptionsUncompressed) {
 				_compressor = [[JANBTParserNullCompressor alloc] initWithStream:stream];
+			} else if (options & JANBTWritingOptionsParallelCompression) {
+				_compressor = [[JAZLibParallelCompressor alloc] initWithStream:stream settings:CompressionSettingsFromOptions(options)];
 			} else {
-				_compressor = [[JAZLibCompressor alloc] initWithStream:stream mode:kJAZLibCompressionGZip];
+				_compressor = [[JAZLibCompressor alloc] initWithStream:stream settings:CompressionSettingsFromOptions(options)];
 			}
 			if (_compressor == nil)  return nil;
 		}
+		
+		if (![self setUpStaging])  return nil;
 	}
 	
 	return self;
 }
 
 
-- (BOOL) encodeObject:(id)root withSchema:(id)schema rootName:(NSString *)rootName error:(NSError **)outError
+- (id) initForDataWithOptions:(JANBTWritingOptions)options
+{
+	if ((self = [super init]))
+	{
+		_dataMode = YES;
+		_uncompressed = (options & JANBTWritingOptionsUncompressed) != 0;
+		_parallel = (options & JANBTWritingOptionsParallelCompression) != 0;
+		_compressionSettings = CompressionSettingsFromOptions(options);
+		if (!_uncompressed && ![self setUpStaging])  return nil;
+	}
+	
+	return self;
+}
+
+
+- (BOOL) setUpStaging
+{
+	_staging = malloc(kStagingSize);
+	if (_staging == NULL)  return NO;
+	_writer = JANBTMakeBufferWriter(_staging, kStagingSize);
+	return YES;
+}
+
+
+- (void) dealloc
+{
+	free(_staging);
+}
+
+
+- (BOOL) encodeObject:(id)root withSchema:(JANBTCompiledSchema *)schema rootName:(NSString *)rootName error:(NSError **)outError
 {
 	BOOL OK;
+	uint64_t start = 0, compressionStart = 0;
+	if (_counters != NULL)
+	{
+		start = mach_absolute_time();
+		compressionStart = _counters->compressionTime;
+	}
 	
 	@autoreleasepool
 	{
-		OK = [self encodeObjectInner:root withSchema:schema rootName:rootName];
-		if (OK && _compressor != nil)
-		{
-			NSError __autoreleasing *error;
-			OK = [_compressor flushWithError:&error];
-			if (!OK)  _error = error;
-		}
+		if (_dataMode)  OK = [self prepareDataOutputForObject:root withSchema:schema.rootNode rootName:rootName];
+		else  OK = YES;
+		
+		if (OK)  OK = [self encodeObjectInner:root withSchema:schema.rootNode rootName:rootName];
+		if (OK)  OK = [self finishOutput];
 	}
 	
+	// Compression time is added as it happens; the rest is processing.
+	if (_counters != NULL)  _counters->processingTime += mach_absolute_time() - start - (_counters->compressionTime - compressionStart);
+	
 	if (!OK && outError != NULL)  *outError = _error;
 	return OK;
 }
 
 
+- (BOOL) encodePatch:(JANBTPatch *)patch ofNBTBytes:(const uint8_t *)bytes length:(NSUInteger)length withSchema:(JANBTCompiledSchema *)schema error:(NSError **)outError
+{
+	BOOL OK = YES;
+	
+	@autoreleasepool
+	{
+		_spliceCursor = JANBTMakeBufferCursor(bytes, length);
+		_spliceCopied = bytes;
+		_splicePending = patch.changeCount;
+		
+		if (_dataMode)  OK = [self prepareDataOutputWithSize:length + [self encodedSizeOfPatch:patch]];
+		if (OK)  OK = [self spliceRootWithPatch:patch schema:schema.rootNode];
+		if (OK)  OK = SpliceCopy(self, _spliceCursor.end);
+		if (OK)  OK = [self finishOutput];
+	}
+	
+	if (!OK && outError != NULL)  *outError = _error;
+	return OK;
+}
+
+
+- (NSData *) encodedData
+{
+	return _encodedData;
+}
+
+
+@synthesize statisticsCounters = _counters;
+
+
 - (NSUInteger) bytesWritten
 {
+	if (_dataMode)  return _encodedData.length;
 	return _compressor.compressedBytesWritten;
 }
 
 
+/*
+	In data mode, the exact size of the NBT is computed up front. Uncompressed
+	NBTs are then written straight into a buffer of that size, and compressed
+	ones are deflated into a buffer sized for it.
+*/
+- (BOOL) prepareDataOutputForObject:(id)root withSchema:(const JANBTSchemaNode *)schema rootName:(NSString *)rootName
+{
+	return [self prepareDataOutputWithSize:[self encodedSizeOfRoot:root withSchema:schema rootName:rootName]];
+}
+
+
+- (BOOL) prepareDataOutputWithSize:(NSUInteger)size
+{
+	if (_uncompressed)
+	{
+		_outData = [NSMutableData dataWithLength:size];
+		REQUIRE_ERR(_outData != nil, kJANBTSerializationMemoryError, @"Not enough memory for NBT data of %lu bytes.", size);
+		_writer = JANBTMakeBufferWriter(_outData.mutableBytes, size);
+	}
+	else
+	{
+		if (_parallel && size >= kParallelCompressionThreshold)
+		{
+			_compressor = [[JAZLibParallelCompressor alloc] initWithExpectedLength:size settings:_compressionSettings];
+		}
+		else
+		{
+			_compressor = [[JAZLibCompressor alloc] initWithExpectedLength:size settings:_compressionSettings];
+		}
+		REQUIRE_ERR(_compressor != nil, kJANBTSerializationCompressionError, @"Could not create NBT compressor.");
+	}
+	
+	return YES;
+}
+
+
+- (BOOL) finishOutput
+{
+	if (_outData != nil)
+	{
+		_outData.length = _writer.next - (uint8_t *)_outData.mutableBytes;
+		_encodedData = _outData;
+		if (_counters != NULL)
+		{
+			_counters->uncompressedLength += _outData.length;
+			_counters->compressedLength += _outData.length;
+		}
+		return YES;
+	}
+	
+	REQUIRE(FlushStaging(self));
+	if (_compressor == nil)  return YES;
+	
+	uint64_t start = (_counters != NULL) ? mach_absolute_time() : 0;
+	NSError __autoreleasing *error;
+	if (![_compressor flushWithError:&error])
+	{
+		_error = error;
+		return NO;
+	}
+	
+	if (_counters != NULL)
+	{
+		_counters->compressionTime += mach_absolute_time() - start;
+		_counters->compressedLength += _compressor.compressedBytesWritten;
+	}
+	
+	// Both in-memory compressors provide compressedData.
+	if (_dataMode)  _encodedData = [(id)_compressor compressedData];
+	return YES;
+}
+
+
 - (void) setErrorIfClear:(NSInteger)errorCode underlyingError:(NSError *)underlyingError format:(NSString *)format, ...
 {
 	if (_error != nil)  return;
@@ -147,16 +328,267 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 	
 	_error = [NSError errorWithDomain:kJANBTSerializationErrorDomain
 								 code:errorCode
-							 userInfo:@{ NSLocalizedDescriptionKey: message, NSUnderlyingErrorKey: underlyingError }];
+							 userInfo:@{ NSLocalizedDescriptionKey: message, NSUnderlyingErrorKey: underlyingError ?: @"" }];
+}
+
+
+/*
+	Output primitives. These write to _writer, which points either into the
+	staging buffer or, for uncompressed data, straight into the result. When
+	it fills up, MakeRoom() passes the staging buffer on to the compressor or
+	grows the result.
+*/
+static BOOL FlushStaging(JANBTStreamEncoder *self)
+{
+	NSUInteger pending = self->_writer.next - self->_staging;
+	self->_writer = JANBTMakeBufferWriter(self->_staging, kStagingSize);
+	
+	if (pending == 0 || self->_compressor == nil)  return YES;
+	return [self writeToCompressor:self->_staging length:pending];
 }
 
 
-- (BOOL) encodeObjectInner:(id)root withSchema:(id)schema rootName:(NSString *)rootName
+static BOOL MakeRoom(JANBTStreamEncoder *self, size_t needed)
+{
+	if (self->_outData == nil)  return FlushStaging(self);
+	
+	// The size pre-pass should make this unnecessary, but growing is better than failing.
+	NSMutableData *data = self->_outData;
+	NSUInteger used = self->_writer.next - (uint8_t *)data.mutableBytes;
+	data.length = MAX(data.length * 2, used + needed);
+	self->_writer = JANBTMakeBufferWriter((uint8_t *)data.mutableBytes + used, data.length - used);
+	return YES;
+}
+
+
+static inline BOOL WriteByte(JANBTStreamEncoder *self, uint8_t value)
+{
+	if (__builtin_expect(JANBTWriterWriteByte(&self->_writer, value), 1))  return YES;
+	return MakeRoom(self, sizeof value) && JANBTWriterWriteByte(&self->_writer, value);
+}
+
+
+static inline BOOL WriteShort(JANBTStreamEncoder *self, uint16_t value)
+{
+	if (__builtin_expect(JANBTWriterWriteShort(&self->_writer, value), 1))  return YES;
+	return MakeRoom(self, sizeof value) && JANBTWriterWriteShort(&self->_writer, value);
+}
+
+
+static inline BOOL WriteInt(JANBTStreamEncoder *self, uint32_t value)
+{
+	if (__builtin_expect(JANBTWriterWriteInt(&self->_writer, value), 1))  return YES;
+	return MakeRoom(self, sizeof value) && JANBTWriterWriteInt(&self->_writer, value);
+}
+
+
+static inline BOOL WriteLong(JANBTStreamEncoder *self, uint64_t value)
+{
+	if (__builtin_expect(JANBTWriterWriteLong(&self->_writer, value), 1))  return YES;
+	return MakeRoom(self, sizeof value) && JANBTWriterWriteLong(&self->_writer, value);
+}
+
+
+static inline BOOL WriteFloat(JANBTStreamEncoder *self, Float32 value)
+{
+	union { int32_t i; Float32 f; } convert;
+	convert.f = value;
+	return WriteInt(self, convert.i);
+}
+
+
+static inline BOOL WriteDouble(JANBTStreamEncoder *self, Float64 value)
+{
+	union { int64_t i; Float64 f; } convert;
+	convert.f = value;
+	return WriteLong(self, convert.i);
+}
+
+
+static BOOL WriteBytes(JANBTStreamEncoder *self, const void *bytes, NSUInteger length)
+{
+	if (length >= kDirectWriteThreshold && self->_outData == nil)
+	{
+		// Hand big blocks, like Blocks arrays, to the compressor without copying them.
+		REQUIRE(FlushStaging(self));
+		return self->_compressor == nil || [self writeToCompressor:bytes length:length];
+	}
+	
+	const uint8_t *next = bytes;
+	while (length > 0)
+	{
+		NSUInteger chunk = MIN(length, JANBTWriterRemaining(&self->_writer));
+		if (chunk == 0)
+		{
+			REQUIRE(MakeRoom(self, length));
+			continue;
+		}
+		
+		memcpy(JANBTWriterReserve(&self->_writer, chunk), next, chunk);
+		next += chunk;
+		length -= chunk;
+	}
+	
+	return YES;
+}
+
+
+static BOOL WriteString(JANBTStreamEncoder *self, NSString *value)
+{
+	if (value == nil)  return WriteShort(self, 0);
+	
+	CFStringRef string = (__bridge CFStringRef)value;
+	CFIndex length = CFStringGetLength(string);
+	
+	// Every UTF-16 unit takes at least one byte in UTF-8.
+	REQUIRE_ERR(length <= INT16_MAX, kJANBTSerializationObjectTooLargeError, @"String is too long (%li characters)", (long)length);
+	
+	// Usually, the string can be converted straight into the output buffer after its length prefix.
+	for (unsigned attempt = 0; attempt < 2; attempt++)
+	{
+		size_t room = JANBTWriterRemaining(&self->_writer);
+		if (room > sizeof (uint16_t))
+		{
+			uint8_t *bytes = self->_writer.next + sizeof (uint16_t);
+			CFIndex maxLength = (CFIndex)MIN(room - sizeof (uint16_t), (size_t)INT16_MAX);
+			CFIndex used;
+			if (CFStringGetBytes(string, CFRangeMake(0, length), kCFStringEncodingUTF8, 0, false, bytes, maxLength, &used) == length)
+			{
+				(void)JANBTWriterWriteShort(&self->_writer, (uint16_t)used);
+				self->_writer.next += used;
+				return YES;
+			}
+		}
+		if (attempt == 0)  REQUIRE(MakeRoom(self, sizeof (uint16_t) + length));
+	}
+	
+	NSData *bytes = [value dataUsingEncoding:NSUTF8StringEncoding];
+	NSUInteger byteLength = bytes.length;
+	REQUIRE_ERR(byteLength <= INT16_MAX, kJANBTSerializationObjectTooLargeError, @"String is too long (%lu bytes)", byteLength);
+	
+	REQUIRE(WriteShort(self, (uint16_t)byteLength));
+	return WriteBytes(self, bytes.bytes, byteLength);
+}
+
+
+static BOOL WritePackedValues(JANBTStreamEncoder *self, const void *values, NSUInteger count, size_t elementSize)
+{
+	// Swap straight into the output buffer, a buffer’s worth at a time.
+	const uint8_t *next = values;
+	while (count > 0)
+	{
+		NSUInteger chunk = MIN(count, JANBTWriterRemaining(&self->_writer) / elementSize);
+		if (chunk == 0)
+		{
+			REQUIRE(MakeRoom(self, count * elementSize));
+			continue;
+		}
+		
+		uint8_t *bytes = JANBTWriterReserve(&self->_writer, chunk * elementSize);
+		if (elementSize == sizeof (int32_t))  JANBTByteSwapInt32Array(bytes, next, chunk);
+		else  JANBTByteSwapInt64Array(bytes, next, chunk);
+		
+		next += chunk * elementSize;
+		count -= chunk;
+	}
+	
+	return YES;
+}
+
+
+/*
+	Size pre-pass for data mode. This mirrors the encoding methods below,
+	but doesn’t validate anything; values that can’t be encoded count as
+	nothing, since encoding them will fail anyway.
+*/
+static NSUInteger EncodedStringSize(NSString *string)
+{
+	return sizeof (uint16_t) + [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+}
+
+
+- (NSUInteger) encodedSizeOfRoot:(id)root withSchema:(const JANBTSchemaNode *)schema rootName:(NSString *)rootName
+{
+	JANBTTagType rootType = NormalizedTagType(root, schema);
+	return 1 + EncodedStringSize(rootName) + [self encodedSizeOfTagBody:root ofType:rootType withSchema:schema];
+}
+
+
+- (NSUInteger) encodedSizeOfTagBody:(id)value ofType:(JANBTTagType)type withSchema:(const JANBTSchemaNode *)schema
+{
+	switch (type)
+	{
+		case kJANBTTagByte:
+		case kJANBTTagShort:
+		case kJANBTTagInt:
+		case kJANBTTagLong:
+		case kJANBTTagFloat:
+		case kJANBTTagDouble:
+			return JANBTFixedTagSize(type);
+			
+		case kJANBTTagByteArray:
+			return sizeof (int32_t) + [value length];
+			
+		case kJANBTTagString:
+			return EncodedStringSize(value);
+			
+		case kJANBTTagList:
+		{
+			const JANBTSchemaNode *elementSchema = schema ? schema->element : NULL;
+			JANBTTagType elementType = [value ja_NBTListElementType];
+			if (elementType == kJANBTTagUnknown && elementSchema != NULL)  elementType = elementSchema->type;
+			
+			NSUInteger size = 1 + sizeof (int32_t);
+			for (id elem in value)
+			{
+				JANBTTagType elemType = [elem ja_NBTType];
+				if (elemType == elementType || (JANBTIsNumericalTagType(elemType) && JANBTIsNumericalTagType(elementType)))
+				{
+					size += [self encodedSizeOfTagBody:elem ofType:elementType withSchema:elementSchema];
+				}
+			}
+			return size;
+		}
+			
+		case kJANBTTagCompound:
+		{
+			NSUInteger size = 1;	// TAG_End
+			for (id key in value)
+			{
+				if (![key isKindOfClass:[NSString class]])  continue;
+				id element = [value objectForKey:key];
+				const JANBTSchemaNode *elementSchema = JANBTSchemaNodeMemberForKey(schema, key);
+				JANBTTagType elementType = NormalizedTagType(element, elementSchema);
+				
+				size += 1 + EncodedStringSize(key) + [self encodedSizeOfTagBody:element ofType:elementType withSchema:elementSchema];
+			}
+			return size;
+		}
+			
+		case kJANBTTagIntArray:
+			return sizeof (int32_t) + [value count] * sizeof (int32_t);
+			
+		case kJANBTTagLongArray:
+			return sizeof (int32_t) + [value count] * sizeof (int64_t);
+			
+		case kJANBTTagEnd:
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+	
+	return 0;
+}
+
+
+- (BOOL) encodeObjectInner:(id)root withSchema:(const JANBTSchemaNode *)schema rootName:(NSString *)rootName
 {
 	JANBTTagType rootType = NormalizedTagType(root, schema);
 	REQUIRE_ERR(JANBTIsKnownTagType(rootType), kJANBTSerializationWrongTypeError, @"Object is not an NBT value.");
-	REQUIRE([self writeByte:rootType]);
-	REQUIRE([self writeString:rootName]);
+	REQUIRE(WriteByte(self, rootType));
+	REQUIRE(WriteString(self, rootName));
 	
 	REQUIRE([self encodeOneTagBody:root ofType:rootType withSchema:schema]);
 	
@@ -164,7 +596,7 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 }
 
 
-- (BOOL) encodeOneTagBody:(id)value ofType:(JANBTTagType)type withSchema:(id)schema
+- (BOOL) encodeOneTagBody:(id)value ofType:(JANBTTagType)type withSchema:(const JANBTSchemaNode *)schema
 {
 	/*
 		Caller is responsible for ensuring objects are of the right classes.
@@ -173,6 +605,8 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 		overridden to lie.
 	*/
 	
+	JANBTStatisticsCountTag(_counters, type);
+	
 	switch (type)
 	{
 		case kJANBTTagByte:
@@ -200,16 +634,30 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 			return [self encodeString:value withSchema:schema];
 			
 		case kJANBTTagList:
-			return [self encodeList:value withSchema:schema];
+		{
+			JANBTStatisticsEnterContainer(_counters);
+			BOOL OK = [self encodeList:value withSchema:schema];
+			JANBTStatisticsExitContainer(_counters);
+			return OK;
+		}
 			
 		case kJANBTTagCompound:
-			return [self encodeCompound:value withSchema:schema];
+		{
+			JANBTStatisticsEnterContainer(_counters);
+			BOOL OK = [self encodeCompound:value withSchema:schema];
+			JANBTStatisticsExitContainer(_counters);
+			return OK;
+		}
 			
 		case kJANBTTagIntArray:
 			return [self encodeIntArray:value withSchema:schema];
 			
+		case kJANBTTagLongArray:
+			return [self encodeLongArray:value withSchema:schema];
+			
 		case kJANBTTagEnd:
 		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
 		case kJANBTTagAny:
 		case kJANBTTagUnknown:
 			;
@@ -220,105 +668,100 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 }
 
 
-#define REQUIRE_SCHEMA(COND, EXPECTED, SCH)  REQUIRE_ERR(COND, kJANBTSerializationWrongTypeError, @"Object does not conform to schema; expected %@, got %@.", JANBTTagNameFromSchema(SCH), EXPECTED)
-#define REQUIRE_NUMERICAL_SCHEMA(SCH)  REQUIRE_SCHEMA(JANBTIsNumericalSchema(SCH), @"numerical type", SCH)
+#define REQUIRE_SCHEMA(COND, EXPECTED, SCH)  REQUIRE_ERR(COND, kJANBTSerializationWrongTypeError, @"Object does not conform to schema; expected %@, got %@.", JANBTTagNameFromTagType(JANBTSchemaNodeType(SCH)), EXPECTED)
+#define REQUIRE_NUMERICAL_SCHEMA(SCH)  REQUIRE_SCHEMA(JANBTIsNumericalSchemaNode(SCH), @"numerical type", SCH)
 
-- (BOOL) encodeByte:(NSNumber *)value withSchema:(id)schema
+- (BOOL) encodeByte:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
-	return [self writeByte:value.charValue];
+	return WriteByte(self, value.charValue);
 }
 
 
-- (BOOL) encodeShort:(NSNumber *)value withSchema:(id)schema
+- (BOOL) encodeShort:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
-	return [self writeShort:value.shortValue];
+	return WriteShort(self, value.shortValue);
 }
 
 
-- (BOOL) encodeInt:(NSNumber *)value withSchema:(id)schema
+- (BOOL) encodeInt:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
-	return [self writeInt:value.intValue];
+	return WriteInt(self, value.intValue);
 }
 
 
-- (BOOL) encodeLong:(NSNumber *)value withSchema:(id)schema
+- (BOOL) encodeLong:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
-	return [self writeLong:value.longLongValue];
+	return WriteLong(self, value.longLongValue);
 }
 
 
-- (BOOL) encodeFloat:(NSNumber *)value withSchema:(id)schema
+- (BOOL) encodeFloat:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
-	return [self writeFloat:value.floatValue];
+	return WriteFloat(self, value.floatValue);
 }
 
 
-- (BOOL) encodeDouble:(NSNumber *)value withSchema:(id)schema
+- (BOOL) encodeDouble:(NSNumber *)value withSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
-	return [self writeDouble:value.doubleValue];
+	return WriteDouble(self, value.doubleValue);
 }
 
 
-- (BOOL) encodeByteArray:(NSData *)value withSchema:(id)schema
+- (BOOL) encodeByteArray:(NSData *)value withSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isEqual:@"data"], @"TAG_Byte_Array", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagByteArray, @"TAG_Byte_Array", schema);
 	
 	NSUInteger length = value.length;
 	REQUIRE_ERR(length <= INT32_MAX, kJANBTSerializationObjectTooLargeError, @"Byte array is too long (%lu bytes)", length);
 	
-	REQUIRE([self writeInt:(int32_t)length]);
-	return [self writeBytes:value.bytes length:length];
-	
+	REQUIRE(WriteInt(self, (int32_t)length));
+	return WriteBytes(self, value.bytes, length);
 }
 
 
-- (BOOL) encodeString:(NSString *)value withSchema:(id)schema
+- (BOOL) encodeString:(NSString *)value withSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isEqual:@"string"], @"TAG_String", schema);
-	return [self writeString:value];
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagString, @"TAG_String", schema);
+	return WriteString(self, value);
 }
 
 
-- (BOOL) encodeList:(NSArray *)value withSchema:(id)schema
+- (BOOL) encodeList:(NSArray *)value withSchema:(const JANBTSchemaNode *)schema
 {
-	if (value.ja_NBTListElementType == kJANBTTagIntArrayContent || [schema isEqual:@"intarray"])
-	{
-		return [self encodeIntArray:value withSchema:schema];
-	}
-	
-	REQUIRE_SCHEMA(schema == nil || ([schema isKindOfClass:[NSArray class]] && [schema count] == 1), @"TAG_List", schema);
+	// NOTE: arrays to be written as int or long arrays are diverted by NormalizedTagType().
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagList, @"TAG_List", schema);
 	
-	schema = [schema objectAtIndex:0];
+	const JANBTSchemaNode *elementSchema = schema ? schema->element : NULL;
 	
 	JANBTTagType type = value.ja_NBTListElementType;
-	if (type == kJANBTTagUnknown && schema != nil)
+	if (type == kJANBTTagUnknown && elementSchema != NULL)
 	{
-		type = [schema ja_NBTSchemaType];
+		type = elementSchema->type;
 	}
 	else
 	{
-		REQUIRE_ERR(schema == nil || type == [schema ja_NBTSchemaType], kJANBTSerializationWrongTypeError, @"Object does not conform to schema; expected list element type %@, got %@.", JANBTTagNameFromSchema(schema), JANBTTagNameFromTagType(type));
+		REQUIRE_ERR(elementSchema == NULL || type == elementSchema->type, kJANBTSerializationWrongTypeError, @"Object does not conform to schema; expected list element type %@, got %@.", JANBTTagNameFromTagType(JANBTSchemaNodeType(elementSchema)), JANBTTagNameFromTagType(type));
 	}
 	REQUIRE_ERR(JANBTIsKnownTagType(type), kJANBTSerializationWrongTypeError, @"Object contains list with unknown NBT type.");
 	
 	NSUInteger count = value.count;
 	REQUIRE_ERR(count <= INT32_MAX, kJANBTSerializationObjectTooLargeError, @"List too long (%lu items)", count);
 	
-	REQUIRE([self writeByte:type]);
-	REQUIRE([self writeInt:(int32_t)count]);
+	REQUIRE(WriteByte(self, type));
+	REQUIRE(WriteInt(self, (int32_t)count));
 	
 	for (id elem in value)
 	{
 		JANBTTagType elemType = [elem ja_NBTType];
 		if (elemType == type || (JANBTIsNumericalTagType(elemType) && JANBTIsNumericalTagType(type)))
 		{
-			REQUIRE([self encodeOneTagBody:elem ofType:type withSchema:schema]);
+			REQUIRE([self encodeOneTagBody:elem ofType:type withSchema:elementSchema]);
 		}
 	}
 	
@@ -326,9 +769,9 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 }
 
 
-- (BOOL) encodeCompound:(NSDictionary *)value withSchema:(id)schema
+- (BOOL) encodeCompound:(NSDictionary *)value withSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isKindOfClass:[NSDictionary class]], @"TAG_Compound", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagCompound, @"TAG_Compound", schema);
 	
 	for (id key in value)
 	{
@@ -336,113 +779,492 @@ static JANBTTagType NormalizedTagType(id value, id schema);
 		{
 			REQUIRE_ERR([key isKindOfClass:[NSString class]], kJANBTSerializationWrongTypeError, @"Object countains a non-string dictionary key.");
 			id element = [value objectForKey:key];
-			id elementSchema = [schema objectForKey:key];
+			const JANBTSchemaNode *elementSchema = JANBTSchemaNodeMemberForKey(schema, key);
 			
 			JANBTTagType type = NormalizedTagType(element, elementSchema);
 			REQUIRE_ERR(JANBTIsKnownTagType(type), kJANBTSerializationWrongTypeError, @"Object contains a dictionary value of unknown NBT type.");
 			
-			REQUIRE([self writeByte:type]);
-			REQUIRE([self writeString:key]);
+			REQUIRE(WriteByte(self, type));
+			REQUIRE(WriteString(self, key));
 			
 			REQUIRE([self encodeOneTagBody:element ofType:type withSchema:elementSchema]);
 		}
 	}
 	
-	return [self writeByte:kJANBTTagEnd];
+	return WriteByte(self, kJANBTTagEnd);
 }
 
 
-- (BOOL) encodeIntArray:(NSArray *)value withSchema:(id)schema
+- (BOOL) encodeIntArray:(NSArray *)value withSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isEqual:@"intarray"], @"TAG_Int_Array", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagIntArray, @"TAG_Int_Array", schema);
 	
 	NSUInteger count = value.count;
 	REQUIRE_ERR(count <= INT32_MAX, kJANBTSerializationObjectTooLargeError, @"List too long (%lu items)", count);
 	
-	REQUIRE([self writeInt:(int32_t)count]);
+	REQUIRE(WriteInt(self, (int32_t)count));
+	
+	if ([value isKindOfClass:[JANBTIntArray class]])
+	{
+		return WritePackedValues(self, ((JANBTIntArray *)value).values, count, sizeof (int32_t));
+	}
 	
 	for (id elem in value)
 	{
 		REQUIRE_ERR([elem respondsToSelector:@selector(intValue)], kJANBTSerializationWrongTypeError, @"Int array contains non-numerical object.");
-		REQUIRE([self writeInt:[elem intValue]]);
+		REQUIRE(WriteInt(self, [elem intValue]));
 	}
 	
 	return YES;
 }
 
 
-- (BOOL) writeByte:(uint8_t)value
+- (BOOL) encodeLongArray:(NSArray *)value withSchema:(const JANBTSchemaNode *)schema
 {
-	return [self writeBytes:&value length:sizeof value];
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagLongArray, @"TAG_Long_Array", schema);
+	
+	NSUInteger count = value.count;
+	REQUIRE_ERR(count <= INT32_MAX, kJANBTSerializationObjectTooLargeError, @"List too long (%lu items)", count);
+	
+	REQUIRE(WriteInt(self, (int32_t)count));
+	
+	if ([value isKindOfClass:[JANBTLongArray class]])
+	{
+		return WritePackedValues(self, ((JANBTLongArray *)value).values, count, sizeof (int64_t));
+	}
+	
+	for (id elem in value)
+	{
+		REQUIRE_ERR([elem respondsToSelector:@selector(longLongValue)], kJANBTSerializationWrongTypeError, @"Long array contains non-numerical object.");
+		REQUIRE(WriteLong(self, [elem longLongValue]));
+	}
+	
+	return YES;
+}
+
+
+/*
+	Incremental encoding. Thin wrappers around the output primitives; all
+	the bookkeeping is in JANBTStreamWriter.
+*/
+- (BOOL) writeTagType:(JANBTTagType)type name:(NSString *)name
+{
+	NSAssert(!_dataMode, @"Incremental encoding is only supported for streams.");
+	
+	REQUIRE(WriteByte(self, type));
+	return name == nil || WriteString(self, name);
+}
+
+
+- (BOOL) writeByte:(int8_t)value
+{
+	return WriteByte(self, value);
 }
 
 
-- (BOOL) writeShort:(uint16_t)value
+- (BOOL) writeShort:(int16_t)value
 {
-	value = CFSwapInt16HostToBig(value);
-	return [self writeBytes:&value length:sizeof value];
+	return WriteShort(self, value);
 }
 
 
-- (BOOL) writeInt:(uint32_t)value
+- (BOOL) writeInt:(int32_t)value
 {
-	value = CFSwapInt32HostToBig(value);
-	return [self writeBytes:&value length:sizeof value];
+	return WriteInt(self, value);
 }
 
 
-- (BOOL) writeLong:(uint64_t)value
+- (BOOL) writeLong:(int64_t)value
 {
-	value = CFSwapInt64HostToBig(value);
-	return [self writeBytes:&value length:sizeof value];
+	return WriteLong(self, value);
 }
 
 
 - (BOOL) writeFloat:(Float32)value
 {
-	union { int32_t i; Float32 f; } convert;
-	convert.f = value;
-	return [self writeInt:convert.i];
+	return WriteFloat(self, value);
 }
 
 
-- (BOOL) writeDouble:(Float64)value 
+- (BOOL) writeDouble:(Float64)value
 {
-	union { int64_t i; Float64 f; } convert;
-	convert.f = value;
-	return [self writeLong:convert.i];
+	return WriteDouble(self, value);
 }
 
 
 - (BOOL) writeString:(NSString *)value
 {
-	NSData *bytes = [value dataUsingEncoding:NSUTF8StringEncoding];
-	NSUInteger length = bytes.length;
-	REQUIRE_ERR(length <= INT16_MAX, kJANBTSerializationObjectTooLargeError, @"String is too long (%lu bytes)", length);
-	
-	REQUIRE([self writeShort:length]);
-	return [self writeBytes:bytes.bytes length:length];
+	return WriteString(self, value);
 }
 
 
 - (BOOL) writeBytes:(const void *)bytes length:(NSUInteger)length
 {
-	if (_compressor == nil)  return YES;
+	return length == 0 || WriteBytes(self, bytes, length);
+}
+
+
+- (BOOL) writeInts:(const int32_t *)values count:(NSUInteger)count
+{
+	return WritePackedValues(self, values, count, sizeof (int32_t));
+}
+
+
+- (BOOL) writeLongs:(const int64_t *)values count:(NSUInteger)count
+{
+	return WritePackedValues(self, values, count, sizeof (int64_t));
+}
+
+
+- (JANBTTagType) tagTypeOfObject:(id)value withSchema:(const JANBTSchemaNode *)schema
+{
+	JANBTTagType type = NormalizedTagType(value, schema);
+	return JANBTIsKnownTagType(type) ? type : kJANBTTagUnknown;
+}
+
+
+- (BOOL) encodeTagBody:(id)value ofType:(JANBTTagType)type withSchema:(const JANBTSchemaNode *)schema
+{
+	BOOL OK;
+	@autoreleasepool
+	{
+		OK = [self encodeOneTagBody:value ofType:type withSchema:schema];
+	}
+	return OK;
+}
+
+
+- (BOOL) finishWithError:(NSError **)outError
+{
+	BOOL OK = [self finishOutput];
+	if (!OK && outError != NULL)  *outError = _error;
+	return OK;
+}
+
+
+- (NSError *) error
+{
+	return _error;
+}
+
+
+/*
+	Splicing. The source is walked with _spliceCursor, and bytes before a
+	changed tag are only copied once the change is reached, so untouched
+	stretches go out in as few writes as possible. Every method stops early
+	once _splicePending reaches zero; the caller then copies the rest.
+*/
+static BOOL SpliceCopy(JANBTStreamEncoder *self, const uint8_t *upTo)
+{
+	const uint8_t *start = self->_spliceCopied;
+	self->_spliceCopied = upTo;
+	return upTo == start || WriteBytes(self, start, upTo - start);
+}
+
+
+// The new values, plus a little for their names; the output buffer grows if this is wrong.
+- (NSUInteger) encodedSizeOfPatch:(JANBTPatch *)patch
+{
+	id value = patch.value;
+	if (value != nil)
+	{
+		if (value == [NSNull null])  return 0;
+		return [self encodedSizeOfRoot:value withSchema:NULL rootName:patch.name];
+	}
+	
+	NSUInteger size = 0;
+	for (JANBTPatch *child in patch.namedChildren)  size += [self encodedSizeOfPatch:child];
+	for (JANBTPatch *child in patch.indexedChildren)  size += [self encodedSizeOfPatch:child];
+	return size;
+}
+
+
+- (BOOL) spliceRootWithPatch:(JANBTPatch *)patch schema:(const JANBTSchemaNode *)schema
+{
+	int8_t rootType;
+	const char *rootName;
+	uint16_t rootNameLength;
+	REQUIRE_ERR(JANBTCursorReadByte(&_spliceCursor, &rootType) && JANBTCursorReadStringBytes(&_spliceCursor, &rootName, &rootNameLength), kJANBTSerializationReadError, @"Premature end of file.");
+	REQUIRE_ERR(rootType == kJANBTTagCompound, kJANBTSerializationWrongTypeError, @"NBT root is not a compound.");
+	
+	return [self spliceCompoundWithPatch:patch schema:schema];
+}
+
+
+- (BOOL) spliceCompoundWithPatch:(JANBTPatch *)patch schema:(const JANBTSchemaNode *)schema
+{
+	REQUIRE_ERR(patch.indexedChildren.count == 0, kJANBTSerializationInvalidKeyPathError, @"NBT key path “%@” refers to a list element, but %@ is a compound.", [patch.indexedChildren[0] keyPath], patch.keyPath);
+	
+	NSUInteger unfound = patch.namedChildren.count;
+	while (_splicePending != 0)
+	{
+		const uint8_t *memberStart = _spliceCursor.next;
+		int8_t type;
+		REQUIRE_ERR(JANBTCursorReadByte(&_spliceCursor, &type), kJANBTSerializationReadError, @"Premature end of file.");
+		
+		if (type == kJANBTTagEnd)
+		{
+			// Members that don’t exist yet are added at the end. Removing them is a no-op.
+			if (unfound != 0)
+			{
+				REQUIRE(SpliceCopy(self, memberStart));
+				for (JANBTPatch *child in patch.namedChildren)
+				{
+					if (child.applied)  continue;
+					
+					id value = child.value;
+					REQUIRE_ERR(value != nil, kJANBTSerializationInvalidKeyPathError, @"NBT key path “%@” does not exist.", child.keyPath);
+					if (value != [NSNull null])  REQUIRE([self encodeObjectInner:value withSchema:JANBTSchemaNodeMemberForKey(schema, child.name) rootName:child.name]);
+					_splicePending--;
+				}
+			}
+			return YES;
+		}
+		
+		const char *name;
+		uint16_t nameLength;
+		REQUIRE_ERR(JANBTCursorReadStringBytes(&_spliceCursor, &name, &nameLength), kJANBTSerializationReadError, @"Premature end of file.");
+		
+		JANBTPatch *child = (unfound != 0) ? [patch childNamed:(JANBTStringRef){ name, nameLength }] : nil;
+		if (child == nil)
+		{
+			REQUIRE([self spliceSkipTagBodyOfType:type]);
+			continue;
+		}
+		
+		child.applied = YES;
+		unfound--;
+		REQUIRE([self spliceTagBodyOfType:type start:memberStart patch:child schema:JANBTSchemaNodeMemberNamed(schema, name, nameLength)]);
+	}
+	
+	return YES;
+}
+
+
+- (BOOL) spliceListWithPatch:(JANBTPatch *)patch schema:(const JANBTSchemaNode *)schema
+{
+	REQUIRE_ERR(patch.namedChildren.count == 0, kJANBTSerializationInvalidKeyPathError, @"NBT key path “%@” refers to a compound member, but %@ is a list.", [patch.namedChildren[0] keyPath], patch.keyPath);
+	
+	const uint8_t *headerStart = _spliceCursor.next;
+	int8_t elementType;
+	uint32_t count;
+	REQUIRE_ERR(JANBTCursorReadByte(&_spliceCursor, &elementType) && JANBTCursorReadInt(&_spliceCursor, (int32_t *)&count), kJANBTSerializationReadError, @"Premature end of file.");
+	
+	NSArray *children = patch.indexedChildren;
+	uint32_t removed = 0;
+	for (JANBTPatch *child in children)
+	{
+		REQUIRE_ERR(child.index < count, kJANBTSerializationInvalidKeyPathError, @"NBT key path “%@” is out of range; the list has %u elements.", child.keyPath, count);
+		if (child.value == [NSNull null])  removed++;
+	}
+	
+	// Removing elements changes the count in the header.
+	if (removed != 0)
+	{
+		REQUIRE(SpliceCopy(self, headerStart));
+		REQUIRE(WriteByte(self, elementType));
+		REQUIRE(WriteInt(self, count - removed));
+		_spliceCopied = _spliceCursor.next;
+	}
+	
+	const JANBTSchemaNode *elementSchema = (schema != NULL) ? schema->element : NULL;
+	uint32_t next = 0;
+	for (JANBTPatch *child in children)
+	{
+		if (_splicePending == 0)  return YES;
+		
+		REQUIRE([self spliceSkipElements:child.index - next ofType:elementType]);
+		REQUIRE([self spliceTagBodyOfType:elementType start:_spliceCursor.next patch:child schema:elementSchema]);
+		next = child.index + 1;
+	}
+	
+	if (_splicePending == 0)  return YES;
+	return [self spliceSkipElements:count - next ofType:elementType];
+}
+
+
+/*
+	Apply patch to a tag whose body is at the cursor. start is where the
+	tag begins: the type byte for compound members, the body for list
+	elements.
+*/
+- (BOOL) spliceTagBodyOfType:(JANBTTagType)type start:(const uint8_t *)start patch:(JANBTPatch *)patch schema:(const JANBTSchemaNode *)schema
+{
+	id value = patch.value;
+	if (value == nil)
+	{
+		if (type == kJANBTTagCompound)  return [self spliceCompoundWithPatch:patch schema:schema];
+		REQUIRE_ERR(type == kJANBTTagList, kJANBTSerializationInvalidKeyPathError, @"NBT key path “%@” goes through a %@, which has no members.", patch.keyPath, JANBTTagNameFromTagType(type));
+		return [self spliceListWithPatch:patch schema:schema];
+	}
+	
+	REQUIRE([self spliceSkipTagBodyOfType:type]);
+	REQUIRE(SpliceCopy(self, start));
+	_spliceCopied = _spliceCursor.next;
+	_splicePending--;
+	
+	if (value == [NSNull null])  return YES;
+	if (patch.name != nil)  return [self encodeObjectInner:value withSchema:schema rootName:patch.name];
+	
+	// List elements must keep the list’s type.
+	JANBTTagType valueType = NormalizedTagType(value, schema);
+	REQUIRE_ERR(valueType == type || (JANBTIsNumericalTagType(valueType) && JANBTIsNumericalTagType(type)), kJANBTSerializationWrongTypeError, @"Wrong type for %@ - expected %@, like the rest of the list, got %@.", patch.keyPath, JANBTTagNameFromTagType(type), JANBTTagNameFromTagType(valueType));
+	return [self encodeOneTagBody:value ofType:type withSchema:schema];
+}
+
+
+- (BOOL) spliceSkipElements:(uint32_t)count ofType:(JANBTTagType)type
+{
+	size_t elementSize = JANBTFixedTagSize(type);
+	if (elementSize != 0)
+	{
+		REQUIRE_ERR(JANBTCursorReadBytes(&_spliceCursor, (size_t)count * elementSize) != NULL, kJANBTSerializationReadError, @"Premature end of file.");
+		return YES;
+	}
+	
+	for (uint32_t i = 0; i < count; i++)
+	{
+		REQUIRE([self spliceSkipTagBodyOfType:type]);
+	}
+	return YES;
+}
+
+
+// As -[JANBTStreamParser skipTagBodyOfType:].
+- (BOOL) spliceSkipTagBodyOfType:(JANBTTagType)type
+{
+	switch (type)
+	{
+		case kJANBTTagByte:
+		case kJANBTTagShort:
+		case kJANBTTagInt:
+		case kJANBTTagLong:
+		case kJANBTTagFloat:
+		case kJANBTTagDouble:
+			return [self spliceSkipElements:1 ofType:type];
+			
+		case kJANBTTagByteArray:
+		case kJANBTTagIntArray:
+		case kJANBTTagLongArray:
+		{
+			uint32_t count;
+			REQUIRE_ERR(JANBTCursorReadInt(&_spliceCursor, (int32_t *)&count), kJANBTSerializationReadError, @"Premature end of file.");
+			JANBTTagType elementType = (type == kJANBTTagByteArray) ? kJANBTTagByte : (type == kJANBTTagIntArray) ? kJANBTTagInt : kJANBTTagLong;
+			return [self spliceSkipElements:count ofType:elementType];
+		}
+			
+		case kJANBTTagString:
+		{
+			const char *bytes;
+			uint16_t length;
+			REQUIRE_ERR(JANBTCursorReadStringBytes(&_spliceCursor, &bytes, &length), kJANBTSerializationReadError, @"Premature end of file.");
+			return YES;
+		}
+			
+		case kJANBTTagList:
+		{
+			int8_t elementType;
+			uint32_t count;
+			REQUIRE_ERR(JANBTCursorReadByte(&_spliceCursor, &elementType) && JANBTCursorReadInt(&_spliceCursor, (int32_t *)&count), kJANBTSerializationReadError, @"Premature end of file.");
+			if (count == 0)  return YES;
+			return [self spliceSkipElements:count ofType:elementType];
+		}
+			
+		case kJANBTTagCompound:
+			for (;;)
+			{
+				int8_t memberType;
+				const char *name;
+				uint16_t nameLength;
+				REQUIRE_ERR(JANBTCursorReadByte(&_spliceCursor, &memberType), kJANBTSerializationReadError, @"Premature end of file.");
+				if (memberType == kJANBTTagEnd)  return YES;
+				
+				REQUIRE_ERR(JANBTCursorReadStringBytes(&_spliceCursor, &name, &nameLength), kJANBTSerializationReadError, @"Premature end of file.");
+				REQUIRE([self spliceSkipTagBodyOfType:memberType]);
+			}
+			
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+	
+	[self setErrorIfClear:kJANBTSerializationUnknownTagError underlyingError:nil format:@"Unknown NBT tag %u.", type];
+	return NO;
+}
+
+
+- (BOOL) writeToCompressor:(const void *)bytes length:(NSUInteger)length
+{
+	uint64_t start = (_counters != NULL) ? mach_absolute_time() : 0;
 	NSError __autoreleasing *error;
 	BOOL OK = [_compressor write:bytes length:length error:&error];
 	if (!OK)  _error = error;
+	
+	if (_counters != NULL)
+	{
+		_counters->compressionTime += mach_absolute_time() - start;
+		_counters->uncompressedLength += length;
+	}
 	return OK;
 }
 
 @end
 
 
-static JANBTTagType NormalizedTagType(id value, id schema)
+static JANBTTagType NormalizedTagType(id value, const JANBTSchemaNode *schema)
+{
+	if (schema != NULL && JANBTIsNumericalTagType(schema->type) && [value isKindOfClass:[NSNumber class]])
+	{
+		return schema->type;
+	}
+	
+	JANBTTagType type = [value ja_NBTType];
+	if (type == kJANBTTagList)
+	{
+		// Plain NSArrays may be tagged or schema’d as int or long arrays.
+		JANBTTagType elementType = [value ja_NBTListElementType];
+		if (elementType == kJANBTTagIntArrayContent || JANBTSchemaNodeType(schema) == kJANBTTagIntArray)  return kJANBTTagIntArray;
+		if (elementType == kJANBTTagLongArrayContent || JANBTSchemaNodeType(schema) == kJANBTTagLongArray)  return kJANBTTagLongArray;
+	}
+	return type;
+}
+
+
+static JAZLibCompressionSettings CompressionSettingsFromOptions(JANBTWritingOptions options)
 {
-	if (schema != nil && [value isKindOfClass:[NSNumber class]])
+	JAZLibCompressionSettings settings = JAZLibDefaultCompressionSettings(kJAZLibCompressionGZip);
+	
+	switch (options & JANBTWritingOptionsContainerMask)
 	{
-		JANBTTagType schemaType = [schema ja_NBTSchemaType];
-		if (JANBTIsNumericalTagType(schemaType))  return schemaType;
+		case JANBTWritingOptionsZLibContainer:
+			settings.mode = kJAZLibCompressionZLib;
+			break;
+			
+		case JANBTWritingOptionsRawDeflateContainer:
+			settings.mode = kJAZLibCompressionRawDeflate;
+			break;
 	}
-	return [value ja_NBTType];
+	
+	unsigned level = (unsigned)((options & JANBTWritingOptionsCompressionLevelMask) >> 8);
+	if (level != 0)  settings.level = MIN(level, 9U);
+	
+	switch (options & JANBTWritingOptionsStrategyMask)
+	{
+		case JANBTWritingOptionsFilteredStrategy:
+			settings.strategy = kJAZLibStrategyFiltered;
+			break;
+			
+		case JANBTWritingOptionsRLEStrategy:
+			settings.strategy = kJAZLibStrategyRLE;
+			break;
+			
+		case JANBTWritingOptionsHuffmanOnlyStrategy:
+			settings.strategy = kJAZLibStrategyHuffmanOnly;
+			break;
+	}
+	
+	return settings;
 }
@@ -27,12 +27,54 @@
 */
 
 #import "JANBTSerialization.h"
+#import "JANBTReaderDelegate.h"
+#import "JANBTSchemaNode.h"
+#import "JANBTStatisticsCounters.h"
+
+@class JANBTProjection, JANBTLazyDocument;
 
 
 @interface JANBTStreamParser: NSObject
 
 - (id) initWithStream:(NSInputStream *)stream options:(JANBTReadingOptions)options;
-- (BOOL) parseWithSchema:(id)schema expectedRootName:(NSString *)expectedName error:(NSError **)outError;
+
+/*
+	Parse an in-memory buffer of uncompressed NBT. This is considerably
+	faster than the stream case, since primitives are read directly from the
+	buffer. Unless mutable leaves are requested, byte arrays are returned as
+	slices of data, which is retained and must not be mutated.
+*/
+- (id) initWithUncompressedData:(NSData *)data options:(JANBTReadingOptions)options;
+- (BOOL) parseWithSchema:(JANBTCompiledSchema *)schema expectedRootName:(NSString *)expectedName error:(NSError **)outError;
+
+/*
+	Walk the NBT and report it to delegate instead of building a property
+	list. root is not set; rootName is.
+*/
+- (BOOL) scanWithDelegate:(id<JANBTReaderDelegate>)delegate expectedRootName:(NSString *)expectedName error:(NSError **)outError;
+
+/*
+	Parse a single tag body at bytes, which must lie within document’s
+	buffer. Used by lazy containers to parse their members on demand;
+	compounds and lists in the result are themselves lazy.
+*/
++ (id) lazyValueOfType:(JANBTTagType)type
+				 bytes:(const uint8_t *)bytes
+				schema:(const JANBTSchemaNode *)schema
+			  document:(JANBTLazyDocument *)document
+				 error:(NSError **)outError;
+
+/*
+	If set, only the members of the root compound selected by the projection
+	are parsed; everything else is skipped.
+*/
+@property (nonatomic) JANBTProjection *projection;
+
+/*
+	If set, tags, nesting, objects and time spent parsing or scanning are
+	added to these counters. They must outlive the parse.
+*/
+@property (nonatomic) JANBTStatisticsCounters *statisticsCounters;
 
 @property (readonly) id root;
 @property (readonly) NSString *rootName;
@@ -28,6 +28,15 @@
 #import "JANBTTypedNumbers.h"
 #import "JANBTParserNullCompressor.h"
 #import "JAZLibCompressor.h"
+#import "JANBTBufferCursor.h"
+#import "JANBTDataSlice.h"
+#import "JANBTProjection.h"
+#import "JANBTPackedArrays.h"
+#import "JANBTByteSwap.h"
+#import "JANBTStringTable.h"
+#import "JANBTSchemaNode.h"
+#import "JANBTLazyContainers.h"
+#import "JANBTValidator.h"
 
 
 #define LOG_PARSING 0
@@ -44,9 +53,6 @@ static void ParseLog(NSString *message, NSInteger indent, NSUInteger offset);
 
 
 
-static inline BOOL IsNumericalSchema(id schema);
-
-
 /*
 	REQUIRE(cond)
 	REQUIRE_ERR(condition, errorCode, format)
@@ -64,17 +70,54 @@ static inline BOOL IsNumericalSchema(id schema);
 #define REQUIRE(COND) do { if (__builtin_expect(!(COND), 0))  return 0; } while (0)
 
 
+// Reusable storage for borrowed names, strings and arrays when scanning a stream.
+typedef struct
+{
+	void					*bytes;
+	size_t					capacity;
+} ScratchBuffer;
+
+
 @implementation JANBTStreamParser
 {
 	id						_result;
 	NSString				*_rootName;
 	id<JANBTParserDecompressor>	_decompressor;
+	NSData					*_buffer;
+	JANBTBufferCursor		_cursor;
 	NSError					*_error;
 	NSMutableArray			*_keyPath;
+	JANBTProjection			*_currentProjection;	// nil means everything.
+	JANBTStringTable		*_keyTable;
+	JANBTLazyDocument		*_lazyDocument;		// Non-nil while producing lazy containers.
+	JANBTStatisticsCounters	*_counters;
+	JANBTReadingOptions		_options;
+	BOOL					_lazyContainers;
 	BOOL					_mutableContainers;
 	BOOL					_mutableLeaves;
 	BOOL					_allowFragments;
 	
+	id<JANBTReaderDelegate>	_delegate;
+	struct
+	{
+		unsigned				beginCompound: 1,
+								endCompound: 1,
+								beginList: 1,
+								endList: 1,
+								foundByte: 1,
+								foundShort: 1,
+								foundInt: 1,
+								foundLong: 1,
+								foundFloat: 1,
+								foundDouble: 1,
+								foundString: 1,
+								foundByteArray: 1,
+								foundIntArray: 1,
+								foundLongArray: 1;
+	}						_delegateResponds;
+	ScratchBuffer			_nameScratch;
+	ScratchBuffer			_valueScratch;
+	
 #if LOG_PARSING
 	NSInteger				_parseLogIndent;
 #endif
@@ -85,24 +128,297 @@ static inline BOOL IsNumericalSchema(id schema);
 {
 	NSParameterAssert(stream != nil);
 	
-	if ((self = [super init]))
+	if ((self = [self initWithOptions:options]))
 	{
 		if (options & JANBTReadingOptionsUncompressed) {
 			_decompressor = [[JANBTParserNullDecompressor alloc] initWithStream:stream];
 		} else {
 			_decompressor = [[JAZlibDecompressor alloc] initWithStream:stream mode:kJAZLibCompressionAutoDetect];
 		}
+	}
+	return self;
+}
+
+
+- (id) initWithUncompressedData:(NSData *)data options:(JANBTReadingOptions)options
+{
+	NSParameterAssert(data != nil);
+	
+	if ((self = [self initWithOptions:options]))
+	{
+		_buffer = data;
+		_cursor = JANBTMakeBufferCursor(data.bytes, data.length);
 		
+		// Lazy containers point into the buffer, so they’re only possible when parsing from memory.
+		_lazyContainers = (options & JANBTReadingOptionsLazyContainers) && !_mutableContainers;
+	}
+	return self;
+}
+
+
++ (id) lazyValueOfType:(JANBTTagType)type
+				 bytes:(const uint8_t *)bytes
+				schema:(const JANBTSchemaNode *)schema
+			  document:(JANBTLazyDocument *)document
+				 error:(NSError **)outError
+{
+	NSData *buffer = document.buffer;
+	NSParameterAssert((const uint8_t *)buffer.bytes <= bytes && bytes < (const uint8_t *)buffer.bytes + buffer.length);
+	
+	JANBTStreamParser *parser = [[self alloc] init];
+	if (parser == nil)  return nil;
+	
+	parser->_options = document.options;
+	parser->_mutableLeaves = document.options & JANBTReadingOptionsMutableLeaves;
+	parser->_buffer = buffer;
+	parser->_cursor = (JANBTBufferCursor){ bytes, (const uint8_t *)buffer.bytes + buffer.length };
+	parser->_keyPath = [NSMutableArray new];
+	parser->_keyTable = document.keyTable;
+	parser->_lazyDocument = document;
+	parser->_rootName = @"";
+	
+	id result;
+	@autoreleasepool
+	{
+		result = [parser parseOneTagBodyOfType:type withSchema:schema];
+	}
+	
+	if (result == nil && outError != NULL)  *outError = parser->_error;
+	return result;
+}
+
+
+- (id) initWithOptions:(JANBTReadingOptions)options
+{
+	if ((self = [super init]))
+	{
+		_options = options;
 		_mutableContainers = options & JANBTReadingOptionsMutableContainers;
 		_mutableLeaves = options & JANBTReadingOptionsMutableLeaves;
 		_allowFragments = options & JANBTReadingOptionsAllowFragments;
 		
 		_keyPath = [NSMutableArray new];
+		
+		if (options & JANBTReadingOptionsSharedKeyTable)  _keyTable = [JANBTStringTable sharedTable];
+		else  _keyTable = [JANBTStringTable new];
 	}
 	return self;
 }
 
 
+- (void) dealloc
+{
+	free(_nameScratch.bytes);
+	free(_valueScratch.bytes);
+}
+
+
+/*
+	Primitive readers.
+	
+	When parsing from memory, these read straight from _cursor and are cheap
+	enough to inline into the tag parsers. Stream parsing goes through
+	-readBytes:length: and the decompressor.
+*/
+static BOOL PrematureEnd(JANBTStreamParser *self)
+{
+	[self setErrorIfClear:kJANBTSerializationReadError underlyingError:nil format:@"Premature end of file."];
+	return NO;
+}
+
+
+static inline const uint8_t *ReadBufferedBytes(JANBTStreamParser *self, size_t length)
+{
+	const uint8_t *result = JANBTCursorReadBytes(&self->_cursor, length);
+	if (__builtin_expect(result == NULL, 0))  PrematureEnd(self);
+	return result;
+}
+
+
+static inline BOOL ReadByte(JANBTStreamParser *self, int8_t *value)
+{
+	if (__builtin_expect(self->_buffer != nil, 1))
+	{
+		return JANBTCursorReadByte(&self->_cursor, value) || PrematureEnd(self);
+	}
+	return [self readBytes:value length:sizeof *value];
+}
+
+
+static inline BOOL ReadShort(JANBTStreamParser *self, int16_t *value)
+{
+	if (__builtin_expect(self->_buffer != nil, 1))
+	{
+		return JANBTCursorReadShort(&self->_cursor, value) || PrematureEnd(self);
+	}
+	uint16_t raw;
+	REQUIRE([self readBytes:&raw length:sizeof raw]);
+	*value = CFSwapInt16BigToHost(raw);
+	return YES;
+}
+
+
+static inline BOOL ReadInt(JANBTStreamParser *self, int32_t *value)
+{
+	if (__builtin_expect(self->_buffer != nil, 1))
+	{
+		return JANBTCursorReadInt(&self->_cursor, value) || PrematureEnd(self);
+	}
+	uint32_t raw;
+	REQUIRE([self readBytes:&raw length:sizeof raw]);
+	*value = CFSwapInt32BigToHost(raw);
+	return YES;
+}
+
+
+static inline BOOL ReadLong(JANBTStreamParser *self, int64_t *value)
+{
+	if (__builtin_expect(self->_buffer != nil, 1))
+	{
+		return JANBTCursorReadLong(&self->_cursor, value) || PrematureEnd(self);
+	}
+	uint64_t raw;
+	REQUIRE([self readBytes:&raw length:sizeof raw]);
+	*value = CFSwapInt64BigToHost(raw);
+	return YES;
+}
+
+
+static inline BOOL ReadFloat(JANBTStreamParser *self, Float32 *value)
+{
+	union { int32_t i; Float32 f; } convert;
+	REQUIRE(ReadInt(self, &convert.i));
+	*value = convert.f;
+	return YES;
+}
+
+
+static inline BOOL ReadDouble(JANBTStreamParser *self, Float64 *value)
+{
+	union { int64_t i; Float64 f; } convert;
+	REQUIRE(ReadLong(self, &convert.i));
+	*value = convert.f;
+	return YES;
+}
+
+
+/*
+	Borrowed reads, used by scanning and projection. These return pointers into
+	the parse buffer, or into a scratch buffer when reading from a stream.
+*/
+static void *ScratchBytes(JANBTStreamParser *self, ScratchBuffer *scratch, size_t length)
+{
+	if (scratch->bytes == NULL || scratch->capacity < length)
+	{
+		size_t capacity = MAX(length, MAX(scratch->capacity * 2, (size_t)256));
+		void *bytes = realloc(scratch->bytes, capacity);
+		REQUIRE_ERR(bytes, kJANBTSerializationMemoryError, @"Not enough memory for NBT value of length %zu.", length);
+		
+		scratch->bytes = bytes;
+		scratch->capacity = capacity;
+	}
+	return scratch->bytes;
+}
+
+
+// Bytes borrowed from the parse buffer, or read into scratch when streaming.
+static const uint8_t *ReadBorrowedBytes(JANBTStreamParser *self, size_t length, ScratchBuffer *scratch)
+{
+	if (self->_buffer != nil)  return ReadBufferedBytes(self, length);
+	
+	uint8_t *bytes;
+	REQUIRE(bytes = ScratchBytes(self, scratch, length));
+	REQUIRE([self readBytes:bytes length:length]);
+	return bytes;
+}
+
+
+static BOOL ReadStringRef(JANBTStreamParser *self, JANBTStringRef *outRef, ScratchBuffer *scratch)
+{
+	uint16_t length;
+	REQUIRE(ReadShort(self, (int16_t *)&length));
+	
+	const uint8_t *bytes;
+	REQUIRE(bytes = ReadBorrowedBytes(self, length, scratch));
+	*outRef = (JANBTStringRef){ (const char *)bytes, length };
+	return YES;
+}
+
+
+enum
+{
+	kPackedReadChunkSize		= 1 << 20
+};
+
+
+/*
+	Read count big-endian integers of elementSize bytes into a new malloced
+	buffer, in host byte order.
+	
+	The count comes straight from the data, so nothing is allocated for it
+	until the bytes are known to exist. When parsing from memory, the buffer
+	is checked first and the values are swapped straight out of it. When
+	streaming, the values are read in chunks of at most kPackedReadChunkSize
+	bytes, growing the result as they arrive, so a corrupt count fails with
+	a read error at the end of the stream rather than a huge allocation.
+*/
+static void *ReadPackedValues(JANBTStreamParser *self, uint32_t count, size_t elementSize)
+{
+	size_t length = (size_t)count * elementSize;
+	uint8_t *values = NULL;
+	
+	if (self->_buffer != nil)
+	{
+		const uint8_t *raw = ReadBufferedBytes(self, length);
+		if (raw == NULL)  return NULL;
+		
+		values = malloc(MAX(length, (size_t)1));
+		REQUIRE_ERR(values, kJANBTSerializationMemoryError, @"Not enough memory for array of %u elements.", count);
+		
+		if (elementSize == sizeof (int32_t))  JANBTByteSwapInt32Array(values, raw, count);
+		else  JANBTByteSwapInt64Array(values, raw, count);
+		return values;
+	}
+	
+	size_t filled = 0;
+	do
+	{
+		size_t chunk = MIN(length - filled, (size_t)kPackedReadChunkSize);
+		uint8_t *grown = realloc(values, MAX(filled + chunk, (size_t)1));
+		if (grown == NULL)  free(values);
+		REQUIRE_ERR(grown, kJANBTSerializationMemoryError, @"Not enough memory for array of %u elements.", count);
+		values = grown;
+		
+		if (![self readBytes:values + filled length:chunk])
+		{
+			free(values);
+			return NULL;
+		}
+		filled += chunk;
+	}
+	while (filled < length);
+	
+	if (elementSize == sizeof (int32_t))  JANBTByteSwapInt32Array(values, values, count);
+	else  JANBTByteSwapInt64Array(values, values, count);
+	return values;
+}
+
+
+static BOOL SkipBytes(JANBTStreamParser *self, size_t length)
+{
+	if (self->_buffer != nil)  return ReadBufferedBytes(self, length) != NULL;
+	
+	uint8_t discard[4096];
+	while (length > 0)
+	{
+		size_t chunk = MIN(length, sizeof discard);
+		REQUIRE([self readBytes:discard length:chunk]);
+		length -= chunk;
+	}
+	return YES;
+}
+
+
 - (void) setErrorIfClear:(NSInteger)errorCode underlyingError:(NSError *)underlyingError format:(NSString *)format, ...
 {
 	if (_error != nil)  return;
@@ -124,30 +440,36 @@ static inline BOOL IsNumericalSchema(id schema);
 }
 
 
-@synthesize root = _result, rootName = _rootName;
+@synthesize root = _result, rootName = _rootName, statisticsCounters = _counters;
 
 
-- (BOOL) parseWithSchema:(id)schema expectedRootName:(NSString *)expectedName error:(NSError **)outError
+- (BOOL) parseWithSchema:(JANBTCompiledSchema *)schema expectedRootName:(NSString *)expectedName error:(NSError **)outError
 {
 	NSError *error;
 	BOOL OK;
+	uint64_t start = (_counters != NULL) ? mach_absolute_time() : 0;
 	
 	@autoreleasepool
 	{
-		OK = [self parseWithSchemaInner:schema expectedRootName:expectedName];
+		if (_lazyContainers)  _lazyDocument = [[JANBTLazyDocument alloc] initWithBuffer:_buffer options:_options keyTable:_keyTable schema:schema];
+		
+		OK = [self parseWithSchemaInner:schema.rootNode expectedRootName:expectedName];
 		if (!OK)  error = _error;
 		_decompressor = nil;
+		_buffer = nil;
+		_lazyDocument = nil;
 	}
 	
+	if (_counters != NULL)  _counters->processingTime += mach_absolute_time() - start;
 	if (!OK && outError != NULL)  *outError = error;
 	return OK;
 }
 
 
-- (BOOL) parseWithSchemaInner:(id)schema expectedRootName:(NSString *)expectedName
+- (BOOL) parseWithSchemaInner:(const JANBTSchemaNode *)schema expectedRootName:(NSString *)expectedName
 {
 	int8_t rootType;
-	REQUIRE([self readByte:&rootType]);
+	REQUIRE(ReadByte(self, &rootType));
 	
 	REQUIRE_ERR(rootType == kJANBTTagCompound || _allowFragments, kJANBTSerializationWrongTypeError, @"NBT root is not a compound, and fragments are not permitted.");
 	
@@ -159,6 +481,7 @@ static inline BOOL IsNumericalSchema(id schema);
 		PARSE_LOG(@"Root %@ [%@] =", _rootName, JANBTTagNameFromTagType(rootType));
 		PARSE_LOG_INDENT();
 		
+		_currentProjection = _projection;
 		REQUIRE(_result = [self parseOneTagBodyOfType:rootType withSchema:schema]);
 		
 		PARSE_LOG_OUTDENT();
@@ -169,8 +492,14 @@ static inline BOOL IsNumericalSchema(id schema);
 }
 
 
-- (id) parseOneTagBodyOfType:(JANBTTagType)type withSchema:(id)schema
+- (id) parseOneTagBodyOfType:(JANBTTagType)type withSchema:(const JANBTSchemaNode *)schema
 {
+	if (_counters != NULL)
+	{
+		JANBTStatisticsCountTag(_counters, type);
+		_counters->objectCount++;
+	}
+	
 	switch (type)
 	{
 		case kJANBTTagByte:
@@ -198,15 +527,29 @@ static inline BOOL IsNumericalSchema(id schema);
 			return [self parseStringWithSchema:schema];
 			
 		case kJANBTTagList:
-			return [self parseListWithSchema:schema];
+		{
+			JANBTStatisticsEnterContainer(_counters);
+			id result = [self parseListWithSchema:schema];
+			JANBTStatisticsExitContainer(_counters);
+			return result;
+		}
 			
 		case kJANBTTagCompound:
-			return [self parseCompoundWithSchema:schema];
+		{
+			JANBTStatisticsEnterContainer(_counters);
+			id result = [self parseCompoundWithSchema:schema];
+			JANBTStatisticsExitContainer(_counters);
+			return result;
+		}
 			
 		case kJANBTTagIntArray:
 			return [self parseIntArrayWithSchema:schema];
 			
+		case kJANBTTagLongArray:
+			return [self parseLongArrayWithSchema:schema];
+			
 		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
 		case kJANBTTagEnd:
 		case kJANBTTagAny:
 		case kJANBTTagUnknown:
@@ -218,8 +561,8 @@ static inline BOOL IsNumericalSchema(id schema);
 }
 
 
-#define REQUIRE_SCHEMA(COND, GOT, SCH)  REQUIRE_ERR(COND, kJANBTSerializationWrongTypeError, @"Wrong type in NBT - expected %@, got %@ - at %@.", JANBTTagNameFromSchema(SCH), GOT, self.currentKeyPath)
-#define REQUIRE_NUMERICAL_SCHEMA(SCH)  REQUIRE_SCHEMA(JANBTIsNumericalSchema(SCH), @"numerical type", SCH)
+#define REQUIRE_SCHEMA(COND, GOT, SCH)  REQUIRE_ERR(COND, kJANBTSerializationWrongTypeError, @"Wrong type in NBT - expected %@, got %@ - at %@.", JANBTTagNameFromTagType(JANBTSchemaNodeType(SCH)), GOT, self.currentKeyPath)
+#define REQUIRE_NUMERICAL_SCHEMA(SCH)  REQUIRE_SCHEMA(JANBTIsNumericalSchemaNode(SCH), @"numerical type", SCH)
 
 #define PUSH_PATH(FORMAT, ELEM)	do { [_keyPath addObject:FORMAT]; [_keyPath addObject:ELEM]; } while (0)
 #define POP_PATH()				do { [_keyPath removeLastObject]; [_keyPath removeLastObject]; } while (0)
@@ -240,85 +583,95 @@ static inline BOOL IsNumericalSchema(id schema);
 }
 
 
-- (NSNumber *) parseByteWithSchema:(id)schema
+- (NSNumber *) parseByteWithSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
 	
 	int8_t value;
-	REQUIRE([self readByte:&value]);
+	REQUIRE(ReadByte(self, &value));
 	PARSE_LOG(@"BYTE: %i", value);
-	if (schema != nil)  return [NSNumber numberWithChar:value];
-	else  return [[JANBTInteger alloc] initWithValue:value type:kJANBTTagByte];
+	if (schema != NULL)  return [NSNumber numberWithChar:value];
+	else  return JANBTMakeInteger(value, kJANBTTagByte);
 }
 
 
-- (NSNumber *) parseShortWithSchema:(id)schema
+- (NSNumber *) parseShortWithSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
 	
 	int16_t value;
-	REQUIRE([self readShort:&value]);
+	REQUIRE(ReadShort(self, &value));
 	PARSE_LOG(@"SHORT: %i", value);
-	if (schema != nil)  return [NSNumber numberWithShort:value];
-	else  return [[JANBTInteger alloc] initWithValue:value type:kJANBTTagShort];
+	if (schema != NULL)  return [NSNumber numberWithShort:value];
+	else  return JANBTMakeInteger(value, kJANBTTagShort);
 }
 
 
-- (NSNumber *) parseIntWithSchema:(id)schema
+- (NSNumber *) parseIntWithSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
 	
 	int32_t value;
-	REQUIRE([self readInt:&value]);
+	REQUIRE(ReadInt(self, &value));
 	PARSE_LOG(@"INT: %i", value);
-	if (schema != nil)  return [NSNumber numberWithInt:value];
-	else  return [[JANBTInteger alloc] initWithValue:value type:kJANBTTagInt];
+	if (schema != NULL)  return [NSNumber numberWithInt:value];
+	else  return JANBTMakeInteger(value, kJANBTTagInt);
 }
 
 
-- (NSNumber *) parseLongWithSchema:(id)schema
+- (NSNumber *) parseLongWithSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
 	
 	int64_t value;
-	REQUIRE([self readLong:&value]);
+	REQUIRE(ReadLong(self, &value));
 	PARSE_LOG(@"BYTE: %lli", value);
-	if (schema != nil)  return [NSNumber numberWithLong:value];
-	else  return [[JANBTInteger alloc] initWithValue:value type:kJANBTTagLong];
+	if (schema != NULL)  return [NSNumber numberWithLong:value];
+	else  return JANBTMakeInteger(value, kJANBTTagLong);
 }
 
 
-- (NSNumber *) parseFloatWithSchema:(id)schema
+- (NSNumber *) parseFloatWithSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
 	
 	float value;
-	REQUIRE([self readFloat:&value]);
+	REQUIRE(ReadFloat(self, &value));
 	PARSE_LOG(@"FLOAT: %g", value);
-	if (schema != nil)  return [NSNumber numberWithFloat:value];
-	else  return [[JANBTFloat alloc] initWithValue:value];
+	if (schema != NULL)  return [NSNumber numberWithFloat:value];
+	else  return JANBTMakeFloat(value);
 }
 
 
-- (NSNumber *) parseDoubleWithSchema:(id)schema
+- (NSNumber *) parseDoubleWithSchema:(const JANBTSchemaNode *)schema
 {
 	REQUIRE_NUMERICAL_SCHEMA(schema);
 	
 	double value;
-	REQUIRE([self readDouble:&value]);
+	REQUIRE(ReadDouble(self, &value));
 	PARSE_LOG(@"DOUBLE: %g", value);
-	if (schema != nil)  return [NSNumber numberWithDouble:value];
-	else  return [[JANBTDouble alloc] initWithValue:value];
+	if (schema != NULL)  return [NSNumber numberWithDouble:value];
+	else  return JANBTMakeDouble(value);
 }
 
 
-- (NSData *) parseByteArrayWithSchema:(id)schema
+- (NSData *) parseByteArrayWithSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isEqual:@"data"], @"TAG_Byte_Array", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagByteArray, @"TAG_Byte_Array", schema);
 	
 	uint32_t length;
-	REQUIRE([self readInt:(int32_t *)&length]);
+	REQUIRE(ReadInt(self, (int32_t *)&length));
 	PARSE_LOG(@"BYTE ARRAY: %u bytes", length);
+	
+	if (_buffer != nil)
+	{
+		const uint8_t *bytes;
+		REQUIRE(bytes = ReadBufferedBytes(self, length));
+		
+		if (_mutableLeaves)  return [[NSMutableData alloc] initWithBytes:bytes length:length];
+		return [[JANBTDataSlice alloc] initWithBackingData:_buffer bytes:bytes length:length];
+	}
+	
 	void *bytes = malloc(length);
 	REQUIRE_ERR(bytes, kJANBTSerializationMemoryError, @"Not enough memory for byte array of length %u.", length);
 	
@@ -335,35 +688,38 @@ static inline BOOL IsNumericalSchema(id schema);
 }
 
 
-- (NSString *) parseStringWithSchema:(id)schema
+- (NSString *) parseStringWithSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isEqual:@"string"], @"TAG_String", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagString, @"TAG_String", schema);
 	id result = [self readStringMutable:_mutableLeaves];
 	PARSE_LOG(@"STRING: %@", result);
 	return result;
 }
 
 
-- (NSArray *) parseListWithSchema:(id)schema
+- (NSArray *) parseListWithSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || ([schema isKindOfClass:[NSArray class]] && [schema count] == 1), @"TAG_List", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagList, @"TAG_List", schema);
 	
 	int8_t type;
 	uint32_t i, count;
-	REQUIRE([self readByte:&type]);
-	REQUIRE([self readInt:(int32_t *)&count]);
+	REQUIRE(ReadByte(self, &type));
+	REQUIRE(ReadInt(self, (int32_t *)&count));
 	
 	PARSE_LOG(@"ARRAY: %u x %@", count, JANBTTagNameFromTagType(type));
+	
+	const JANBTSchemaNode *elementSchema = schema ? schema->element : NULL;
+	if (_lazyDocument != nil && _currentProjection == nil)  return [self parseLazyListOfType:type count:count withSchema:elementSchema];
+	
 	PARSE_LOG_INDENT();
 	
 	NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
-	schema = [schema objectAtIndex:0];
 	
 	for (i = 0; i < count; i++)
 	{
 		PUSH_PATH(@"[%@]", @(i));
 		
-		id value = [self parseOneTagBodyOfType:type withSchema:schema];
+		id value = [self parseOneTagBodyOfType:type withSchema:elementSchema];
 		REQUIRE(value);
 		[array addObject:value];
 		
@@ -373,14 +729,17 @@ static inline BOOL IsNumericalSchema(id schema);
 	PARSE_LOG_OUTDENT();
 	
 	if (!_mutableContainers)  array = [array copy];
-	if (schema == nil)  array.NBTListElementType = type;
+	if (elementSchema == NULL)  array.NBTListElementType = type;
 	return array;
 }
 
 
-- (NSDictionary *) parseCompoundWithSchema:(id)schema
+- (NSDictionary *) parseCompoundWithSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isKindOfClass:[NSDictionary class]], @"TAG_Compound", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagCompound, @"TAG_Compound", schema);
+	
+	JANBTProjection *projection = _currentProjection;
+	if (_lazyDocument != nil && projection == nil)  return [self parseLazyCompoundWithSchema:schema];
 	
 	NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
 	
@@ -390,21 +749,38 @@ static inline BOOL IsNumericalSchema(id schema);
 	for (;;)
 	{
 		int8_t type;
-		REQUIRE([self readByte:&type]);
+		REQUIRE(ReadByte(self, &type));
 		if (type == kJANBTTagEnd)  break;
 		
 		@autoreleasepool
 		{
-			NSString *key = [self readStringMutable:NO];
+			JANBTStringRef keyRef;
+			REQUIRE(ReadStringRef(self, &keyRef, &_nameScratch));
+			
+			if (projection != nil)
+			{
+				// Look the key up before creating a string for it, so skipped members cost nothing.
+				JANBTProjection *child = [projection childNamed:keyRef];
+				if (child == nil)
+				{
+					REQUIRE([self skipTagBodyOfType:type]);
+					continue;
+				}
+				_currentProjection = child.leaf ? nil : child;
+			}
+			
+			const JANBTSchemaNode *memberSchema = JANBTSchemaNodeMemberNamed(schema, keyRef.bytes, keyRef.length);
+			NSString *key = [_keyTable stringWithUTF8Bytes:keyRef.bytes length:keyRef.length];
+			REQUIRE_ERR(key != nil, kJANBTSerializationReadError, @"Invalid UTF-8 string.");
 			PUSH_PATH(@".%@", key);
 			
 			PARSE_LOG(@"%@ [%@] =", key, JANBTTagNameFromTagType(type));
-			REQUIRE(key);
-			id value = [self parseOneTagBodyOfType:type withSchema:[schema objectForKey:key]];
+			id value = [self parseOneTagBodyOfType:type withSchema:memberSchema];
 			REQUIRE(value);
 			[dictionary setObject:value forKey:key];
 			
 			POP_PATH();
+			_currentProjection = projection;
 		}
 	}
 	
@@ -415,107 +791,529 @@ static inline BOOL IsNumericalSchema(id schema);
 }
 
 
-- (NSArray *) parseIntArrayWithSchema:(id)schema
+- (NSArray *) parseIntArrayWithSchema:(const JANBTSchemaNode *)schema
 {
-	REQUIRE_SCHEMA(schema == nil || [schema isEqual:@"intarray"], @"TAG_Int_Array", schema);
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagIntArray, @"TAG_Int_Array", schema);
 	
-	uint32_t i, count;
-	REQUIRE([self readInt:(int32_t *)&count]);
+	uint32_t count;
+	REQUIRE(ReadInt(self, (int32_t *)&count));
 	
 	PARSE_LOG(@"INTARRAY: %u x int", count);
-	PARSE_LOG_INDENT();
 	
-	NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
+	int32_t *values;
+	REQUIRE(values = ReadPackedValues(self, count, sizeof *values));
+	NSArray *array = [[JANBTIntArray alloc] initWithValuesNoCopy:values count:count freeWhenDone:YES];
+	REQUIRE_ERR(array, kJANBTSerializationMemoryError, @"Not enough memory for int array of %u elements.", count);
 	
-	for (i = 0; i < count; i++)
+	if (_mutableContainers)
 	{
-		int32_t value;
-		REQUIRE([self readInt:&value]);
-		[array addObject:@(value)];
+		array = [array mutableCopy];
+		array.NBTListElementType = kJANBTTagIntArrayContent;
 	}
+	return array;
+}
+
+
+- (NSArray *) parseLongArrayWithSchema:(const JANBTSchemaNode *)schema
+{
+	REQUIRE_SCHEMA(schema == NULL || schema->type == kJANBTTagLongArray, @"TAG_Long_Array", schema);
 	
-	PARSE_LOG_OUTDENT();
+	uint32_t count;
+	REQUIRE(ReadInt(self, (int32_t *)&count));
 	
-	if (!_mutableContainers)  array = [array copy];
-	array.NBTListElementType = kJANBTTagIntArrayContent;
+	PARSE_LOG(@"LONGARRAY: %u x long", count);
+	
+	int64_t *values;
+	REQUIRE(values = ReadPackedValues(self, count, sizeof *values));
+	NSArray *array = [[JANBTLongArray alloc] initWithValuesNoCopy:values count:count freeWhenDone:YES];
+	REQUIRE_ERR(array, kJANBTSerializationMemoryError, @"Not enough memory for long array of %u elements.", count);
+	
+	if (_mutableContainers)
+	{
+		array = [array mutableCopy];
+		array.NBTListElementType = kJANBTTagLongArrayContent;
+	}
 	return array;
 }
 
 
-- (BOOL) readByte:(int8_t *)value
+/*
+	Lazy containers.
+	
+	Instead of parsing its members, a lazy compound or list notes where each
+	one starts and skips over it. Skipping still checks every length against
+	the buffer, so a truncated or corrupt structure is reported here rather
+	than on access, and so does the UTF-8 of every string and name skipped,
+	since NSDictionary and NSArray accessors can only report a bad string by
+	raising. Member types are checked against the schema up front for the
+	same reason; anything deeper is checked when the member is parsed.
+*/
+
+- (NSDictionary *) parseLazyCompoundWithSchema:(const JANBTSchemaNode *)schema
 {
-	NSParameterAssert(value != NULL);
-	return [self readBytes:value length:sizeof *value];
+	NSMutableData *entries = [NSMutableData data];
+	NSMutableDictionary *indices = [NSMutableDictionary dictionary];
+	
+	PARSE_LOG(@"LAZY COMPOUND");
+	
+	for (;;)
+	{
+		int8_t type;
+		REQUIRE(ReadByte(self, &type));
+		if (type == kJANBTTagEnd)  break;
+		
+		JANBTStringRef keyRef;
+		REQUIRE(ReadStringRef(self, &keyRef, &_nameScratch));
+		NSString *key = [_keyTable stringWithUTF8Bytes:keyRef.bytes length:keyRef.length];
+		REQUIRE_ERR(key != nil, kJANBTSerializationReadError, @"Invalid UTF-8 string.");
+		
+		const JANBTSchemaNode *memberSchema = JANBTSchemaNodeMemberNamed(schema, keyRef.bytes, keyRef.length);
+		if (!JANBTSchemaNodeAcceptsTagType(memberSchema, type))
+		{
+			PUSH_PATH(@".%@", key);
+			REQUIRE_SCHEMA(NO, JANBTTagNameFromTagType(type), memberSchema);
+		}
+		
+		// As with NSMutableDictionary, a repeated key replaces the earlier member.
+		JANBTLazyEntry entry = { _cursor.next, memberSchema, type };
+		indices[key] = @(entries.length / sizeof entry);
+		[entries appendBytes:&entry length:sizeof entry];
+		
+		REQUIRE([self skipTagBodyOfType:type]);
+	}
+	
+	NSDictionary *result = [[JANBTLazyCompound alloc] initWithDocument:_lazyDocument entries:entries indices:indices];
+	REQUIRE_ERR(result, kJANBTSerializationMemoryError, @"Not enough memory for compound of %lu members.", (unsigned long)indices.count);
+	return result;
 }
 
 
-- (BOOL) readShort:(int16_t *)value
+- (NSArray *) parseLazyListOfType:(JANBTTagType)type count:(uint32_t)count withSchema:(const JANBTSchemaNode *)elementSchema
 {
-	NSParameterAssert(value != NULL);
-	uint16_t raw;
-	REQUIRE([self readBytes:&raw length:sizeof raw]);
-	*value = CFSwapInt16BigToHost(raw);
-	return YES;
+	const uint8_t *first = _cursor.next;
+	size_t stride = 0;
+	NSMutableData *starts;
+	
+	if (count != 0)
+	{
+		REQUIRE_SCHEMA(JANBTSchemaNodeAcceptsTagType(elementSchema, type), JANBTTagNameFromTagType(type), elementSchema);
+		
+		stride = JANBTFixedTagSize(type);
+		if (stride != 0)
+		{
+			REQUIRE(SkipBytes(self, (size_t)count * stride));
+		}
+		else
+		{
+			// Every variable-sized tag body is at least one byte, so this catches absurd counts before allocating.
+			REQUIRE_ERR(count <= JANBTCursorRemaining(&_cursor), kJANBTSerializationReadError, @"Premature end of file.");
+			
+			starts = [NSMutableData dataWithLength:(NSUInteger)count * sizeof (const uint8_t *)];
+			REQUIRE_ERR(starts, kJANBTSerializationMemoryError, @"Not enough memory for list of %u elements.", count);
+			const uint8_t **elementStarts = starts.mutableBytes;
+			
+			for (uint32_t i = 0; i < count; i++)
+			{
+				elementStarts[i] = _cursor.next;
+				REQUIRE([self skipTagBodyOfType:type]);
+			}
+		}
+	}
+	
+	NSArray *result = [[JANBTLazyList alloc] initWithDocument:_lazyDocument
+												  elementType:type
+													   schema:elementSchema
+														count:count
+														first:first
+													   stride:stride
+													   starts:starts];
+	REQUIRE_ERR(result, kJANBTSerializationMemoryError, @"Not enough memory for list of %u elements.", count);
+	return result;
 }
 
 
-- (BOOL) readInt:(int32_t *)value
+/*
+	Event-driven scanning.
+	
+	This mirrors the parse methods above, but reports each tag to _delegate
+	instead of building objects. Names, strings and arrays are handed out as
+	pointers into the parse buffer, or into the scratch buffers when reading
+	from a stream. Names use _nameScratch and values use _valueScratch, since
+	a scalar’s name must survive reading its value.
+	
+	Tags the delegate isn’t interested in are skipped without being copied.
+*/
+- (BOOL) scanWithDelegate:(id<JANBTReaderDelegate>)delegate expectedRootName:(NSString *)expectedName error:(NSError **)outError
 {
-	NSParameterAssert(value != NULL);
-	uint32_t raw;
-	REQUIRE([self readBytes:&raw length:sizeof raw]);
-	*value = CFSwapInt32BigToHost(raw);
+	NSParameterAssert(delegate != nil);
+	
+	_delegate = delegate;
+	_delegateResponds.beginCompound = [delegate respondsToSelector:@selector(beginCompoundNamed:)];
+	_delegateResponds.endCompound = [delegate respondsToSelector:@selector(endCompound)];
+	_delegateResponds.beginList = [delegate respondsToSelector:@selector(beginListNamed:count:)];
+	_delegateResponds.endList = [delegate respondsToSelector:@selector(endList)];
+	_delegateResponds.foundByte = [delegate respondsToSelector:@selector(foundByte:named:)];
+	_delegateResponds.foundShort = [delegate respondsToSelector:@selector(foundShort:named:)];
+	_delegateResponds.foundInt = [delegate respondsToSelector:@selector(foundInt:named:)];
+	_delegateResponds.foundLong = [delegate respondsToSelector:@selector(foundLong:named:)];
+	_delegateResponds.foundFloat = [delegate respondsToSelector:@selector(foundFloat:named:)];
+	_delegateResponds.foundDouble = [delegate respondsToSelector:@selector(foundDouble:named:)];
+	_delegateResponds.foundString = [delegate respondsToSelector:@selector(foundString:named:)];
+	_delegateResponds.foundByteArray = [delegate respondsToSelector:@selector(foundByteArray:length:named:)];
+	_delegateResponds.foundIntArray = [delegate respondsToSelector:@selector(foundIntArray:count:named:)];
+	_delegateResponds.foundLongArray = [delegate respondsToSelector:@selector(foundLongArray:count:named:)];
+	
+	NSError *error;
+	BOOL OK;
+	uint64_t start = (_counters != NULL) ? mach_absolute_time() : 0;
+	
+	@autoreleasepool
+	{
+		OK = [self scanWithExpectedRootNameInner:expectedName];
+		if (!OK)  error = _error;
+		_decompressor = nil;
+		_buffer = nil;
+		_delegate = nil;
+	}
+	
+	if (_counters != NULL)  _counters->processingTime += mach_absolute_time() - start;
+	if (!OK && outError != NULL)  *outError = error;
+	return OK;
+}
+
+
+- (BOOL) scanWithExpectedRootNameInner:(NSString *)expectedName
+{
+	int8_t rootType;
+	REQUIRE(ReadByte(self, &rootType));
+	
+	REQUIRE_ERR(rootType == kJANBTTagCompound || _allowFragments, kJANBTSerializationWrongTypeError, @"NBT root is not a compound, and fragments are not permitted.");
+	
+	if (rootType != kJANBTTagEnd)
+	{
+		JANBTStringRef name;
+		REQUIRE(ReadStringRef(self, &name, &_nameScratch));
+		_rootName = JANBTStringFromStringRef(name);
+		REQUIRE_ERR(_rootName != nil, kJANBTSerializationReadError, @"Invalid UTF-8 string.");
+		REQUIRE_ERR(expectedName == nil || [_rootName isEqualToString:expectedName], kJANBTSerializationWrongRootNameError, @"Expected NBT root name to be %@, but found %@.", expectedName, _rootName);
+		
+		REQUIRE([self scanOneTagBodyOfType:rootType named:name]);
+	}
+	
 	return YES;
 }
 
 
-- (BOOL) readLong:(int64_t *)value
+- (BOOL) scanOneTagBodyOfType:(JANBTTagType)type named:(JANBTStringRef)name
 {
-	NSParameterAssert(value != NULL);
-	uint64_t raw;
-	REQUIRE([self readBytes:&raw length:sizeof raw]);
-	*value = CFSwapInt64BigToHost(raw);
+	JANBTStatisticsCountTag(_counters, type);
+	
+	switch (type)
+	{
+		case kJANBTTagByte:
+		{
+			int8_t value;
+			REQUIRE(ReadByte(self, &value));
+			if (_delegateResponds.foundByte)  [_delegate foundByte:value named:name];
+			return YES;
+		}
+			
+		case kJANBTTagShort:
+		{
+			int16_t value;
+			REQUIRE(ReadShort(self, &value));
+			if (_delegateResponds.foundShort)  [_delegate foundShort:value named:name];
+			return YES;
+		}
+			
+		case kJANBTTagInt:
+		{
+			int32_t value;
+			REQUIRE(ReadInt(self, &value));
+			if (_delegateResponds.foundInt)  [_delegate foundInt:value named:name];
+			return YES;
+		}
+			
+		case kJANBTTagLong:
+		{
+			int64_t value;
+			REQUIRE(ReadLong(self, &value));
+			if (_delegateResponds.foundLong)  [_delegate foundLong:value named:name];
+			return YES;
+		}
+			
+		case kJANBTTagFloat:
+		{
+			Float32 value;
+			REQUIRE(ReadFloat(self, &value));
+			if (_delegateResponds.foundFloat)  [_delegate foundFloat:value named:name];
+			return YES;
+		}
+			
+		case kJANBTTagDouble:
+		{
+			Float64 value;
+			REQUIRE(ReadDouble(self, &value));
+			if (_delegateResponds.foundDouble)  [_delegate foundDouble:value named:name];
+			return YES;
+		}
+			
+		case kJANBTTagByteArray:
+			return [self scanByteArrayNamed:name];
+			
+		case kJANBTTagString:
+			return [self scanStringNamed:name];
+			
+		case kJANBTTagList:
+		{
+			JANBTStatisticsEnterContainer(_counters);
+			BOOL OK = [self scanListNamed:name];
+			JANBTStatisticsExitContainer(_counters);
+			return OK;
+		}
+			
+		case kJANBTTagCompound:
+		{
+			JANBTStatisticsEnterContainer(_counters);
+			BOOL OK = [self scanCompoundNamed:name];
+			JANBTStatisticsExitContainer(_counters);
+			return OK;
+		}
+			
+		case kJANBTTagIntArray:
+			return [self scanIntArrayNamed:name];
+			
+		case kJANBTTagLongArray:
+			return [self scanLongArrayNamed:name];
+			
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+	
+	[self setErrorIfClear:kJANBTSerializationUnknownTagError underlyingError:nil format:@"Unknown NBT tag %u.", type];
+	return NO;
+}
+
+
+- (BOOL) scanByteArrayNamed:(JANBTStringRef)name
+{
+	uint32_t length;
+	REQUIRE(ReadInt(self, (int32_t *)&length));
+	
+	if (!_delegateResponds.foundByteArray)  return SkipBytes(self, length);
+	
+	const uint8_t *bytes;
+	REQUIRE(bytes = ReadBorrowedBytes(self, length, &_valueScratch));
+	[_delegate foundByteArray:bytes length:length named:name];
 	return YES;
 }
 
 
-- (BOOL) readFloat:(Float32 *)value
+- (BOOL) scanStringNamed:(JANBTStringRef)name
 {
-	NSParameterAssert(value != NULL);
-	union { int32_t i; Float32 f; } convert;
-	REQUIRE([self readInt:&convert.i]);
-	*value = convert.f;
+	if (!_delegateResponds.foundString)
+	{
+		uint16_t length;
+		REQUIRE(ReadShort(self, (int16_t *)&length));
+		return SkipBytes(self, length);
+	}
+	
+	JANBTStringRef value;
+	REQUIRE(ReadStringRef(self, &value, &_valueScratch));
+	[_delegate foundString:value named:name];
 	return YES;
 }
 
 
-- (BOOL) readDouble:(Float64 *)value
+- (BOOL) scanListNamed:(JANBTStringRef)name
 {
-	NSParameterAssert(value != NULL);
-	union { int64_t i; Float64 f; } convert;
-	REQUIRE([self readLong:&convert.i]);
-	*value = convert.f;
+	int8_t type;
+	uint32_t i, count;
+	REQUIRE(ReadByte(self, &type));
+	REQUIRE(ReadInt(self, (int32_t *)&count));
+	
+	if (_delegateResponds.beginList)  [_delegate beginListNamed:name count:count];
+	
+	JANBTStringRef noName = { NULL, 0 };
+	for (i = 0; i < count; i++)
+	{
+		REQUIRE([self scanOneTagBodyOfType:type named:noName]);
+	}
+	
+	if (_delegateResponds.endList)  [_delegate endList];
 	return YES;
 }
 
 
-- (NSString *) readStringMutable:(BOOL)mutable
+- (BOOL) scanCompoundNamed:(JANBTStringRef)name
 {
-	uint16_t length;
-	REQUIRE([self readShort:(int16_t *)&length]);
-	char *bytes = malloc(length);
-	REQUIRE_ERR(bytes, kJANBTSerializationMemoryError, @"Not enough memory for string of length %u.", length);
+	if (_delegateResponds.beginCompound)  [_delegate beginCompoundNamed:name];
 	
-	if ([self readBytes:bytes length:length])
+	for (;;)
 	{
-		Class stringClass = mutable ? [NSMutableString class] : [NSString class];
-		return [[stringClass alloc] initWithBytesNoCopy:bytes length:length encoding:NSUTF8StringEncoding freeWhenDone:YES];
+		int8_t type;
+		REQUIRE(ReadByte(self, &type));
+		if (type == kJANBTTagEnd)  break;
+		
+		JANBTStringRef key;
+		REQUIRE(ReadStringRef(self, &key, &_nameScratch));
+		REQUIRE([self scanOneTagBodyOfType:type named:key]);
 	}
-	else
+	
+	if (_delegateResponds.endCompound)  [_delegate endCompound];
+	return YES;
+}
+
+
+- (BOOL) scanIntArrayNamed:(JANBTStringRef)name
+{
+	uint32_t count;
+	REQUIRE(ReadInt(self, (int32_t *)&count));
+	size_t length = (size_t)count * sizeof (int32_t);
+	
+	if (!_delegateResponds.foundIntArray)  return SkipBytes(self, length);
+	
+	// In buffer mode the raw values are in the (immutable) parse buffer, so they’re swapped into scratch space.
+	const uint8_t *raw;
+	REQUIRE(raw = ReadBorrowedBytes(self, length, &_valueScratch));
+	int32_t *values;
+	REQUIRE(values = ScratchBytes(self, &_valueScratch, length));
+	JANBTByteSwapInt32Array(values, raw, count);
+	
+	[_delegate foundIntArray:values count:count named:name];
+	return YES;
+}
+
+
+- (BOOL) scanLongArrayNamed:(JANBTStringRef)name
+{
+	uint32_t count;
+	REQUIRE(ReadInt(self, (int32_t *)&count));
+	size_t length = (size_t)count * sizeof (int64_t);
+	
+	if (!_delegateResponds.foundLongArray)  return SkipBytes(self, length);
+	
+	const uint8_t *raw;
+	REQUIRE(raw = ReadBorrowedBytes(self, length, &_valueScratch));
+	int64_t *values;
+	REQUIRE(values = ScratchBytes(self, &_valueScratch, length));
+	JANBTByteSwapInt64Array(values, raw, count);
+	
+	[_delegate foundLongArray:values count:count named:name];
+	return YES;
+}
+
+
+/*
+	Skip over a tag using the length prefixes of its contents, without
+	creating any objects. When producing lazy containers, skipped strings
+	are validated, since they will be decoded later.
+*/
+- (BOOL) skipTagBodyOfType:(JANBTTagType)type
+{
+	switch (type)
 	{
-		free(bytes);
-		return nil;
+		case kJANBTTagByte:
+		case kJANBTTagShort:
+		case kJANBTTagInt:
+		case kJANBTTagLong:
+		case kJANBTTagFloat:
+		case kJANBTTagDouble:
+			return SkipBytes(self, JANBTFixedTagSize(type));
+			
+		case kJANBTTagByteArray:
+		{
+			uint32_t length;
+			REQUIRE(ReadInt(self, (int32_t *)&length));
+			return SkipBytes(self, length);
+		}
+			
+		case kJANBTTagString:
+			return [self skipString];
+			
+		case kJANBTTagList:
+		{
+			int8_t elementType;
+			uint32_t i, count;
+			REQUIRE(ReadByte(self, &elementType));
+			REQUIRE(ReadInt(self, (int32_t *)&count));
+			
+			size_t elementSize = JANBTFixedTagSize(elementType);
+			if (elementSize != 0)  return SkipBytes(self, (size_t)count * elementSize);
+			
+			for (i = 0; i < count; i++)
+			{
+				REQUIRE([self skipTagBodyOfType:elementType]);
+			}
+			return YES;
+		}
+			
+		case kJANBTTagCompound:
+			for (;;)
+			{
+				int8_t memberType;
+				REQUIRE(ReadByte(self, &memberType));
+				if (memberType == kJANBTTagEnd)  return YES;
+				
+				REQUIRE([self skipString]);
+				REQUIRE([self skipTagBodyOfType:memberType]);
+			}
+			
+		case kJANBTTagIntArray:
+		{
+			uint32_t count;
+			REQUIRE(ReadInt(self, (int32_t *)&count));
+			return SkipBytes(self, (size_t)count * sizeof (int32_t));
+		}
+			
+		case kJANBTTagLongArray:
+		{
+			uint32_t count;
+			REQUIRE(ReadInt(self, (int32_t *)&count));
+			return SkipBytes(self, (size_t)count * sizeof (int64_t));
+		}
+			
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
 	}
+	
+	[self setErrorIfClear:kJANBTSerializationUnknownTagError underlyingError:nil format:@"Unknown NBT tag %u.", type];
+	return NO;
+}
+
+
+- (BOOL) skipString
+{
+	uint16_t length;
+	REQUIRE(ReadShort(self, (int16_t *)&length));
+	if (!_lazyContainers)  return SkipBytes(self, length);
+	
+	const uint8_t *bytes;
+	REQUIRE(bytes = ReadBufferedBytes(self, length));
+	REQUIRE_ERR(JANBTIsValidUTF8(bytes, length), kJANBTSerializationReadError, @"Invalid UTF-8 string.");
+	return YES;
+}
+
+
+- (NSString *) readStringMutable:(BOOL)mutable
+{
+	JANBTStringRef ref;
+	REQUIRE(ReadStringRef(self, &ref, &_valueScratch));
+	
+	NSString *result;
+	if (mutable)  result = [[NSMutableString alloc] initWithBytes:ref.bytes length:ref.length encoding:NSUTF8StringEncoding];
+	else  result = JANBTMakeString(ref.bytes, ref.length);
+	
+	REQUIRE_ERR(result != nil, kJANBTSerializationReadError, @"Invalid UTF-8 string.");
+	return result;
 }
 
 
@@ -0,0 +1,426 @@
+/*
+	JANBTStreamWriter.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTStreamWriter.h"
+#import "JANBTStreamEncoder.h"
+#import "JANBTTagType.h"
+#import "JANBTSchemaNode.h"
+
+
+/*
+	The writer keeps a stack of open compounds and lists, checks each call
+	against it, and hands the bytes to a JANBTStreamEncoder in incremental
+	mode. A list’s type and count are written with its first element, since
+	the type isn’t known until then.
+*/
+typedef struct
+{
+	const JANBTSchemaNode	*schema;
+	NSUInteger				count;			// Lists: elements declared.
+	NSUInteger				written;		// Lists: elements started.
+	JANBTTagType			elementType;	// Lists: kJANBTTagUnknown until the first element.
+	BOOL					isList;
+} Frame;
+
+
+@interface JANBTStreamWriter ()
+
+- (BOOL) failWithCode:(NSInteger)errorCode format:(NSString *)format, ... NS_FORMAT_FUNCTION(2, 3);
+
+@end
+
+
+@implementation JANBTStreamWriter
+{
+	JANBTStreamEncoder		*_encoder;
+	JANBTCompiledSchema		*_schema;
+	NSOutputStream			*_memoryStream;
+	NSData					*_data;
+	NSError					*_error;
+	
+	Frame					*_frames;
+	NSUInteger				_depth;
+	NSUInteger				_frameCapacity;
+	
+	BOOL					_rootStarted;
+	BOOL					_finished;
+	NSUInteger				_byteArrayRemaining;
+}
+
+
+- (id) initWithStream:(NSOutputStream *)stream options:(JANBTWritingOptions)options schema:(id)schema error:(NSError **)outError
+{
+	NSParameterAssert(stream != nil);
+	
+	if ((self = [super init]))
+	{
+		_schema = [JANBTCompiledSchema compiledSchemaForSchema:schema error:outError];
+		if (schema != nil && _schema == nil)  return nil;
+		
+		_encoder = [[JANBTStreamEncoder alloc] initWithStream:stream options:options];
+		if (_encoder == nil)
+		{
+			if (outError != NULL)  *outError = [NSError errorWithDomain:kJANBTSerializationErrorDomain code:kJANBTSerializationMemoryError userInfo:@{ NSLocalizedDescriptionKey: @"Could not create NBT encoder." }];
+			return nil;
+		}
+	}
+	
+	return self;
+}
+
+
+- (id) initForDataWithOptions:(JANBTWritingOptions)options schema:(id)schema error:(NSError **)outError
+{
+	NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+	[stream open];
+	
+	if ((self = [self initWithStream:stream options:options schema:schema error:outError]))
+	{
+		_memoryStream = stream;
+	}
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	free(_frames);
+}
+
+
+- (NSData *) data
+{
+	return _data;
+}
+
+
+- (NSUInteger) bytesWritten
+{
+	return _encoder.bytesWritten;
+}
+
+
+- (NSError *) error
+{
+	return _error;
+}
+
+
+- (BOOL) failWithCode:(NSInteger)errorCode format:(NSString *)format, ...
+{
+	if (_error == nil)
+	{
+		format = [[NSBundle bundleForClass:[JANBTSerialization class]] localizedStringForKey:format value:format table:nil];
+		va_list args;
+		va_start(args, format);
+		NSString *message = [[NSString alloc] initWithFormat:format arguments:args];
+		va_end(args);
+		
+		_error = [NSError errorWithDomain:kJANBTSerializationErrorDomain code:errorCode userInfo:@{ NSLocalizedDescriptionKey: message }];
+	}
+	return NO;
+}
+
+
+// Pick up an error from the encoder, which has already described it.
+- (BOOL) checkEncoder:(BOOL)OK
+{
+	if (__builtin_expect(OK, 1))  return YES;
+	
+	if (_error == nil)  _error = _encoder.error;
+	if (_error == nil)  [self failWithCode:kJANBTSerializationWriteError format:@"Could not write NBT data."];
+	return NO;
+}
+
+
+/*
+	Check that a tag may be written here and write its type and name, or
+	for list elements, the list header if this is the first. Returns the
+	schema for the new tag in *outSchema.
+*/
+- (BOOL) beginTagOfType:(JANBTTagType)type named:(NSString *)name schema:(const JANBTSchemaNode **)outSchema
+{
+	if (_error != nil)  return NO;
+	if (_finished || (_depth == 0 && _rootStarted))  return [self failWithCode:kJANBTSerializationWriteError format:@"The NBT root has already been written."];
+	if (_byteArrayRemaining != 0)  return [self failWithCode:kJANBTSerializationWriteError format:@"Byte array is unfinished (%lu bytes remaining).", (unsigned long)_byteArrayRemaining];
+	
+	if (_depth == 0)
+	{
+		_rootStarted = YES;
+		*outSchema = _schema.rootNode;
+		return [self checkEncoder:[_encoder writeTagType:type name:name ?: @""]];
+	}
+	
+	Frame *frame = &_frames[_depth - 1];
+	if (!frame->isList)
+	{
+		if (name == nil)  return [self failWithCode:kJANBTSerializationWriteError format:@"Compound members must be named."];
+		*outSchema = JANBTSchemaNodeMemberForKey(frame->schema, name);
+		return [self checkEncoder:[_encoder writeTagType:type name:name]];
+	}
+	
+	if (name != nil)  return [self failWithCode:kJANBTSerializationWriteError format:@"List elements can’t be named (got “%@”).", name];
+	if (frame->written == frame->count)  return [self failWithCode:kJANBTSerializationWriteError format:@"List has more than the %lu elements it was begun with.", (unsigned long)frame->count];
+	
+	if (frame->elementType == kJANBTTagUnknown)
+	{
+		frame->elementType = type;
+		if (![self checkEncoder:[_encoder writeByte:type] && [_encoder writeInt:(int32_t)frame->count]])  return NO;
+	}
+	else if (type != frame->elementType)
+	{
+		return [self failWithCode:kJANBTSerializationWrongTypeError format:@"List elements must all be the same type; expected %@, got %@.", JANBTTagNameFromTagType(frame->elementType), JANBTTagNameFromTagType(type)];
+	}
+	
+	frame->written++;
+	*outSchema = (frame->schema != NULL) ? frame->schema->element : NULL;
+	return YES;
+}
+
+
+- (BOOL) pushFrameWithSchema:(const JANBTSchemaNode *)schema isList:(BOOL)isList count:(NSUInteger)count
+{
+	if (_depth == _frameCapacity)
+	{
+		NSUInteger capacity = MAX(_frameCapacity * 2, (NSUInteger)16);
+		Frame *frames = realloc(_frames, capacity * sizeof *frames);
+		if (frames == NULL)  return [self failWithCode:kJANBTSerializationMemoryError format:@"Not enough memory for NBT nesting depth %lu.", (unsigned long)_depth];
+		_frames = frames;
+		_frameCapacity = capacity;
+	}
+	
+	_frames[_depth++] = (Frame)
+	{
+		.schema = schema,
+		.count = count,
+		.elementType = kJANBTTagUnknown,
+		.isList = isList
+	};
+	return YES;
+}
+
+
+- (BOOL) popFrameIsList:(BOOL)isList
+{
+	if (_error != nil)  return NO;
+	if (_byteArrayRemaining != 0)  return [self failWithCode:kJANBTSerializationWriteError format:@"Byte array is unfinished (%lu bytes remaining).", (unsigned long)_byteArrayRemaining];
+	if (_depth == 0 || _frames[_depth - 1].isList != isList)
+	{
+		return [self failWithCode:kJANBTSerializationWriteError format:@"%@ called with no open %@.", isList ? @"-endList" : @"-endCompound", isList ? @"list" : @"compound"];
+	}
+	
+	_depth--;
+	return YES;
+}
+
+
+- (BOOL) beginCompoundNamed:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	if (![self beginTagOfType:kJANBTTagCompound named:name schema:&schema])  return NO;
+	return [self pushFrameWithSchema:schema isList:NO count:0];
+}
+
+
+- (BOOL) endCompound
+{
+	if (![self popFrameIsList:NO])  return NO;
+	return [self checkEncoder:[_encoder writeByte:kJANBTTagEnd]];
+}
+
+
+- (BOOL) beginListNamed:(NSString *)name count:(NSUInteger)count
+{
+	if (count > INT32_MAX)  return [self failWithCode:kJANBTSerializationObjectTooLargeError format:@"List too long (%lu items)", (unsigned long)count];
+	
+	const JANBTSchemaNode *schema;
+	if (![self beginTagOfType:kJANBTTagList named:name schema:&schema])  return NO;
+	return [self pushFrameWithSchema:schema isList:YES count:count];
+}
+
+
+- (BOOL) endList
+{
+	if (_error != nil)  return NO;
+	
+	Frame *frame = (_depth > 0) ? &_frames[_depth - 1] : NULL;
+	if (frame != NULL && frame->isList && frame->written != frame->count)
+	{
+		return [self failWithCode:kJANBTSerializationWriteError format:@"List ended after %lu of %lu elements.", (unsigned long)frame->written, (unsigned long)frame->count];
+	}
+	
+	// An empty list never got its header.
+	BOOL empty = (frame != NULL && frame->isList && frame->elementType == kJANBTTagUnknown);
+	if (![self popFrameIsList:YES])  return NO;
+	if (empty)  return [self checkEncoder:[_encoder writeByte:kJANBTTagEnd] && [_encoder writeInt:0]];
+	return YES;
+}
+
+
+- (BOOL) writeByte:(int8_t)value named:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	return [self beginTagOfType:kJANBTTagByte named:name schema:&schema] && [self checkEncoder:[_encoder writeByte:value]];
+}
+
+
+- (BOOL) writeShort:(int16_t)value named:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	return [self beginTagOfType:kJANBTTagShort named:name schema:&schema] && [self checkEncoder:[_encoder writeShort:value]];
+}
+
+
+- (BOOL) writeInt:(int32_t)value named:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	return [self beginTagOfType:kJANBTTagInt named:name schema:&schema] && [self checkEncoder:[_encoder writeInt:value]];
+}
+
+
+- (BOOL) writeLong:(int64_t)value named:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	return [self beginTagOfType:kJANBTTagLong named:name schema:&schema] && [self checkEncoder:[_encoder writeLong:value]];
+}
+
+
+- (BOOL) writeFloat:(float)value named:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	return [self beginTagOfType:kJANBTTagFloat named:name schema:&schema] && [self checkEncoder:[_encoder writeFloat:value]];
+}
+
+
+- (BOOL) writeDouble:(double)value named:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	return [self beginTagOfType:kJANBTTagDouble named:name schema:&schema] && [self checkEncoder:[_encoder writeDouble:value]];
+}
+
+
+- (BOOL) writeString:(NSString *)value named:(NSString *)name
+{
+	const JANBTSchemaNode *schema;
+	return [self beginTagOfType:kJANBTTagString named:name schema:&schema] && [self checkEncoder:[_encoder writeString:value]];
+}
+
+
+- (BOOL) writeByteArray:(const void *)bytes length:(NSUInteger)length named:(NSString *)name
+{
+	return [self beginByteArrayNamed:name length:length] && [self writeByteArrayChunk:bytes length:length];
+}
+
+
+- (BOOL) writeIntArray:(const int32_t *)values count:(NSUInteger)count named:(NSString *)name
+{
+	if (count > INT32_MAX)  return [self failWithCode:kJANBTSerializationObjectTooLargeError format:@"Int array too long (%lu items)", (unsigned long)count];
+	
+	const JANBTSchemaNode *schema;
+	if (![self beginTagOfType:kJANBTTagIntArray named:name schema:&schema])  return NO;
+	return [self checkEncoder:[_encoder writeInt:(int32_t)count] && [_encoder writeInts:values count:count]];
+}
+
+
+- (BOOL) writeLongArray:(const int64_t *)values count:(NSUInteger)count named:(NSString *)name
+{
+	if (count > INT32_MAX)  return [self failWithCode:kJANBTSerializationObjectTooLargeError format:@"Long array too long (%lu items)", (unsigned long)count];
+	
+	const JANBTSchemaNode *schema;
+	if (![self beginTagOfType:kJANBTTagLongArray named:name schema:&schema])  return NO;
+	return [self checkEncoder:[_encoder writeInt:(int32_t)count] && [_encoder writeLongs:values count:count]];
+}
+
+
+- (BOOL) beginByteArrayNamed:(NSString *)name length:(NSUInteger)length
+{
+	if (length > INT32_MAX)  return [self failWithCode:kJANBTSerializationObjectTooLargeError format:@"Byte array is too long (%lu bytes)", (unsigned long)length];
+	
+	const JANBTSchemaNode *schema;
+	if (![self beginTagOfType:kJANBTTagByteArray named:name schema:&schema])  return NO;
+	if (![self checkEncoder:[_encoder writeInt:(int32_t)length]])  return NO;
+	
+	_byteArrayRemaining = length;
+	return YES;
+}
+
+
+- (BOOL) writeByteArrayChunk:(const void *)bytes length:(NSUInteger)length
+{
+	if (_error != nil)  return NO;
+	if (length > _byteArrayRemaining)
+	{
+		return [self failWithCode:kJANBTSerializationWriteError format:@"Byte array chunk of %lu bytes is longer than the %lu bytes remaining.", (unsigned long)length, (unsigned long)_byteArrayRemaining];
+	}
+	
+	_byteArrayRemaining -= length;
+	return [self checkEncoder:[_encoder writeBytes:bytes length:length]];
+}
+
+
+- (BOOL) writeObject:(id)object named:(NSString *)name
+{
+	if (_error != nil)  return NO;
+	
+	// The schema for the tag is needed to pick its type, before the header is written.
+	const JANBTSchemaNode *schema = NULL;
+	if (_depth == 0)  schema = _schema.rootNode;
+	else if (!_frames[_depth - 1].isList)  schema = JANBTSchemaNodeMemberForKey(_frames[_depth - 1].schema, name);
+	else if (_frames[_depth - 1].schema != NULL)  schema = _frames[_depth - 1].schema->element;
+	
+	JANBTTagType type = [_encoder tagTypeOfObject:object withSchema:schema];
+	if (type == kJANBTTagUnknown)  return [self failWithCode:kJANBTSerializationWrongTypeError format:@"Object is not an NBT value."];
+	
+	if (![self beginTagOfType:type named:name schema:&schema])  return NO;
+	return [self checkEncoder:[_encoder encodeTagBody:object ofType:type withSchema:schema]];
+}
+
+
+- (BOOL) finishWithError:(NSError **)outError
+{
+	if (_error == nil && !_finished)
+	{
+		if (!_rootStarted || _depth != 0 || _byteArrayRemaining != 0)
+		{
+			[self failWithCode:kJANBTSerializationWriteError format:@"NBT is incomplete."];
+		}
+		else if ([self checkEncoder:[_encoder finishWithError:NULL]])
+		{
+			_finished = YES;
+			if (_memoryStream != nil)
+			{
+				[_memoryStream close];
+				_data = [_memoryStream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+				_memoryStream = nil;
+			}
+		}
+	}
+	
+	if (_error != nil && outError != NULL)  *outError = _error;
+	return _error == nil;
+}
+
+@end
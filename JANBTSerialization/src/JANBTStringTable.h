@@ -0,0 +1,103 @@
+/*
+	JANBTStringTable.h
+	
+	Intern table for NBT compound keys. The same few dozen keys (id, x, y, z,
+	Count, Slot…) occur over and over in chunk data; looking them up by their
+	raw UTF-8 bytes returns the same immutable NSString each time instead of
+	allocating a new one.
+	
+	A table created with -init is for use by a single parser. The shared
+	table is thread-safe and persists for the life of the process. Both only
+	intern short keys and stop growing at a fixed size, so unusual data can’t
+	make them grow without bound.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+@interface JANBTStringTable: NSObject
+
++ (JANBTStringTable *) sharedTable;
+
+// Returns nil if bytes are not valid UTF-8.
+- (NSString *) stringWithUTF8Bytes:(const char *)bytes length:(NSUInteger)length;
+
+@end
+
+
+/*
+	Create an immutable string from UTF-8 bytes, skipping UTF-8 decoding if
+	they’re pure ASCII. Returns nil if bytes are not valid UTF-8.
+*/
+NSString *JANBTMakeString(const char *bytes, NSUInteger length);
+
+
+// FNV-1a, used for key lookup by the string table and compiled schemata.
+static inline uint32_t JANBTHashUTF8Bytes(const char *bytes, NSUInteger length)
+{
+	uint32_t hash = 2166136261U;
+	for (NSUInteger i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t)bytes[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+
+static inline BOOL JANBTIsASCII(const void *bytes, size_t length)
+{
+	const uint8_t *next = bytes;
+	
+#if __SSE2__
+	while (length >= 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i *)next);
+		if (_mm_movemask_epi8(chunk) != 0)  return NO;
+		next += 16;
+		length -= 16;
+	}
+#endif
+	
+	// Check eight bytes at a time for set high bits, then the tail.
+	uint64_t accumulator = 0;
+	while (length >= 8)
+	{
+		uint64_t chunk;
+		memcpy(&chunk, next, sizeof chunk);
+		accumulator |= chunk;
+		next += 8;
+		length -= 8;
+	}
+	while (length > 0)
+	{
+		accumulator |= *next++;
+		length--;
+	}
+	
+	return (accumulator & 0x8080808080808080ULL) == 0;
+}
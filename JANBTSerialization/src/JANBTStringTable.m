@@ -0,0 +1,195 @@
+/*
+	JANBTStringTable.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTStringTable.h"
+#include <pthread.h>
+
+
+enum
+{
+	kInitialCapacity		= 64,		// Must be a power of two.
+	kMaxEntries				= 4096,
+	kMaxInternedLength		= 64
+};
+
+
+typedef struct
+{
+	uint32_t				hash;
+	uint32_t				length;
+	char					*bytes;
+	CFStringRef				string;		// NULL for empty slots.
+} StringTableEntry;
+
+
+@implementation JANBTStringTable
+{
+	StringTableEntry		*_entries;
+	NSUInteger				_capacity;
+	NSUInteger				_count;
+	
+	BOOL					_threadSafe;
+	pthread_rwlock_t		_lock;
+}
+
+
++ (JANBTStringTable *) sharedTable
+{
+	static JANBTStringTable *sharedTable;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedTable = [self new];
+		sharedTable->_threadSafe = YES;
+	});
+	
+	return sharedTable;
+}
+
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_capacity = kInitialCapacity;
+		_entries = calloc(_capacity, sizeof *_entries);
+		if (_entries == NULL)  return nil;
+		pthread_rwlock_init(&_lock, NULL);
+	}
+	return self;
+}
+
+
+- (void) dealloc
+{
+	for (NSUInteger i = 0; i < _capacity; i++)
+	{
+		if (_entries[i].string != NULL)
+		{
+			CFRelease(_entries[i].string);
+			free(_entries[i].bytes);
+		}
+	}
+	free(_entries);
+	pthread_rwlock_destroy(&_lock);
+}
+
+
+- (NSString *) stringWithUTF8Bytes:(const char *)bytes length:(NSUInteger)length
+{
+	if (length > kMaxInternedLength)  return JANBTMakeString(bytes, length);
+	
+	uint32_t hash = JANBTHashUTF8Bytes(bytes, length);
+	CFStringRef string;
+	
+	if (_threadSafe)  pthread_rwlock_rdlock(&_lock);
+	string = [self lookUpBytes:bytes length:length hash:hash];
+	if (_threadSafe)  pthread_rwlock_unlock(&_lock);
+	if (string != NULL)  return (__bridge NSString *)string;
+	
+	NSString *result = JANBTMakeString(bytes, length);
+	if (result == nil)  return nil;
+	
+	if (_threadSafe)  pthread_rwlock_wrlock(&_lock);
+	
+	// Another thread may have got there first.
+	string = [self lookUpBytes:bytes length:length hash:hash];
+	if (string != NULL)
+	{
+		result = (__bridge NSString *)string;
+	}
+	else if (_count < kMaxEntries)
+	{
+		[self insertString:result bytes:bytes length:length hash:hash];
+	}
+	
+	if (_threadSafe)  pthread_rwlock_unlock(&_lock);
+	return result;
+}
+
+
+- (CFStringRef) lookUpBytes:(const char *)bytes length:(NSUInteger)length hash:(uint32_t)hash
+{
+	NSUInteger mask = _capacity - 1;
+	for (NSUInteger i = hash & mask; _entries[i].string != NULL; i = (i + 1) & mask)
+	{
+		StringTableEntry *entry = &_entries[i];
+		if (entry->hash == hash && entry->length == length && memcmp(entry->bytes, bytes, length) == 0)
+		{
+			return entry->string;
+		}
+	}
+	return NULL;
+}
+
+
+- (void) insertString:(NSString *)string bytes:(const char *)bytes length:(NSUInteger)length hash:(uint32_t)hash
+{
+	// Keep the load factor at or below 1/2.
+	if ((_count + 1) * 2 > _capacity && ![self grow])  return;
+	
+	char *copy = malloc(length + 1);
+	if (copy == NULL)  return;
+	memcpy(copy, bytes, length);
+	
+	NSUInteger mask = _capacity - 1;
+	NSUInteger i = hash & mask;
+	while (_entries[i].string != NULL)  i = (i + 1) & mask;
+	
+	_entries[i] = (StringTableEntry){ hash, (uint32_t)length, copy, (CFStringRef)CFBridgingRetain(string) };
+	_count++;
+}
+
+
+- (BOOL) grow
+{
+	NSUInteger newCapacity = _capacity * 2;
+	StringTableEntry *newEntries = calloc(newCapacity, sizeof *newEntries);
+	if (newEntries == NULL)  return NO;
+	
+	NSUInteger mask = newCapacity - 1;
+	for (NSUInteger i = 0; i < _capacity; i++)
+	{
+		if (_entries[i].string == NULL)  continue;
+		
+		NSUInteger j = _entries[i].hash & mask;
+		while (newEntries[j].string != NULL)  j = (j + 1) & mask;
+		newEntries[j] = _entries[i];
+	}
+	
+	free(_entries);
+	_entries = newEntries;
+	_capacity = newCapacity;
+	return YES;
+}
+
+@end
+
+
+NSString *JANBTMakeString(const char *bytes, NSUInteger length)
+{
+	// For ASCII, CFString can store the bytes as they are without decoding.
+	CFStringEncoding encoding = JANBTIsASCII(bytes, length) ? kCFStringEncodingASCII : kCFStringEncodingUTF8;
+	return CFBridgingRelease(CFStringCreateWithBytes(kCFAllocatorDefault, (const UInt8 *)bytes, (CFIndex)length, encoding, false));
+}
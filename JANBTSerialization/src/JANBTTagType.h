@@ -42,7 +42,9 @@ typedef enum
 	kJANBTTagList				= 9,
 	kJANBTTagCompound			= 10,
 	kJANBTTagIntArray			= 11,
+	kJANBTTagLongArray			= 12,
 	
+	kJANBTTagLongArrayContent	= 0xFC,	// Special ja_NBTListElementType value for NSArrays to be represented as LongArrays.
 	kJANBTTagIntArrayContent	= 0xFD,	// Special ja_NBTListElementType value for NSArrays to be represented as IntArrays.
 	kJANBTTagAny				= 0xFE,
 	kJANBTTagUnknown			= 0xFF
@@ -50,7 +52,6 @@ typedef enum
 
 
 NSString *JANBTTagNameFromTagType(JANBTTagType type);
-NSString *JANBTTagNameFromSchema(id schema);
 BOOL JANBTIsKnownTagType(JANBTTagType type);	// True if type is valid for use in NBT file. (Doesn’t include kJANBTTagEnd, which is only valid in specific circumstances.)
 
 
@@ -75,11 +76,17 @@ static inline BOOL JANBTIsNumericalTagType(JANBTTagType type)
 }
 
 
-static inline BOOL JANBTIsNumericalSchema(id schema)
+// Size of the payload of fixed-size tags, or 0 for variable-sized ones.
+static inline size_t JANBTFixedTagSize(JANBTTagType type)
 {
-	if (schema != nil)
+	switch (type)
 	{
-		return JANBTIsNumericalTagType([schema ja_NBTSchemaType]);
+		case kJANBTTagByte:		return 1;
+		case kJANBTTagShort:	return 2;
+		case kJANBTTagInt:		return 4;
+		case kJANBTTagLong:		return 8;
+		case kJANBTTagFloat:	return 4;
+		case kJANBTTagDouble:	return 8;
+		default:				return 0;
 	}
-	return YES;
 }
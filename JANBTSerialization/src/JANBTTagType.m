@@ -113,6 +113,7 @@ static const void *kNBTListElementTypeStorageKey = &kNBTListElementTypeStorageKe
 	if ([self isEqualToString:@"data"])		return kJANBTTagByteArray;
 	if ([self isEqualToString:@"string"])	return kJANBTTagString;
 	if ([self isEqualToString:@"intarray"])	return kJANBTTagIntArray;
+	if ([self isEqualToString:@"longarray"])	return kJANBTTagLongArray;
 	return kJANBTTagUnknown;
 }
 
@@ -129,12 +130,6 @@ static const void *kNBTListElementTypeStorageKey = &kNBTListElementTypeStorageKe
 @end
 
 
-NSString *JANBTTagNameFromSchema(id schema)
-{
-	return JANBTTagNameFromTagType(schema ? [schema ja_NBTSchemaType] : kJANBTTagAny);
-}
-
-
 NSString *JANBTTagNameFromTagType(JANBTTagType type)
 {
 	switch (type)
@@ -175,10 +170,14 @@ NSString *JANBTTagNameFromTagType(JANBTTagType type)
 		case kJANBTTagIntArray:
 			return @"TAG_Int_Array";
 			
+		case kJANBTTagLongArray:
+			return @"TAG_Long_Array";
+			
 		case kJANBTTagAny:
 			return @"wildcard";
 			
 		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
 		case kJANBTTagUnknown:
 			;
 			// Fall through
@@ -203,10 +202,12 @@ BOOL JANBTIsKnownTagType(JANBTTagType type)
 		case kJANBTTagList:
 		case kJANBTTagCompound:
 		case kJANBTTagIntArray:
+		case kJANBTTagLongArray:
 			return YES;
 			
 		case kJANBTTagEnd:
 		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
 		case kJANBTTagAny:
 		case kJANBTTagUnknown:
 			;
@@ -54,3 +54,16 @@
 - (id) initWithValue:(Float64)value;
 
 @end
+
+
+/*
+	Typed number factories. These return shared, preallocated instances for
+	every byte and for small integers and integral floating-point values of
+	the other types, which covers most numbers in real NBTs (counts, flags,
+	coordinates within a chunk, zero motion and so forth). Other values are
+	allocated as usual. Instances are immutable, so sharing is invisible
+	except to pointer comparison.
+*/
+NSNumber *JANBTMakeInteger(NSInteger value, JANBTTagType type);
+NSNumber *JANBTMakeFloat(Float32 value);
+NSNumber *JANBTMakeDouble(Float64 value);
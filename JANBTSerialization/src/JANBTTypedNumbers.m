@@ -25,6 +25,21 @@
 
 #import "JANBTTypedNumbers.h"
 
+
+enum
+{
+	// Cached range for shorts, ints and longs. Bytes are always cached.
+	kSmallIntegerMin			= -128,
+	kSmallIntegerMax			= 1023,
+	kSmallIntegerCount			= kSmallIntegerMax - kSmallIntegerMin + 1,
+	
+	// Cached range for integral floats and doubles.
+	kSmallRealMin				= -16,
+	kSmallRealMax				= 16,
+	kSmallRealCount				= kSmallRealMax - kSmallRealMin + 1
+};
+
+
 @implementation JANBTInteger
 {
 	NSInteger					_value;
@@ -478,3 +493,78 @@
 }
 
 @end
+
+
+/*
+	The caches are filled once, on first use, and never released. Byte
+	values use the same table as the other integer types, indexed by type.
+*/
+static JANBTInteger *sSmallIntegers[4][kSmallIntegerCount];
+static JANBTFloat *sSmallFloats[kSmallRealCount];
+static JANBTDouble *sSmallDoubles[kSmallRealCount];
+
+
+static void InitSmallNumbers(void)
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		for (JANBTTagType type = kJANBTTagByte; type <= kJANBTTagLong; type++)
+		{
+			for (NSInteger value = kSmallIntegerMin; value <= kSmallIntegerMax; value++)
+			{
+				if (type == kJANBTTagByte && value > INT8_MAX)  break;
+				sSmallIntegers[type - kJANBTTagByte][value - kSmallIntegerMin] = [[JANBTInteger alloc] initWithValue:value type:type];
+			}
+		}
+		
+		for (NSInteger value = kSmallRealMin; value <= kSmallRealMax; value++)
+		{
+			sSmallFloats[value - kSmallRealMin] = [[JANBTFloat alloc] initWithValue:value];
+			sSmallDoubles[value - kSmallRealMin] = [[JANBTDouble alloc] initWithValue:value];
+		}
+	});
+}
+
+
+NSNumber *JANBTMakeInteger(NSInteger value, JANBTTagType type)
+{
+	if (kSmallIntegerMin <= value && value <= kSmallIntegerMax && kJANBTTagByte <= type && type <= kJANBTTagLong)
+	{
+		InitSmallNumbers();
+		JANBTInteger *result = sSmallIntegers[type - kJANBTTagByte][value - kSmallIntegerMin];
+		if (result != nil)  return result;
+	}
+	
+	return [[JANBTInteger alloc] initWithValue:value type:type];
+}
+
+
+// Integral values in the cached range; negative zero is excluded so it round-trips.
+static inline BOOL IsSmallReal(Float64 value)
+{
+	return kSmallRealMin <= value && value <= kSmallRealMax && value == (NSInteger)value && !(value == 0 && signbit(value));
+}
+
+
+NSNumber *JANBTMakeFloat(Float32 value)
+{
+	if (IsSmallReal(value))
+	{
+		InitSmallNumbers();
+		return sSmallFloats[(NSInteger)value - kSmallRealMin];
+	}
+	
+	return [[JANBTFloat alloc] initWithValue:value];
+}
+
+
+NSNumber *JANBTMakeDouble(Float64 value)
+{
+	if (IsSmallReal(value))
+	{
+		InitSmallNumbers();
+		return sSmallDoubles[(NSInteger)value - kSmallRealMin];
+	}
+	
+	return [[JANBTDouble alloc] initWithValue:value];
+}
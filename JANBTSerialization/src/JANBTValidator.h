@@ -0,0 +1,82 @@
+/*
+	JANBTValidator.h
+
+	Walks uncompressed NBT, checking its structure, its strings and
+	optionally its conformance to a schema, without creating any objects.
+	This is the engine behind +[JANBTSerialization validateNBTData:…].
+
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTSerialization.h"
+#import "JANBTSchemaNode.h"
+
+
+typedef enum
+{
+	kJANBTValidationOK,
+	kJANBTValidationPrematureEnd,
+	kJANBTValidationUnknownTag,
+	kJANBTValidationInvalidUTF8,
+	kJANBTValidationWrongType,
+	kJANBTValidationRootNotCompound,
+	kJANBTValidationTooDeep
+} JANBTValidationStatus;
+
+
+typedef struct JANBTValidationFailure
+{
+	JANBTValidationStatus	status;
+	size_t					offset;			// Where the problem was found.
+	JANBTTagType			type;			// The offending tag type, for unknown tag and wrong type.
+	JANBTTagType			expectedType;	// For wrong type.
+} JANBTValidationFailure;
+
+
+enum
+{
+	// Deeper NBTs are rejected rather than risk running out of stack.
+	kJANBTValidationMaxDepth	= 512
+};
+
+
+/*
+	Validate the NBT in bytes. On success, *outRootName points into bytes
+	(or has NULL bytes for an empty fragment) and summary, if not NULL, is filled
+	in. On failure, *outFailure describes the problem. Nothing is allocated.
+*/
+BOOL JANBTValidateBytes(const uint8_t *bytes,
+						size_t length,
+						const JANBTSchemaNode *schema,
+						BOOL allowFragments,
+						JANBTStringRef *outRootName,
+						JANBTValidationSummary *summary,
+						JANBTValidationFailure *outFailure);
+
+
+// Create an NSError describing failure, if outError is not null. Defined in JANBTSerialization.m.
+void JANBTSetValidationError(NSError **outError, const JANBTValidationFailure *failure);
+
+
+// Standard UTF-8 validation, matching what the parser accepts.
+BOOL JANBTIsValidUTF8(const void *bytes, size_t length);
@@ -0,0 +1,282 @@
+/*
+	JANBTValidator.m
+
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JANBTValidator.h"
+#import "JANBTBufferCursor.h"
+#import "JANBTStringTable.h"
+
+
+typedef struct
+{
+	JANBTBufferCursor		cursor;
+	const uint8_t			*start;
+	JANBTValidationSummary	*summary;
+	JANBTValidationFailure	*failure;
+	NSUInteger				depth;
+} Validator;
+
+
+static BOOL ValidateTagBody(Validator *validator, JANBTTagType type, const JANBTSchemaNode *schema);
+
+
+static BOOL Fail(Validator *validator, JANBTValidationStatus status, JANBTTagType type, const JANBTSchemaNode *schema)
+{
+	*validator->failure = (JANBTValidationFailure)
+	{
+		.status = status,
+		.offset = (size_t)(validator->cursor.next - validator->start),
+		.type = type,
+		.expectedType = JANBTSchemaNodeType(schema)
+	};
+	return NO;
+}
+
+
+static inline BOOL Skip(Validator *validator, size_t length)
+{
+	if (__builtin_expect(JANBTCursorReadBytes(&validator->cursor, length) == NULL, 0))
+	{
+		return Fail(validator, kJANBTValidationPrematureEnd, kJANBTTagEnd, NULL);
+	}
+	return YES;
+}
+
+
+static inline BOOL ReadByte(Validator *validator, int8_t *value)
+{
+	return JANBTCursorReadByte(&validator->cursor, value) || Fail(validator, kJANBTValidationPrematureEnd, kJANBTTagEnd, NULL);
+}
+
+
+static inline BOOL ReadLength(Validator *validator, uint32_t *value)
+{
+	return JANBTCursorReadInt(&validator->cursor, (int32_t *)value) || Fail(validator, kJANBTValidationPrematureEnd, kJANBTTagEnd, NULL);
+}
+
+
+static BOOL ReadString(Validator *validator, JANBTStringRef *outString)
+{
+	const char *bytes;
+	uint16_t length;
+	if (!JANBTCursorReadStringBytes(&validator->cursor, &bytes, &length))
+	{
+		return Fail(validator, kJANBTValidationPrematureEnd, kJANBTTagEnd, NULL);
+	}
+	if (!JANBTIsValidUTF8(bytes, length))
+	{
+		validator->cursor.next = (const uint8_t *)bytes;
+		return Fail(validator, kJANBTValidationInvalidUTF8, kJANBTTagString, NULL);
+	}
+	
+	if (outString != NULL)  *outString = (JANBTStringRef){ bytes, length };
+	return YES;
+}
+
+
+static BOOL Enter(Validator *validator)
+{
+	if (++validator->depth > kJANBTValidationMaxDepth)  return Fail(validator, kJANBTValidationTooDeep, kJANBTTagEnd, NULL);
+	if (validator->depth > validator->summary->maxDepth)  validator->summary->maxDepth = validator->depth;
+	return YES;
+}
+
+
+static BOOL ValidateList(Validator *validator, const JANBTSchemaNode *schema)
+{
+	int8_t type;
+	uint32_t count;
+	if (!ReadByte(validator, &type) || !ReadLength(validator, &count))  return NO;
+	if (count == 0)  return YES;
+	
+	const JANBTSchemaNode *elementSchema = schema ? schema->element : NULL;
+	if (!JANBTIsKnownTagType(type))  return Fail(validator, kJANBTValidationUnknownTag, type, NULL);
+	if (!JANBTSchemaNodeAcceptsTagType(elementSchema, type))  return Fail(validator, kJANBTValidationWrongType, type, elementSchema);
+	
+	// Lists of numbers are skipped in one go.
+	size_t elementSize = JANBTFixedTagSize(type);
+	if (elementSize != 0)
+	{
+		if (!Skip(validator, (size_t)count * elementSize))  return NO;
+		validator->summary->tagCounts[type] += count;
+		validator->summary->payloadLength += (size_t)count * elementSize;
+		return YES;
+	}
+	
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!ValidateTagBody(validator, type, elementSchema))  return NO;
+	}
+	return YES;
+}
+
+
+static BOOL ValidateCompound(Validator *validator, const JANBTSchemaNode *schema)
+{
+	for (;;)
+	{
+		int8_t type;
+		if (!ReadByte(validator, &type))  return NO;
+		if (type == kJANBTTagEnd)  return YES;
+		
+		JANBTStringRef name;
+		if (!ReadString(validator, &name))  return NO;
+		
+		const JANBTSchemaNode *memberSchema = JANBTSchemaNodeMemberNamed(schema, name.bytes, name.length);
+		if (!ValidateTagBody(validator, type, memberSchema))  return NO;
+	}
+}
+
+
+static BOOL ValidateTagBody(Validator *validator, JANBTTagType type, const JANBTSchemaNode *schema)
+{
+	if (!JANBTIsKnownTagType(type))  return Fail(validator, kJANBTValidationUnknownTag, type, NULL);
+	if (!JANBTSchemaNodeAcceptsTagType(schema, type))  return Fail(validator, kJANBTValidationWrongType, type, schema);
+	
+	JANBTValidationSummary *summary = validator->summary;
+	summary->tagCounts[type]++;
+	
+	switch (type)
+	{
+		case kJANBTTagByte:
+		case kJANBTTagShort:
+		case kJANBTTagInt:
+		case kJANBTTagLong:
+		case kJANBTTagFloat:
+		case kJANBTTagDouble:
+		{
+			size_t size = JANBTFixedTagSize(type);
+			summary->payloadLength += size;
+			return Skip(validator, size);
+		}
+			
+		case kJANBTTagString:
+		{
+			JANBTStringRef string;
+			if (!ReadString(validator, &string))  return NO;
+			summary->payloadLength += string.length;
+			return YES;
+		}
+			
+		case kJANBTTagByteArray:
+		case kJANBTTagIntArray:
+		case kJANBTTagLongArray:
+		{
+			uint32_t count;
+			if (!ReadLength(validator, &count))  return NO;
+			size_t size = (size_t)count * ((type == kJANBTTagByteArray) ? 1 : (type == kJANBTTagIntArray) ? 4 : 8);
+			summary->payloadLength += size;
+			return Skip(validator, size);
+		}
+			
+		case kJANBTTagList:
+		case kJANBTTagCompound:
+		{
+			if (!Enter(validator))  return NO;
+			BOOL OK = (type == kJANBTTagList) ? ValidateList(validator, schema) : ValidateCompound(validator, schema);
+			validator->depth--;
+			return OK;
+		}
+			
+		case kJANBTTagIntArrayContent:
+		case kJANBTTagLongArrayContent:
+		case kJANBTTagEnd:
+		case kJANBTTagAny:
+		case kJANBTTagUnknown:
+			;
+	}
+	
+	return Fail(validator, kJANBTValidationUnknownTag, type, NULL);
+}
+
+
+BOOL JANBTValidateBytes(const uint8_t *bytes,
+						size_t length,
+						const JANBTSchemaNode *schema,
+						BOOL allowFragments,
+						JANBTStringRef *outRootName,
+						JANBTValidationSummary *summary,
+						JANBTValidationFailure *outFailure)
+{
+	NSCParameterAssert(outRootName != NULL && outFailure != NULL);
+	
+	JANBTValidationSummary scratchSummary;
+	if (summary == NULL)  summary = &scratchSummary;
+	memset(summary, 0, sizeof *summary);
+	
+	Validator validator =
+	{
+		.cursor = JANBTMakeBufferCursor(bytes, length),
+		.start = bytes,
+		.summary = summary,
+		.failure = outFailure
+	};
+	
+	int8_t rootType;
+	if (!ReadByte(&validator, &rootType))  return NO;
+	if (rootType != kJANBTTagCompound && !allowFragments)  return Fail(&validator, kJANBTValidationRootNotCompound, rootType, NULL);
+	
+	*outRootName = (JANBTStringRef){ NULL, 0 };
+	if (rootType != kJANBTTagEnd)
+	{
+		if (!ReadString(&validator, outRootName))  return NO;
+		if (!ValidateTagBody(&validator, rootType, schema))  return NO;
+	}
+	
+	summary->length = (size_t)(validator.cursor.next - bytes);
+	return YES;
+}
+
+
+BOOL JANBTIsValidUTF8(const void *bytes, size_t length)
+{
+	if (JANBTIsASCII(bytes, length))  return YES;
+	
+	const uint8_t *next = bytes, *end = next + length;
+	while (next < end)
+	{
+		uint8_t c = *next++;
+		if (c < 0x80)  continue;
+		
+		unsigned extra;
+		uint32_t codePoint, minimum;
+		if ((c & 0xE0) == 0xC0)  { extra = 1; codePoint = c & 0x1F; minimum = 0x80; }
+		else if ((c & 0xF0) == 0xE0)  { extra = 2; codePoint = c & 0x0F; minimum = 0x800; }
+		else if ((c & 0xF8) == 0xF0)  { extra = 3; codePoint = c & 0x07; minimum = 0x10000; }
+		else  return NO;
+		
+		if ((size_t)(end - next) < extra)  return NO;
+		while (extra--)
+		{
+			c = *next++;
+			if ((c & 0xC0) != 0x80)  return NO;
+			codePoint = (codePoint << 6) | (c & 0x3F);
+		}
+		
+		// Overlong forms, UTF-16 surrogates and values beyond Unicode.
+		if (codePoint < minimum || codePoint > 0x10FFFF || (0xD800 <= codePoint && codePoint <= 0xDFFF))  return NO;
+	}
+	return YES;
+}
@@ -39,9 +39,48 @@ typedef enum
 } JAZLibCompressionMode;
 
 
+// See deflateInit2() in zlib.h.
+typedef enum
+{
+	kJAZLibStrategyDefault,
+	kJAZLibStrategyFiltered,
+	kJAZLibStrategyRLE,				// Good for long runs of identical bytes, like block IDs.
+	kJAZLibStrategyHuffmanOnly
+} JAZLibCompressionStrategy;
+
+
+typedef struct
+{
+	JAZLibCompressionMode		mode;
+	int							level;		// 1 (fastest) to 9 (smallest), 0 for no compression, or -1 for zlib’s default.
+	JAZLibCompressionStrategy	strategy;
+} JAZLibCompressionSettings;
+
+
+static inline JAZLibCompressionSettings JAZLibDefaultCompressionSettings(JAZLibCompressionMode mode)
+{
+	return (JAZLibCompressionSettings){ mode, -1, kJAZLibStrategyDefault };
+}
+
+
+// The corresponding Z_*STRATEGY constant.
+int JAZLibZLibStrategy(JAZLibCompressionStrategy strategy);
+
+
 @interface JAZLibCompressor: NSObject <JANBTParserCompressor>
 
 - (id) initWithStream:(NSOutputStream *)stream mode:(JAZLibCompressionMode)mode;
+- (id) initWithStream:(NSOutputStream *)stream settings:(JAZLibCompressionSettings)settings;
+
+/*
+	Compress into memory instead of a stream. deflate writes straight into a
+	buffer sized for expectedLength bytes of input, which grows if needed.
+	The result is available from compressedData after flushing.
+*/
+- (id) initWithExpectedLength:(NSUInteger)expectedLength mode:(JAZLibCompressionMode)mode;
+- (id) initWithExpectedLength:(NSUInteger)expectedLength settings:(JAZLibCompressionSettings)settings;
+
+@property (readonly) NSData *compressedData;
 
 @property (readonly) NSUInteger rawBytesWritten;
 @property (readonly) NSUInteger compressedBytesWritten;
@@ -58,6 +97,60 @@ typedef enum
 */
 - (NSData *) readToEndWithError:(NSError **)outError;
 
+/*
+	Decompress an in-memory payload into a single contiguous buffer, without
+	going through a stream. Trailing data after the end of the compressed
+	stream is ignored. For gzip data, the buffer is sized from the length
+	in the trailer, so it is normally inflated in one call with no copying.
+	
+	This uses libdeflate if it was available at build time, otherwise zlib.
+*/
++ (NSData *) inflateData:(NSData *)data mode:(JAZLibCompressionMode)mode error:(NSError **)outError;
+
+// “zlib” or “libdeflate”, for diagnostics.
++ (NSString *) inflateBackendName;
+
+@end
+
+
+/*
+	Inflate state that is reset rather than recreated between payloads: a
+	z_stream with its I/O buffers, or a libdeflate decompressor. Inflaters
+	are not thread safe. Each thread keeps a small pool, which
+	JAZlibDecompressor draws on; JANBTReadingContext holds one for its
+	lifetime instead.
+*/
+@interface JAZLibInflater: NSObject
+
+// Take an inflater from the current thread’s pool, or make a new one.
++ (JAZLibInflater *) checkOutInflater;
+
+/*
+	Return to the current thread’s pool. The inflater must not be used
+	afterwards. The size of the last payload, used as the initial buffer
+	size for the next zlib payload, is forgotten.
+*/
+- (void) checkIn;
+
+// As +[JAZlibDecompressor inflateData:mode:error:].
+- (NSData *) inflateData:(NSData *)data mode:(JAZLibCompressionMode)mode error:(NSError **)outError;
+
+/*
+	Incremental inflation, for data that arrives in pieces. After
+	-beginIncrementalInflateWithMode:error:, pass each piece to
+	-inflateBytes:length:error:handler:. Output is passed to handler in
+	chunks which are only valid for the duration of the call; if handler
+	returns NO, the rest of the input is discarded. Input after the end of
+	the compressed stream is ignored, and incrementalInflateFinished is set.
+*/
+- (BOOL) beginIncrementalInflateWithMode:(JAZLibCompressionMode)mode error:(NSError **)outError;
+- (BOOL) inflateBytes:(const void *)bytes
+			   length:(NSUInteger)length
+				error:(NSError **)outError
+			  handler:(BOOL (^)(const uint8_t *bytes, NSUInteger length))handler;
+
+@property (readonly) BOOL incrementalInflateFinished;
+
 @end
 
 
@@ -27,9 +27,24 @@
 #import <zlib.h>
 
 
+/*
+	The one-shot inflater, +inflateData:mode:error:, can use libdeflate
+	instead of zlib, which is usually faster for whole buffers. It is only
+	used if JAZLIB_USE_LIBDEFLATE is 1. The JAZLIB_USE_LIBDEFLATE build
+	setting in shared.xcconfig defines it and also links libdeflate.
+*/
+#ifndef JAZLIB_USE_LIBDEFLATE
+	#define JAZLIB_USE_LIBDEFLATE 0
+#endif
+
+#if JAZLIB_USE_LIBDEFLATE
+#import <libdeflate.h>
+#endif
+
+
 enum
 {
-	// Note: each compressor/decompressor has two buffers of size kBufferSize, plus zlib-internal buffers.
+	// Note: each compressor and pooled inflater has two buffers of size kBufferSize, plus zlib-internal buffers.
 	kBufferSize					= 128 << 10,
 	kFlushThreshold				= kBufferSize * 3 / 4
 };
@@ -39,11 +54,40 @@ NSString * const kJAZLibErrorDomain = @"se.jens.ayton net.zlib Error Domain";
 
 
 static void SetZLibError(int code, z_stream *stream, NSError **outError);
+static int InflateWindowBits(JAZLibCompressionMode mode);
+static NSUInteger ExpectedInflatedLength(const uint8_t *bytes, NSUInteger length, JAZLibCompressionMode mode);
+static void SetOutOfMemoryError(NSError **outError);
+#if JAZLIB_USE_LIBDEFLATE
+static NSData *InflateWithLibdeflate(struct libdeflate_decompressor *decompressor, const uint8_t *bytes, NSUInteger length, JAZLibCompressionMode mode, NSUInteger expectedLength, NSError **outError);
+#else
+static NSData *InflateWithZLib(z_stream *zstream, const uint8_t *bytes, NSUInteger length, NSUInteger expectedLength, NSError **outError);
+#endif
+
+
+static NSString * const kInflaterPoolKey = @"se.jens.ayton JAZLibInflater pool";
+
+enum
+{
+	// Enough for a parser or two per thread, plus a one-shot inflate.
+	kMaxPooledInflaters			= 4
+};
+
+
+@interface JAZLibInflater ()
+
+// Both buffers are kBufferSize bytes. Allocated on first use.
+@property (readonly) uint8_t *buffers;
+
+// Initializes or resets the z_stream for a new payload. Returns NULL on failure.
+- (z_stream *) resetStreamForMode:(JAZLibCompressionMode)mode;
+
+@end
 
 
 @implementation JAZLibCompressor
 {
 	NSOutputStream				*_stream;
+	NSMutableData				*_outData;		// In-memory mode only.
 	uint8_t						*_inBuffer;
 	uint8_t						*_outBuffer;
 	NSUInteger					_inCursor;
@@ -54,9 +98,52 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 }
 
 - (id) initWithStream:(NSOutputStream *)stream mode:(JAZLibCompressionMode)mode
+{
+	return [self initWithStream:stream settings:JAZLibDefaultCompressionSettings(mode)];
+}
+
+
+- (id) initWithStream:(NSOutputStream *)stream settings:(JAZLibCompressionSettings)settings
 {
 	if (stream == nil)  return nil;
 	
+	if ((self = [self initWithSettings:settings]))
+	{
+		_stream = stream;
+		if (stream.streamStatus == NSStreamStatusNotOpen)
+		{
+			_streamWasClosed = YES;
+			[stream open];
+		}
+	}
+	
+	return self;
+}
+
+
+- (id) initWithExpectedLength:(NSUInteger)expectedLength mode:(JAZLibCompressionMode)mode
+{
+	return [self initWithExpectedLength:expectedLength settings:JAZLibDefaultCompressionSettings(mode)];
+}
+
+
+- (id) initWithExpectedLength:(NSUInteger)expectedLength settings:(JAZLibCompressionSettings)settings
+{
+	if ((self = [self initWithSettings:settings]))
+	{
+		_outData = [NSMutableData dataWithLength:deflateBound(&_zstream, expectedLength)];
+		if (_outData == nil)  return nil;
+		
+		_zstream.next_out = _outData.mutableBytes;
+		_zstream.avail_out = (uInt)MIN(_outData.length, (NSUInteger)UINT_MAX);
+	}
+	
+	return self;
+}
+
+
+- (id) initWithSettings:(JAZLibCompressionSettings)settings
+{
 	if ((self = [super init]))
 	{
 		_inBuffer = malloc(kBufferSize * 2);
@@ -69,15 +156,8 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 		
 		_outBuffer = _inBuffer + kBufferSize;
 		
-		_stream = stream;
-		if (stream.streamStatus == NSStreamStatusNotOpen)
-		{
-			_streamWasClosed = YES;
-			[stream open];
-		}
-		
 		int windowBits = 15;
-		switch (mode)
+		switch (settings.mode)
 		{
 			case kJAZLibCompressionRawDeflate:
 				windowBits = -windowBits;
@@ -96,7 +176,7 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 		_zstream.next_out = _outBuffer;
 		_zstream.avail_out = kBufferSize;
 		
-		int zstatus = deflateInit2(&_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY);
+		int zstatus = deflateInit2(&_zstream, settings.level, Z_DEFLATED, windowBits, 9, JAZLibZLibStrategy(settings.strategy));
 		if (zstatus != Z_OK)  return nil;
 		
 		_zOpen = YES;
@@ -118,6 +198,8 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 
 - (BOOL) writeToOutStreamWithError:(NSError **)outError
 {
+	if (_outData != nil)  return [self growOutData];
+	
 	uint8_t *outBytes = _outBuffer;
 	NSUInteger outRemaining = kBufferSize - _zstream.avail_out;
 		  
@@ -145,11 +227,68 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 }
 
 
+// In-memory mode: keep at least as much output space as the stream mode would.
+- (BOOL) growOutData
+{
+	uint8_t *base = _outData.mutableBytes;
+	NSUInteger used = _zstream.next_out - base;
+	if (_outData.length - used >= kBufferSize - kFlushThreshold)  return YES;
+	
+	_outData.length += _outData.length / 2 + kBufferSize;
+	_zstream.next_out = (uint8_t *)_outData.mutableBytes + used;
+	_zstream.avail_out = (uInt)MIN(_outData.length - used, (NSUInteger)UINT_MAX);
+	return YES;
+}
+
+
+// Deflate everything in avail_in, writing output as it accumulates.
+- (BOOL) deflatePendingInputWithError:(NSError **)outError
+{
+	while (_zstream.avail_in > 0)
+	{
+		int zstatus = deflate(&_zstream, Z_NO_FLUSH);
+		if (zstatus != Z_OK)
+		{
+			SetZLibError(zstatus, &_zstream, outError);
+			_failed = YES;
+			return NO;
+		}
+		
+		if (_zstream.avail_out < kBufferSize - kFlushThreshold)
+		{
+			if (![self writeToOutStreamWithError:outError])  return NO;
+		}
+	}
+	
+	return YES;
+}
+
+
 - (BOOL) write:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)outError
 {
 	NSParameterAssert(bytes != NULL);
 	if (_failed)  return NO;
 	
+	if (length >= kBufferSize)
+	{
+		// Large writes are deflated straight from the caller’s memory rather than copied into the input buffer.
+		if (![self deflatePendingInputWithError:outError])  return NO;
+		
+		while (length > 0)
+		{
+			uInt chunk = (uInt)MIN(length, (NSUInteger)UINT_MAX);
+			_zstream.next_in = (Bytef *)bytes;
+			_zstream.avail_in = chunk;
+			if (![self deflatePendingInputWithError:outError])  return NO;
+			bytes += chunk;
+			length -= chunk;
+		}
+		
+		_zstream.next_in = _inBuffer;
+		_inCursor = 0;
+		return YES;
+	}
+	
 	while (length > 0)
 	{
 		// Copy input into deflate buffer.
@@ -208,6 +347,8 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 			return NO;
 		}
 		
+		// In memory, there’s nothing to write out once the stream is finished.
+		if (_outData != nil && zstatus == Z_STREAM_END)  break;
 		if (![self writeToOutStreamWithError:outError])  return NO;
 	}
 	while (zstatus != Z_STREAM_END);
@@ -215,6 +356,8 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 	deflateEnd(&_zstream);
 	_zOpen = NO;
 	
+	if (_outData != nil)  _outData.length = _zstream.next_out - (uint8_t *)_outData.mutableBytes;
+	
 	if (_streamWasClosed)
 	{
 		[_stream close];
@@ -225,6 +368,12 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 }
 
 
+- (NSData *) compressedData
+{
+	return _outData;
+}
+
+
 - (NSUInteger) rawBytesWritten
 {
 	return _zstream.total_in + _zstream.avail_in;
@@ -242,9 +391,10 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 @implementation JAZlibDecompressor
 {
 	NSInputStream				*_stream;
+	JAZLibInflater				*_inflater;
 	uint8_t						*_inBuffer;
 	uint8_t						*_outBuffer;
-	z_stream					_zstream;
+	z_stream					*_zstream;
 	uInt						_readCursor;
 	BOOL						_streamWasClosed;
 	BOOL						_zOpen;
@@ -256,16 +406,14 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 	
 	if ((self = [super init]))
 	{
-		_inBuffer = malloc(kBufferSize * 2);
-		
-		if (_inBuffer == nil)
-		{
-			free(_inBuffer);
-			[NSException raise:NSMallocException format:@"Could not allocate space for zlib decompression."];
-		}
-		
+		// The buffers and z_stream are borrowed from the thread’s pool, rather than set up for every NBT.
+		_inflater = [JAZLibInflater checkOutInflater];
+		_inBuffer = _inflater.buffers;
 		_outBuffer = _inBuffer + kBufferSize;
 		
+		_zstream = [_inflater resetStreamForMode:mode];
+		if (_zstream == NULL)  return nil;
+		
 		_stream = stream;
 		if (stream.streamStatus == NSStreamStatusNotOpen)
 		{
@@ -273,31 +421,10 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 			[stream open];
 		}
 		
-		int windowBits = 15;
-		switch (mode)
-		{
-			case kJAZLibCompressionRawDeflate:
-				windowBits = -windowBits;
-				break;
-				
-			case kJAZLibCompressionZLib:
-				break;
-				
-			case kJAZLibCompressionGZip:
-				windowBits += 16;
-				break;
-				
-			case kJAZLibCompressionAutoDetect:
-				windowBits += 32;
-				break;
-		}
-		
-		_zstream.next_in = _inBuffer;
-		_zstream.next_out = _outBuffer;
-		_zstream.avail_out = kBufferSize;
-		
-		int zstatus = inflateInit2(&_zstream, windowBits);
-		if (zstatus != Z_OK)  return nil;
+		_zstream->next_in = _inBuffer;
+		_zstream->avail_in = 0;
+		_zstream->next_out = _outBuffer;
+		_zstream->avail_out = kBufferSize;
 		
 		_zOpen = YES;
 	}
@@ -308,10 +435,8 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 
 - (void) dealloc
 {
-	if (_zOpen)  inflateEnd(&_zstream);
 	if (_streamWasClosed)  [_stream close];
-	
-	free(_inBuffer);
+	[_inflater checkIn];
 }
 
 
@@ -323,7 +448,7 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 	
 	while (length > 0)
 	{
-		NSInteger pending = kBufferSize - _zstream.avail_out - _readCursor;
+		NSInteger pending = kBufferSize - _zstream->avail_out - _readCursor;
 		
 		if (pending != 0)
 		{
@@ -338,8 +463,8 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 			
 			if (pending == toCopy)
 			{
-				_zstream.next_out = _outBuffer;
-				_zstream.avail_out = kBufferSize;
+				_zstream->next_out = _outBuffer;
+				_zstream->avail_out = kBufferSize;
 				_readCursor = 0;
 			}
 		}
@@ -347,14 +472,14 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 		{
 			// Read some input if necessary, and pump the inflator.
 			BOOL flush = YES;
-			if (_zstream.avail_in == 0)
+			if (_zstream->avail_in == 0)
 			{
 				flush = NO;
-				_zstream.next_in = _inBuffer;
-				NSInteger status = [_stream read:_zstream.next_in maxLength:kBufferSize];
+				_zstream->next_in = _inBuffer;
+				NSInteger status = [_stream read:_zstream->next_in maxLength:kBufferSize];
 				if (status > 0)
 				{
-					_zstream.avail_in = (uint)status;
+					_zstream->avail_in = (uint)status;
 				}
 				else
 				{
@@ -367,17 +492,16 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 				}
 			}
 			
-			int zstatus = inflate(&_zstream, flush ? Z_SYNC_FLUSH : 0);
+			int zstatus = inflate(_zstream, flush ? Z_SYNC_FLUSH : 0);
 			if (zstatus != Z_OK)
 			{
 				if (zstatus == Z_STREAM_END)
 				{
 					_zOpen = NO;
-					inflateEnd(&_zstream);
 				}
 				else
 				{
-					SetZLibError(zstatus, &_zstream, outError);
+					SetZLibError(zstatus, _zstream, outError);
 					return -1;
 				}
 			}
@@ -425,9 +549,380 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError);
 	return result;
 }
 
+
++ (NSData *) inflateData:(NSData *)data mode:(JAZLibCompressionMode)mode error:(NSError **)outError
+{
+	JAZLibInflater *inflater = [JAZLibInflater checkOutInflater];
+	NSData *result = [inflater inflateData:data mode:mode error:outError];
+	[inflater checkIn];
+	return result;
+}
+
+
++ (NSString *) inflateBackendName
+{
+#if JAZLIB_USE_LIBDEFLATE
+	return @"libdeflate";
+#else
+	return @"zlib";
+#endif
+}
+
+@end
+
+
+@implementation JAZLibInflater
+{
+	z_stream					_zstream;
+	uint8_t						*_buffers;
+#if JAZLIB_USE_LIBDEFLATE
+	struct libdeflate_decompressor *_decompressor;
+#endif
+	NSUInteger					_lastLength;
+	BOOL						_zOpen;
+}
+
+
++ (JAZLibInflater *) checkOutInflater
+{
+	NSMutableArray *pool = [NSThread currentThread].threadDictionary[kInflaterPoolKey];
+	JAZLibInflater *result = pool.lastObject;
+	if (result != nil)  [pool removeLastObject];
+	else  result = [self new];
+	
+	return result;
+}
+
+
+- (void) checkIn
+{
+	NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+	NSMutableArray *pool = threadDictionary[kInflaterPoolKey];
+	if (pool == nil)
+	{
+		pool = [NSMutableArray new];
+		threadDictionary[kInflaterPoolKey] = pool;
+	}
+	
+	// The size history is only meant for a context reading related payloads, not whoever borrows this next.
+	_lastLength = 0;
+	if (pool.count < kMaxPooledInflaters)  [pool addObject:self];
+}
+
+
+- (void) dealloc
+{
+	if (_zOpen)  inflateEnd(&_zstream);
+#if JAZLIB_USE_LIBDEFLATE
+	if (_decompressor != NULL)  libdeflate_free_decompressor(_decompressor);
+#endif
+	free(_buffers);
+}
+
+
+- (uint8_t *) buffers
+{
+	if (_buffers == NULL)
+	{
+		_buffers = malloc(kBufferSize * 2);
+		if (_buffers == NULL)  [NSException raise:NSMallocException format:@"Could not allocate space for zlib decompression."];
+	}
+	return _buffers;
+}
+
+
+- (z_stream *) resetStreamForMode:(JAZLibCompressionMode)mode
+{
+	int zstatus;
+	if (_zOpen)
+	{
+		zstatus = inflateReset2(&_zstream, InflateWindowBits(mode));
+	}
+	else
+	{
+		_zstream = (z_stream){0};
+		zstatus = inflateInit2(&_zstream, InflateWindowBits(mode));
+		_zOpen = (zstatus == Z_OK);
+	}
+	
+	// inflateReset2() leaves the I/O pointers alone, and they may refer to the previous payload.
+	_zstream.next_in = Z_NULL;
+	_zstream.avail_in = 0;
+	_zstream.next_out = Z_NULL;
+	_zstream.avail_out = 0;
+	
+	return (zstatus == Z_OK) ? &_zstream : NULL;
+}
+
+
+- (NSData *) inflateData:(NSData *)data mode:(JAZLibCompressionMode)mode error:(NSError **)outError
+{
+	NSParameterAssert(data != nil);
+	
+	const uint8_t *bytes = data.bytes;
+	NSUInteger length = data.length;
+	
+	if (mode == kJAZLibCompressionAutoDetect)
+	{
+		mode = (length >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) ? kJAZLibCompressionGZip : kJAZLibCompressionZLib;
+	}
+	
+	// Without a gzip length, consecutive payloads (like the chunks of a region) are assumed to be of similar size.
+	NSUInteger expectedLength = ExpectedInflatedLength(bytes, length, mode);
+	if (mode != kJAZLibCompressionGZip)  expectedLength = MAX(expectedLength, _lastLength);
+	
+	NSData *result;
+#if JAZLIB_USE_LIBDEFLATE
+	if (_decompressor == NULL)  _decompressor = libdeflate_alloc_decompressor();
+	if (_decompressor == NULL)
+	{
+		SetOutOfMemoryError(outError);
+		return nil;
+	}
+	result = InflateWithLibdeflate(_decompressor, bytes, length, mode, expectedLength, outError);
+#else
+	z_stream *zstream = [self resetStreamForMode:mode];
+	if (zstream == NULL)
+	{
+		SetZLibError(Z_MEM_ERROR, NULL, outError);
+		return nil;
+	}
+	result = InflateWithZLib(zstream, bytes, length, expectedLength, outError);
+#endif
+	
+	if (result != nil)  _lastLength = result.length;
+	return result;
+}
+
+
+- (BOOL) beginIncrementalInflateWithMode:(JAZLibCompressionMode)mode error:(NSError **)outError
+{
+	_incrementalInflateFinished = NO;
+	if ([self resetStreamForMode:mode] == NULL)
+	{
+		SetZLibError(Z_MEM_ERROR, NULL, outError);
+		return NO;
+	}
+	return YES;
+}
+
+
+- (BOOL) inflateBytes:(const void *)bytes
+			   length:(NSUInteger)length
+				error:(NSError **)outError
+			  handler:(BOOL (^)(const uint8_t *bytes, NSUInteger length))handler
+{
+	NSParameterAssert(_zOpen && handler != nil);
+	if (_incrementalInflateFinished)  return YES;
+	
+	uint8_t *window = self.buffers;
+	const uint8_t *next = bytes;
+	NSUInteger remaining = length;
+	BOOL wantsMore = YES;
+	
+	do
+	{
+		if (_zstream.avail_in == 0)
+		{
+			uInt chunk = (uInt)MIN(remaining, (NSUInteger)UINT_MAX);
+			_zstream.next_in = (Bytef *)next;
+			_zstream.avail_in = chunk;
+			next += chunk;
+			remaining -= chunk;
+		}
+		_zstream.next_out = window;
+		_zstream.avail_out = kBufferSize;
+		
+		int zstatus = inflate(&_zstream, Z_NO_FLUSH);
+		if (zstatus == Z_STREAM_END)
+		{
+			_incrementalInflateFinished = YES;
+		}
+		else if (zstatus != Z_OK && zstatus != Z_BUF_ERROR)
+		{
+			SetZLibError(zstatus, &_zstream, outError);
+			return NO;
+		}
+		
+		NSUInteger produced = kBufferSize - _zstream.avail_out;
+		if (produced != 0)  wantsMore = handler(window, produced);
+	}
+	// A full window may mean zlib has more output pending even if all input is consumed.
+	while (wantsMore && !_incrementalInflateFinished && (_zstream.avail_in != 0 || remaining != 0 || _zstream.avail_out == 0));
+	
+	// Don’t hold on to pointers into the caller’s buffer.
+	_zstream.next_in = Z_NULL;
+	_zstream.avail_in = 0;
+	return YES;
+}
+
 @end
 
 
+/*
+	A gzip trailer records the uncompressed length modulo 2^32, which lets the
+	one-shot inflaters allocate exactly the right amount up front. Otherwise,
+	NBT data typically compresses by a factor of four to ten, so start at the
+	low end and grow as needed.
+	
+	The gzip length is only a hint: it’s truncated for huge payloads, and
+	trailing data after the compressed stream would be misread as a trailer.
+	Deflate can’t expand data by more than a factor of 1032, so anything
+	larger than that is ignored.
+*/
+static NSUInteger ExpectedInflatedLength(const uint8_t *bytes, NSUInteger length, JAZLibCompressionMode mode)
+{
+	NSUInteger estimate = MAX(length * 4, (NSUInteger)kBufferSize);
+	if (mode != kJAZLibCompressionGZip || length < 18)  return estimate;
+	
+	uint32_t trailerLength;
+	memcpy(&trailerLength, bytes + length - sizeof trailerLength, sizeof trailerLength);
+	NSUInteger recorded = CFSwapInt32LittleToHost(trailerLength);
+	
+	if (recorded == 0 || recorded / 1032 > length)  return estimate;
+	return recorded;
+}
+
+
+// Trim a one-shot inflate buffer to its contents and wrap it.
+static NSData *AdoptInflatedBytes(uint8_t *outBytes, NSUInteger capacity, NSUInteger outLength)
+{
+	if (outLength < capacity)
+	{
+		uint8_t *trimmed = realloc(outBytes, MAX(outLength, (NSUInteger)1));
+		if (trimmed != NULL)  outBytes = trimmed;
+	}
+	return [[NSData alloc] initWithBytesNoCopy:outBytes length:outLength freeWhenDone:YES];
+}
+
+
+static void SetOutOfMemoryError(NSError **outError)
+{
+	if (outError != NULL)  *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+}
+
+
+#if JAZLIB_USE_LIBDEFLATE
+
+static NSData *InflateWithLibdeflate(struct libdeflate_decompressor *decompressor, const uint8_t *bytes, NSUInteger length, JAZLibCompressionMode mode, NSUInteger expectedLength, NSError **outError)
+{
+	NSUInteger capacity = expectedLength;
+	uint8_t *outBytes = NULL;
+	size_t outLength = 0;
+	enum libdeflate_result result = LIBDEFLATE_BAD_DATA;
+	
+	// libdeflate needs the whole output buffer up front; if the guess is too small, double it and start over.
+	for (;;)
+	{
+		uint8_t *newBytes = realloc(outBytes, capacity);
+		if (newBytes == NULL)
+		{
+			free(outBytes);
+			SetOutOfMemoryError(outError);
+			return nil;
+		}
+		outBytes = newBytes;
+		
+		size_t inUsed;
+		switch (mode)
+		{
+			case kJAZLibCompressionGZip:
+				result = libdeflate_gzip_decompress_ex(decompressor, bytes, length, outBytes, capacity, &inUsed, &outLength);
+				break;
+				
+			case kJAZLibCompressionZLib:
+			case kJAZLibCompressionAutoDetect:
+				result = libdeflate_zlib_decompress_ex(decompressor, bytes, length, outBytes, capacity, &inUsed, &outLength);
+				break;
+				
+			case kJAZLibCompressionRawDeflate:
+				result = libdeflate_deflate_decompress_ex(decompressor, bytes, length, outBytes, capacity, &inUsed, &outLength);
+				break;
+		}
+		
+		if (result != LIBDEFLATE_INSUFFICIENT_SPACE)  break;
+		capacity *= 2;
+	}
+	
+	if (result != LIBDEFLATE_SUCCESS)
+	{
+		free(outBytes);
+		if (outError != NULL)
+		{
+			NSString *message = (result == LIBDEFLATE_SHORT_OUTPUT) ? @"Compressed data is truncated." : @"Invalid compressed data.";
+			*outError = [NSError errorWithDomain:kJAZLibErrorDomain
+											code:Z_DATA_ERROR
+										userInfo:@{ NSLocalizedFailureReasonErrorKey: message }];
+		}
+		return nil;
+	}
+	
+	return AdoptInflatedBytes(outBytes, capacity, outLength);
+}
+
+#else
+
+// zstream must be freshly reset for the payload’s mode.
+static NSData *InflateWithZLib(z_stream *zstream, const uint8_t *bytes, NSUInteger length, NSUInteger expectedLength, NSError **outError)
+{
+	const uint8_t *inBytes = bytes;
+	NSUInteger inRemaining = length;
+	
+	int zstatus;
+	NSUInteger capacity = expectedLength;
+	NSUInteger outLength = 0;
+	uint8_t *outBytes = malloc(capacity);
+	
+	for (;;)
+	{
+		if (zstream->avail_in == 0 && inRemaining > 0)
+		{
+			uInt toFeed = (uInt)MIN(inRemaining, (NSUInteger)UINT_MAX);
+			zstream->next_in = (Bytef *)inBytes;
+			zstream->avail_in = toFeed;
+			inBytes += toFeed;
+			inRemaining -= toFeed;
+		}
+		
+		if (outLength == capacity && outBytes != NULL)
+		{
+			capacity *= 2;
+			uint8_t *newBytes = realloc(outBytes, capacity);
+			if (newBytes == NULL)  free(outBytes);
+			outBytes = newBytes;
+		}
+		
+		if (outBytes == NULL)
+		{
+			SetOutOfMemoryError(outError);
+			return nil;
+		}
+		
+		// With a known length, this normally completes in a single call.
+		uInt outSpace = (uInt)MIN(capacity - outLength, (NSUInteger)UINT_MAX);
+		zstream->next_out = outBytes + outLength;
+		zstream->avail_out = outSpace;
+		
+		zstatus = inflate(zstream, inRemaining == 0 ? Z_FINISH : Z_NO_FLUSH);
+		outLength += outSpace - zstream->avail_out;
+		
+		if (zstatus == Z_STREAM_END)  break;
+		if (zstatus == Z_OK)  continue;
+		
+		// Z_BUF_ERROR means inflate ran out of room, unless all input has been consumed, in which case it’s truncated.
+		if (zstatus == Z_BUF_ERROR && (zstream->avail_out == 0 || zstream->avail_in != 0 || inRemaining != 0))  continue;
+		
+		SetZLibError(zstatus, zstream, outError);
+		free(outBytes);
+		return nil;
+	}
+	
+	return AdoptInflatedBytes(outBytes, capacity, outLength);
+}
+
+#endif
+
+
 static void SetZLibError(int code, z_stream *stream, NSError **outError)
 {
 	if (outError == NULL || code == Z_OK)  return;
@@ -437,8 +932,56 @@ static void SetZLibError(int code, z_stream *stream, NSError **outError)
 	{
 		message = [NSString stringWithUTF8String:stream->msg];
 	}
+	else
+	{
+		message = [NSString stringWithFormat:@"zlib error %i.", code];
+	}
 	
 	*outError = [NSError errorWithDomain:kJAZLibErrorDomain
 									code:code
 								userInfo:@{ NSLocalizedFailureReasonErrorKey: message }];
 }
+
+
+static int InflateWindowBits(JAZLibCompressionMode mode)
+{
+	int windowBits = 15;
+	switch (mode)
+	{
+		case kJAZLibCompressionRawDeflate:
+			windowBits = -windowBits;
+			break;
+			
+		case kJAZLibCompressionZLib:
+			break;
+			
+		case kJAZLibCompressionGZip:
+			windowBits += 16;
+			break;
+			
+		case kJAZLibCompressionAutoDetect:
+			windowBits += 32;
+			break;
+	}
+	return windowBits;
+}
+
+
+int JAZLibZLibStrategy(JAZLibCompressionStrategy strategy)
+{
+	switch (strategy)
+	{
+		case kJAZLibStrategyDefault:
+			break;
+			
+		case kJAZLibStrategyFiltered:
+			return Z_FILTERED;
+			
+		case kJAZLibStrategyRLE:
+			return Z_RLE;
+			
+		case kJAZLibStrategyHuffmanOnly:
+			return Z_HUFFMAN_ONLY;
+	}
+	return Z_DEFAULT_STRATEGY;
+}
@@ -0,0 +1,48 @@
+/*
+	JAZLibParallelCompressor.h
+
+	Multithreaded compressor in the style of pigz. Input is split into fixed
+	size blocks which are deflated concurrently, each primed with the end of
+	the previous block as a dictionary, and stitched together into a single
+	standard gzip, zlib or raw deflate stream. The output is slightly larger
+	than JAZLibCompressor’s, but can be read by any inflater.
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JAZLibCompressor.h"
+
+
+@interface JAZLibParallelCompressor: NSObject <JANBTParserCompressor>
+
+// mode may not be kJAZLibCompressionAutoDetect.
+- (id) initWithStream:(NSOutputStream *)stream mode:(JAZLibCompressionMode)mode;
+- (id) initWithStream:(NSOutputStream *)stream settings:(JAZLibCompressionSettings)settings;
+- (id) initWithExpectedLength:(NSUInteger)expectedLength mode:(JAZLibCompressionMode)mode;
+- (id) initWithExpectedLength:(NSUInteger)expectedLength settings:(JAZLibCompressionSettings)settings;
+
+@property (readonly) NSData *compressedData;
+
+@property (readonly) NSUInteger rawBytesWritten;
+@property (readonly) NSUInteger compressedBytesWritten;
+
+@end
@@ -0,0 +1,449 @@
+/*
+	JAZLibParallelCompressor.m
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JAZLibParallelCompressor.h"
+#import <zlib.h>
+
+
+enum
+{
+	// Same as pigz. Smaller blocks parallelize better but compress worse.
+	kBlockSize					= 128 << 10,
+
+	// The deflate window; this much of the previous block is used as a dictionary.
+	kDictionarySize				= 32 << 10
+};
+
+
+static void SetZLibError(int code, NSString *message, NSError **outError);
+
+
+/*
+	One block of input and, once its semaphore has been signalled, its
+	compressed form. Blocks other than the last end with a sync flush, so
+	they can be concatenated.
+*/
+@interface JAZLibParallelBlock: NSObject
+{
+@public
+	NSData						*_input;
+	NSData						*_dictionary;
+	BOOL						_isLast;
+	JAZLibCompressionSettings	_settings;
+
+	NSMutableData				*_output;
+	uLong						_check;
+	int							_status;
+	NSString					*_message;
+	dispatch_semaphore_t		_done;
+}
+
+- (void) compress;
+
+@end
+
+
+@implementation JAZLibParallelCompressor
+{
+	NSOutputStream				*_stream;
+	NSMutableData				*_outData;		// In-memory mode only.
+	JAZLibCompressionSettings	_settings;
+	JAZLibCompressionMode		_mode;
+
+	NSMutableData				*_current;
+	NSData						*_previous;
+	NSMutableArray				*_pending;
+	NSUInteger					_maxPending;
+
+	uLong						_check;
+	uint64_t					_rawLength;
+	NSUInteger					_compressedLength;
+
+	BOOL						_streamWasClosed;
+	BOOL						_failed;
+	BOOL						_finished;
+}
+
+
+- (id) initWithStream:(NSOutputStream *)stream mode:(JAZLibCompressionMode)mode
+{
+	return [self initWithStream:stream settings:JAZLibDefaultCompressionSettings(mode)];
+}
+
+
+- (id) initWithStream:(NSOutputStream *)stream settings:(JAZLibCompressionSettings)settings
+{
+	if (stream == nil)  return nil;
+
+	if ((self = [self initWithSettings:settings]))
+	{
+		_stream = stream;
+		if (stream.streamStatus == NSStreamStatusNotOpen)
+		{
+			_streamWasClosed = YES;
+			[stream open];
+		}
+	}
+
+	return self;
+}
+
+
+- (id) initWithExpectedLength:(NSUInteger)expectedLength mode:(JAZLibCompressionMode)mode
+{
+	return [self initWithExpectedLength:expectedLength settings:JAZLibDefaultCompressionSettings(mode)];
+}
+
+
+- (id) initWithExpectedLength:(NSUInteger)expectedLength settings:(JAZLibCompressionSettings)settings
+{
+	if ((self = [self initWithSettings:settings]))
+	{
+		_outData = [NSMutableData dataWithCapacity:expectedLength / 2];
+		if (_outData == nil)  return nil;
+	}
+
+	return self;
+}
+
+
+- (id) initWithSettings:(JAZLibCompressionSettings)settings
+{
+	JAZLibCompressionMode mode = settings.mode;
+	NSParameterAssert(mode != kJAZLibCompressionAutoDetect);
+
+	if ((self = [super init]))
+	{
+		_settings = settings;
+		_mode = mode;
+		_current = [NSMutableData dataWithCapacity:kBlockSize];
+		_pending = [NSMutableArray new];
+
+		// Keep every core busy, plus a little slack so they don’t wait for the writer.
+		_maxPending = [NSProcessInfo processInfo].activeProcessorCount * 2;
+
+		_check = (mode == kJAZLibCompressionGZip) ? crc32(0, Z_NULL, 0) : adler32(0, Z_NULL, 0);
+	}
+
+	return self;
+}
+
+
+- (void) dealloc
+{
+	if (!_failed && !_finished)  [self flushWithError:NULL];
+
+	// Don’t leave workers referring to buffers we’re done with.
+	for (JAZLibParallelBlock *block in _pending)
+	{
+		dispatch_semaphore_wait(block->_done, DISPATCH_TIME_FOREVER);
+	}
+
+	if (_streamWasClosed)  [_stream close];
+}
+
+
+- (BOOL) writeOutput:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)outError
+{
+	_compressedLength += length;
+
+	if (_outData != nil)
+	{
+		[_outData appendBytes:bytes length:length];
+		return YES;
+	}
+
+	while (length > 0)
+	{
+		NSInteger status = [_stream write:bytes maxLength:length];
+		if (status > 0)
+		{
+			bytes += status;
+			length -= status;
+		}
+		else
+		{
+			if (outError != NULL)  *outError = _stream.streamError;
+			_failed = YES;
+			return NO;
+		}
+	}
+
+	return YES;
+}
+
+
+- (BOOL) writeHeaderWithError:(NSError **)outError
+{
+	switch (_mode)
+	{
+		case kJAZLibCompressionGZip:
+		{
+			// No file name or time stamp, deflate, OS unknown.
+			static const uint8_t header[] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+			return [self writeOutput:header length:sizeof header error:outError];
+		}
+
+		case kJAZLibCompressionZLib:
+		{
+			// 32 KiB window, deflate, no dictionary, and the FLEVEL hint zlib would use. The check bits make it a multiple of 31.
+			uint8_t header[2] = { 0x78, 0 };
+			int level = _settings.level;
+			if (level < 0)  level = 6;
+			header[1] = (level < 2) ? 0 : (level < 6) ? 1 : (level == 6) ? 2 : 3;
+			header[1] <<= 6;
+			header[1] += 31 - (header[0] * 256 + header[1]) % 31;
+			return [self writeOutput:header length:sizeof header error:outError];
+		}
+
+		case kJAZLibCompressionRawDeflate:
+		case kJAZLibCompressionAutoDetect:
+			break;
+	}
+
+	return YES;
+}
+
+
+- (BOOL) writeTrailerWithError:(NSError **)outError
+{
+	switch (_mode)
+	{
+		case kJAZLibCompressionGZip:
+		{
+			// CRC-32 and length modulo 2^32, little-endian.
+			uint32_t trailer[2] = { CFSwapInt32HostToLittle((uint32_t)_check), CFSwapInt32HostToLittle((uint32_t)_rawLength) };
+			return [self writeOutput:(const uint8_t *)trailer length:sizeof trailer error:outError];
+		}
+
+		case kJAZLibCompressionZLib:
+		{
+			// Adler-32, big-endian.
+			uint32_t trailer = CFSwapInt32HostToBig((uint32_t)_check);
+			return [self writeOutput:(const uint8_t *)&trailer length:sizeof trailer error:outError];
+		}
+
+		case kJAZLibCompressionRawDeflate:
+		case kJAZLibCompressionAutoDetect:
+			break;
+	}
+
+	return YES;
+}
+
+
+- (BOOL) submitCurrentBlockIsLast:(BOOL)isLast error:(NSError **)outError
+{
+	JAZLibParallelBlock *block = [JAZLibParallelBlock new];
+	block->_input = _current;
+	block->_dictionary = _previous;
+	block->_isLast = isLast;
+	block->_settings = _settings;
+	block->_done = dispatch_semaphore_create(0);
+
+	_previous = _current;
+	_current = isLast ? nil : [NSMutableData dataWithCapacity:kBlockSize];
+
+	[_pending addObject:block];
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		[block compress];
+	});
+
+	// Blocks are retired in order. This bounds memory use to a few blocks per core.
+	while (_pending.count > _maxPending)
+	{
+		if (![self retireOldestBlockWithError:outError])  return NO;
+	}
+
+	return YES;
+}
+
+
+- (BOOL) retireOldestBlockWithError:(NSError **)outError
+{
+	JAZLibParallelBlock *block = _pending[0];
+	[_pending removeObjectAtIndex:0];
+	dispatch_semaphore_wait(block->_done, DISPATCH_TIME_FOREVER);
+
+	if (block->_status != Z_OK)
+	{
+		SetZLibError(block->_status, block->_message, outError);
+		_failed = YES;
+		return NO;
+	}
+
+	NSUInteger length = block->_input.length;
+	if (_mode == kJAZLibCompressionGZip)  _check = crc32_combine(_check, block->_check, (z_off_t)length);
+	else  _check = adler32_combine(_check, block->_check, (z_off_t)length);
+	_rawLength += length;
+
+	return [self writeOutput:block->_output.bytes length:block->_output.length error:outError];
+}
+
+
+- (BOOL) write:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)outError
+{
+	NSParameterAssert(bytes != NULL);
+	if (_failed || _finished)  return NO;
+
+	if (_compressedLength == 0 && ![self writeHeaderWithError:outError])  return NO;
+
+	while (length > 0)
+	{
+		NSUInteger toCopy = MIN(length, kBlockSize - _current.length);
+		[_current appendBytes:bytes length:toCopy];
+		bytes += toCopy;
+		length -= toCopy;
+
+		if (_current.length == kBlockSize)
+		{
+			if (![self submitCurrentBlockIsLast:NO error:outError])  return NO;
+		}
+	}
+
+	return YES;
+}
+
+
+- (BOOL) flushWithError:(NSError **)outError
+{
+	if (_failed)  return NO;
+	if (_finished)  return YES;
+
+	if (_compressedLength == 0 && ![self writeHeaderWithError:outError])  return NO;
+
+	// The last block may be empty; it still carries the final deflate block.
+	if (![self submitCurrentBlockIsLast:YES error:outError])  return NO;
+	while (_pending.count > 0)
+	{
+		if (![self retireOldestBlockWithError:outError])  return NO;
+	}
+
+	if (![self writeTrailerWithError:outError])  return NO;
+	_finished = YES;
+	_previous = nil;
+
+	if (_streamWasClosed)
+	{
+		[_stream close];
+		_streamWasClosed = NO;
+	}
+
+	return YES;
+}
+
+
+- (NSData *) compressedData
+{
+	return _outData;
+}
+
+
+- (NSUInteger) rawBytesWritten
+{
+	return (NSUInteger)_rawLength + _current.length;
+}
+
+
+- (NSUInteger) compressedBytesWritten
+{
+	return _compressedLength;
+}
+
+@end
+
+
+@implementation JAZLibParallelBlock
+
+- (void) compress
+{
+	const uint8_t *bytes = _input.bytes;
+	NSUInteger length = _input.length;
+
+	BOOL gzip = (_settings.mode == kJAZLibCompressionGZip);
+	_check = gzip ? crc32(0, Z_NULL, 0) : adler32(0, Z_NULL, 0);
+	if (gzip)  _check = crc32(_check, bytes, (uInt)length);
+	else  _check = adler32(_check, bytes, (uInt)length);
+
+	z_stream zstream = {0};
+	_status = deflateInit2(&zstream, _settings.level, Z_DEFLATED, -15, 9, JAZLibZLibStrategy(_settings.strategy));
+	if (_status != Z_OK)
+	{
+		dispatch_semaphore_signal(_done);
+		return;
+	}
+
+	if (_dictionary != nil)
+	{
+		NSUInteger dictLength = MIN(_dictionary.length, (NSUInteger)kDictionarySize);
+		_status = deflateSetDictionary(&zstream, (const Bytef *)_dictionary.bytes + _dictionary.length - dictLength, (uInt)dictLength);
+	}
+
+	// deflateBound() doesn’t account for the sync flush marker.
+	_output = [NSMutableData dataWithLength:deflateBound(&zstream, length) + 16];
+	zstream.next_in = (Bytef *)bytes;
+	zstream.avail_in = (uInt)length;
+	zstream.next_out = _output.mutableBytes;
+	zstream.avail_out = (uInt)_output.length;
+
+	int flush = _isLast ? Z_FINISH : Z_SYNC_FLUSH;
+	while (_status == Z_OK)
+	{
+		int zstatus = deflate(&zstream, flush);
+		if (zstatus == Z_STREAM_END)  break;
+		if (zstatus != Z_OK)
+		{
+			_status = zstatus;
+			break;
+		}
+		if (!_isLast && zstream.avail_in == 0 && zstream.avail_out != 0)  break;
+
+		// Out of space after all; grow and try again.
+		NSUInteger used = _output.length - zstream.avail_out;
+		_output.length += kBlockSize;
+		zstream.next_out = (Bytef *)_output.mutableBytes + used;
+		zstream.avail_out = (uInt)(_output.length - used);
+	}
+
+	if (_status != Z_OK && zstream.msg != NULL)  _message = [NSString stringWithUTF8String:zstream.msg];
+	_output.length -= zstream.avail_out;
+	deflateEnd(&zstream);
+
+	_dictionary = nil;
+	dispatch_semaphore_signal(_done);
+}
+
+@end
+
+
+static void SetZLibError(int code, NSString *message, NSError **outError)
+{
+	if (outError == NULL || code == Z_OK)  return;
+
+	if (message == nil)  message = [NSString stringWithFormat:@"zlib error %i.", code];
+	*outError = [NSError errorWithDomain:kJAZLibErrorDomain
+									code:code
+								userInfo:@{ NSLocalizedFailureReasonErrorKey: message }];
+}
@@ -2,13 +2,26 @@
 
 #import "JANBTSerialization.h"
 #import "JAZLibCompressor.h"
+#import "JAZLibParallelCompressor.h"
 #import "JANBTTagType.h"
+#import "JANBTPushParser.h"
+#import "JANBTDocument.h"
+#import "JANBTStreamWriter.h"
+#import "JANBTByteSwap.h"
 
 @interface JANBTSerializationTests : XCTestCase
 
 @end
 
 
+// Records reader events as strings, for comparison.
+@interface JANBTEventRecorder: NSObject <JANBTReaderDelegate>
+
+@property (readonly) NSMutableArray *events;
+
+@end
+
+
 @implementation JANBTSerializationTests
 
 - (void)setUp
@@ -156,4 +169,864 @@ static NSString * const byteArrayTestKey = @"byteArrayTest (the first 1000 value
 	XCTAssertEqual([newRoot[@"doubleTest"] ja_NBTType], kJANBTTagDouble);
 }
 
+- (void)testStreamAndBufferParsingAgree
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+
+	NSError *error;
+	NSDictionary *fromData = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+
+	NSInputStream *stream = [NSInputStream inputStreamWithData:testNBT];
+	NSDictionary *fromStream = [JANBTSerialization NBTObjectWithStream:stream rootName:nil options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+
+	XCTAssertEqualObjects(fromData, fromStream);
+
+	// Mutable leaves must not share storage with the parse buffer.
+	NSDictionary *mutable = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:JANBTReadingOptionsMutableLeaves schema:nil error:&error];
+	XCTAssertTrue([mutable[byteArrayTestKey] isKindOfClass:[NSMutableData class]]);
+	XCTAssertEqualObjects(mutable[byteArrayTestKey], self.bigTestBytes);
+}
+
+- (void)testLazyContainers
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+
+	NSError *error;
+	NSDictionary *eager = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:nil error:&error];
+	NSString *rootName;
+	NSDictionary *lazy = [JANBTSerialization NBTObjectWithData:testNBT rootName:&rootName options:JANBTReadingOptionsLazyContainers schema:nil error:&error];
+	XCTAssertNotNil(lazy, @"%@", error);
+	XCTAssertEqualObjects(rootName, @"Level");
+
+	// Members are parsed once and then kept.
+	XCTAssertEqual(lazy[@"nested compound test"], lazy[@"nested compound test"]);
+	XCTAssertEqual([lazy[@"listTest (compound)"] ja_NBTListElementType], kJANBTTagCompound);
+	XCTAssertEqual([lazy[@"listTest (long)"][1] ja_NBTType], kJANBTTagLong);
+	XCTAssertEqualObjects(lazy, eager);
+
+	NSData *reencoded = [JANBTSerialization dataWithNBTObject:lazy rootName:rootName options:0 schema:nil error:&error];
+	XCTAssertEqualObjects([JANBTSerialization NBTObjectWithData:reencoded rootName:nil options:0 schema:nil error:&error], eager);
+
+	// Truncation is still caught up front.
+	NSData *uncompressed = [JAZlibDecompressor inflateData:testNBT mode:kJAZLibCompressionAutoDetect error:&error];
+	NSData *truncated = [uncompressed subdataWithRange:NSMakeRange(0, uncompressed.length - 3)];
+	XCTAssertNil([JANBTSerialization NBTObjectWithData:truncated rootName:nil options:JANBTReadingOptionsUncompressed | JANBTReadingOptionsLazyContainers schema:nil error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationReadError);
+
+	// So is invalid UTF-8 in a nested string value or name, rather than raising when it is read.
+	const uint8_t badString[] = { 10, 0, 0, 10, 0, 1, 'a', 8, 0, 1, 's', 0, 1, 0xFF, 0, 0 };
+	error = nil;
+	XCTAssertNil([JANBTSerialization NBTObjectWithData:[NSData dataWithBytes:badString length:sizeof badString] rootName:nil options:JANBTReadingOptionsUncompressed | JANBTReadingOptionsLazyContainers schema:nil error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationReadError);
+	
+	const uint8_t badName[] = { 10, 0, 0, 10, 0, 1, 'a', 1, 0, 1, 0xC0, 1, 0, 0 };
+	error = nil;
+	XCTAssertNil([JANBTSerialization NBTObjectWithData:[NSData dataWithBytes:badName length:sizeof badName] rootName:nil options:JANBTReadingOptionsUncompressed | JANBTReadingOptionsLazyContainers schema:nil error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationReadError);
+}
+
+- (void)testValidation
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+
+	NSError *error;
+	NSString *rootName;
+	JANBTValidationSummary summary;
+	XCTAssertTrue([JANBTSerialization validateNBTData:testNBT rootName:&rootName options:0 schema:nil summary:&summary error:&error], @"%@", error);
+	XCTAssertEqualObjects(rootName, @"Level");
+	XCTAssertEqual(summary.length, (NSUInteger)1544);
+	XCTAssertEqual(summary.maxDepth, (NSUInteger)3);
+	XCTAssertEqual(summary.tagCounts[kJANBTTagLong], (NSUInteger)8);
+	XCTAssertEqual(summary.tagCounts[kJANBTTagList], (NSUInteger)2);
+	XCTAssertEqual(summary.tagCounts[kJANBTTagCompound], (NSUInteger)6);
+	XCTAssertEqual(summary.tagCounts[kJANBTTagByteArray], (NSUInteger)1);
+
+	// Same verdicts as the parser.
+	XCTAssertTrue([JANBTSerialization validateNBTData:testNBT rootName:NULL options:0 schema:@{ @"shortTest": @"short", @"listTest (long)": @[ @"long" ] } summary:NULL error:&error]);
+	XCTAssertFalse([JANBTSerialization validateNBTData:testNBT rootName:NULL options:0 schema:@{ @"shortTest": @"string" } summary:NULL error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationWrongTypeError);
+
+	rootName = @"Nope";
+	XCTAssertFalse([JANBTSerialization validateNBTData:testNBT rootName:&rootName options:0 schema:nil summary:NULL error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationWrongRootNameError);
+
+	NSData *uncompressed = [JAZlibDecompressor inflateData:testNBT mode:kJAZLibCompressionAutoDetect error:&error];
+	for (NSUInteger length = 0; length < uncompressed.length; length++)
+	{
+		NSData *truncated = [uncompressed subdataWithRange:NSMakeRange(0, length)];
+		XCTAssertFalse([JANBTSerialization validateNBTData:truncated rootName:NULL options:JANBTReadingOptionsUncompressed schema:nil summary:NULL error:&error]);
+	}
+
+	const uint8_t badString[] = { 10, 0, 0, 8, 0, 1, 's', 0, 1, 0xFF, 0 };
+	XCTAssertFalse([JANBTSerialization validateNBTData:[NSData dataWithBytes:badString length:sizeof badString] rootName:NULL options:JANBTReadingOptionsUncompressed schema:nil summary:NULL error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationReadError);
+}
+
+- (void)testTruncatedData
+{
+	NSData *testNBT = [self NBTWithName:@"test"];
+	NSData *truncated = [testNBT subdataWithRange:(NSRange){ 0, testNBT.length - 3 }];
+
+	NSError *error;
+	id root = [JANBTSerialization NBTObjectWithData:truncated rootName:nil options:JANBTReadingOptionsUncompressed schema:nil error:&error];
+	XCTAssertNil(root);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationReadError);
+}
+
+- (void)testKeyPathProjection
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+	NSArray *keyPaths = @[ @"shortTest", @"nested compound test.egg.name", @"listTest (compound)[*].name" ];
+
+	NSError *error;
+	NSDictionary *root = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:nil keyPaths:keyPaths error:&error];
+	XCTAssertNil(error);
+
+	NSDictionary *expected =
+	  @{
+		@"shortTest": @32767,
+		@"nested compound test": @{
+			@"egg": @{
+				@"name": @"Eggbert"
+			}
+		},
+		@"listTest (compound)": @[
+			@{ @"name": @"Compound tag #0" },
+			@{ @"name": @"Compound tag #1" },
+		]
+	};
+	XCTAssertEqualObjects(root, expected);
+
+	// Skipping must also work when streaming.
+	NSInputStream *stream = [NSInputStream inputStreamWithData:testNBT];
+	NSDictionary *fromStream = [JANBTSerialization NBTObjectWithStream:stream rootName:nil options:0 schema:nil keyPaths:keyPaths error:&error];
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(fromStream, expected);
+
+	// A shorter key path selects everything below it.
+	root = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:nil keyPaths:@[ @"nested compound test.ham", @"nested compound test" ] error:&error];
+	XCTAssertEqual([root[@"nested compound test"] count], (NSUInteger)2);
+
+	root = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:nil keyPaths:@[ @"foo[1]" ] error:&error];
+	XCTAssertNil(root);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationInvalidKeyPathError);
+}
+
+- (void)testPatching
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+
+	NSError *error;
+	NSMutableDictionary *expected = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:JANBTReadingOptionsMutableContainers schema:nil error:&error];
+	expected[@"shortTest"] = @1234;
+	expected[@"nested compound test"][@"egg"][@"value"] = @0.25f;
+	[expected[@"nested compound test"] removeObjectForKey:@"ham"];
+	expected[@"listTest (long)"][1] = @42;
+	[expected[@"listTest (long)"] removeObjectAtIndex:3];
+	expected[@"listTest (compound)"][0][@"name"] = @"Renamed";
+	expected[@"newTag"] = @"Added";
+
+	NSDictionary *changes =
+	  @{
+		@"shortTest": @1234,
+		@"nested compound test.egg.value": @0.25f,
+		@"nested compound test.ham": [NSNull null],
+		@"listTest (long)[1]": @42,
+		@"listTest (long)[3]": [NSNull null],
+		@"listTest (compound)[0].name": @"Renamed",
+		@"newTag": @"Added",
+		@"notThere": [NSNull null]
+	};
+	NSData *patched = [JANBTSerialization dataByPatchingNBTData:testNBT readingOptions:0 changes:changes writingOptions:0 schema:nil error:&error];
+	XCTAssertNotNil(patched, @"%@", error);
+
+	NSString *rootName;
+	XCTAssertEqualObjects([JANBTSerialization NBTObjectWithData:patched rootName:&rootName options:0 schema:nil error:&error], expected);
+	XCTAssertEqualObjects(rootName, @"Level");
+
+	// With no changes, the NBT is copied verbatim.
+	NSData *uncompressed = [JAZlibDecompressor inflateData:testNBT mode:kJAZLibCompressionAutoDetect error:&error];
+	XCTAssertEqualObjects([JANBTSerialization dataByPatchingNBTData:uncompressed readingOptions:JANBTReadingOptionsUncompressed changes:@{} writingOptions:JANBTWritingOptionsUncompressed schema:nil error:&error], uncompressed);
+
+	for (NSDictionary *badChanges in @[ @{ @"listTest (long)[5]": @1 }, @{ @"intTest.foo": @1 }, @{ @"missing.foo": @1 }, @{ @"listTest (compound)": @[], @"listTest (compound)[0].name": @"" }, @{ @"listTest (long)[*]": @1 } ])
+	{
+		error = nil;
+		XCTAssertNil([JANBTSerialization dataByPatchingNBTData:testNBT readingOptions:0 changes:badChanges writingOptions:0 schema:nil error:&error], @"%@", badChanges);
+		XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationInvalidKeyPathError, @"%@", badChanges);
+	}
+}
+
+- (void)testStatistics
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+	
+	NSError *error;
+	JANBTValidationSummary summary;
+	XCTAssertTrue([JANBTSerialization validateNBTData:testNBT rootName:nil options:0 schema:nil summary:&summary error:&error]);
+	
+	JANBTStatistics *readStatistics = [JANBTStatistics new];
+	JANBTReadingContext *context = [JANBTReadingContext new];
+	context.statistics = readStatistics;
+	id root = [context NBTObjectWithData:testNBT rootName:nil options:0 schema:nil error:&error];
+	XCTAssertNotNil(root, @"%@", error);
+	
+	// Failures aren’t counted.
+	XCTAssertNil([context NBTObjectWithData:[testNBT subdataWithRange:NSMakeRange(0, 20)] rootName:nil options:0 schema:nil error:&error]);
+	
+	XCTAssertEqual(readStatistics.documentCount, (NSUInteger)1);
+	for (NSUInteger tagID = 1; tagID <= 12; tagID++)
+	{
+		XCTAssertEqual([readStatistics countOfTagsWithID:tagID], summary.tagCounts[tagID], @"tag %lu", (unsigned long)tagID);
+	}
+	XCTAssertEqual(readStatistics.maxDepth, summary.maxDepth);
+	XCTAssertEqual(readStatistics.objectCount, readStatistics.tagCount);
+	XCTAssertEqual(readStatistics.compressedLength, (unsigned long long)testNBT.length);
+	XCTAssertEqual(readStatistics.uncompressedLength, (unsigned long long)summary.length);
+	
+	JANBTStatistics *writeStatistics = [JANBTStatistics new];
+	NSData *data = [JANBTSerialization dataWithNBTObject:root rootName:@"Level" options:0 schema:nil statistics:writeStatistics error:&error];
+	XCTAssertNotNil(data, @"%@", error);
+	XCTAssertEqual(writeStatistics.documentCount, (NSUInteger)1);
+	XCTAssertEqual(writeStatistics.tagCount, readStatistics.tagCount);
+	XCTAssertEqual(writeStatistics.maxDepth, summary.maxDepth);
+	XCTAssertEqual(writeStatistics.objectCount, (NSUInteger)0);
+	XCTAssertEqual(writeStatistics.compressedLength, (unsigned long long)data.length);
+	
+	JANBTStatistics *total = [readStatistics copy];
+	[total addStatistics:writeStatistics];
+	XCTAssertEqual(total.documentCount, (NSUInteger)2);
+	XCTAssertEqual(total.tagCount, readStatistics.tagCount + writeStatistics.tagCount);
+	XCTAssertEqualObjects(total.dictionaryRepresentation[@"documentCount"], @2);
+	
+	[total reset];
+	XCTAssertEqual(total.tagCount, (NSUInteger)0);
+}
+
+- (void)testDocument
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+	
+	NSError *error;
+	JANBTValidationSummary summary;
+	XCTAssertTrue([JANBTSerialization validateNBTData:testNBT rootName:nil options:0 schema:nil summary:&summary error:&error]);
+	id expected = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:nil error:&error];
+	
+	JANBTDocument *document = [JANBTDocument new];
+	XCTAssertTrue([document parseData:testNBT options:0 error:&error], @"%@", error);
+	XCTAssertEqualObjects(document.rootName, @"Level");
+	XCTAssertEqualObjects([document objectAtIndex:0 options:0], expected);
+	
+	// One entry per tag, including list elements.
+	JANBTTape tape = document.tape;
+	NSUInteger tagCount = 0;
+	for (NSUInteger tagID = 1; tagID <= 12; tagID++)  tagCount += summary.tagCounts[tagID];
+	XCTAssertEqual((NSUInteger)tape.count, tagCount);
+	XCTAssertEqual(JANBTTapeNext(tape, 0), tape.count);
+	
+	JANBTTapeIndex longTest = JANBTTapeMemberNamed(tape, 0, "longTest");
+	XCTAssertNotEqual(longTest, (JANBTTapeIndex)kJANBTTapeNotFound);
+	XCTAssertEqual(JANBTTapeIntegerValue(tape, longTest), INT64_MAX);
+	XCTAssertEqual(JANBTTapeMemberNamed(tape, 0, "missing"), (JANBTTapeIndex)kJANBTTapeNotFound);
+	
+	JANBTTapeIndex longs = JANBTTapeMemberNamed(tape, 0, "listTest (long)");
+	XCTAssertEqual(JANBTTapeCount(tape, longs), (uint32_t)5);
+	XCTAssertEqual(JANBTTapeIntegerValue(tape, JANBTTapeElementAtIndex(tape, longs, 4)), (int64_t)15);
+	XCTAssertEqual(JANBTTapeElementAtIndex(tape, longs, 5), (JANBTTapeIndex)kJANBTTapeNotFound);
+	
+	JANBTTapeIndex compounds = JANBTTapeMemberNamed(tape, 0, "listTest (compound)");
+	JANBTTapeIndex second = JANBTTapeElementAtIndex(tape, compounds, 1);
+	JANBTStringRef name = JANBTTapeStringValue(tape, JANBTTapeMemberNamed(tape, second, "name"));
+	XCTAssertEqualObjects(JANBTStringFromStringRef(name), expected[@"listTest (compound)"][1][@"name"]);
+	XCTAssertEqualObjects([document objectAtIndex:compounds options:0], expected[@"listTest (compound)"]);
+	
+	// The document can be reused, and is empty after a failure.
+	NSData *uncompressed = [JANBTSerialization dataWithNBTObject:@{ @"ints": @[ @1, @2 ] } rootName:@"" options:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	XCTAssertTrue([document parseData:uncompressed options:JANBTReadingOptionsUncompressed error:&error], @"%@", error);
+	XCTAssertEqual(document.tape.count, (JANBTTapeIndex)4);
+	XCTAssertEqualObjects([document objectAtIndex:0 options:JANBTReadingOptionsMutableContainers], (@{ @"ints": @[ @1, @2 ] }));
+	
+	XCTAssertFalse([document parseData:[uncompressed subdataWithRange:NSMakeRange(0, uncompressed.length - 1)] options:JANBTReadingOptionsUncompressed error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationReadError);
+	XCTAssertEqual(document.tape.count, (JANBTTapeIndex)0);
+}
+
+- (void)testStreamWriter
+{
+	NSError *error;
+	JANBTStreamWriter *writer = [[JANBTStreamWriter alloc] initForDataWithOptions:0 schema:@{ @"entity": @{ @"x": @"int" } } error:&error];
+	XCTAssertNotNil(writer, @"%@", error);
+
+	const uint8_t bytes[] = { 1, 2, 3, 4, 5 };
+	const int32_t ints[] = { 1, -2, 65536 };
+
+	XCTAssertTrue([writer beginCompoundNamed:@"Level"]);
+	XCTAssertTrue([writer writeShort:-7 named:@"short"]);
+	XCTAssertTrue([writer writeString:@"Ærø" named:@"string"]);
+	XCTAssertTrue([writer beginByteArrayNamed:@"bytes" length:sizeof bytes]);
+	XCTAssertTrue([writer writeByteArrayChunk:bytes length:2]);
+	XCTAssertTrue([writer writeByteArrayChunk:bytes + 2 length:3]);
+	XCTAssertTrue([writer writeIntArray:ints count:3 named:@"ints"]);
+	XCTAssertTrue([writer beginListNamed:@"doubles" count:2]);
+	XCTAssertTrue([writer writeDouble:0.5 named:nil]);
+	XCTAssertTrue([writer writeDouble:-1 named:nil]);
+	XCTAssertTrue([writer endList]);
+	XCTAssertTrue([writer beginListNamed:@"empty" count:0]);
+	XCTAssertTrue([writer endList]);
+	XCTAssertTrue([writer writeObject:@{ @"x": @3 } named:@"entity"]);
+	XCTAssertTrue([writer endCompound]);
+	XCTAssertTrue([writer finishWithError:&error], @"%@", error);
+
+	NSString *rootName;
+	NSDictionary *root = [JANBTSerialization NBTObjectWithData:writer.data rootName:&rootName options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(rootName, @"Level");
+	XCTAssertEqualObjects(root, (@{ @"short": @-7, @"string": @"Ærø", @"bytes": [NSData dataWithBytes:bytes length:sizeof bytes], @"ints": @[ @1, @-2, @65536 ], @"doubles": @[ @0.5, @-1 ], @"empty": @[], @"entity": @{ @"x": @3 } }));
+	XCTAssertEqual([root[@"entity"][@"x"] ja_NBTType], kJANBTTagInt);
+	XCTAssertEqual([root[@"doubles"] ja_NBTListElementType], kJANBTTagDouble);
+
+	// Mistakes stick.
+	writer = [[JANBTStreamWriter alloc] initForDataWithOptions:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	XCTAssertTrue([writer beginCompoundNamed:@""]);
+	XCTAssertTrue([writer beginListNamed:@"list" count:1]);
+	XCTAssertTrue([writer writeInt:1 named:nil]);
+	XCTAssertFalse([writer writeInt:2 named:nil]);
+	XCTAssertEqual(writer.error.code, (NSInteger)kJANBTSerializationWriteError);
+	XCTAssertFalse([writer endList]);
+	XCTAssertFalse([writer finishWithError:&error]);
+	XCTAssertEqual(error, writer.error);
+
+	writer = [[JANBTStreamWriter alloc] initForDataWithOptions:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	XCTAssertTrue([writer beginCompoundNamed:@""]);
+	XCTAssertFalse([writer writeByte:1 named:nil]);
+	writer = [[JANBTStreamWriter alloc] initForDataWithOptions:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	XCTAssertTrue([writer beginCompoundNamed:@""]);
+	XCTAssertFalse([writer finishWithError:&error]);
+	XCTAssertNil(writer.data);
+}
+
+- (void)testPackedArrays
+{
+	int32_t ints[] = { 1, -2, 65536, INT32_MIN };
+	int64_t longs[] = { 1, -2, 1LL << 40, INT64_MIN };
+	JANBTIntArray *intArray = [[JANBTIntArray alloc] initWithValues:ints count:4];
+	JANBTLongArray *longArray = [[JANBTLongArray alloc] initWithValues:longs count:4];
+	XCTAssertEqualObjects(intArray, (@[ @1, @-2, @65536, @(INT32_MIN) ]));
+	XCTAssertEqualObjects(longArray, (@[ @1, @-2, @(1LL << 40), @(INT64_MIN) ]));
+
+	NSError *error;
+	NSData *data = [JANBTSerialization dataWithNBTObject:@{ @"ints": intArray, @"longs": longArray } rootName:@"" options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+
+	NSDictionary *root = [JANBTSerialization NBTObjectWithData:data rootName:nil options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+	XCTAssertTrue([root[@"ints"] isKindOfClass:[JANBTIntArray class]]);
+	XCTAssertTrue([root[@"longs"] isKindOfClass:[JANBTLongArray class]]);
+	XCTAssertEqual(memcmp(((JANBTIntArray *)root[@"ints"]).values, ints, sizeof ints), 0);
+	XCTAssertEqual(memcmp(((JANBTLongArray *)root[@"longs"]).values, longs, sizeof longs), 0);
+
+	// Plain arrays can be written as long arrays through the schema, and read back the same way from a stream.
+	NSDictionary *schema = @{ @"longs": @"longarray" };
+	data = [JANBTSerialization dataWithNBTObject:@{ @"longs": @[ @1, @-2, @(1LL << 40), @(INT64_MIN) ] } rootName:@"" options:0 schema:schema error:&error];
+	XCTAssertNil(error);
+
+	NSInputStream *stream = [NSInputStream inputStreamWithData:data];
+	root = [JANBTSerialization NBTObjectWithStream:stream rootName:nil options:0 schema:schema error:&error];
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(root[@"longs"], longArray);
+	XCTAssertTrue([root[@"longs"] isKindOfClass:[JANBTLongArray class]]);
+}
+
+- (void)testByteSwapArrays
+{
+	// Counts up to two AVX2 vectors of ints plus one, so every vector path is run with and without a remainder.
+	enum { kMaxCount = 17, kGuard = 16, kFill = 0xA5 };
+	struct
+	{
+		size_t size;
+		void (*swap)(void *dst, const void *src, size_t count);
+	} widths[] = { { sizeof (uint32_t), JANBTByteSwapInt32Array }, { sizeof (uint64_t), JANBTByteSwapInt64Array } };
+
+	// Offset by one byte from the buffers’ starts, since neither side needs to be aligned.
+	uint8_t src[1 + kMaxCount * sizeof (uint64_t)];
+	for (size_t i = 0; i < sizeof src; i++)  src[i] = (uint8_t)(i * 37 + 11);
+
+	for (size_t w = 0; w < sizeof widths / sizeof widths[0]; w++)
+	{
+		size_t size = widths[w].size;
+		for (size_t count = 0; count <= kMaxCount; count++)
+		{
+			uint8_t expected[kMaxCount * sizeof (uint64_t)];
+			for (size_t i = 0; i < count; i++)
+			{
+				if (size == sizeof (uint32_t))
+				{
+					uint32_t value = OSReadBigInt32(src + 1, i * size);
+					memcpy(expected + i * size, &value, size);
+				}
+				else
+				{
+					uint64_t value = OSReadBigInt64(src + 1, i * size);
+					memcpy(expected + i * size, &value, size);
+				}
+			}
+
+			uint8_t out[1 + kMaxCount * sizeof (uint64_t) + kGuard];
+			memset(out, kFill, sizeof out);
+			widths[w].swap(out + 1, src + 1, count);
+			XCTAssertEqual(memcmp(out + 1, expected, count * size), 0, @"out of place, size %zu, count %zu", size, count);
+			XCTAssertEqual(out[0], (uint8_t)kFill);
+			for (size_t i = 1 + count * size; i < sizeof out; i++)
+			{
+				XCTAssertEqual(out[i], (uint8_t)kFill, @"wrote past end, size %zu, count %zu", size, count);
+			}
+
+			memset(out, kFill, sizeof out);
+			memcpy(out + 1, src + 1, count * size);
+			widths[w].swap(out + 1, out + 1, count);
+			XCTAssertEqual(memcmp(out + 1, expected, count * size), 0, @"in place, size %zu, count %zu", size, count);
+			XCTAssertEqual(out[0], (uint8_t)kFill);
+			XCTAssertEqual(out[1 + count * size], (uint8_t)kFill);
+		}
+	}
+}
+
+- (void)testCompiledSchema
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+
+	NSError *error;
+	JANBTCompiledSchema *schema = [JANBTCompiledSchema compiledSchemaWithPropertyList:@{ @"shortTest": @"short", @"listTest (long)": @[ @"long" ], @"nested compound test": @{ @"ham": @{ @"name": @"string", @"value": @"float" } } } error:&error];
+	XCTAssertNotNil(schema);
+	XCTAssertNil(error);
+
+	NSDictionary *root = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:schema error:&error];
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(root[@"shortTest"], @32767);
+	XCTAssertEqualObjects(root[@"listTest (long)"], (@[ @11, @12, @13, @14, @15 ]));
+	XCTAssertEqualObjects([root valueForKeyPath:@"nested compound test.ham.name"], @"Hampus");
+
+	// Mismatches are still caught, and the property list form behaves the same.
+	root = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:@{ @"shortTest": @"string" } error:&error];
+	XCTAssertNil(root);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationWrongTypeError);
+
+	error = nil;
+	XCTAssertNil([JANBTCompiledSchema compiledSchemaWithPropertyList:@{ @"list": @[] } error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationInvalidSchemaError);
+
+	error = nil;
+	XCTAssertNil([JANBTSerialization dataWithNBTObject:@{} rootName:@"" options:0 schema:@{ @"x": @"bogus" } error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationInvalidSchemaError);
+
+	// Writing uses the schema’s number types.
+	schema = [JANBTCompiledSchema compiledSchemaWithPropertyList:@{ @"b": @"byte", @"l": @[ @"double" ] } error:NULL];
+	NSData *data = [JANBTSerialization dataWithNBTObject:@{ @"b": @1, @"l": @[ @1, @2 ] } rootName:@"" options:0 schema:schema error:&error];
+	root = [JANBTSerialization NBTObjectWithData:data rootName:nil options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+	XCTAssertEqual([root[@"b"] ja_NBTType], kJANBTTagByte);
+	XCTAssertEqual([root[@"l"] ja_NBTListElementType], kJANBTTagDouble);
+}
+
+- (void)testEncodeToData
+{
+	// Big enough to bypass both the encoder’s staging buffer and the compressor’s input buffer.
+	NSMutableData *blocks = [NSMutableData dataWithLength:1 << 20];
+	uint8_t *bytes = blocks.mutableBytes;
+	for (NSUInteger i = 0; i < blocks.length; i++)  bytes[i] = (uint8_t)(i * 7 + i / 4096);
+
+	NSMutableArray *entities = [NSMutableArray array];
+	for (int i = 0; i < 2000; i++)  [entities addObject:@{ @"id": [NSString stringWithFormat:@"Entity %i ÅÄÖ", i], @"x": @(i * 0.5) }];
+	NSDictionary *root = @{ @"Blocks": blocks, @"Entities": entities, @"Width": @(int16_t)256 };
+
+	NSError *error;
+	NSData *uncompressed = [JANBTSerialization dataWithNBTObject:root rootName:@"Schematic" options:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	XCTAssertNil(error);
+
+	// The data path should produce exactly what the stream path does.
+	NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+	[stream open];
+	NSInteger written = [JANBTSerialization writeNBTObject:root rootName:@"Schematic" toStream:stream options:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	[stream close];
+	XCTAssertEqual((NSUInteger)written, uncompressed.length);
+	XCTAssertEqualObjects([stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey], uncompressed);
+
+	NSData *compressed = [JANBTSerialization dataWithNBTObject:root rootName:@"Schematic" options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+	XCTAssertLessThan(compressed.length, uncompressed.length);
+
+	NSString *rootName;
+	NSDictionary *decoded = [JANBTSerialization NBTObjectWithData:compressed rootName:&rootName options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(rootName, @"Schematic");
+	XCTAssertEqualObjects(decoded, root);
+}
+
+- (void)testParallelCompression
+{
+	// Several blocks, with the last one partial, written in awkward pieces.
+	NSMutableData *raw = [NSMutableData dataWithLength:(3 << 20) + 12345];
+	uint8_t *bytes = raw.mutableBytes;
+	for (NSUInteger i = 0; i < raw.length; i++)  bytes[i] = (uint8_t)(i * 7 + i / 4096 + (i % 13 == 0 ? i >> 3 : 0));
+
+	NSError *error;
+	JAZLibParallelCompressor *compressor = [[JAZLibParallelCompressor alloc] initWithExpectedLength:raw.length mode:kJAZLibCompressionZLib];
+	for (NSUInteger offset = 0; offset < raw.length; offset += 100003)
+	{
+		XCTAssertTrue([compressor write:bytes + offset length:MIN((NSUInteger)100003, raw.length - offset) error:&error]);
+	}
+	XCTAssertTrue([compressor flushWithError:&error]);
+	XCTAssertEqual(compressor.compressedBytesWritten, compressor.compressedData.length);
+	XCTAssertEqualObjects([JAZlibDecompressor inflateData:compressor.compressedData mode:kJAZLibCompressionZLib error:&error], raw);
+	XCTAssertNil(error);
+
+	// Through the NBT API, in both the data and stream paths.
+	NSDictionary *root = @{ @"Blocks": raw, @"Height": @(int16_t)64 };
+	NSData *compressed = [JANBTSerialization dataWithNBTObject:root rootName:@"Schematic" options:JANBTWritingOptionsParallelCompression schema:nil error:&error];
+	XCTAssertNil(error);
+	NSString *rootName;
+	XCTAssertEqualObjects([JANBTSerialization NBTObjectWithData:compressed rootName:&rootName options:0 schema:nil error:&error], root);
+	XCTAssertNil(error);
+
+	NSOutputStream *stream = [NSOutputStream outputStreamToMemory];
+	[stream open];
+	NSInteger written = [JANBTSerialization writeNBTObject:root rootName:@"Schematic" toStream:stream options:JANBTWritingOptionsParallelCompression schema:nil error:&error];
+	[stream close];
+	NSData *streamed = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+	XCTAssertEqual((NSUInteger)written, streamed.length);
+	XCTAssertEqualObjects(streamed, compressed);
+}
+
+- (void)testInflateData
+{
+	NSMutableData *raw = [NSMutableData dataWithLength:300000];
+	uint8_t *bytes = raw.mutableBytes;
+	for (NSUInteger i = 0; i < raw.length; i++)  bytes[i] = (uint8_t)(i / 97 + i % 5);
+
+	NSError *error;
+	for (NSNumber *mode in @[ @(kJAZLibCompressionGZip), @(kJAZLibCompressionZLib) ])
+	{
+		JAZLibCompressor *compressor = [[JAZLibCompressor alloc] initWithExpectedLength:raw.length mode:mode.intValue];
+		XCTAssertTrue([compressor write:bytes length:raw.length error:&error]);
+		XCTAssertTrue([compressor flushWithError:&error]);
+		NSData *compressed = compressor.compressedData;
+
+		NSData *inflated = [JAZlibDecompressor inflateData:compressed mode:kJAZLibCompressionAutoDetect error:&error];
+		XCTAssertEqualObjects(inflated, raw, @"%@ with %@", mode, [JAZlibDecompressor inflateBackendName]);
+
+		// Trailing junk is ignored, even when it makes the gzip length hint wrong.
+		NSMutableData *padded = [compressed mutableCopy];
+		uint8_t junk[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+		[padded appendBytes:junk length:sizeof junk];
+		XCTAssertEqualObjects([JAZlibDecompressor inflateData:padded mode:mode.intValue error:&error], raw);
+
+		error = nil;
+		NSData *truncated = [compressed subdataWithRange:NSMakeRange(0, compressed.length / 2)];
+		XCTAssertNil([JAZlibDecompressor inflateData:truncated mode:mode.intValue error:&error]);
+		XCTAssertEqualObjects(error.domain, kJAZLibErrorDomain);
+	}
+}
+
+- (void)testReadingContext
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+	NSError *error;
+	id expected = [JANBTSerialization NBTObjectWithData:testNBT rootName:NULL options:0 schema:nil error:&error];
+	XCTAssertNotNil(expected);
+
+	// Alternate between payloads of different sizes and formats, so stale state would show.
+	NSData *small = [JANBTSerialization dataWithNBTObject:@{ @"x": @(int32_t)1 } rootName:@"" options:0 schema:nil error:&error];
+	JAZLibCompressor *compressor = [[JAZLibCompressor alloc] initWithExpectedLength:small.length mode:kJAZLibCompressionZLib];
+	NSData *uncompressedSmall = [JAZlibDecompressor inflateData:small mode:kJAZLibCompressionGZip error:&error];
+	XCTAssertTrue([compressor write:uncompressedSmall.bytes length:uncompressedSmall.length error:&error]);
+	XCTAssertTrue([compressor flushWithError:&error]);
+	NSData *zlibSmall = compressor.compressedData;
+
+	JANBTReadingContext *context = [JANBTReadingContext new];
+	for (int i = 0; i < 3; i++)
+	{
+		NSString *rootName;
+		XCTAssertEqualObjects([context NBTObjectWithData:testNBT rootName:&rootName options:0 schema:nil error:&error], expected);
+		XCTAssertEqualObjects(rootName, @"Level");
+		XCTAssertEqualObjects([context NBTObjectWithData:zlibSmall rootName:NULL options:0 schema:nil error:&error], @{ @"x": @(int32_t)1 });
+		XCTAssertEqualObjects([context NBTObjectWithData:small rootName:NULL options:0 schema:nil error:&error], @{ @"x": @(int32_t)1 });
+	}
+
+	// A failure mustn’t poison the context.
+	NSData *truncated = [testNBT subdataWithRange:NSMakeRange(0, testNBT.length / 2)];
+	XCTAssertNil([context NBTObjectWithData:truncated rootName:NULL options:0 schema:nil error:&error]);
+	XCTAssertEqual(error.code, (NSInteger)kJANBTSerializationCompressionError);
+	XCTAssertEqualObjects([context NBTObjectWithData:testNBT rootName:NULL options:0 schema:nil error:&error], expected);
+}
+
+// Counts numbers, and distinct number objects, in a property list.
+static void CountNumbers(id plist, NSUInteger *ioCount, NSHashTable *objects)
+{
+	if ([plist isKindOfClass:[NSNumber class]])
+	{
+		(*ioCount)++;
+		[objects addObject:plist];
+	}
+	else if ([plist isKindOfClass:[NSDictionary class]])
+	{
+		for (id value in [plist allValues])  CountNumbers(value, ioCount, objects);
+	}
+	else if ([plist isKindOfClass:[NSArray class]])
+	{
+		for (id value in plist)  CountNumbers(value, ioCount, objects);
+	}
+}
+
+- (void)testTypedNumberAllocations
+{
+	// Something shaped like an Anvil chunk, read without a schema as regiondump does.
+	NSMutableArray *sections = [NSMutableArray array];
+	for (int y = 0; y < 8; y++)
+	{
+		[sections addObject:@{ @"Y": @(int8_t)y, @"Blocks": [NSMutableData dataWithLength:4096], @"Data": [NSMutableData dataWithLength:2048] }];
+	}
+	NSMutableArray *entities = [NSMutableArray array];
+	for (int i = 0; i < 40; i++)
+	{
+		[entities addObject:@{ @"id": @"Sheep", @"Pos": @[ @(i * 0.37 + 100.5), @64.0, @(i * 1.13 - 200.5) ], @"Motion": @[ @0.0, @(-0.0784), @0.0 ],
+							   @"Rotation": @[ @((float)i * 3.1f), @0.0f ], @"Health": @(int16_t)8, @"Air": @(int16_t)300, @"Fire": @(int16_t)-1,
+							   @"FallDistance": @0.0f, @"OnGround": @(int8_t)1, @"Color": @(int8_t)(i % 16), @"Sheared": @(int8_t)0 }];
+	}
+	NSMutableArray *tileEntities = [NSMutableArray array];
+	for (int i = 0; i < 60; i++)
+	{
+		[tileEntities addObject:@{ @"id": @"Chest", @"x": @(i % 16 + 320), @"y": @(i + 10), @"z": @(i / 4 - 96),
+								   @"Items": @[ @{ @"id": @(int16_t)4, @"Damage": @(int16_t)0, @"Count": @(int8_t)64, @"Slot": @(int8_t)(i % 27) } ] }];
+	}
+	NSDictionary *chunk = @{ @"Level": @{ @"xPos": @20, @"zPos": @-6, @"LastUpdate": @(int64_t)1234567890123, @"TerrainPopulated": @(int8_t)1,
+										  @"Sections": sections, @"Entities": entities, @"TileEntities": tileEntities } };
+
+	NSError *error;
+	NSData *data = [JANBTSerialization dataWithNBTObject:chunk rootName:@"" options:0 schema:nil error:&error];
+	id parsed = [JANBTSerialization NBTObjectWithData:data rootName:NULL options:0 schema:nil error:&error];
+	XCTAssertEqualObjects(parsed, chunk);
+
+	// Before caching, every number was a separate allocation. nbtbench’s synthetic-chunks workload measures actual allocation counts.
+	NSUInteger numberCount = 0;
+	NSHashTable *objects = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+	CountNumbers(parsed, &numberCount, objects);
+	XCTAssertLessThan(objects.count * 2, numberCount);
+}
+
+- (void)testEventReader
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+
+	NSString *rootName;
+	NSError *error;
+	JANBTEventRecorder *fromData = [JANBTEventRecorder new];
+	XCTAssertTrue([JANBTSerialization readNBTData:testNBT rootName:&rootName options:0 delegate:fromData error:&error]);
+	XCTAssertNil(error);
+	XCTAssertEqualObjects(rootName, @"Level");
+
+	JANBTEventRecorder *fromStream = [JANBTEventRecorder new];
+	NSInputStream *stream = [NSInputStream inputStreamWithData:testNBT];
+	XCTAssertTrue([JANBTSerialization readNBTStream:stream rootName:nil options:0 delegate:fromStream error:&error]);
+	XCTAssertNil(error);
+
+	XCTAssertEqualObjects(fromData.events, fromStream.events);
+
+	NSArray *events = fromData.events;
+	XCTAssertEqualObjects(events.firstObject, @"{Level");
+	XCTAssertEqualObjects(events.lastObject, @"}");
+	XCTAssertTrue([events containsObject:@"short shortTest = 32767"]);
+	XCTAssertTrue([events containsObject:@"long longTest = 9223372036854775807"]);
+	XCTAssertTrue([events containsObject:@"string stringTest = HELLO WORLD THIS IS A TEST STRING ÅÄÖ!"]);
+	XCTAssertTrue([events containsObject:@"[listTest (long) 5"]);
+	XCTAssertTrue([events containsObject:@"long (null) = 11"]);
+
+	NSString *bytesEvent = [NSString stringWithFormat:@"bytes %@ = %@", byteArrayTestKey, self.bigTestBytes];
+	XCTAssertTrue([events containsObject:bytesEvent]);
+}
+
+- (void)testEventReaderIntArray
+{
+	NSArray *ints = @[ @1, @-2, @65536 ];
+	ints.NBTListElementType = kJANBTTagIntArrayContent;
+	NSDictionary *root = @{ @"ints": ints };
+
+	NSError *error;
+	NSData *data = [JANBTSerialization dataWithNBTObject:root rootName:@"" options:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	XCTAssertNil(error);
+
+	JANBTEventRecorder *recorder = [JANBTEventRecorder new];
+	XCTAssertTrue([JANBTSerialization readNBTData:data rootName:nil options:JANBTReadingOptionsUncompressed delegate:recorder error:&error]);
+	XCTAssertEqualObjects(recorder.events, (@[ @"{", @"ints ints = 1 -2 65536", @"}" ]));
+}
+
+- (void)testStringRefComparison
+{
+	XCTAssertTrue(JANBTStringRefIsEqualToCString((JANBTStringRef){ "Level", 5 }, "Level"));
+	XCTAssertTrue(JANBTStringRefIsEqualToCString((JANBTStringRef){ "", 0 }, ""));
+	XCTAssertFalse(JANBTStringRefIsEqualToCString((JANBTStringRef){ "Level", 5 }, "Lev"));
+	XCTAssertFalse(JANBTStringRefIsEqualToCString((JANBTStringRef){ "Lev", 3 }, "Level"));
+	XCTAssertFalse(JANBTStringRefIsEqualToCString((JANBTStringRef){ NULL, 0 }, ""));
+
+	// An embedded NUL must not end the comparison early.
+	XCTAssertFalse(JANBTStringRefIsEqualToCString((JANBTStringRef){ "Level\0xyz", 9 }, "Level"));
+}
+
+- (void)testPushParser
+{
+	NSData *testNBT = [self NBTWithName:@"bigtest"];
+	const uint8_t *bytes = testNBT.bytes;
+
+	NSError *error;
+	NSDictionary *expected = [JANBTSerialization NBTObjectWithData:testNBT rootName:nil options:0 schema:nil error:&error];
+	XCTAssertNil(error);
+
+	// Pieces of one byte split every token; seven bytes is out of step with everything.
+	for (NSUInteger pieceLength = 1; pieceLength <= 7; pieceLength += 6)
+	{
+		JANBTPushParser *parser = [[JANBTPushParser alloc] initWithOptions:0 schema:nil error:&error];
+		for (NSUInteger offset = 0; offset < testNBT.length; offset += pieceLength)
+		{
+			XCTAssertNotEqual([parser feedBytes:bytes + offset length:MIN(pieceLength, testNBT.length - offset)], JANBTPushParserFailed, @"%@", parser.error);
+		}
+		XCTAssertEqual([parser finish], JANBTPushParserDone, @"%@", parser.error);
+		XCTAssertEqualObjects(parser.root, expected);
+		XCTAssertEqualObjects(parser.rootName, @"Level");
+	}
+
+	JANBTEventRecorder *fromData = [JANBTEventRecorder new];
+	XCTAssertTrue([JANBTSerialization readNBTData:testNBT rootName:nil options:0 delegate:fromData error:&error]);
+
+	JANBTEventRecorder *pushed = [JANBTEventRecorder new];
+	JANBTPushParser *parser = [[JANBTPushParser alloc] initWithOptions:0 delegate:pushed];
+	for (NSUInteger offset = 0; offset < testNBT.length; offset += 3)
+	{
+		[parser feedBytes:bytes + offset length:MIN((NSUInteger)3, testNBT.length - offset)];
+	}
+	XCTAssertEqual([parser finish], JANBTPushParserDone, @"%@", parser.error);
+	XCTAssertEqualObjects(pushed.events, fromData.events);
+
+	NSData *uncompressed = [JANBTSerialization dataWithNBTObject:expected rootName:@"Level" options:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	parser = [[JANBTPushParser alloc] initWithOptions:JANBTReadingOptionsUncompressed schema:nil error:&error];
+	XCTAssertEqual([parser feedBytes:uncompressed.bytes length:uncompressed.length - 1], JANBTPushParserNeedsMoreData);
+	XCTAssertEqual([parser finish], JANBTPushParserFailed);
+	XCTAssertNil(parser.root);
+	XCTAssertEqual(parser.error.code, (NSInteger)kJANBTSerializationReadError);
+}
+
+- (void)testPushParserLargeArrays
+{
+	// Arrays longer than the preallocation limit, so the buffers have to grow as pieces arrive.
+	NSMutableData *bytes = [NSMutableData dataWithLength:100000];
+	for (NSUInteger i = 0; i < bytes.length; i++)  ((uint8_t *)bytes.mutableBytes)[i] = (uint8_t)(i * 7);
+	NSMutableArray *ints = [NSMutableArray array];
+	for (int32_t i = 0; i < 5000; i++)  [ints addObject:@(i * -3)];
+	ints.NBTListElementType = kJANBTTagIntArrayContent;
+	NSDictionary *root = @{ @"bytes": bytes, @"ints": ints };
+
+	NSError *error;
+	NSData *data = [JANBTSerialization dataWithNBTObject:root rootName:@"" options:JANBTWritingOptionsUncompressed schema:nil error:&error];
+	XCTAssertNotNil(data, @"%@", error);
+
+	JANBTPushParser *parser = [[JANBTPushParser alloc] initWithOptions:JANBTReadingOptionsUncompressed schema:nil error:&error];
+	for (NSUInteger offset = 0; offset < data.length; offset += 4093)
+	{
+		XCTAssertNotEqual([parser feedBytes:(const uint8_t *)data.bytes + offset length:MIN((NSUInteger)4093, data.length - offset)], JANBTPushParserFailed, @"%@", parser.error);
+	}
+	XCTAssertEqual([parser finish], JANBTPushParserDone, @"%@", parser.error);
+	XCTAssertEqualObjects(parser.root, root);
+
+	// A byte array claiming 2 GiB, with no contents. This must fail as truncated rather than allocate for the count.
+	const uint8_t header[] = { 10, 0, 0, 7, 0, 1, 'a', 0x7F, 0xFF, 0xFF, 0xFF };
+	parser = [[JANBTPushParser alloc] initWithOptions:JANBTReadingOptionsUncompressed schema:nil error:&error];
+	XCTAssertEqual([parser feedBytes:header length:sizeof header], JANBTPushParserNeedsMoreData);
+	XCTAssertEqual([parser finish], JANBTPushParserFailed);
+	XCTAssertEqual(parser.error.code, (NSInteger)kJANBTSerializationReadError);
+}
+
+@end
+
+
+@implementation JANBTEventRecorder
+
+- (id) init
+{
+	if ((self = [super init]))
+	{
+		_events = [NSMutableArray new];
+	}
+	return self;
+}
+
+- (void) beginCompoundNamed:(JANBTStringRef)name
+{
+	[_events addObject:[@"{" stringByAppendingString:JANBTStringFromStringRef(name) ?: @""]];
+}
+
+- (void) endCompound
+{
+	[_events addObject:@"}"];
+}
+
+- (void) beginListNamed:(JANBTStringRef)name count:(NSUInteger)count
+{
+	[_events addObject:[NSString stringWithFormat:@"[%@ %lu", JANBTStringFromStringRef(name), (unsigned long)count]];
+}
+
+- (void) endList
+{
+	[_events addObject:@"]"];
+}
+
+- (void) foundByte:(int8_t)value named:(JANBTStringRef)name
+{
+	[_events addObject:[NSString stringWithFormat:@"byte %@ = %i", JANBTStringFromStringRef(name), value]];
+}
+
+- (void) foundShort:(int16_t)value named:(JANBTStringRef)name
+{
+	[_events addObject:[NSString stringWithFormat:@"short %@ = %i", JANBTStringFromStringRef(name), value]];
+}
+
+- (void) foundInt:(int32_t)value named:(JANBTStringRef)name
+{
+	[_events addObject:[NSString stringWithFormat:@"int %@ = %i", JANBTStringFromStringRef(name), value]];
+}
+
+- (void) foundLong:(int64_t)value named:(JANBTStringRef)name
+{
+	[_events addObject:[NSString stringWithFormat:@"long %@ = %lli", JANBTStringFromStringRef(name), value]];
+}
+
+- (void) foundFloat:(float)value named:(JANBTStringRef)name
+{
+	[_events addObject:[NSString stringWithFormat:@"float %@ = %g", JANBTStringFromStringRef(name), value]];
+}
+
+- (void) foundDouble:(double)value named:(JANBTStringRef)name
+{
+	[_events addObject:[NSString stringWithFormat:@"double %@ = %g", JANBTStringFromStringRef(name), value]];
+}
+
+- (void) foundString:(JANBTStringRef)value named:(JANBTStringRef)name
+{
+	[_events addObject:[NSString stringWithFormat:@"string %@ = %@", JANBTStringFromStringRef(name), JANBTStringFromStringRef(value)]];
+}
+
+- (void) foundByteArray:(const uint8_t *)bytes length:(NSUInteger)length named:(JANBTStringRef)name
+{
+	NSData *data = [NSData dataWithBytes:bytes length:length];
+	[_events addObject:[NSString stringWithFormat:@"bytes %@ = %@", JANBTStringFromStringRef(name), data]];
+}
+
+- (void) foundIntArray:(const int32_t *)values count:(NSUInteger)count named:(JANBTStringRef)name
+{
+	NSMutableString *event = [NSMutableString stringWithFormat:@"ints %@ =", JANBTStringFromStringRef(name)];
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		[event appendFormat:@" %i", values[i]];
+	}
+	[_events addObject:event];
+}
+
 @end
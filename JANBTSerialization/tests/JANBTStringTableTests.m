@@ -0,0 +1,82 @@
+#import <XCTest/XCTest.h>
+
+#import "JANBTSerialization.h"
+#import "JANBTStringTable.h"
+
+@interface JANBTStringTableTests : XCTestCase
+
+@end
+
+
+@implementation JANBTStringTableTests
+
+- (void)testIsASCII
+{
+	char bytes[40];
+	for (size_t length = 0; length < sizeof bytes; length++)
+	{
+		memset(bytes, 'a', length);
+		XCTAssertTrue(JANBTIsASCII(bytes, length));
+
+		for (size_t i = 0; i < length; i++)
+		{
+			bytes[i] = (char)0xC3;
+			XCTAssertFalse(JANBTIsASCII(bytes, length));
+			bytes[i] = 'a';
+		}
+	}
+}
+
+- (void)testMakeString
+{
+	XCTAssertEqualObjects(JANBTMakeString("Count", 5), @"Count");
+	XCTAssertEqualObjects(JANBTMakeString("\xC3\x85\xC3\x84\xC3\x96", 6), @"ÅÄÖ");
+	XCTAssertEqualObjects(JANBTMakeString("", 0), @"");
+	XCTAssertNil(JANBTMakeString("\xC3", 1));
+}
+
+- (void)testInterning
+{
+	/*
+		Keys short enough to be tagged pointers are identical whether interned
+		or not, so pointer comparisons need longer ones.
+	*/
+	JANBTStringTable *table = [JANBTStringTable new];
+	NSString *first = [table stringWithUTF8Bytes:"CustomPotionEffects" length:19];
+	NSString *second = [table stringWithUTF8Bytes:"CustomPotionEffects!" length:19];
+	XCTAssertEqualObjects(first, @"CustomPotionEffects");
+	XCTAssertTrue(first == second);
+	XCTAssertTrue(JANBTMakeString("CustomPotionEffects", 19) != first);
+
+	XCTAssertEqualObjects([table stringWithUTF8Bytes:"Dam" length:3], @"Dam");
+	XCTAssertNil([table stringWithUTF8Bytes:"\xC3" length:1]);
+
+	// Force the table to grow, and check earlier entries survive.
+	for (unsigned i = 0; i < 1000; i++)
+	{
+		char key[16];
+		int length = snprintf(key, sizeof key, "key%u", i);
+		XCTAssertEqualObjects([table stringWithUTF8Bytes:key length:(NSUInteger)length], ([NSString stringWithFormat:@"key%u", i]));
+	}
+	XCTAssertTrue([table stringWithUTF8Bytes:"CustomPotionEffects" length:19] == first);
+}
+
+- (void)testParsedKeysAreShared
+{
+	NSData *data = [JANBTSerialization dataWithNBTObject:@{ @"list": @[ @{ @"TileEntityData": @1 }, @{ @"TileEntityData": @2 } ] } rootName:@"" options:0 schema:nil error:NULL];
+
+	NSDictionary *root = [JANBTSerialization NBTObjectWithData:data rootName:nil options:JANBTReadingOptionsSharedKeyTable schema:nil error:NULL];
+	NSString *key0 = [root[@"list"][0] allKeys].firstObject;
+	NSString *key1 = [root[@"list"][1] allKeys].firstObject;
+	XCTAssertEqualObjects(key0, @"TileEntityData");
+	XCTAssertTrue(key0 == key1);
+
+	root = [JANBTSerialization NBTObjectWithData:data rootName:nil options:JANBTReadingOptionsSharedKeyTable schema:nil error:NULL];
+	XCTAssertTrue([root[@"list"][0] allKeys].firstObject == key0);
+
+	// Without the shared table, a separate parse gets its own copy.
+	root = [JANBTSerialization NBTObjectWithData:data rootName:nil options:0 schema:nil error:NULL];
+	XCTAssertTrue([root[@"list"][0] allKeys].firstObject != key0);
+}
+
+@end
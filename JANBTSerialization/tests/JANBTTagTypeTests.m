@@ -2,6 +2,7 @@
 
 #import "JANBTTagType.h"
 #import "JANBTTypedNumbers.h"
+#import "JANBTPackedArrays.h"
 
 @interface JANBTTagTypeTests : XCTestCase
 
@@ -24,6 +25,8 @@
 	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagList));
 	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagCompound));
 	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagIntArray));
+	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagLongArray));
+	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagLongArrayContent));
 	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagIntArrayContent));
 	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagAny));
 	XCTAssertFalse(JANBTIsNumericalTagType(kJANBTTagUnknown));
@@ -37,6 +40,15 @@
 	XCTAssertEqual(@[].NBTType, kJANBTTagList);
 	XCTAssertEqual(@{}.NBTType, kJANBTTagCompound);
 	XCTAssertEqual([NSData data].NBTType, kJANBTTagByteArray);
+	XCTAssertEqual([[JANBTIntArray alloc] initWithValues:NULL count:0].NBTType, kJANBTTagIntArray);
+	XCTAssertEqual([[JANBTLongArray alloc] initWithValues:NULL count:0].NBTType, kJANBTTagLongArray);
+}
+
+- (void)testSchemaType
+{
+	XCTAssertEqual(@"intarray".NBTSchemaType, kJANBTTagIntArray);
+	XCTAssertEqual(@"longarray".NBTSchemaType, kJANBTTagLongArray);
+	XCTAssertEqual(@"bogus".NBTSchemaType, kJANBTTagUnknown);
 }
 
 - (void)testNBTListElementType
@@ -73,6 +85,32 @@
 	XCTAssertEqual(value.NBTType, kJANBTTagFloat);
 }
 
+- (void)testTypedNumberFactories
+{
+	// Small values are shared, but keep their types.
+	XCTAssertEqual(JANBTMakeInteger(3, kJANBTTagByte), JANBTMakeInteger(3, kJANBTTagByte));
+	XCTAssertNotEqual(JANBTMakeInteger(3, kJANBTTagByte), JANBTMakeInteger(3, kJANBTTagInt));
+	XCTAssertEqual(JANBTMakeInteger(-128, kJANBTTagByte).NBTType, kJANBTTagByte);
+	XCTAssertEqual(JANBTMakeInteger(1023, kJANBTTagLong).NBTType, kJANBTTagLong);
+	XCTAssertEqualObjects(JANBTMakeInteger(-128, kJANBTTagShort), @-128);
+
+	// Large values are allocated as before.
+	XCTAssertEqualObjects(JANBTMakeInteger(100000, kJANBTTagInt), @100000);
+	XCTAssertEqual(JANBTMakeInteger(100000, kJANBTTagInt).NBTType, kJANBTTagInt);
+	XCTAssertEqual(JANBTMakeInteger(INT64_MIN, kJANBTTagLong).longLongValue, INT64_MIN);
+
+	XCTAssertEqual(JANBTMakeFloat(0), JANBTMakeFloat(0));
+	XCTAssertEqual(JANBTMakeFloat(-16).NBTType, kJANBTTagFloat);
+	XCTAssertEqualObjects(JANBTMakeFloat(0.25f), @0.25);
+	XCTAssertEqual(JANBTMakeDouble(1).NBTType, kJANBTTagDouble);
+	XCTAssertEqualObjects(JANBTMakeDouble(16.5), @16.5);
+
+	// Negative zero must not collapse to zero.
+	XCTAssertTrue(signbit(JANBTMakeDouble(-0.0).doubleValue));
+	XCTAssertTrue(signbit(JANBTMakeFloat(-0.0f).floatValue));
+	XCTAssertTrue(isnan(JANBTMakeDouble(NAN).doubleValue));
+}
+
 - (void)testNBTDouble
 {
 	NSNumber *value;
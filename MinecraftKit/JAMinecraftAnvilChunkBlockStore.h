@@ -32,6 +32,16 @@
 
 - (id) initWithData:(NSData *)data error:(NSError **)outError;
 
+/*
+	Load a chunk, keeping only the listed keys of the Level compound as
+	metadata (xPos and zPos are always included). Everything else is never
+	converted to objects, which is much cheaper than loading the full chunk
+	when only the blocks are of interest. A nil metadataKeys loads all
+	metadata. Block IDs and data are unpacked straight from the NBT into
+	section storage either way.
+*/
+- (id) initWithData:(NSData *)data metadataKeys:(NSSet *)metadataKeys error:(NSError **)outError;
+
 @property (nonatomic, copy) NSDictionary *metadata;
 
 @end
@@ -25,9 +25,8 @@
 
 #import "JAMinecraftAnvilChunkBlockStore.h"
 #import <JANBTSerialization/JANBTSerialization.h>
-#import "MCKitSchema.h"
+#import <JANBTSerialization/JANBTDocument.h>
 #import "JACollectionHelpers.h"
-#import "JAPropertyListAccessors.h"
 
 
 enum
@@ -40,10 +39,14 @@ enum
 	kGroundLevel			= 63,
 	
 	kSectionBlockIDsSize	= kWidth * kSectionHeight * kLength,
-	kSectionBlockDataSize	= kSectionBlockIDsSize / 2
+	kSectionBlockDataSize	= kSectionBlockIDsSize / 2,
+	kSectionCount			= kNominalHeight / kSectionHeight
 };
 
 
+static NSString * const kThreadDocumentKey = @"se.ayton.jens.minecraftkit JAMinecraftAnvilChunkBlockStore document";
+
+
 static __attribute__((pure)) off_t IndexFromCoordinates(MCGridCoordinates coords)
 {
 	return (coords.y * kLength + coords.z) * kWidth + coords.x;
@@ -66,13 +69,41 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 
 - (MCCell) cellAt:(MCGridCoordinates)location;
 - (void) setCell:(MCCell)cell at:(MCGridCoordinates)location;
-- (BOOL) loadFromInfo:(NSDictionary *)info error:(NSError **)error;
+- (void) loadBlockIDs:(const uint8_t *)blockIDs blockData:(const uint8_t *)blockData;
 
 @property (nonatomic, readonly, getter=isEmpty) bool empty;
 
 @end
 
 
+// Parsing chunks is the hot path when scanning worlds, so each thread keeps a document and reuses its tape.
+static JANBTDocument *ThreadDocument(void)
+{
+	NSMutableDictionary *threadDictionary = NSThread.currentThread.threadDictionary;
+	JANBTDocument *document = threadDictionary[kThreadDocumentKey];
+	if (document == nil)
+	{
+		document = [JANBTDocument new];
+		threadDictionary[kThreadDocumentKey] = document;
+	}
+	return document;
+}
+
+
+// A numerical member of a compound, or 0 if it’s missing.
+static int64_t IntegerMember(JANBTTape tape, JANBTTapeIndex compound, const char *name)
+{
+	JANBTTapeIndex member = JANBTTapeMemberNamed(tape, compound, name);
+	return (member != kJANBTTapeNotFound) ? JANBTTapeIntegerValue(tape, member) : 0;
+}
+
+
+static BOOL IsByteArrayOfLength(JANBTTape tape, JANBTTapeIndex index, uint32_t length)
+{
+	return index != kJANBTTapeNotFound && JANBTTapeType(tape, index) == kJANBTTapeTagByteArray && JANBTTapeCount(tape, index) == length;
+}
+
+
 @implementation JAMinecraftAnvilChunkBlockStore
 {
 	NSMutableArray			*_sections;
@@ -81,6 +112,12 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 
 
 - (id) initWithData:(NSData *)data error:(NSError **)error
+{
+	return [self initWithData:data metadataKeys:nil error:error];
+}
+
+
+- (id) initWithData:(NSData *)data metadataKeys:(NSSet *)metadataKeys error:(NSError **)error
 {
 	if (error != NULL)  *error = nil;
 	
@@ -92,12 +129,13 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 		return nil;
 	}
 	
-	NSDictionary *schema = GetAnvilChunkSchema();
-	NSString *rootName = @"";	// For some reason, chunks have an empty root name and contain a single compound named "Level".
-	
-	NSDictionary *dict = [JANBTSerialization NBTObjectWithData:data rootName:&rootName options:0 schema:schema error:error];
-	dict = dict[@"Level"];
-	if (dict == nil)
+	/*
+		Chunks are parsed into a tape, and the sections’ Blocks and Data are
+		unpacked straight from the inflated buffer into section storage.
+		Only metadata and tile entities are turned into objects.
+	*/
+	JANBTDocument *document = ThreadDocument();
+	if (![document parseData:data options:0 error:error])
 	{
 		if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
 														 code:kJABlockStoreErrorWrongFileFormat
@@ -105,38 +143,72 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 		return nil;
 	}
 	
+	// For some reason, chunks have an empty root name and contain a single compound named "Level".
+	JANBTTape tape = document.tape;
+	JANBTTapeIndex level = JANBTTapeMemberNamed(tape, 0, "Level");
+	if (level == kJANBTTapeNotFound || JANBTTapeType(tape, level) != kJANBTTapeTagCompound)
+	{
+		if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+														 code:kJABlockStoreErrorWrongFileFormat
+													 userInfo:nil];
+		return nil;
+	}
+	
 	[self beginBulkUpdate];
 	
+	NSMutableDictionary *metadata = [NSMutableDictionary dictionary];
+	JANBTTapeIndex sections = kJANBTTapeNotFound;
+	JANBTTapeIndex tileEntities = kJANBTTapeNotFound;
+	
+	JANBTTapeIndex member = JANBTTapeFirstChild(tape, level);
+	for (uint32_t i = 0; i < JANBTTapeCount(tape, level); i++, member = JANBTTapeNext(tape, member))
+	{
+		JANBTStringRef name = JANBTTapeName(tape, member);
+		if (JANBTStringRefIsEqualToCString(name, "Sections"))  sections = member;
+		else if (JANBTStringRefIsEqualToCString(name, "TileEntities"))  tileEntities = member;
+		else if (!JANBTStringRefIsEqualToCString(name, "HeightMap"))
+		{
+			NSString *key = JANBTStringFromStringRef(name);
+			if (metadataKeys == nil || [metadataKeys containsObject:key] || [key isEqualToString:@"xPos"] || [key isEqualToString:@"zPos"])
+			{
+				metadata[key] = [document objectAtIndex:member options:0];
+			}
+		}
+	}
+	
 	// Load sections.
-	NSArray *sections = dict[@"Sections"];
-	for (NSDictionary *sectionInfo in sections)
+	if (sections != kJANBTTapeNotFound && JANBTTapeType(tape, sections) == kJANBTTapeTagList)
 	{
-		NSUInteger yIndex = [sectionInfo[@"Y"] intValue];
-		if (![[self sectionAtIndex:yIndex] loadFromInfo:sectionInfo error:error])
+		JANBTTapeIndex section = JANBTTapeFirstChild(tape, sections);
+		for (uint32_t i = 0; i < JANBTTapeCount(tape, sections); i++, section = JANBTTapeNext(tape, section))
 		{
-			return nil;
+			if (![self loadSectionAtIndex:section ofTape:tape error:error])  return nil;
 		}
 	}
 	
 	// Load tile entities.
-	NSArray *serializedEntities = dict[@"TileEntities"];
-	_tileEntities = [NSMutableDictionary dictionaryWithCapacity:serializedEntities.count];
-	
-	NSInteger baseX = [dict ja_integerForKey:@"xPos"] * 16;
-	NSInteger baseZ = [dict ja_integerForKey:@"zPos"] * 16;
-	
+	NSInteger baseX = (NSInteger)IntegerMember(tape, level, "xPos") * kWidth;
+	NSInteger baseZ = (NSInteger)IntegerMember(tape, level, "zPos") * kLength;
 	NSSet *coordKeys = [NSSet setWithObjects:@"x", @"y", @"z", nil];
-	[serializedEntities enumerateObjectsUsingBlock:^(id entityDef, NSUInteger idx, BOOL *stop)
-	 {
-		 NSInteger x = [entityDef ja_integerForKey:@"x"] - baseX;
-		 NSInteger y = [entityDef ja_integerForKey:@"y"];
-		 NSInteger z = [entityDef ja_integerForKey:@"z"] - baseZ;
-		 entityDef = [entityDef ja_dictionaryByRemovingObjectsForKeys:coordKeys];
-		 
-		 [_tileEntities setObject:entityDef forKey:KeyForCoords(x, y, z)];
-	 }];
 	
-	self.metadata = [dict ja_dictionaryByRemovingObjectsForKeys:[NSSet setWithObjects:@"Sections", @"TileEntities", @"HeightMap", nil]];
+	_tileEntities = [NSMutableDictionary dictionary];
+	if (tileEntities != kJANBTTapeNotFound && JANBTTapeType(tape, tileEntities) == kJANBTTapeTagList)
+	{
+		JANBTTapeIndex entity = JANBTTapeFirstChild(tape, tileEntities);
+		for (uint32_t i = 0; i < JANBTTapeCount(tape, tileEntities); i++, entity = JANBTTapeNext(tape, entity))
+		{
+			if (JANBTTapeType(tape, entity) != kJANBTTapeTagCompound)  continue;
+			
+			NSInteger x = (NSInteger)IntegerMember(tape, entity, "x") - baseX;
+			NSInteger y = (NSInteger)IntegerMember(tape, entity, "y");
+			NSInteger z = (NSInteger)IntegerMember(tape, entity, "z") - baseZ;
+			NSDictionary *entityDef = [[document objectAtIndex:entity options:0] ja_dictionaryByRemovingObjectsForKeys:coordKeys];
+			
+			[_tileEntities setObject:entityDef forKey:KeyForCoords(x, y, z)];
+		}
+	}
+	
+	self.metadata = metadata;
 	
 	[self endBulkUpdate];
 	[self noteChangeInExtents:self.extents];
@@ -145,6 +217,44 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 }
 
 
+- (BOOL) loadSectionAtIndex:(JANBTTapeIndex)section ofTape:(JANBTTape)tape error:(NSError **)error
+{
+	if (JANBTTapeType(tape, section) != kJANBTTapeTagCompound)  return YES;
+	
+	if (JANBTTapeMemberNamed(tape, section, "Add") != kJANBTTapeNotFound)
+	{
+		// Extended block IDs are not supported (by Minecraft either, at the time of writing).
+		if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+														 code:kJABlockStoreErrorExtendedBlockIDsNotSupported
+													 userInfo:nil];
+		return NO;
+	}
+	
+	int64_t yIndex = IntegerMember(tape, section, "Y");
+	if (yIndex < 0 || yIndex >= kSectionCount)
+	{
+		if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+														 code:kJABlockStoreErrorWrongFileFormat
+													 userInfo:nil];
+		return NO;
+	}
+	
+	JANBTTapeIndex blockIDs = JANBTTapeMemberNamed(tape, section, "Blocks");
+	JANBTTapeIndex blockData = JANBTTapeMemberNamed(tape, section, "Data");
+	if (!IsByteArrayOfLength(tape, blockIDs, kSectionBlockIDsSize) || !IsByteArrayOfLength(tape, blockData, kSectionBlockDataSize))
+	{
+		if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+														 code:kJABlockStoreErrorTruncatedData
+													 userInfo:nil];
+		return NO;
+	}
+	
+	[[self sectionAtIndex:(NSUInteger)yIndex] loadBlockIDs:JANBTTapeByteArrayBytes(tape, blockIDs)
+												 blockData:JANBTTapeByteArrayBytes(tape, blockData)];
+	return YES;
+}
+
+
 - (NSInteger) minimumLayer
 {
 	return 0;
@@ -283,41 +393,19 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 }
 
 
-- (BOOL) loadFromInfo:(NSDictionary *)info error:(NSError **)error
+- (void) loadBlockIDs:(const uint8_t *)blockIDs blockData:(const uint8_t *)blockData
 {
 	if (_storage == nil)  [self createStorage];
 	
-	if (info[@"Add"] != nil)
-	{
-		// Extended block IDs are not supported (by Minecraft either, at the time of writing).
-		if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
-														 code:kJABlockStoreErrorExtendedBlockIDsNotSupported
-													 userInfo:nil];
-		return NO;
-	}
-	
-	NSData *blockIDs = info[@"Blocks"];
-	NSData *blockData = info[@"Data"];
-	if (blockIDs.length != kSectionBlockIDsSize || blockData.length != kSectionBlockDataSize)
-	{
-		if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
-														 code:kJABlockStoreErrorTruncatedData
-													 userInfo:nil];
-		return NO;
-	}
-	
-	const unsigned char *blockIDBytes = blockIDs.bytes;
-	const unsigned char *blockDataBytes = blockData.bytes;
+	// Data is packed two blocks to a byte, low nibble first.
 	for (NSUInteger i = 0; i < kSectionBlockIDsSize; i += 2)
 	{
-		unsigned char data = blockDataBytes[i / 2];
-		_storage[i].blockID = blockIDBytes[i];
-		_storage[i].blockData = data >> 4;
-		_storage[i + 1].blockID = blockIDBytes[i + 1];
-		_storage[i + 1].blockData = data * 0x0F;
+		uint8_t data = blockData[i / 2];
+		_storage[i].blockID = blockIDs[i];
+		_storage[i].blockData = data & 0x0F;
+		_storage[i + 1].blockID = blockIDs[i + 1];
+		_storage[i + 1].blockData = data >> 4;
 	}
-	
-	return YES;
 }
 
 
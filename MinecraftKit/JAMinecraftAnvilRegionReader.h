@@ -47,4 +47,7 @@
 - (JAMinecraftAnvilChunkBlockStore *) chunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
 - (JAMinecraftAnvilChunkBlockStore *) chunkAtLocalX:(uint8_t)x localZ:(uint8_t)z error:(NSError **)error;
 
+// Retrieve chunk, loading only the specified metadata. See -[JAMinecraftAnvilChunkBlockStore initWithData:metadataKeys:error:].
+- (JAMinecraftAnvilChunkBlockStore *) chunkAtLocalX:(uint8_t)x localZ:(uint8_t)z metadataKeys:(NSSet *)metadataKeys error:(NSError **)error;
+
 @end
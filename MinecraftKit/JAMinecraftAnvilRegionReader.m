@@ -25,36 +25,14 @@
 
 #import "JAMinecraftAnvilRegionReader.h"
 #import "JAMinecraftAnvilChunkBlockStore.h"
-
-
-enum
-{
-	kChunksPerRegionSide			= 32,
-	kChunksPerRegion				= kChunksPerRegionSide * kChunksPerRegionSide,
-	kHeaderBytesPerChunk			= 8,
-	kHeaderSize						= kHeaderBytesPerChunk * kChunksPerRegion,
-	kSectorSize						= 4096,
-	kChunkHeaderSize				= 5
-};
-
-
-enum
-{
-	kChunkCompressionModeGZip		= 1,
-	kChunkCompressionModeZLib		= 2
-};
-
-
-static inline uint16_t ChunkIndexFromLocalCoords(uint16_t x, uint16_t z)
-{
-	return z * kChunksPerRegionSide + x;
-}
+#import "JAMinecraftRegionFormat.h"
 
 
 @implementation JAMinecraftAnvilRegionReader
 {
 	NSData					*_regionData;
 	uint32_t				_offsets[kChunksPerRegion];
+	uint32_t				_timestamps[kChunksPerRegion];
 }
 
 - (id) initWithData:(NSData *)data
@@ -89,18 +67,23 @@ static inline uint16_t ChunkIndexFromLocalCoords(uint16_t x, uint16_t z)
 		The header consists of two arrays of kChunksPerRegion entries each.
 		Entries in the first array are consist of a big-endian 24-bit offset
 		and 8-bit size, measured in 4 KiB sectors. The second array contains
-		big-endian 32-bit time stamps, which we currently don’t care about.
+		big-endian 32-bit time stamps, in seconds since 1970.
 	*/
 	
 	const uint32_t *header = (const uint32_t *)_regionData.bytes;
 	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
 	{
 		uint32_t offset = *header++;
-		offset = ntohl(offset) >> 8;
+		offset = LocationOffset(ntohl(offset));
 		
 		_offsets[idx] = offset;
 	}
 	
+	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+	{
+		_timestamps[idx] = ntohl(*header++);
+	}
+	
 	return YES;
 }
 
@@ -113,6 +96,15 @@ static inline uint16_t ChunkIndexFromLocalCoords(uint16_t x, uint16_t z)
 }
 
 
+- (uint32_t) timestampForChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	
+	uint16_t idx = ChunkIndexFromLocalCoords(x, z);
+	return (_offsets[idx] != 0) ? _timestamps[idx] : 0;
+}
+
+
 - (JAMinecraftAnvilChunkBlockStore *) chunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
 {
 	return [self chunkAtLocalX:x localZ:z error:NULL];
@@ -120,10 +112,16 @@ static inline uint16_t ChunkIndexFromLocalCoords(uint16_t x, uint16_t z)
 
 
 - (JAMinecraftAnvilChunkBlockStore *) chunkAtLocalX:(uint8_t)x localZ:(uint8_t)z error:(NSError **)error
+{
+	return [self chunkAtLocalX:x localZ:z metadataKeys:nil error:error];
+}
+
+
+- (JAMinecraftAnvilChunkBlockStore *) chunkAtLocalX:(uint8_t)x localZ:(uint8_t)z metadataKeys:(NSSet *)metadataKeys error:(NSError **)error
 {
 	NSData *data = [self chunkDataAtLocalX:x localZ:z error:error];
 	if (data == nil)  return nil;
-	return [[JAMinecraftAnvilChunkBlockStore alloc] initWithData:data error:error];
+	return [[JAMinecraftAnvilChunkBlockStore alloc] initWithData:data metadataKeys:metadataKeys error:error];
 }
 
 
@@ -136,11 +134,14 @@ static inline uint16_t ChunkIndexFromLocalCoords(uint16_t x, uint16_t z)
 	
 	offset *= kSectorSize;
 	NSUInteger totalSize = _regionData.length;
-	if (offset + kChunkHeaderSize >= totalSize)  return nil;	// Corrupt region file; chunk is out of bounds.
+	if (offset + kChunkHeaderSize > totalSize)  return nil;	// Corrupt region file; chunk is out of bounds.
 	
+	// The stored length counts the compression mode byte, which is part of kChunkHeaderSize.
 	const uint8_t *bytes = _regionData.bytes + offset;
 	NSUInteger length = htonl(*(uint32_t *)bytes);
-	if (offset + kChunkHeaderSize + length >= totalSize)  return nil;	// Corrupt region file; chunk is out of bounds.
+	if (length == 0)  return nil;	// Corrupt region file; no room for the compression mode.
+	length -= 1;
+	if (offset + kChunkHeaderSize + length > totalSize)  return nil;	// Corrupt region file; chunk is out of bounds.
 	
 	// JAZLibCompressionMode compressionMode;
 	switch (bytes[4])
@@ -162,4 +163,10 @@ static inline uint16_t ChunkIndexFromLocalCoords(uint16_t x, uint16_t z)
 	return [_regionData subdataWithRange:(NSRange){ offset + kChunkHeaderSize, length }];
 }
 
+
+- (void) enumerateChunksConcurrentlyWithOptions:(JAMinecraftChunkEnumerationOptions)options usingBlock:(JAMinecraftChunkEnumerationBlock)block
+{
+	JAMinecraftEnumerateRegionChunks(self, options, block);
+}
+
 @end
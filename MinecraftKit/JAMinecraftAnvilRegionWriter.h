@@ -0,0 +1,77 @@
+/*
+	JAMinecraftAnvilRegionWriter.h
+	
+	Updates Minecraft Anvil region files in place.
+	
+	Changes are staged in memory and written together by -commitWithError:.
+	New chunk data only goes into sectors that no chunk in the file’s
+	current header uses, either gaps left by earlier commits or the end of
+	the file, so the old chunks stay intact until the new header has been
+	written. The header itself is first written to a journal file next to
+	the region, so a crash while it is being replaced is repaired the next
+	time the region is opened for writing. Sectors freed by a commit can be
+	reused by the next one.
+	
+	A region writer is not thread safe, and a region should only be open in
+	one writer at a time. Region readers that are already open don’t see
+	committed changes.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+
+@interface JAMinecraftAnvilRegionWriter: NSObject
+
+// Open a region file, creating it if it doesn’t exist.
++ (id) regionWriterWithURL:(NSURL *)regionFileURL error:(NSError **)error;
+- (id) initWithURL:(NSURL *)regionFileURL error:(NSError **)error;
+
+/*
+	Stage a new version of a chunk. data is a compressed NBT, as returned by
+	-[JAMinecraftRegionReader chunkDataAtLocalX:localZ:error:]; zlib and gzip
+	are both accepted. The chunk’s timestamp is set to the current time
+	unless specified. Chunks can be at most 255 sectors (about 1 MiB).
+*/
+- (void) setChunkData:(NSData *)data atLocalX:(uint8_t)x localZ:(uint8_t)z;
+- (void) setChunkData:(NSData *)data timestamp:(uint32_t)timestamp atLocalX:(uint8_t)x localZ:(uint8_t)z;
+
+- (void) removeChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+
+// These reflect staged changes.
+- (BOOL) hasChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+- (uint32_t) timestampForChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+
+@property (readonly) NSUInteger pendingChangeCount;
+
+/*
+	Write all staged changes: chunk data in as few writes as possible,
+	followed by one sync, then the header. On failure, the file still has
+	its previous contents and the changes remain staged.
+*/
+- (BOOL) commitWithError:(NSError **)error;
+
+// Discard staged changes.
+- (void) discardChanges;
+
+@end
@@ -0,0 +1,554 @@
+/*
+	JAMinecraftAnvilRegionWriter.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JAMinecraftAnvilRegionWriter.h"
+#import "JAMinecraftBlockStore.h"
+#import "JAMinecraftRegionFormat.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <zlib.h>
+
+
+enum
+{
+	kHeaderSectors					= kHeaderSize / kSectorSize,
+	kMaxChunkSectors				= 255,
+	kJournalSize					= kHeaderSize + sizeof (uint32_t)
+};
+
+
+// A chunk to be written, in the order it goes in the file.
+typedef struct
+{
+	uint32_t				sector;
+	uint32_t				sectorCount;
+	uint8_t					header[kChunkHeaderSize];	// Big-endian length, including the compression mode byte, then the mode.
+	const void				*bytes;
+	size_t					length;
+} ChunkWrite;
+
+
+static NSError *POSIXError(int code);
+static int FullSync(int fd);
+static void EncodeHeader(uint8_t *bytes, const uint32_t *locations, const uint32_t *timestamps);
+static uint32_t AllocateSectors(NSMutableData *usedSectors, uint32_t count);
+static BOOL WriteChunks(int fd, ChunkWrite *writes, NSUInteger count, int *outErrno);
+static int CompareChunkWrites(const void *a, const void *b);
+
+
+@implementation JAMinecraftAnvilRegionWriter
+{
+	NSString				*_path;
+	int						_fd;
+	
+	// The committed header, in host byte order.
+	uint32_t				_locations[kChunksPerRegion];
+	uint32_t				_timestamps[kChunksPerRegion];
+	
+	// One byte per sector in the file, non-zero if used by the header or a chunk in it.
+	NSMutableData			*_usedSectors;
+	
+	// Chunk index → NSData, or NSNull for removal.
+	NSMutableDictionary		*_pending;
+	uint32_t				_pendingTimestamps[kChunksPerRegion];
+}
+
+
++ (id) regionWriterWithURL:(NSURL *)regionFileURL error:(NSError **)error
+{
+	return [[self alloc] initWithURL:regionFileURL error:error];
+}
+
+
+- (id) initWithURL:(NSURL *)regionFileURL error:(NSError **)error
+{
+	NSParameterAssert(regionFileURL.isFileURL);
+	
+	if (!(self = [super init]))  return nil;
+	
+	_path = regionFileURL.path;
+	_pending = [NSMutableDictionary dictionary];
+	
+	_fd = open(_path.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+	if (_fd < 0)
+	{
+		if (error != NULL)  *error = POSIXError(errno);
+		return nil;
+	}
+	
+	if (![self recoverJournalWithError:error])  return nil;
+	if (![self readHeaderWithError:error])  return nil;
+	
+	return self;
+}
+
+
+- (void) dealloc
+{
+	if (_fd >= 0)  close(_fd);
+}
+
+
+- (NSString *) journalPath
+{
+	return [_path stringByAppendingString:@".journal"];
+}
+
+
+/*
+	A journal is left behind if a commit was interrupted after the new
+	header was synced but before it was written to the region, or before
+	the journal was removed. If it’s complete, it’s the header to use;
+	otherwise, the region’s own header hasn’t been touched.
+*/
+- (BOOL) recoverJournalWithError:(NSError **)error
+{
+	const char *journalPath = self.journalPath.fileSystemRepresentation;
+	int journal = open(journalPath, O_RDONLY);
+	if (journal < 0)
+	{
+		if (errno == ENOENT)  return YES;
+		if (error != NULL)  *error = POSIXError(errno);
+		return NO;
+	}
+	
+	uint8_t bytes[kJournalSize];
+	ssize_t length = pread(journal, bytes, kJournalSize, 0);
+	close(journal);
+	
+	if (length == kJournalSize)
+	{
+		uint32_t checksum = OSReadBigInt32(bytes, kHeaderSize);
+		if (checksum == crc32(0, bytes, kHeaderSize))
+		{
+			if (pwrite(_fd, bytes, kHeaderSize, 0) != kHeaderSize || FullSync(_fd) != 0)
+			{
+				if (error != NULL)  *error = POSIXError(errno);
+				return NO;
+			}
+		}
+	}
+	
+	unlink(journalPath);
+	return YES;
+}
+
+
+- (BOOL) readHeaderWithError:(NSError **)error
+{
+	struct stat info;
+	if (fstat(_fd, &info) != 0)
+	{
+		if (error != NULL)  *error = POSIXError(errno);
+		return NO;
+	}
+	
+	// A new file gets its header on the first commit.
+	off_t fileSize = info.st_size;
+	if (fileSize != 0)
+	{
+		uint8_t header[kHeaderSize];
+		if (fileSize < kHeaderSize || pread(_fd, header, kHeaderSize, 0) != kHeaderSize)
+		{
+			if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+															 code:kJABlockStoreErrorTruncatedData
+														 userInfo:nil];
+			return NO;
+		}
+		
+		for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+		{
+			_locations[idx] = OSReadBigInt32(header, idx * sizeof (uint32_t));
+			_timestamps[idx] = OSReadBigInt32(header, kHeaderSize / 2 + idx * sizeof (uint32_t));
+		}
+	}
+	
+	NSUInteger sectorCount = MAX((NSUInteger)((fileSize + kSectorSize - 1) / kSectorSize), (NSUInteger)kHeaderSectors);
+	[self rebuildUsedSectorsWithCount:sectorCount];
+	return YES;
+}
+
+
+/*
+	Mark the sectors used by the header and the committed chunks. Entries
+	that overlap the header or run past the end of the file can’t be read
+	anyway, and are dropped so that their sectors can’t be handed out
+	twice.
+*/
+- (void) rebuildUsedSectorsWithCount:(NSUInteger)sectorCount
+{
+	_usedSectors = [NSMutableData dataWithLength:sectorCount];
+	uint8_t *used = _usedSectors.mutableBytes;
+	memset(used, 1, kHeaderSectors);
+	
+	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+	{
+		uint32_t offset = LocationOffset(_locations[idx]);
+		uint32_t count = LocationCount(_locations[idx]);
+		if (offset < kHeaderSectors || count == 0 || offset + count > sectorCount)
+		{
+			_locations[idx] = 0;
+			continue;
+		}
+		memset(used + offset, 1, count);
+	}
+}
+
+
+- (void) setChunkData:(NSData *)data atLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	[self setChunkData:data timestamp:(uint32_t)time(NULL) atLocalX:x localZ:z];
+}
+
+
+- (void) setChunkData:(NSData *)data timestamp:(uint32_t)timestamp atLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide && data != nil);
+	
+	uint16_t idx = ChunkIndexFromLocalCoords(x, z);
+	_pending[@(idx)] = [data copy];
+	_pendingTimestamps[idx] = timestamp;
+}
+
+
+- (void) removeChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	
+	uint16_t idx = ChunkIndexFromLocalCoords(x, z);
+	_pending[@(idx)] = [NSNull null];
+	_pendingTimestamps[idx] = 0;
+}
+
+
+- (BOOL) hasChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	
+	uint16_t idx = ChunkIndexFromLocalCoords(x, z);
+	id pending = _pending[@(idx)];
+	if (pending != nil)  return pending != [NSNull null];
+	return _locations[idx] != 0;
+}
+
+
+- (uint32_t) timestampForChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	
+	uint16_t idx = ChunkIndexFromLocalCoords(x, z);
+	if (_pending[@(idx)] != nil)  return _pendingTimestamps[idx];
+	return _timestamps[idx];
+}
+
+
+- (NSUInteger) pendingChangeCount
+{
+	return _pending.count;
+}
+
+
+- (void) discardChanges
+{
+	[_pending removeAllObjects];
+}
+
+
+- (BOOL) commitWithError:(NSError **)error
+{
+	if (_pending.count == 0)  return YES;
+	
+	uint32_t locations[kChunksPerRegion];
+	uint32_t timestamps[kChunksPerRegion];
+	memcpy(locations, _locations, sizeof locations);
+	memcpy(timestamps, _timestamps, sizeof timestamps);
+	
+	/*
+		Allocate sectors for the new chunks. Sectors used by the committed
+		header stay reserved, even for chunks being replaced or removed,
+		since that header remains in effect until this commit is done.
+	*/
+	NSMutableData *usedSectors = [_usedSectors mutableCopy];
+	NSMutableData *writeBuffer = [NSMutableData dataWithLength:_pending.count * sizeof (ChunkWrite)];
+	ChunkWrite *writes = writeBuffer.mutableBytes;
+	NSUInteger writeCount = 0;
+	
+	NSArray *indices = [_pending.allKeys sortedArrayUsingSelector:@selector(compare:)];
+	for (NSNumber *key in indices)
+	{
+		uint16_t idx = key.unsignedShortValue;
+		NSData *data = _pending[key];
+		timestamps[idx] = _pendingTimestamps[idx];
+		
+		if ((id)data == [NSNull null])
+		{
+			locations[idx] = 0;
+			continue;
+		}
+		
+		NSUInteger length = data.length;
+		NSUInteger sectorCount = (length + kChunkHeaderSize + kSectorSize - 1) / kSectorSize;
+		if (length == 0 || sectorCount > kMaxChunkSectors)
+		{
+			if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+															 code:(length == 0) ? kJABlockStoreErrorEmptyDocument : kJABlockStoreErrorDocumentTooLarge
+														 userInfo:nil];
+			return NO;
+		}
+		
+		uint32_t sector = AllocateSectors(usedSectors, (uint32_t)sectorCount);
+		if (sector + sectorCount > 0xFFFFFF + 1)
+		{
+			// The region is full; sector offsets are 24 bits.
+			if (error != NULL)  *error = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+															 code:kJABlockStoreErrorDocumentTooLarge
+														 userInfo:nil];
+			return NO;
+		}
+		locations[idx] = sector << 8 | (uint32_t)sectorCount;
+		
+		const uint8_t *bytes = data.bytes;
+		ChunkWrite *write = &writes[writeCount++];
+		*write = (ChunkWrite)
+		{
+			.sector = sector,
+			.sectorCount = (uint32_t)sectorCount,
+			.bytes = bytes,
+			.length = length
+		};
+		OSWriteBigInt32(write->header, 0, (uint32_t)length + 1);
+		write->header[4] = (length >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) ? kChunkCompressionModeGZip : kChunkCompressionModeZLib;
+	}
+	
+	// Write the chunks in file order, so that adjacent ones go out together, then make sure they’re on disk.
+	qsort(writes, writeCount, sizeof *writes, CompareChunkWrites);
+	int writeErrno = 0;
+	BOOL OK = WriteChunks(_fd, writes, writeCount, &writeErrno);
+	if (OK && writeCount != 0 && FullSync(_fd) != 0)
+	{
+		OK = NO;
+		writeErrno = errno;
+	}
+	if (!OK)
+	{
+		if (error != NULL)  *error = POSIXError(writeErrno);
+		return NO;
+	}
+	
+	if (![self writeHeaderWithLocations:locations timestamps:timestamps error:error])  return NO;
+	
+	memcpy(_locations, locations, sizeof locations);
+	memcpy(_timestamps, timestamps, sizeof timestamps);
+	[self rebuildUsedSectorsWithCount:usedSectors.length];
+	[_pending removeAllObjects];
+	
+	return YES;
+}
+
+
+// Write the header to the journal, then to the region, and remove the journal.
+- (BOOL) writeHeaderWithLocations:(const uint32_t *)locations timestamps:(const uint32_t *)timestamps error:(NSError **)error
+{
+	uint8_t bytes[kJournalSize];
+	EncodeHeader(bytes, locations, timestamps);
+	OSWriteBigInt32(bytes, kHeaderSize, (uint32_t)crc32(0, bytes, kHeaderSize));
+	
+	const char *journalPath = self.journalPath.fileSystemRepresentation;
+	int journal = open(journalPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (journal < 0)
+	{
+		if (error != NULL)  *error = POSIXError(errno);
+		return NO;
+	}
+	
+	BOOL OK = write(journal, bytes, kJournalSize) == kJournalSize && FullSync(journal) == 0;
+	int journalErrno = errno;
+	close(journal);
+	if (!OK)
+	{
+		unlink(journalPath);
+		if (error != NULL)  *error = POSIXError(journalErrno);
+		return NO;
+	}
+	
+	// If this fails, the journal is left for the next open to apply.
+	if (pwrite(_fd, bytes, kHeaderSize, 0) != kHeaderSize || FullSync(_fd) != 0)
+	{
+		if (error != NULL)  *error = POSIXError(errno);
+		return NO;
+	}
+	
+	unlink(journalPath);
+	return YES;
+}
+
+@end
+
+
+static NSError *POSIXError(int code)
+{
+	return [NSError errorWithDomain:NSPOSIXErrorDomain code:(code != 0) ? code : EIO userInfo:nil];
+}
+
+
+static int FullSync(int fd)
+{
+#ifdef F_FULLFSYNC
+	// On Darwin, fsync() doesn’t flush the drive’s own cache.
+	if (fcntl(fd, F_FULLFSYNC) == 0)  return 0;
+#endif
+	return fsync(fd);
+}
+
+
+static void EncodeHeader(uint8_t *bytes, const uint32_t *locations, const uint32_t *timestamps)
+{
+	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+	{
+		OSWriteBigInt32(bytes, idx * sizeof (uint32_t), locations[idx]);
+		OSWriteBigInt32(bytes, kHeaderSize / 2 + idx * sizeof (uint32_t), timestamps[idx]);
+	}
+}
+
+
+/*
+	First fit: the lowest run of count free sectors, or the end of the
+	file. The returned sectors are marked as used.
+*/
+static uint32_t AllocateSectors(NSMutableData *usedSectors, uint32_t count)
+{
+	uint8_t *used = usedSectors.mutableBytes;
+	NSUInteger sectorCount = usedSectors.length;
+	
+	NSUInteger runStart = kHeaderSectors, runLength = 0;
+	for (NSUInteger sector = kHeaderSectors; sector < sectorCount && runLength < count; sector++)
+	{
+		if (used[sector])
+		{
+			runStart = sector + 1;
+			runLength = 0;
+		}
+		else
+		{
+			runLength++;
+		}
+	}
+	
+	// A free run at the end of the file can be extended.
+	if (runLength < count)
+	{
+		usedSectors.length = runStart + count;
+		used = usedSectors.mutableBytes;
+	}
+	
+	memset(used + runStart, 1, count);
+	return (uint32_t)runStart;
+}
+
+
+static int CompareChunkWrites(const void *a, const void *b)
+{
+	uint32_t sectorA = ((const ChunkWrite *)a)->sector;
+	uint32_t sectorB = ((const ChunkWrite *)b)->sector;
+	return (sectorA > sectorB) - (sectorA < sectorB);
+}
+
+
+/*
+	Write a run of iovecs at offset, resuming after short writes. pwritev()
+	isn’t available on older systems, so this seeks and uses writev(),
+	which is the same thing for a file only one writer is using.
+*/
+static BOOL WriteVectors(int fd, struct iovec *iov, int iovCount, off_t offset, int *outErrno)
+{
+	if (lseek(fd, offset, SEEK_SET) < 0)
+	{
+		*outErrno = errno;
+		return NO;
+	}
+	
+	while (iovCount > 0)
+	{
+		ssize_t written = writev(fd, iov, iovCount);
+		if (written < 0)
+		{
+			if (errno == EINTR)  continue;
+			*outErrno = errno;
+			return NO;
+		}
+		
+		while (iovCount > 0 && (size_t)written >= iov->iov_len)
+		{
+			written -= iov->iov_len;
+			iov++;
+			iovCount--;
+		}
+		if (iovCount > 0)
+		{
+			iov->iov_base = (uint8_t *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	
+	return YES;
+}
+
+
+/*
+	Write chunks, sorted by sector, each padded to a whole number of sectors.
+	Chunks in adjacent sectors are gathered into a single write.
+*/
+static BOOL WriteChunks(int fd, ChunkWrite *writes, NSUInteger count, int *outErrno)
+{
+	static const uint8_t padding[kSectorSize];
+	struct iovec iov[IOV_MAX];
+	*outErrno = 0;
+	
+	NSUInteger idx = 0;
+	while (idx < count)
+	{
+		off_t offset = (off_t)writes[idx].sector * kSectorSize;
+		uint32_t nextSector = writes[idx].sector;
+		int iovCount = 0;
+		
+		while (idx < count && writes[idx].sector == nextSector && iovCount + 3 <= IOV_MAX)
+		{
+			ChunkWrite *write = &writes[idx++];
+			size_t padLength = (size_t)write->sectorCount * kSectorSize - kChunkHeaderSize - write->length;
+			
+			iov[iovCount++] = (struct iovec){ write->header, kChunkHeaderSize };
+			iov[iovCount++] = (struct iovec){ (void *)write->bytes, write->length };
+			if (padLength != 0)  iov[iovCount++] = (struct iovec){ (void *)padding, padLength };
+			
+			nextSector = write->sector + write->sectorCount;
+		}
+		
+		if (!WriteVectors(fd, iov, iovCount, offset, outErrno))  return NO;
+	}
+	
+	return YES;
+}
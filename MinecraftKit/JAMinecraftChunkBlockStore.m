@@ -106,10 +106,10 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 		return nil;
 	}
 	
-	NSDictionary *schema = GetChunkSchema();
+	JANBTCompiledSchema *schema = GetChunkSchema();
 	NSString *rootName = @"";	// For some reason, chunks have an empty root name and contain a single compound named "Level".
 	
-	NSDictionary *dict = [JANBTSerialization NBTObjectWithData:data rootName:&rootName options:0 schema:schema error:outError];
+	NSDictionary *dict = [JANBTSerialization NBTObjectWithData:data rootName:&rootName options:JANBTReadingOptionsSharedKeyTable schema:schema error:outError];
 	dict = [dict objectForKey:kLevelKey];
 	if (dict == nil)
 	{
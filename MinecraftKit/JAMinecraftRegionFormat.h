@@ -0,0 +1,66 @@
+/*
+	JAMinecraftRegionFormat.h
+	
+	Layout of Minecraft region files (both McRegion and Anvil), shared by the
+	readers, the writer and JAMinecraftRegionManifest. Internal; not part of
+	the public MinecraftKit headers.
+	
+	A region covers 32×32 chunks. It starts with an 8 KiB header of two
+	arrays of kChunksPerRegion big-endian 32-bit entries: locations (a 24-bit
+	offset and an 8-bit count, measured in 4 KiB sectors) and modification
+	times (seconds since 1970). Each chunk starts on a sector boundary with
+	a 5-byte header: a big-endian 32-bit length, which counts the following
+	compression mode byte, and the compression mode.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+
+enum
+{
+	kChunksPerRegionSide			= 32,
+	kChunksPerRegion				= kChunksPerRegionSide * kChunksPerRegionSide,
+	kHeaderBytesPerChunk			= 8,
+	kHeaderSize						= kHeaderBytesPerChunk * kChunksPerRegion,
+	kSectorSize						= 4096,
+	kChunkHeaderSize				= 5
+};
+
+
+enum
+{
+	kChunkCompressionModeGZip		= 1,
+	kChunkCompressionModeZLib		= 2
+};
+
+
+static inline uint16_t ChunkIndexFromLocalCoords(uint16_t x, uint16_t z)
+{
+	return z * kChunksPerRegionSide + x;
+}
+
+
+// Header locations are a 24-bit sector offset and an 8-bit sector count.
+static inline uint32_t LocationOffset(uint32_t location)  { return location >> 8; }
+static inline uint32_t LocationCount(uint32_t location)  { return location & 0xFF; }
@@ -0,0 +1,72 @@
+/*
+	JAMinecraftRegionManifest.h
+	
+	A snapshot of a region file’s header: the location (sector offset and
+	count) and modification time of each chunk. Comparing a manifest saved
+	by an earlier run with one for the current file tells which chunks have
+	changed since, without reading any chunk data.
+	
+	Both location and timestamp are compared. Timestamps only have a
+	resolution of one second, and not every tool that edits regions updates
+	them, but a rewritten chunk is almost always moved.
+	
+	Manifests cover one region. To track a world, save one per region file,
+	for instance under the region’s file name.
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <Foundation/Foundation.h>
+
+
+@interface JAMinecraftRegionManifest: NSObject
+
+// Read the 8 KiB header of a region file, and nothing else.
++ (id) manifestForRegionAtURL:(NSURL *)regionFileURL error:(NSError **)error;
+
+// From a whole region file, or at least its header, already in memory.
+- (id) initWithRegionData:(NSData *)regionData error:(NSError **)error;
+
+// Saved manifests, as written by -writeToURL:error:.
++ (id) manifestWithContentsOfURL:(NSURL *)manifestURL error:(NSError **)error;
+- (id) initWithDataRepresentation:(NSData *)data error:(NSError **)error;
+
+@property (readonly) NSData *dataRepresentation;
+- (BOOL) writeToURL:(NSURL *)manifestURL error:(NSError **)error;
+
+// Chunk coordinates range from 0 to 32 in region-local space.
+- (BOOL) hasChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+- (uint32_t) sectorOffsetOfChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+- (uint8_t) sectorCountOfChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+- (uint32_t) timestampForChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+
+@property (readonly) NSUInteger chunkCount;
+
+/*
+	Call block for each chunk whose location or timestamp differs from
+	previousManifest, including chunks that have been added or removed. If
+	previousManifest is nil, every present chunk is changed.
+*/
+- (void) enumerateChunksChangedSinceManifest:(JAMinecraftRegionManifest *)previousManifest usingBlock:(void (^)(uint8_t localX, uint8_t localZ, BOOL *stop))block;
+- (NSUInteger) countOfChunksChangedSinceManifest:(JAMinecraftRegionManifest *)previousManifest;
+
+@end
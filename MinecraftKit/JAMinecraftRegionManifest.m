@@ -0,0 +1,256 @@
+/*
+	JAMinecraftRegionManifest.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JAMinecraftRegionManifest.h"
+#import "JAMinecraftBlockStore.h"
+#import "JAMinecraftRegionFormat.h"
+#include <fcntl.h>
+
+
+/*
+	Saved manifest format: the magic number and a version, both big-endian
+	32-bit, followed by a copy of the region header as stored in the region.
+*/
+enum
+{
+	kManifestMagic					= 'MCRM',
+	kManifestVersion				= 1,
+	kManifestPreambleSize			= 2 * sizeof (uint32_t),
+	kManifestSize					= kManifestPreambleSize + kHeaderSize
+};
+
+
+static NSError *BlockStoreError(NSInteger code);
+
+
+@implementation JAMinecraftRegionManifest
+{
+	// In host byte order.
+	uint32_t				_locations[kChunksPerRegion];
+	uint32_t				_timestamps[kChunksPerRegion];
+}
+
+
++ (id) manifestForRegionAtURL:(NSURL *)regionFileURL error:(NSError **)error
+{
+	int fd = open(regionFileURL.path.fileSystemRepresentation, O_RDONLY);
+	if (fd < 0)
+	{
+		if (error != NULL)  *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		return nil;
+	}
+	
+	NSMutableData *header = [NSMutableData dataWithLength:kHeaderSize];
+	ssize_t length = pread(fd, header.mutableBytes, kHeaderSize, 0);
+	int readErrno = errno;
+	close(fd);
+	
+	if (length < 0)
+	{
+		if (error != NULL)  *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:readErrno userInfo:nil];
+		return nil;
+	}
+	header.length = (NSUInteger)length;
+	
+	return [[self alloc] initWithRegionData:header error:error];
+}
+
+
+- (id) initWithRegionData:(NSData *)regionData error:(NSError **)error
+{
+	if (regionData == nil)
+	{
+		if (error != NULL)  *error = BlockStoreError(kJABlockStoreErrorNilData);
+		return nil;
+	}
+	if (regionData.length < kHeaderSize)
+	{
+		if (error != NULL)  *error = BlockStoreError(kJABlockStoreErrorTruncatedData);
+		return nil;
+	}
+	
+	if ((self = [super init]))
+	{
+		const uint8_t *header = regionData.bytes;
+		for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+		{
+			_locations[idx] = OSReadBigInt32(header, idx * sizeof (uint32_t));
+			_timestamps[idx] = OSReadBigInt32(header, kHeaderSize / 2 + idx * sizeof (uint32_t));
+		}
+	}
+	
+	return self;
+}
+
+
++ (id) manifestWithContentsOfURL:(NSURL *)manifestURL error:(NSError **)error
+{
+	NSData *data = [NSData dataWithContentsOfURL:manifestURL options:0 error:error];
+	if (data == nil)  return nil;
+	return [[self alloc] initWithDataRepresentation:data error:error];
+}
+
+
+- (id) initWithDataRepresentation:(NSData *)data error:(NSError **)error
+{
+	if (data == nil)
+	{
+		if (error != NULL)  *error = BlockStoreError(kJABlockStoreErrorNilData);
+		return nil;
+	}
+	
+	const uint8_t *bytes = data.bytes;
+	if (data.length < kManifestPreambleSize || OSReadBigInt32(bytes, 0) != kManifestMagic)
+	{
+		if (error != NULL)  *error = BlockStoreError(kJABlockStoreErrorWrongFileFormat);
+		return nil;
+	}
+	if (OSReadBigInt32(bytes, sizeof (uint32_t)) != kManifestVersion)
+	{
+		if (error != NULL)  *error = BlockStoreError(kJABlockStoreErrorUnknownFormatVersion);
+		return nil;
+	}
+	if (data.length < kManifestSize)
+	{
+		if (error != NULL)  *error = BlockStoreError(kJABlockStoreErrorTruncatedData);
+		return nil;
+	}
+	
+	return [self initWithRegionData:[data subdataWithRange:(NSRange){ kManifestPreambleSize, kHeaderSize }] error:error];
+}
+
+
+- (NSData *) dataRepresentation
+{
+	NSMutableData *data = [NSMutableData dataWithLength:kManifestSize];
+	uint8_t *bytes = data.mutableBytes;
+	
+	OSWriteBigInt32(bytes, 0, kManifestMagic);
+	OSWriteBigInt32(bytes, sizeof (uint32_t), kManifestVersion);
+	
+	uint8_t *header = bytes + kManifestPreambleSize;
+	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+	{
+		OSWriteBigInt32(header, idx * sizeof (uint32_t), _locations[idx]);
+		OSWriteBigInt32(header, kHeaderSize / 2 + idx * sizeof (uint32_t), _timestamps[idx]);
+	}
+	
+	return data;
+}
+
+
+- (BOOL) writeToURL:(NSURL *)manifestURL error:(NSError **)error
+{
+	return [self.dataRepresentation writeToURL:manifestURL options:NSDataWritingAtomic error:error];
+}
+
+
+- (BOOL) hasChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	return LocationOffset(_locations[ChunkIndexFromLocalCoords(x, z)]) != 0;
+}
+
+
+- (uint32_t) sectorOffsetOfChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	return LocationOffset(_locations[ChunkIndexFromLocalCoords(x, z)]);
+}
+
+
+- (uint8_t) sectorCountOfChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	return (uint8_t)LocationCount(_locations[ChunkIndexFromLocalCoords(x, z)]);
+}
+
+
+- (uint32_t) timestampForChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z
+{
+	NSParameterAssert(x < kChunksPerRegionSide && z < kChunksPerRegionSide);
+	
+	uint16_t idx = ChunkIndexFromLocalCoords(x, z);
+	return (LocationOffset(_locations[idx]) != 0) ? _timestamps[idx] : 0;
+}
+
+
+- (NSUInteger) chunkCount
+{
+	NSUInteger count = 0;
+	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+	{
+		if (LocationOffset(_locations[idx]) != 0)  count++;
+	}
+	return count;
+}
+
+
+- (BOOL) chunkAtIndex:(NSUInteger)idx differsFromManifest:(JAMinecraftRegionManifest *)other
+{
+	BOOL present = LocationOffset(_locations[idx]) != 0;
+	
+	if (other == nil)  return present;
+	
+	BOOL otherPresent = LocationOffset(other->_locations[idx]) != 0;
+	if (!present && !otherPresent)  return NO;	// Stale timestamps of absent chunks don’t matter.
+	
+	return _locations[idx] != other->_locations[idx] || _timestamps[idx] != other->_timestamps[idx];
+}
+
+
+- (void) enumerateChunksChangedSinceManifest:(JAMinecraftRegionManifest *)previousManifest usingBlock:(void (^)(uint8_t localX, uint8_t localZ, BOOL *stop))block
+{
+	NSParameterAssert(block != nil);
+	
+	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+	{
+		if ([self chunkAtIndex:idx differsFromManifest:previousManifest])
+		{
+			BOOL stop = NO;
+			block((uint8_t)(idx % kChunksPerRegionSide), (uint8_t)(idx / kChunksPerRegionSide), &stop);
+			if (stop)  break;
+		}
+	}
+}
+
+
+- (NSUInteger) countOfChunksChangedSinceManifest:(JAMinecraftRegionManifest *)previousManifest
+{
+	NSUInteger count = 0;
+	for (NSUInteger idx = 0; idx < kChunksPerRegion; idx++)
+	{
+		if ([self chunkAtIndex:idx differsFromManifest:previousManifest])  count++;
+	}
+	return count;
+}
+
+@end
+
+
+static NSError *BlockStoreError(NSInteger code)
+{
+	return [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain code:code userInfo:nil];
+}
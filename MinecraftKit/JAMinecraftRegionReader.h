@@ -32,17 +32,55 @@ NS_ASSUME_NONNULL_BEGIN
 @class JAMinecraftBlockStore;
 
 
+typedef NS_OPTIONS(NSUInteger, JAMinecraftChunkEnumerationOptions)
+{
+	/*
+		Call the block serially, in chunk index order (z major, as in the
+		region header). Chunks are still decoded concurrently, a bounded
+		distance ahead of the one being delivered. Without this option, the
+		block is called concurrently, in whatever order chunks finish.
+	*/
+	JAMinecraftChunkEnumerationOrdered		= 1 << 0
+};
+
+
+/*
+	chunk is nil, and error is usually set, if a present chunk can’t be read.
+	Setting *stop stops the enumeration. In unordered enumerations, calls
+	already in progress on other threads still finish.
+*/
+typedef void (^JAMinecraftChunkEnumerationBlock)(JAMinecraftBlockStore * _Nullable chunk, uint8_t localX, uint8_t localZ, NSError * _Nullable error, BOOL *stop);
+
+
 @protocol JAMinecraftRegionReader <NSObject>
 
 // Chunk coordinates range from 0 to 32 in region-local space.
 - (BOOL) hasChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
 
+// Last modification time from the region header, in seconds since 1970. 0 if the chunk isn’t present.
+- (uint32_t) timestampForChunkAtLocalX:(uint8_t)x localZ:(uint8_t)z;
+
 // Retrieve chunk.
 - (nullable JAMinecraftBlockStore *) chunkAtLocalX:(uint8_t)x localZ:(uint8_t)z error:(NSError **)error;
 
 // Retrieve chunk NBT data.
 - (NSData *) chunkDataAtLocalX:(uint8_t)x localZ:(uint8_t)z error:(NSError **)error;
 
+/*
+	Decode every present chunk on a pool of about one worker per core and
+	pass it to block, on whichever thread decoded it. Absent chunks are
+	skipped. Returns once the block has been called for the last time.
+*/
+- (void) enumerateChunksConcurrentlyWithOptions:(JAMinecraftChunkEnumerationOptions)options usingBlock:(JAMinecraftChunkEnumerationBlock)block;
+
 @end
 
+
+/*
+	Shared implementation of -enumerateChunksConcurrentlyWithOptions:usingBlock:
+	in terms of -hasChunkAtLocalX:localZ: and -chunkAtLocalX:localZ:error:,
+	which must be safe to call from several threads at once.
+*/
+void JAMinecraftEnumerateRegionChunks(id <JAMinecraftRegionReader> reader, JAMinecraftChunkEnumerationOptions options, JAMinecraftChunkEnumerationBlock block);
+
 NS_ASSUME_NONNULL_END
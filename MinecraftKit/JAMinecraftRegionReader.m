@@ -0,0 +1,218 @@
+/*
+	JAMinecraftRegionReader.m
+	
+	
+	Copyright © 2016 Jens Ayton
+	
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+	
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+	
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import "JAMinecraftRegionReader.h"
+#import "JAMinecraftBlockStore.h"
+#import "JAMinecraftRegionFormat.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+
+enum
+{
+	/*
+		In ordered enumerations, workers may run this many chunks per worker
+		ahead of the one being delivered. Without a limit, one slow chunk
+		near the start would leave most of the region decoded and waiting.
+	*/
+	kOrderedLookaheadPerWorker		= 4
+};
+
+
+typedef struct EnumerationState
+{
+	uint16_t				indices[kChunksPerRegion];	// Present chunks, in index order.
+	NSUInteger				count;
+	atomic_uint_fast32_t	nextPosition;				// Next entry in indices to decode.
+	atomic_bool				stop;
+	
+	// Ordered delivery only.
+	pthread_mutex_t			lock;
+	CFTypeRef				chunks[kChunksPerRegion];	// Decoded and waiting, by position in indices.
+	CFTypeRef				errors[kChunksPerRegion];
+	bool					ready[kChunksPerRegion];
+	NSUInteger				nextDelivery;
+	bool					delivering;
+} EnumerationState;
+
+
+static void DeliverOrdered(EnumerationState *state, NSUInteger position, JAMinecraftBlockStore *chunk, NSError *error, JAMinecraftChunkEnumerationBlock block, dispatch_semaphore_t lookahead, NSUInteger workerCount);
+
+
+void JAMinecraftEnumerateRegionChunks(id <JAMinecraftRegionReader> reader, JAMinecraftChunkEnumerationOptions options, JAMinecraftChunkEnumerationBlock block)
+{
+	NSCParameterAssert(reader != nil && block != nil);
+	
+	EnumerationState *state = calloc(1, sizeof *state);
+	if (state == NULL)  return;
+	
+	for (uint16_t index = 0; index < kChunksPerRegion; index++)
+	{
+		if ([reader hasChunkAtLocalX:index % kChunksPerRegionSide localZ:index / kChunksPerRegionSide])
+		{
+			state->indices[state->count++] = index;
+		}
+	}
+	
+	if (state->count == 0)
+	{
+		free(state);
+		return;
+	}
+	
+	BOOL ordered = (options & JAMinecraftChunkEnumerationOrdered) != 0;
+	NSUInteger workerCount = MIN([NSProcessInfo processInfo].activeProcessorCount, state->count);
+	
+	/*
+		In ordered mode, a worker takes a token before claiming a chunk, and
+		the token is returned when that chunk has been delivered. Since
+		chunks are claimed in order, the next chunk to deliver is always held
+		by a worker with a token, so the lookahead can’t stall delivery.
+		
+		The tokens are signalled in rather than passed to
+		dispatch_semaphore_create(), since a stopped enumeration doesn’t
+		return them all and libdispatch traps if a semaphore is released
+		below its initial value.
+	*/
+	dispatch_semaphore_t lookahead = nil;
+	if (ordered)
+	{
+		pthread_mutex_init(&state->lock, NULL);
+		lookahead = dispatch_semaphore_create(0);
+		for (NSUInteger i = 0; i < workerCount * kOrderedLookaheadPerWorker; i++)
+		{
+			dispatch_semaphore_signal(lookahead);
+		}
+	}
+	
+	dispatch_apply(workerCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t worker __unused)
+	{
+		for (;;)
+		{
+			if (ordered)  dispatch_semaphore_wait(lookahead, DISPATCH_TIME_FOREVER);
+			
+			NSUInteger position = atomic_fetch_add_explicit(&state->nextPosition, 1, memory_order_relaxed);
+			if (position >= state->count || atomic_load_explicit(&state->stop, memory_order_relaxed))
+			{
+				// Pass the token on, so a worker still waiting for one can see that there’s nothing left.
+				if (ordered)  dispatch_semaphore_signal(lookahead);
+				break;
+			}
+			
+			uint16_t index = state->indices[position];
+			uint8_t x = index % kChunksPerRegionSide;
+			uint8_t z = index / kChunksPerRegionSide;
+			
+			@autoreleasepool
+			{
+				NSError *error = nil;
+				JAMinecraftBlockStore *chunk = [reader chunkAtLocalX:x localZ:z error:&error];
+				
+				if (ordered)
+				{
+					DeliverOrdered(state, position, chunk, error, block, lookahead, workerCount);
+				}
+				else if (!atomic_load_explicit(&state->stop, memory_order_relaxed))
+				{
+					BOOL stop = NO;
+					block(chunk, x, z, chunk == nil ? error : nil, &stop);
+					if (stop)  atomic_store_explicit(&state->stop, true, memory_order_relaxed);
+				}
+			}
+		}
+	});
+	
+	if (ordered)
+	{
+		// After a stop, chunks decoded ahead of the stopping one are never delivered.
+		for (NSUInteger position = 0; position < state->count; position++)
+		{
+			if (state->chunks[position] != NULL)  CFRelease(state->chunks[position]);
+			if (state->errors[position] != NULL)  CFRelease(state->errors[position]);
+		}
+		pthread_mutex_destroy(&state->lock);
+#if !OS_OBJECT_USE_OBJC
+		dispatch_release(lookahead);
+#endif
+	}
+	
+	free(state);
+}
+
+
+/*
+	Park a decoded chunk, then deliver as many chunks as are ready in order.
+	Only one worker delivers at a time; a worker that finds another
+	delivering leaves its chunk for that one to pick up.
+*/
+static void DeliverOrdered(EnumerationState *state, NSUInteger position, JAMinecraftBlockStore *chunk, NSError *error, JAMinecraftChunkEnumerationBlock block, dispatch_semaphore_t lookahead, NSUInteger workerCount)
+{
+	pthread_mutex_lock(&state->lock);
+	
+	state->chunks[position] = CFBridgingRetain(chunk);
+	state->errors[position] = (chunk == nil) ? CFBridgingRetain(error) : NULL;
+	state->ready[position] = true;
+	
+	if (state->delivering)
+	{
+		pthread_mutex_unlock(&state->lock);
+		return;
+	}
+	state->delivering = true;
+	
+	while (state->nextDelivery < state->count && state->ready[state->nextDelivery] && !atomic_load_explicit(&state->stop, memory_order_relaxed))
+	{
+		NSUInteger next = state->nextDelivery++;
+		JAMinecraftBlockStore *nextChunk = CFBridgingRelease(state->chunks[next]);
+		NSError *nextError = CFBridgingRelease(state->errors[next]);
+		state->chunks[next] = NULL;
+		state->errors[next] = NULL;
+		pthread_mutex_unlock(&state->lock);
+		
+		uint16_t index = state->indices[next];
+		BOOL stop = NO;
+		@autoreleasepool
+		{
+			block(nextChunk, index % kChunksPerRegionSide, index / kChunksPerRegionSide, nextError, &stop);
+		}
+		
+		if (stop)
+		{
+			atomic_store_explicit(&state->stop, true, memory_order_relaxed);
+			
+			// Wake every worker waiting for lookahead, so they see the stop and exit.
+			for (NSUInteger i = 0; i < workerCount; i++)
+			{
+				dispatch_semaphore_signal(lookahead);
+			}
+		}
+		dispatch_semaphore_signal(lookahead);
+		
+		pthread_mutex_lock(&state->lock);
+	}
+	
+	state->delivering = false;
+	pthread_mutex_unlock(&state->lock);
+}
@@ -43,6 +43,9 @@
 - (NSData *) schematicDataWithError:(NSError **)outError;
 - (NSData *) schematicDataForRegion:(MCGridExtents)region withError:(NSError **)outError;
 
+// Write a schematic incrementally; memory use doesn’t grow with the size of the region.
+- (BOOL) writeSchematicForRegion:(MCGridExtents)region toStream:(NSOutputStream *)stream error:(NSError **)outError;
+
 @end
 
 
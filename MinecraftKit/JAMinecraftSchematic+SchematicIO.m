@@ -25,6 +25,7 @@
 
 #import "JAMinecraftSchematic+SchematicIO.h"
 #import <JANBTSerialization/JANBTSerialization.h>
+#import <JANBTSerialization/JANBTStreamWriter.h>
 #import "JACollectionHelpers.h"
 #import "JAPropertyListAccessors.h"
 #import "MCKitSchema.h"
@@ -67,7 +68,7 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 		return nil;
 	}
 	
-	NSDictionary *schema = GetSchematicSchema();
+	JANBTCompiledSchema *schema = GetSchematicSchema();
 	NSString *rootName = kSchematicKey;
 	
 	NSDictionary *dict = [JANBTSerialization NBTObjectWithData:data rootName:&rootName options:0 schema:schema error:outError];
@@ -176,75 +177,121 @@ static id KeyForCoords(NSInteger x, NSInteger y, NSInteger z)
 
 - (NSData *) schematicDataForRegion:(MCGridExtents)region withError:(NSError **)outError
 {
-	NSMutableDictionary *root = [NSMutableDictionary dictionary];
+	// Large schematics are mostly Blocks and Data, which compress well in parallel.
+	JANBTStreamWriter *writer = [[JANBTStreamWriter alloc] initForDataWithOptions:JANBTWritingOptionsParallelCompression schema:GetSchematicSchema() error:outError];
+	if (![self writeSchematicForRegion:region withWriter:writer error:outError])  return nil;
+	return writer.data;
+}
+
+
+- (BOOL) writeSchematicForRegion:(MCGridExtents)region toStream:(NSOutputStream *)stream error:(NSError **)outError
+{
+	JANBTStreamWriter *writer = [[JANBTStreamWriter alloc] initWithStream:stream options:JANBTWritingOptionsParallelCompression schema:GetSchematicSchema() error:outError];
+	return [self writeSchematicForRegion:region withWriter:writer error:outError];
+}
+
+
+/*
+	Blocks and Data are written a layer at a time, in two passes over the
+	region, so the only things held in memory are one layer and the tile
+	entities.
+*/
+- (BOOL) writeSchematicForRegion:(MCGridExtents)region withWriter:(JANBTStreamWriter *)writer error:(NSError **)outError
+{
+	if (writer == nil)  return NO;
 	
 	NSUInteger width = MCGridExtentsWidth(region);
 	NSUInteger length = MCGridExtentsLength(region);
 	NSUInteger height = MCGridExtentsHeight(region);
+	NSInteger groundLevel = self.groundLevel;
 	
-	[root ja_setInteger:width forKey:kWidthKey];
-	[root ja_setInteger:length forKey:kLengthKey];
-	[root ja_setInteger:height forKey:kHeightKey];
-	
-	[root ja_setInteger:self.groundLevel forKey:kGroundLevelKey];
-	[root setObject:kMaterialsAlpha forKey:kMaterialsKey];
+	// Dimensions and ground level are stored as shorts.
+	if (width > INT16_MAX || length > INT16_MAX || height > INT16_MAX || groundLevel < INT16_MIN || groundLevel > INT16_MAX)
+	{
+		if (outError != nil)  *outError = [NSError errorWithDomain:kJAMinecraftBlockStoreErrorDomain
+															  code:kJABlockStoreErrorDocumentTooLarge
+														  userInfo:@{ NSLocalizedFailureReasonErrorKey: NSLocalizedString(@"This document is too large to be stored in schematic format. Schematic format is limited to 32767 blocks in each dimension, and a ground level between -32768 and 32767.", NULL) }];
+		return NO;
+	}
 	
-	NSUInteger planeSize = width * length * height;
-	NSMutableData *blockIDs = [NSMutableData dataWithLength:planeSize];
-	NSMutableData *blockData = [NSMutableData dataWithLength:planeSize];
-	if (blockIDs == nil || blockData == nil)
+	NSUInteger layerSize = width * length;
+	NSMutableData *layer = [NSMutableData dataWithLength:layerSize];
+	if (layer == nil)
 	{
 		if (outError != nil)  *outError = [NSError errorWithDomain:NSOSStatusErrorDomain
 															  code:memFullErr
 														  userInfo:nil];
-		return nil;
+		return NO;
 	}
+	uint8_t *layerBytes = layer.mutableBytes;
 	
-	NSMutableArray *tileEntities = [NSMutableArray array];
+	[writer beginCompoundNamed:kSchematicKey];
+	[writer writeShort:(int16_t)width named:kWidthKey];
+	[writer writeShort:(int16_t)length named:kLengthKey];
+	[writer writeShort:(int16_t)height named:kHeightKey];
+	[writer writeShort:(int16_t)groundLevel named:kGroundLevelKey];
+	[writer writeString:kMaterialsAlpha named:kMaterialsKey];
 	
-	uint8_t *blockBytes = blockIDs.mutableBytes;
-	uint8_t *metaBytes = blockData.mutableBytes;
+	NSMutableArray *tileEntities = [NSMutableArray array];
 	
-	MCGridCoordinates location;
-	for (location.y = region.minY; location.y <= region.maxY; location.y++)
+	for (unsigned pass = 0; pass < 2 && writer.error == nil; pass++)
 	{
-		for (location.z = region.minZ; location.z <= region.maxZ; location.z++)
+		BOOL blocks = (pass == 0);
+		[writer beginByteArrayNamed:blocks ? kBlocksKey : kDataKey length:layerSize * height];
+		
+		MCGridCoordinates location;
+		for (location.y = region.minY; location.y <= region.maxY; location.y++)
 		{
-			for (location.x = region.minX; location.x <= region.maxX; location.x++)
+			uint8_t *next = layerBytes;
+			for (location.z = region.minZ; location.z <= region.maxZ; location.z++)
 			{
-				__autoreleasing NSDictionary *tileEntity;
-				MCCell cell = [self cellAt:location gettingTileEntity:&tileEntity];
-				*blockBytes++ = cell.blockID;
-				*metaBytes++ = cell.blockData & kMCInfoStandardBitsMask;
-				
-				if (tileEntity != nil)
+				for (location.x = region.minX; location.x <= region.maxX; location.x++)
 				{
-					@autoreleasepool
+					__autoreleasing NSDictionary *tileEntity;
+					MCCell cell = [self cellAt:location gettingTileEntity:blocks ? &tileEntity : NULL];
+					
+					if (blocks)
 					{
-						NSMutableDictionary *mutableEntity = [tileEntity mutableCopy];
-						[mutableEntity ja_setInteger:location.x forKey:@"x"];
-						[mutableEntity ja_setInteger:location.y forKey:@"y"];
-						[mutableEntity ja_setInteger:location.z forKey:@"z"];
+						*next++ = cell.blockID;
 						
-						[tileEntities addObject:mutableEntity];
+						if (tileEntity != nil)
+						{
+							@autoreleasepool
+							{
+								NSMutableDictionary *mutableEntity = [tileEntity mutableCopy];
+								[mutableEntity ja_setInteger:location.x forKey:@"x"];
+								[mutableEntity ja_setInteger:location.y forKey:@"y"];
+								[mutableEntity ja_setInteger:location.z forKey:@"z"];
+								
+								[tileEntities addObject:mutableEntity];
+							}
+						}
+					}
+					else
+					{
+						*next++ = cell.blockData & kMCInfoStandardBitsMask;
 					}
 				}
 			}
+			
+			if (![writer writeByteArrayChunk:layerBytes length:layerSize])  break;
 		}
 	}
 	
-	[root setObject:blockIDs forKey:kBlocksKey];
-	[root setObject:blockData forKey:kDataKey];
-	[root setObject:tileEntities forKey:kTileEntitiesKey];
-	[root setObject:[NSArray array] forKey:kEntitiesKey];
+	[writer beginListNamed:kEntitiesKey count:0];
+	[writer endList];
+	
+	[writer beginListNamed:kTileEntitiesKey count:tileEntities.count];
+	for (NSDictionary *tileEntity in tileEntities)
+	{
+		[writer writeObject:tileEntity named:nil];
+	}
+	[writer endList];
 	
-	NSDictionary *schema = GetSchematicSchema();
+	[writer endCompound];
 	
-	return [JANBTSerialization dataWithNBTObject:root
-										rootName:kSchematicKey
-										 options:0
-										  schema:schema
-										   error:outError];
+	// Errors stick, so checking once at the end is enough.
+	return [writer finishWithError:outError];
 }
 
 @end
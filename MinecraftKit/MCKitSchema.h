@@ -3,48 +3,49 @@
 	property list files inside the framework. In libminecraftkit, schemata
 	are instead compiled into the code as binary plists. This file provides
 	uniform access to both representations.
+
+	Schemata are loaded and compiled once, on first use, and cached for the
+	life of the process. The accessors are cheap and may be called from any
+	thread.
 */
 
-#if MCKIT_STATIC
+#import <JANBTSerialization/JANBTSerialization.h>
 
-#import "SchematicSchema.h"
-#import "DataSchema.h"
-#import "ChunkSchema.h"
-#import "AnvilChunkSchema.h"
-#import "BlockDescriptions.h"
 
-#else
-#import "JAMinecraftBlock.h"
+// Returns nil if the schema doesn’t exist or is invalid.
+JANBTCompiledSchema *MCKitGetNamedSchema(NSString *name);
+
 
-static inline id GetNamedSchema(NSString *name)
+static inline JANBTCompiledSchema *GetSchematicSchema(void)
 {
-	return [NSDictionary dictionaryWithContentsOfURL:[[NSBundle bundleForClass:[JAMinecraftBlock class]] URLForResource:name withExtension:@"schema"]];
+	return MCKitGetNamedSchema(@"Schematic");
 }
 
 
-static inline id GetSchematicSchema(void)
+static inline JANBTCompiledSchema *GetDataSchema(void)
 {
-	return GetNamedSchema(@"Schematic");
+	return MCKitGetNamedSchema(@"Data");
 }
 
 
-static inline id GetDataSchema(void)
+static inline JANBTCompiledSchema *GetChunkSchema(void)
 {
-	return GetNamedSchema(@"Data");
+	return MCKitGetNamedSchema(@"Chunk");
 }
 
 
-static inline id GetChunkSchema(void)
+static inline JANBTCompiledSchema *GetAnvilChunkSchema(void)
 {
-	return GetNamedSchema(@"Chunk");
+	return MCKitGetNamedSchema(@"AnvilChunk");
 }
 
 
-static inline id GetAnvilChunkSchema(void)
-{
-	return GetNamedSchema(@"AnvilChunk");
-}
+#if MCKIT_STATIC
+
+#import "BlockDescriptions.h"
 
+#else
+#import "JAMinecraftBlock.h"
 
 static inline id GetBlockDescriptions(void)
 {
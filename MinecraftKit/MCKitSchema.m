@@ -0,0 +1,87 @@
+/*
+	MCKitSchema.m
+
+
+	Copyright © 2016 Jens Ayton
+
+	Permission is hereby granted, free of charge, to any person obtaining a
+	copy of this software and associated documentation files (the “Software”),
+	to deal in the Software without restriction, including without limitation
+	the rights to use, copy, modify, merge, publish, distribute, sublicense,
+	and/or sell copies of the Software, and to permit persons to whom the
+	Software is furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in
+	all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+	THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+	DEALINGS IN THE SOFTWARE.
+*/
+
+#import <JANBTSerialization/JANBTSerialization.h>
+
+/*
+	MCKitSchema.h can’t be imported here in libminecraftkit, because the
+	generated headers define property list accessors with the same names as
+	its compiled schema accessors.
+*/
+#if MCKIT_STATIC
+#import "SchematicSchema.h"
+#import "DataSchema.h"
+#import "ChunkSchema.h"
+#import "AnvilChunkSchema.h"
+#else
+#import "JAMinecraftBlock.h"
+#endif
+
+
+JANBTCompiledSchema *MCKitGetNamedSchema(NSString *name);
+
+
+static id LoadSchemaPropertyList(NSString *name)
+{
+#if MCKIT_STATIC
+	if ([name isEqualToString:@"Schematic"])  return GetSchematicSchema();
+	if ([name isEqualToString:@"Data"])  return GetDataSchema();
+	if ([name isEqualToString:@"Chunk"])  return GetChunkSchema();
+	if ([name isEqualToString:@"AnvilChunk"])  return GetAnvilChunkSchema();
+	return nil;
+#else
+	return [NSDictionary dictionaryWithContentsOfURL:[[NSBundle bundleForClass:[JAMinecraftBlock class]] URLForResource:name withExtension:@"schema"]];
+#endif
+}
+
+
+JANBTCompiledSchema *MCKitGetNamedSchema(NSString *name)
+{
+	static NSMutableDictionary *sRegistry;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sRegistry = [NSMutableDictionary new];
+	});
+
+	@synchronized (sRegistry)
+	{
+		JANBTCompiledSchema *result = sRegistry[name];
+		if (result == nil)
+		{
+			id propertyList = LoadSchemaPropertyList(name);
+			if (propertyList == nil)  return nil;
+
+			NSError *error;
+			result = [JANBTCompiledSchema compiledSchemaWithPropertyList:propertyList error:&error];
+			if (result == nil)
+			{
+				NSLog(@"Could not compile %@ schema: %@", name, error.localizedDescription);
+				return nil;
+			}
+			sRegistry[name] = result;
+		}
+		return result;
+	}
+}
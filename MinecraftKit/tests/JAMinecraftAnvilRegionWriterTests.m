@@ -0,0 +1,159 @@
+#import <XCTest/XCTest.h>
+
+#import "JAMinecraftAnvilRegionWriter.h"
+#import "JAMinecraftAnvilRegionReader.h"
+#include <zlib.h>
+
+@interface JAMinecraftAnvilRegionWriterTests : XCTestCase
+
+@end
+
+
+enum
+{
+	kSectorSize = 4096,
+	kChunkHeaderSize = 5,
+	kHeaderSize = 2 * kSectorSize
+};
+
+
+@implementation JAMinecraftAnvilRegionWriterTests
+{
+	NSURL *_directory;
+}
+
+- (void)setUp
+{
+	[super setUp];
+	
+	NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+	_directory = [NSURL fileURLWithPath:path isDirectory:YES];
+	[[NSFileManager defaultManager] createDirectoryAtURL:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+}
+
+- (void)tearDown
+{
+	[[NSFileManager defaultManager] removeItemAtURL:_directory error:NULL];
+	[super tearDown];
+}
+
+// Stand-in chunk payload. Only the first two bytes are looked at, to tell gzip from zlib.
+- (NSData *)chunkDataOfLength:(NSUInteger)length seed:(uint8_t)seed
+{
+	NSMutableData *data = [NSMutableData dataWithLength:length];
+	uint8_t *bytes = data.mutableBytes;
+	for (NSUInteger i = 0; i < length; i++)  bytes[i] = (uint8_t)(i * 31 + seed);
+	bytes[0] = 0x78;
+	return data;
+}
+
+- (void)testWriteAndReadBack
+{
+	NSURL *regionURL = [_directory URLByAppendingPathComponent:@"r.0.0.mca"];
+	NSError *error;
+	JAMinecraftAnvilRegionWriter *writer = [JAMinecraftAnvilRegionWriter regionWriterWithURL:regionURL error:&error];
+	XCTAssertNotNil(writer, @"%@", error);
+	
+	// The last chunk exactly fills its sector and ends the file.
+	NSData *small = [self chunkDataOfLength:100 seed:1];
+	NSData *large = [self chunkDataOfLength:3 * kSectorSize seed:2];
+	NSData *exact = [self chunkDataOfLength:kSectorSize - kChunkHeaderSize seed:3];
+	[writer setChunkData:small timestamp:1000 atLocalX:0 localZ:0];
+	[writer setChunkData:large timestamp:2000 atLocalX:5 localZ:7];
+	[writer setChunkData:exact timestamp:3000 atLocalX:31 localZ:31];
+	XCTAssertTrue([writer commitWithError:&error], @"%@", error);
+	
+	NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:regionURL.path error:NULL];
+	XCTAssertEqual(attributes.fileSize, (unsigned long long)(kHeaderSize + 6 * kSectorSize));
+	
+	JAMinecraftAnvilRegionReader *reader = [JAMinecraftAnvilRegionReader regionReaderWithURL:regionURL];
+	XCTAssertNotNil(reader);
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:0 localZ:0 error:&error], small);
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:5 localZ:7 error:&error], large);
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:31 localZ:31 error:&error], exact);
+	XCTAssertFalse([reader hasChunkAtLocalX:1 localZ:0]);
+	XCTAssertEqual([reader timestampForChunkAtLocalX:5 localZ:7], (uint32_t)2000);
+	
+	// Writing back what was read leaves the chunk unchanged, however often it’s done.
+	for (int i = 0; i < 3; i++)
+	{
+		writer = [JAMinecraftAnvilRegionWriter regionWriterWithURL:regionURL error:&error];
+		[writer setChunkData:[reader chunkDataAtLocalX:0 localZ:0 error:&error] timestamp:1000 atLocalX:0 localZ:0];
+		XCTAssertTrue([writer commitWithError:&error], @"%@", error);
+		reader = [JAMinecraftAnvilRegionReader regionReaderWithURL:regionURL];
+	}
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:0 localZ:0 error:&error], small);
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:31 localZ:31 error:&error], exact);
+	
+	// Removal.
+	writer = [JAMinecraftAnvilRegionWriter regionWriterWithURL:regionURL error:&error];
+	[writer removeChunkAtLocalX:5 localZ:7];
+	XCTAssertFalse([writer hasChunkAtLocalX:5 localZ:7]);
+	XCTAssertTrue([writer commitWithError:&error], @"%@", error);
+	reader = [JAMinecraftAnvilRegionReader regionReaderWithURL:regionURL];
+	XCTAssertFalse([reader hasChunkAtLocalX:5 localZ:7]);
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:31 localZ:31 error:&error], exact);
+}
+
+/*
+	Simulate a crash after the journal was synced but before the region’s
+	header was replaced: the region has the new chunk’s data but its old
+	header, and the journal holds the new header.
+*/
+- (void)testJournalReplay
+{
+	NSURL *regionURL = [_directory URLByAppendingPathComponent:@"r.0.0.mca"];
+	NSURL *updatedURL = [_directory URLByAppendingPathComponent:@"updated.mca"];
+	NSURL *journalURL = [_directory URLByAppendingPathComponent:@"r.0.0.mca.journal"];
+	NSFileManager *fileManager = [NSFileManager defaultManager];
+	NSError *error;
+	
+	NSData *first = [self chunkDataOfLength:500 seed:4];
+	NSData *second = [self chunkDataOfLength:700 seed:5];
+	JAMinecraftAnvilRegionWriter *writer = [JAMinecraftAnvilRegionWriter regionWriterWithURL:regionURL error:&error];
+	[writer setChunkData:first timestamp:1000 atLocalX:0 localZ:0];
+	XCTAssertTrue([writer commitWithError:&error], @"%@", error);
+	writer = nil;
+	NSData *oldHeader = [[NSData dataWithContentsOfURL:regionURL] subdataWithRange:NSMakeRange(0, kHeaderSize)];
+	
+	XCTAssertTrue([fileManager copyItemAtURL:regionURL toURL:updatedURL error:&error], @"%@", error);
+	writer = [JAMinecraftAnvilRegionWriter regionWriterWithURL:updatedURL error:&error];
+	[writer setChunkData:second timestamp:2000 atLocalX:1 localZ:0];
+	XCTAssertTrue([writer commitWithError:&error], @"%@", error);
+	writer = nil;
+	
+	NSMutableData *crashed = [[NSData dataWithContentsOfURL:updatedURL] mutableCopy];
+	NSMutableData *journal = [[crashed subdataWithRange:NSMakeRange(0, kHeaderSize)] mutableCopy];
+	uint32_t checksum = OSSwapHostToBigInt32((uint32_t)crc32(0, journal.bytes, kHeaderSize));
+	[journal appendBytes:&checksum length:sizeof checksum];
+	[crashed replaceBytesInRange:NSMakeRange(0, kHeaderSize) withBytes:oldHeader.bytes];
+	XCTAssertTrue([crashed writeToURL:regionURL atomically:NO]);
+	XCTAssertTrue([journal writeToURL:journalURL atomically:NO]);
+	
+	XCTAssertFalse([[JAMinecraftAnvilRegionReader regionReaderWithURL:regionURL] hasChunkAtLocalX:1 localZ:0]);
+	
+	// Opening for writing applies the journal.
+	writer = [JAMinecraftAnvilRegionWriter regionWriterWithURL:regionURL error:&error];
+	XCTAssertNotNil(writer, @"%@", error);
+	XCTAssertTrue([writer hasChunkAtLocalX:1 localZ:0]);
+	XCTAssertFalse([fileManager fileExistsAtPath:journalURL.path]);
+	writer = nil;
+	
+	JAMinecraftAnvilRegionReader *reader = [JAMinecraftAnvilRegionReader regionReaderWithURL:regionURL];
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:0 localZ:0 error:&error], first);
+	XCTAssertEqualObjects([reader chunkDataAtLocalX:1 localZ:0 error:&error], second);
+	XCTAssertEqual([reader timestampForChunkAtLocalX:1 localZ:0], (uint32_t)2000);
+	
+	// A torn journal is discarded, and the region’s own header is kept.
+	XCTAssertTrue([crashed writeToURL:regionURL atomically:NO]);
+	[journal replaceBytesInRange:NSMakeRange(kHeaderSize, sizeof checksum) withBytes:&(uint32_t){ ~checksum }];
+	XCTAssertTrue([journal writeToURL:journalURL atomically:NO]);
+	
+	writer = [JAMinecraftAnvilRegionWriter regionWriterWithURL:regionURL error:&error];
+	XCTAssertNotNil(writer, @"%@", error);
+	XCTAssertFalse([writer hasChunkAtLocalX:1 localZ:0]);
+	XCTAssertTrue([writer hasChunkAtLocalX:0 localZ:0]);
+	XCTAssertFalse([fileManager fileExistsAtPath:journalURL.path]);
+}
+
+@end
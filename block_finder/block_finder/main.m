@@ -129,6 +129,9 @@ static void AnalyzeRegion(NSURL *regionURL)
 		Fatal(@"Could not read region file %@.", regionURL.lastPathComponent);
 	}
 	
+	// Only TerrainPopulated is needed; skip parsing entities, height maps, light and so forth.
+	NSSet *metadataKeys = [NSSet setWithObject:@"TerrainPopulated"];
+	
 	for (uint8_t x = 0; x < 32; x++)
 	{
 		for (uint8_t z = 0; z < 32; z++)
@@ -138,7 +141,7 @@ static void AnalyzeRegion(NSURL *regionURL)
 				if (![region hasChunkAtLocalX:x localZ:z])  continue;
 				
 				NSError *error;
-				JAMinecraftAnvilChunkBlockStore *chunk = [region chunkAtLocalX:x localZ:z error:&error];
+				JAMinecraftAnvilChunkBlockStore *chunk = [region chunkAtLocalX:x localZ:z metadataKeys:metadataKeys error:&error];
 				if (chunk == nil)
 				{
 					Fatal(@"Failed to read a chunk. %@\n", error);
@@ -35,8 +35,8 @@
 
 static void PrintHelpAndExit(void) __attribute__((noreturn));
 
-static void DumpRegionInfo(id<JAMinecraftRegionReader> reader);
-static void DumpChunkInfo(NSData *chunkData);
+static void DumpRegionInfo(id<JAMinecraftRegionReader> reader, JANBTReadingContext *context);
+static void DumpChunkInfo(NSData *chunkData, JANBTReadingContext *context);
 static void DumpEntities(NSArray *entities);
 static void DumpTileEntities(NSArray *entities);
 
@@ -50,6 +50,9 @@ int main (int argc, const char * argv[])
 			PrintHelpAndExit();
 		}
 		
+		// Chunks are read one after another, so they can share inflate state and output size history.
+		JANBTReadingContext *context = [JANBTReadingContext new];
+		
 		for (int argi = 1; argi < argc; argi++)
 		{
 			NSString *inputPath = RealPathFromCString(argv[argi]);
@@ -77,7 +80,7 @@ int main (int argc, const char * argv[])
 			{
 				Print(@"\nRegion %@:\n", [inputPath lastPathComponent]);
 			}
-			DumpRegionInfo(reader);
+			DumpRegionInfo(reader, context);
 		}
 	}
 	
@@ -86,7 +89,7 @@ int main (int argc, const char * argv[])
 }
 
 
-static void DumpRegionInfo(id<JAMinecraftRegionReader> reader)
+static void DumpRegionInfo(id<JAMinecraftRegionReader> reader, JANBTReadingContext *context)
 {
 	for (unsigned x = 0; x < 32; x++)
 	{
@@ -100,7 +103,7 @@ static void DumpRegionInfo(id<JAMinecraftRegionReader> reader)
 				if (chunkData != nil)
 				{
 					Print(@"\n");
-					DumpChunkInfo(chunkData);
+					DumpChunkInfo(chunkData, context);
 				}
 				else
 				{
@@ -116,10 +119,10 @@ static void DumpRegionInfo(id<JAMinecraftRegionReader> reader)
 }
 
 
-static void DumpChunkInfo(NSData *chunkData)
+static void DumpChunkInfo(NSData *chunkData, JANBTReadingContext *context)
 {
 	NSError *error;
-	NSDictionary *root = [JANBTSerialization NBTObjectWithData:chunkData rootName:nil options:0 schema:nil error:&error];
+	NSDictionary *root = [context NBTObjectWithData:chunkData rootName:nil options:JANBTReadingOptionsSharedKeyTable schema:nil error:&error];
 	if (root == nil)
 	{
 		Print(@"  ERROR PARSING CHUNK: %@\n", error);
@@ -159,6 +159,9 @@ static JATerrainStatistics *AnalyzeRegion(NSURL *regionURL)
 	JATerrainStatistics *regionStatistics = [JATerrainStatistics new];
 	[regionStatistics incrementRegionCount];
 	
+	// Only TerrainPopulated is needed; skip parsing entities, height maps, light and so forth.
+	NSSet *metadataKeys = [NSSet setWithObject:@"TerrainPopulated"];
+	
 	for (uint8_t x = 0; x < 32; x++)
 	{
 		for (uint8_t z = 0; z < 32; z++)
@@ -166,7 +169,7 @@ static JATerrainStatistics *AnalyzeRegion(NSURL *regionURL)
 			@autoreleasepool
 			{
 				NSError *error;
-				JAMinecraftAnvilChunkBlockStore *chunk = [region chunkAtLocalX:x localZ:z error:&error];
+				JAMinecraftAnvilChunkBlockStore *chunk = [region chunkAtLocalX:x localZ:z metadataKeys:metadataKeys error:&error];
 				if (chunk == nil)
 				{
 					Fatal(@"Failed to read a chunk. %@\n", error);